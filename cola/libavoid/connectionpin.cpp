@@ -117,7 +117,7 @@ void ShapeConnectionPin::commonInitForShapeConnection(void)
     // Create a visibility vertex for this ShapeConnectionPin.
     VertID id(m_shape->id(), kShapeConnectionPin, 
             VertID::PROP_ConnPoint | VertID::PROP_ConnectionPin);
-    m_vertex = new VertInf(m_router, id, this->position());
+    m_vertex = new (m_router) VertInf(m_router, id, this->position());
     m_vertex->visDirections = this->directions();
     
     if (m_vertex->visDirections == ConnDirAll)
@@ -158,7 +158,7 @@ ShapeConnectionPin::ShapeConnectionPin(JunctionRef *junction,
     //     break rubber-band routing.
     VertID id(m_junction->id(), kShapeConnectionPin, 
             VertID::PROP_ConnPoint | VertID::PROP_ConnectionPin);
-    m_vertex = new VertInf(m_router, id, m_junction->position());
+    m_vertex = new (m_router) VertInf(m_router, id, m_junction->position());
     m_vertex->visDirections = visDirs;
 
     if (m_router->m_allows_polyline_routing)
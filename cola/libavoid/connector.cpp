@@ -39,6 +39,7 @@
 #include "libavoid/assertions.h"
 #include "libavoid/junction.h"
 #include "libavoid/makepath.h"
+#include "libavoid/routecache.h"
 #include "libavoid/debughandler.h"
 
 
@@ -62,7 +63,9 @@ ConnRef::ConnRef(Router *router, const unsigned int id)
       m_callback_func(nullptr),
       m_connector(nullptr),
       m_src_connend(nullptr),
-      m_dst_connend(nullptr)
+      m_dst_connend(nullptr),
+      m_incremental_search(nullptr),
+      m_route_cache(nullptr)
 {
     COLA_ASSERT(m_router != nullptr);
     m_id = m_router->assignId(id);
@@ -91,7 +94,9 @@ ConnRef::ConnRef(Router *router, const ConnEnd& src, const ConnEnd& dst,
       m_callback_func(nullptr),
       m_connector(nullptr),
       m_src_connend(nullptr),
-      m_dst_connend(nullptr)
+      m_dst_connend(nullptr),
+      m_incremental_search(nullptr),
+      m_route_cache(nullptr)
 {
     COLA_ASSERT(m_router != nullptr);
     m_id = m_router->assignId(id);
@@ -121,6 +126,9 @@ ConnRef::~ConnRef()
 
     freeRoutes();
 
+    delete m_incremental_search;
+    delete m_route_cache;
+
     if (m_src_vert)
     {
         m_src_vert->removeFromGraph();
@@ -210,7 +218,8 @@ void ConnRef::setRoutingCheckpoints(const std::vector<Checkpoint>& checkpoints)
     {
         VertID ptID(m_id, 2 + i, 
                 VertID::PROP_ConnPoint | VertID::PROP_ConnCheckpoint);
-        VertInf *vertex = new VertInf(m_router, ptID, m_checkpoints[i].point);
+        VertInf *vertex = new (m_router) VertInf(m_router,
+                ptID, m_checkpoints[i].point);
         vertex->visDirections = ConnDirAll;
 
         m_checkpoint_vertices.push_back(vertex);
@@ -258,7 +267,7 @@ void ConnRef::common_updateEndPoint(const unsigned int type, ConnEnd connEnd)
         }
         else
         {
-            m_src_vert = new VertInf(m_router, ptID, point);
+            m_src_vert = new (m_router) VertInf(m_router, ptID, point);
         }
         m_src_vert->visDirections = connEnd.directions();
 
@@ -288,7 +297,7 @@ void ConnRef::common_updateEndPoint(const unsigned int type, ConnEnd connEnd)
         }
         else
         {
-            m_dst_vert = new VertInf(m_router, ptID, point);
+            m_dst_vert = new (m_router) VertInf(m_router, ptID, point);
         }
         m_dst_vert->visDirections = connEnd.directions();
         
@@ -317,6 +326,12 @@ void ConnRef::common_updateEndPoint(const unsigned int type, ConnEnd connEnd)
 
     makePathInvalid();
     m_router->setStaticGraphInvalidated(true);
+
+    if (m_route_cache)
+    {
+        // The previous route was found for the old endpoint.
+        m_route_cache->clear();
+    }
 }
 
 
@@ -536,7 +551,7 @@ bool ConnRef::setEndpoint(const unsigned int type, const VertID& pointID,
     common_updateEndPoint(type, point);
 
     // Give this visibility just to the point it is over.
-    EdgeInf *edge = new EdgeInf(
+    EdgeInf *edge = new (m_router) EdgeInf(
             (type == VertID::src) ? m_src_vert : m_dst_vert, vInf);
     // XXX: We should be able to set this to zero, but can't due to 
     //      assumptions elsewhere in the code.
@@ -978,6 +993,136 @@ bool ConnRef::generatePath(void)
         generateCheckpointsPath(path, vertices);
     }
 
+    setGeneratedPath(path, vertices, isDummyAtEnd);
+    return true;
+}
+
+
+// Returns whether the route search for this connector can be performed 
+// with AStarPath::searchIsolated(), and hence concurrently with the 
+// searches for other such connectors.  This is not the case for connectors
+// attached to connection pins or junctions, since these temporarily add 
+// edges to the visibility graph and depend on the exclusive pins assigned
+// to earlier connectors, nor for connectors with checkpoints or when 
+// doing rubber-band routing.
+//
+bool ConnRef::canSearchPathInIsolation(void) const
+{
+    if ((!m_false_path && !m_needs_reroute_flag) || 
+            !m_dst_vert || !m_src_vert)
+    {
+        // No path will be generated for this connector.
+        return false;
+    }
+    if (m_router->RubberBandRouting || !m_checkpoints.empty())
+    {
+        return false;
+    }
+    if ((m_src_connend && m_src_connend->isPinConnection()) ||
+            (m_dst_connend && m_dst_connend->isPinConnection()))
+    {
+        return false;
+    }
+    return true;
+}
+
+
+// Returns whether this connector needs rerouting, but has a previous route 
+// that still starts and ends at its endpoints and so could be kept until a
+// later transaction.  This is used when a transaction runs out of time.
+//
+bool ConnRef::canKeepPreviousRoute(void) const
+{
+    if ((!m_false_path && !m_needs_reroute_flag) || 
+            !m_dst_vert || !m_src_vert)
+    {
+        // No path will be generated for this connector.
+        return false;
+    }
+    if (m_route.empty())
+    {
+        return false;
+    }
+    return (m_route.ps.front() == m_src_vert->point) &&
+            (m_route.ps.back() == m_dst_vert->point);
+}
+
+
+// Equivalent to generatePath(), but uses searchedPath, the result of an 
+// earlier call to AStarPath::searchIsolated() for this connector, rather
+// than performing the search.
+//
+bool ConnRef::generatePathFromIsolatedSearch(
+        const std::vector<VertInf *>& searchedPath)
+{
+    COLA_ASSERT(canSearchPathInIsolation());
+
+    m_false_path = false;
+    m_needs_reroute_flag = false;
+
+    m_start_vert = m_src_vert;
+
+    std::vector<Point> path;
+    std::vector<VertInf *> vertices;
+    generateStandardPath(path, vertices, &searchedPath);
+
+    setGeneratedPath(path, vertices, std::make_pair(false, false));
+    return true;
+}
+
+
+// Equivalent to generatePath(), but searches for the path with the 
+// connector's IncrementalPathSearch, which repairs its previous search 
+// where possible.
+//
+bool ConnRef::generatePathIncrementally(void)
+{
+    COLA_ASSERT(canSearchPathInIsolation());
+
+    if (m_incremental_search == nullptr)
+    {
+        m_incremental_search = new IncrementalPathSearch();
+    }
+    std::vector<VertInf *> searchedPath;
+    if (!m_incremental_search->search(this, searchedPath))
+    {
+        return generatePath();
+    }
+    return generatePathFromIsolatedSearch(searchedPath);
+}
+
+
+// Equivalent to generatePath(), but uses route, found for this connector
+// by TiledOrthogonalRouting within a tile of the diagram.
+//
+bool ConnRef::generatePathFromTile(const PolyLine& route)
+{
+    COLA_ASSERT(m_type == ConnType_Orthogonal);
+
+    // As with other orthogonal routes, the connector will be rerouted in 
+    // the next transaction.
+    m_false_path = true;
+    m_needs_reroute_flag = false;
+
+    m_start_vert = m_src_vert;
+
+    freeRoutes();
+    m_route.ps = route.ps;
+
+#ifdef DEBUGHANDLER
+    if (m_router->debugHandler())
+    {
+        m_router->debugHandler()->updateConnectorRoute(this, -1, -1);
+    }
+#endif
+    return true;
+}
+
+
+void ConnRef::setGeneratedPath(std::vector<Point>& path,
+        std::vector<VertInf *>& vertices, 
+        const std::pair<bool, bool>& isDummyAtEnd)
+{
     COLA_ASSERT(vertices.size() >= 2);
     COLA_ASSERT(vertices[0] == src());
     COLA_ASSERT(vertices[vertices.size() - 1] == dst());
@@ -1052,8 +1197,6 @@ bool ConnRef::generatePath(void)
         m_router->debugHandler()->updateConnectorRoute(this, -1, -1);
     }
 #endif
-
-    return true;
 }
 
 void ConnRef::generateCheckpointsPath(std::vector<Point>& path,
@@ -1160,8 +1303,12 @@ void ConnRef::generateCheckpointsPath(std::vector<Point>& path,
 }
 
 
+// If searchedPath is given, it is used as the result of the search rather
+// than performing the search here.
+//
 void ConnRef::generateStandardPath(std::vector<Point>& path,
-        std::vector<VertInf *>& vertices)
+        std::vector<VertInf *>& vertices, 
+        const std::vector<VertInf *> *searchedPath)
 {
     VertInf *tar = m_dst_vert;
     size_t existingPathStart = 0;
@@ -1199,7 +1346,12 @@ void ConnRef::generateStandardPath(std::vector<Point>& path,
     //db_printf("GO\n");
     //db_printf("src: %X strt: %X dst: %X\n", (int) m_src_vert, (int) m_start_vert, (int) m_dst_vert);
     unsigned int pathlen = 0;
-    while (pathlen == 0)
+    if (searchedPath)
+    {
+        COLA_ASSERT(existingPathStart == 0);
+        pathlen = static_cast<unsigned int>(searchedPath->size());
+    }
+    while (!searchedPath && (pathlen == 0))
     {
         AStarPath aStar;
         aStar.search(this, src(), dst(), start());
@@ -1271,6 +1423,7 @@ void ConnRef::generateStandardPath(std::vector<Point>& path,
         m_needs_reroute_flag = true;
         pathlen = 2;
         tar->pathNext = m_src_vert;
+        searchedPath = nullptr;
         if ((m_type == ConnType_PolyLine) && m_router->InvisibilityGrph)
         {
             // TODO:  Could we know this edge already?
@@ -1282,6 +1435,26 @@ void ConnRef::generateStandardPath(std::vector<Point>& path,
     path.resize(pathlen);
     vertices.resize(pathlen);
 
+    if (searchedPath)
+    {
+        for (unsigned int j = 0; j < pathlen; ++j)
+        {
+            VertInf *i = (*searchedPath)[j];
+            if (j > 0)
+            {
+                // Leave the pathNext links as a normal search would.
+                i->pathNext = (*searchedPath)[j - 1];
+            }
+            path[j] = i->point;
+            vertices[j] = i;
+            path[j].id = i->id.objID;
+            path[j].vn = i->id.vn;
+        }
+        COLA_ASSERT(vertices[0] == m_src_vert);
+        COLA_ASSERT(vertices[pathlen - 1] == tar);
+        return;
+    }
+
     unsigned int j = pathlen - 1;
     for (VertInf *i = tar; i != m_src_vert; i = i->pathNext)
     {
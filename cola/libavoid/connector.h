@@ -45,6 +45,8 @@ class Router;
 class ConnRef;
 class JunctionRef;
 class ShapeRef;
+class IncrementalPathSearch;
+class RouteCache;
 typedef std::list<ConnRef *> ConnRefList;
 
 
@@ -420,15 +422,27 @@ class AVOID_EXPORT ConnRef
         friend struct HyperedgeTreeEdge;
         friend struct HyperedgeTreeNode;
         friend class HyperedgeRerouter;
+        friend class RouteCache;
+        friend class TiledOrthogonalRouting;
 
         PolyLine& routeRef(void);
         void freeRoutes(void);
         void performCallback(void);
         bool generatePath(void);
+        bool canSearchPathInIsolation(void) const;
+        bool canKeepPreviousRoute(void) const;
+        bool generatePathFromIsolatedSearch(
+                const std::vector<VertInf *>& searchedPath);
+        bool generatePathIncrementally(void);
+        bool generatePathFromTile(const PolyLine& route);
+        void setGeneratedPath(std::vector<Point>& path,
+                std::vector<VertInf *>& vertices,
+                const std::pair<bool, bool>& isDummyAtEnd);
         void generateCheckpointsPath(std::vector<Point>& path,
                 std::vector<VertInf *>& vertices);
         void generateStandardPath(std::vector<Point>& path,
-                std::vector<VertInf *>& vertices);
+                std::vector<VertInf *>& vertices,
+                const std::vector<VertInf *> *searchedPath = nullptr);
         void unInitialise(void);
         void updateEndPoint(const unsigned int type, const ConnEnd& connEnd);
         void common_updateEndPoint(const unsigned int type, ConnEnd connEnd);
@@ -464,6 +478,8 @@ class AVOID_EXPORT ConnRef
         ConnEnd *m_dst_connend;
         std::vector<Checkpoint> m_checkpoints;
         std::vector<VertInf *> m_checkpoint_vertices;
+        IncrementalPathSearch *m_incremental_search;
+        RouteCache *m_route_cache;
 };
 
 
@@ -330,7 +330,7 @@ void ConnEnd::assignPinVisibilityTo(VertInf *dummyConnectionVert,
             {
                 // This has same ID and is either unconnected or not 
                 // exclusive, so give it visibility.
-                EdgeInf *edge = new EdgeInf(dummyConnectionVert,
+                EdgeInf *edge = new (router) EdgeInf(dummyConnectionVert,
                         currPin->m_vertex, true);
                 // XXX Can't use a zero cost due to assumptions 
                 //     elsewhere in code.
@@ -343,7 +343,7 @@ void ConnEnd::assignPinVisibilityTo(VertInf *dummyConnectionVert,
             {
                 // This has same ID and is either unconnected or not 
                 // exclusive, so give it visibility.
-                EdgeInf *edge = new EdgeInf(dummyConnectionVert,
+                EdgeInf *edge = new (router) EdgeInf(dummyConnectionVert,
                         currPin->m_vertex, false);
                 // XXX Can't use a zero cost due to assumptions 
                 //     elsewhere in code.
@@ -394,7 +394,7 @@ std::pair<bool, VertInf *> ConnEnd::getHyperedgeVertex(Router *router) const
     {
         VertID id(0, kUnassignedVertexNumber,
                 VertID::PROP_ConnPoint);
-        vertex = new VertInf(router, id, m_point);
+        vertex = new (router) VertInf(router, id, m_point);
         vertex->visDirections = m_directions;
         addedVertex = true;
 
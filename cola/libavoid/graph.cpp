@@ -43,6 +43,7 @@ namespace Avoid {
 EdgeInf::EdgeInf(VertInf *v1, VertInf *v2, const bool orthogonal)
     : lstPrev(nullptr),
       lstNext(nullptr),
+      lstOrder(0),
       m_router(nullptr),
       m_blocker(0),
       m_added(false),
@@ -74,6 +75,46 @@ EdgeInf::~EdgeInf()
 }
 
 
+void *EdgeInf::operator new(size_t size, Router *router)
+{
+    COLA_ASSERT(size == sizeof(EdgeInf));
+    COLA_UNUSED(size);
+    return router->m_edge_pool.allocate();
+}
+
+
+void *EdgeInf::operator new(size_t size, Router *router,
+        OrthogonalGraphEdgeTag tag)
+{
+    COLA_ASSERT(size == sizeof(EdgeInf));
+    COLA_UNUSED(size);
+    COLA_UNUSED(tag);
+    return router->m_orthogonal_edge_pool.allocate();
+}
+
+
+void EdgeInf::operator delete(void *ptr)
+{
+    MemoryPool::deallocate(ptr);
+}
+
+
+void EdgeInf::operator delete(void *ptr, Router *router)
+{
+    COLA_UNUSED(router);
+    MemoryPool::deallocate(ptr);
+}
+
+
+void EdgeInf::operator delete(void *ptr, Router *router,
+        OrthogonalGraphEdgeTag tag)
+{
+    COLA_UNUSED(router);
+    COLA_UNUSED(tag);
+    MemoryPool::deallocate(ptr);
+}
+
+
 // Gives an order value between 0 and 3 for the point c, given the last
 // segment was from a to b.  Returns the following value:
 //    0 : Point c is directly backwards from point b.
@@ -204,6 +245,7 @@ void EdgeInf::makeActive(void)
             m_vert1->visListSize++;
             m_pos2 = m_vert2->visList.insert(m_vert2->visList.begin(), this);
             m_vert2->visListSize++;
+            m_router->visGraphChanges.recordEdgeChange(m_vert1, m_vert2);
         }
         else // if (invisible)
         {
@@ -213,8 +255,10 @@ void EdgeInf::makeActive(void)
             m_pos2 = m_vert2->invisList.insert(m_vert2->invisList.begin(), this);
             m_vert2->invisListSize++;
         }
+        m_router->indexEdge(this);
     }
     m_added = true;
+    invalidateCompactNeighbours();
 }
 
 
@@ -233,6 +277,7 @@ void EdgeInf::makeInactive(void)
     }
     else
     {
+        m_router->unindexEdge(this);
         if (m_visible)
         {
             m_router->visGraph.removeEdge(this);
@@ -240,6 +285,7 @@ void EdgeInf::makeInactive(void)
             m_vert1->visListSize--;
             m_vert2->visList.erase(m_pos2);
             m_vert2->visListSize--;
+            m_router->visGraphChanges.recordEdgeChange(m_vert1, m_vert2);
         }
         else // if (invisible)
         {
@@ -253,6 +299,16 @@ void EdgeInf::makeInactive(void)
     m_blocker = 0;
     m_conns.clear();
     m_added = false;
+    invalidateCompactNeighbours();
+}
+
+
+// The neighbours of each endpoint have changed, so searches must no longer
+// use the router's CompactVisGraph snapshot for these vertices.
+void EdgeInf::invalidateCompactNeighbours(void)
+{
+    m_vert1->compactIndex = CompactVisGraph::noIndex;
+    m_vert2->compactIndex = CompactVisGraph::noIndex;
 }
 
 
@@ -270,8 +326,13 @@ void EdgeInf::setDist(double dist)
         m_visible = true;
         makeActive();
     }
+    else if ((m_dist != dist) && !m_orthogonal)
+    {
+        m_router->visGraphChanges.recordEdgeChange(m_vert1, m_vert2);
+    }
     m_dist = dist;
     m_blocker = 0;
+    invalidateCompactNeighbours();
 }
 
 
@@ -297,7 +358,15 @@ bool EdgeInf::isDisabled(void) const
 
 void EdgeInf::setDisabled(const bool disabled)
 {
-    m_disabled = disabled;
+    if (m_disabled != disabled)
+    {
+        m_disabled = disabled;
+        invalidateCompactNeighbours();
+        if (m_added && m_visible && !m_orthogonal)
+        {
+            m_router->visGraphChanges.recordEdgeChange(m_vert1, m_vert2);
+        }
+    }
 }
 
 void EdgeInf::setHyperedgeSegment(const bool hyperedge)
@@ -351,8 +420,16 @@ void EdgeInf::addBlocker(int b)
     if (!m_added)
     {
         m_visible = false;
+        m_blocker = b;
         makeActive();
     }
+    else if (m_blocker != b)
+    {
+        // Move the edge to the index entry for its new blocker.
+        m_router->unindexEdge(this);
+        m_blocker = b;
+        m_router->indexEdge(this);
+    }
     m_dist = 0;
     m_blocker = b;
 }
@@ -370,6 +447,12 @@ pair<Point, Point> EdgeInf::points(void) const
 }
 
 
+pair<VertInf *, VertInf *> EdgeInf::vertices(void) const
+{
+    return std::make_pair(m_vert1, m_vert2);
+}
+
+
 void EdgeInf::db_print(void)
 {
     db_printf("Edge(");
@@ -575,6 +658,12 @@ bool EdgeInf::isDummyConnection(void) const
 }
 
 
+bool EdgeInf::isOrthogonalGraphEdge(void) const
+{
+    return MemoryPool::owner(this) == &(m_router->m_orthogonal_edge_pool);
+}
+
+
 VertInf *EdgeInf::otherVert(const VertInf *vert) const
 {
     COLA_ASSERT((vert == m_vert1) || (vert == m_vert2));
@@ -596,14 +685,14 @@ EdgeInf *EdgeInf::checkEdgeVisibility(VertInf *i, VertInf *j, bool knownNew)
     if (knownNew)
     {
         COLA_ASSERT(existingEdge(i, j) == nullptr);
-        edge = new EdgeInf(i, j);
+        edge = new (router) EdgeInf(i, j);
     }
     else
     {
         edge = existingEdge(i, j);
         if (edge == nullptr)
         {
-            edge = new EdgeInf(i, j);
+            edge = new (router) EdgeInf(i, j);
         }
     }
     edge->checkVis();
@@ -673,7 +762,8 @@ EdgeList::EdgeList(bool orthogonal)
     : m_orthogonal(orthogonal),
       m_first_edge(nullptr),
       m_last_edge(nullptr),
-      m_count(0)
+      m_count(0),
+      m_last_order(0)
 {
 }
 
@@ -698,6 +788,58 @@ void EdgeList::clear(void)
 }
 
 
+// Deletes all the edges in an orthogonal visibility graph.  Rather than 
+// each edge unlinking itself from this list and from the orthogonal 
+// visibility lists of its vertices, those lists are emptied outright.
+// Orthogonal visibility lists only ever contain orthogonal edges, which
+// are all in this list, so this leaves the vertices in the same state.
+//
+// Every edge in the router's orthogonal edge pool is in this list, so 
+// the pool is reset in one go rather than each edge being returned to 
+// it.  Other edges here, for connection pins, are deleted as usual.
+void EdgeList::clearOrthogonal(void)
+{
+    if (m_first_edge == nullptr)
+    {
+        return;
+    }
+    for (EdgeInf *edge = m_first_edge; edge; edge = edge->lstNext)
+    {
+        COLA_ASSERT(edge->m_orthogonal);
+        edge->m_vert1->orthogVisList.clear();
+        edge->m_vert1->orthogVisListSize = 0;
+        edge->m_vert2->orthogVisList.clear();
+        edge->m_vert2->orthogVisListSize = 0;
+        edge->invalidateCompactNeighbours();
+    }
+
+    MemoryPool& pool = m_first_edge->m_router->m_orthogonal_edge_pool;
+    size_t pooledEdges = 0;
+    EdgeInf *edge = m_first_edge;
+    while (edge)
+    {
+        EdgeInf *next = edge->lstNext;
+        edge->m_added = false;
+        if (MemoryPool::owner(edge) == &pool)
+        {
+            edge->~EdgeInf();
+            ++pooledEdges;
+        }
+        else
+        {
+            delete edge;
+        }
+        edge = next;
+    }
+    COLA_ASSERT(pool.statistics().liveObjects == pooledEdges);
+    COLA_UNUSED(pooledEdges);
+    pool.reset();
+    m_first_edge = nullptr;
+    m_last_edge = nullptr;
+    m_count = 0;
+}
+
+
 int EdgeList::size(void) const
 {
     return m_count;
@@ -733,6 +875,7 @@ void EdgeList::addEdge(EdgeInf *edge)
 
         edge->lstNext = nullptr;
     }
+    edge->lstOrder = ++m_last_order;
     m_count++;
 }
 
@@ -780,6 +923,205 @@ EdgeInf *EdgeList::end(void)
 }
 
 
+//===========================================================================
+
+
+CompactVisGraph::Neighbour::Neighbour(EdgeInf *edge, const VertInf *from)
+    : vert(edge->otherVert(from)),
+      edge(edge),
+      dist(edge->getDist()),
+      dummyConnection(edge->isDummyConnection()),
+      disabled(edge->isDisabled())
+{
+}
+
+
+bool CompactVisGraph::Neighbour::rotationLessThan(const VertInf *last,
+        const VertInf *common, const Neighbour& rhs) const
+{
+    if (edge == rhs.edge)
+    {
+        return false;
+    }
+
+    const Point& commonPt = common->point;
+    // If no last point, use one directly to the left;
+    Point lastPt = (last) ? last->point : Point(commonPt.x - 10, commonPt.y);
+
+    int lhsVal = orthogTurnOrder(lastPt, commonPt, vert->point);
+    int rhsVal = orthogTurnOrder(lastPt, commonPt, rhs.vert->point);
+
+    if (lhsVal != rhsVal)
+    {
+        return lhsVal < rhsVal;
+    }
+    return edge->lstOrder < rhs.edge->lstOrder;
+}
+
+
+CompactVisGraph::CompactVisGraph()
+{
 }
 
 
+CompactVisGraph::~CompactVisGraph()
+{
+}
+
+
+// Vertices may have been deleted since the snapshot was taken, so their
+// indices are not reset here.  Stale indices are detected by neighbours().
+void CompactVisGraph::clear(void)
+{
+    m_vertices.clear();
+    m_offsets.clear();
+    m_orthog_offsets.clear();
+    m_neighbours.clear();
+    m_orthog_neighbours.clear();
+}
+
+
+void CompactVisGraph::record(Router *router)
+{
+    clear();
+
+    size_t vertexCount = router->vertices.connsSize() + 
+            router->vertices.shapesSize();
+    m_vertices.reserve(vertexCount);
+    m_offsets.reserve(vertexCount + 1);
+    m_orthog_offsets.reserve(vertexCount + 1);
+    // Each edge appears in the neighbours of both of its endpoints.
+    m_neighbours.reserve(2 * router->visGraph.size());
+    m_orthog_neighbours.reserve(2 * router->visOrthogGraph.size());
+
+    VertInf *finish = router->vertices.end();
+    for (VertInf *vert = router->vertices.connsBegin(); vert != finish;
+            vert = vert->lstNext)
+    {
+        vert->compactIndex = (unsigned int) m_vertices.size();
+        m_vertices.push_back(vert);
+
+        m_offsets.push_back((unsigned int) m_neighbours.size());
+        EdgeInfList::const_iterator visFinish = vert->visList.end();
+        for (EdgeInfList::const_iterator edge = vert->visList.begin();
+                edge != visFinish; ++edge)
+        {
+            m_neighbours.push_back(Neighbour(*edge, vert));
+        }
+
+        m_orthog_offsets.push_back((unsigned int) m_orthog_neighbours.size());
+        visFinish = vert->orthogVisList.end();
+        for (EdgeInfList::const_iterator edge = vert->orthogVisList.begin();
+                edge != visFinish; ++edge)
+        {
+            m_orthog_neighbours.push_back(Neighbour(*edge, vert));
+        }
+    }
+    m_offsets.push_back((unsigned int) m_neighbours.size());
+    m_orthog_offsets.push_back((unsigned int) m_orthog_neighbours.size());
+}
+
+
+bool CompactVisGraph::neighbours(const VertInf *vert, const bool orthogonal,
+        const Neighbour *& begin, const Neighbour *& end) const
+{
+    unsigned int index = vert->compactIndex;
+    if ((index == noIndex) || (index >= m_vertices.size()) || 
+            (m_vertices[index] != vert))
+    {
+        return false;
+    }
+
+    const std::vector<unsigned int>& offsets = 
+            (orthogonal) ? m_orthog_offsets : m_offsets;
+    const NeighbourList& neighbours = 
+            (orthogonal) ? m_orthog_neighbours : m_neighbours;
+    begin = neighbours.data() + offsets[index];
+    end = neighbours.data() + offsets[index + 1];
+    return true;
+}
+
+
+size_t CompactVisGraph::size(void) const
+{
+    return m_vertices.size();
+}
+
+
+// The most changes kept before the log is discarded.  Beyond this, the
+// graph has changed so much that searching afresh is as fast.
+static const size_t maxVisGraphChanges = 1 << 20;
+
+VisGraphChangeLog::VisGraphChangeLog()
+    : m_enabled(false),
+      m_first_position(0)
+{
+}
+
+
+void VisGraphChangeLog::setEnabled(const bool enabled)
+{
+    if (m_enabled != enabled)
+    {
+        discard();
+        m_enabled = enabled;
+    }
+}
+
+
+void VisGraphChangeLog::recordEdgeChange(VertInf *vert1, VertInf *vert2)
+{
+    record(Change(vert1, vert2));
+}
+
+
+void VisGraphChangeLog::recordVertexMove(VertInf *vert)
+{
+    record(Change(vert, nullptr));
+}
+
+
+void VisGraphChangeLog::record(const Change& change)
+{
+    if (!m_enabled || (m_changes.size() >= maxVisGraphChanges))
+    {
+        // The change can't be recorded, so nothing before it can be used.
+        discard();
+        return;
+    }
+    m_changes.push_back(change);
+}
+
+
+void VisGraphChangeLog::discard(void)
+{
+    // Also skip a position, so that searches are restarted even if there
+    // were no changes to discard.
+    m_first_position += m_changes.size() + 1;
+    m_changes.clear();
+}
+
+
+unsigned long long VisGraphChangeLog::firstPosition(void) const
+{
+    return m_first_position;
+}
+
+
+unsigned long long VisGraphChangeLog::endPosition(void) const
+{
+    return m_first_position + m_changes.size();
+}
+
+
+const VisGraphChangeLog::Change& VisGraphChangeLog::at(
+        const unsigned long long position) const
+{
+    COLA_ASSERT(position >= m_first_position);
+    COLA_ASSERT(position < endPosition());
+    return m_changes[static_cast<size_t>(position - m_first_position)];
+}
+
+
+}
+
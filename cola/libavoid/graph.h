@@ -28,8 +28,11 @@
 
 
 #include <cassert>
+#include <climits>
 #include <list>
+#include <set>
 #include <utility>
+#include <vector>
 #include "libavoid/vertices.h"
 
 namespace Avoid {
@@ -48,6 +51,19 @@ class EdgeInf
     public:
         EdgeInf(VertInf *v1, VertInf *v2, const bool orthogonal = false);
         ~EdgeInf();
+        // Edges are allocated from their router's memory pool, i.e.,
+        // new (router) EdgeInf(v1, v2).  Edges generated for the 
+        // orthogonal visibility graph instead use new (router, 
+        // OrthogonalGraphEdge) EdgeInf(v1, v2, true), which takes them 
+        // from a pool that is reset when the graph is discarded.
+        enum OrthogonalGraphEdgeTag { OrthogonalGraphEdge };
+        static void *operator new(size_t size, Router *router);
+        static void *operator new(size_t size, Router *router,
+                OrthogonalGraphEdgeTag tag);
+        static void operator delete(void *ptr);
+        static void operator delete(void *ptr, Router *router);
+        static void operator delete(void *ptr, Router *router,
+                OrthogonalGraphEdgeTag tag);
         inline double getDist(void)
         {
             return m_dist;
@@ -60,11 +76,15 @@ class EdgeInf
         bool added(void);
         bool isOrthogonal(void) const;
         bool isDummyConnection(void) const;
+        // Whether this edge was generated as part of the static
+        // orthogonal visibility graph, i.e., with OrthogonalGraphEdge.
+        bool isOrthogonalGraphEdge(void) const;
         bool isDisabled(void) const;
         void setDisabled(const bool disabled);
         bool rotationLessThan(const VertInf* last, const EdgeInf *rhs) const;
         std::pair<VertID, VertID> ids(void) const;
         std::pair<Point, Point> points(void) const;
+        std::pair<VertInf *, VertInf *> vertices(void) const;
         void db_print(void);
         void checkVis(void);
         VertInf *otherVert(const VertInf *vert) const;
@@ -80,12 +100,18 @@ class EdgeInf
 
         EdgeInf *lstPrev;
         EdgeInf *lstNext;
+        // Increases with each edge added to an EdgeList, so can be used
+        // to sort edges into the order they appear in that list.
+        unsigned long long lstOrder;
     private:
         friend class MinimumTerminalSpanningTree;
         friend class VertInf;
+        friend class Router;
+        friend class EdgeList;
 
         void makeActive(void);
         void makeInactive(void);
+        void invalidateCompactNeighbours(void);
         int firstBlocker(void);
         bool isBetween(VertInf *i, VertInf *j);
 
@@ -113,6 +139,7 @@ class EdgeList
         EdgeList(bool orthogonal = false);
         ~EdgeList();
         void clear(void);
+        void clearOrthogonal(void);
         EdgeInf *begin(void);
         EdgeInf *end(void);
         int size(void) const;
@@ -124,6 +151,105 @@ class EdgeList
         EdgeInf *m_first_edge;
         EdgeInf *m_last_edge;
         unsigned int m_count;
+        unsigned long long m_last_order;
+};
+
+
+// Orders edges from the same EdgeList by their position in that list.
+struct CmpEdgeInfListOrder
+{
+    bool operator()(const EdgeInf *lhs, const EdgeInf *rhs) const
+    {
+        return lhs->lstOrder < rhs->lstOrder;
+    }
+};
+
+typedef std::set<EdgeInf *, CmpEdgeInfListOrder> EdgeInfListOrderSet;
+
+
+// A compact snapshot of the visibility graphs, stored in compressed sparse
+// row form.  The neighbours of each vertex are held contiguously, so that
+// route searches don't need to follow the linked lists of EdgeInf pointers
+// on each VertInf.  The lists remain the editable form of the graphs.
+//
+// Each vertex records its index into the snapshot.  Any change to the 
+// visibility edges of a vertex resets this index, after which searches 
+// fall back to reading that vertex's edge lists until the next snapshot.
+//
+class CompactVisGraph
+{
+    public:
+        struct Neighbour
+        {
+            VertInf *vert;
+            EdgeInf *edge;
+            double dist;
+            bool dummyConnection;
+            bool disabled;
+
+            Neighbour(EdgeInf *edge, const VertInf *from);
+            // As for EdgeInf::rotationLessThan() for the edges from the
+            // common vertex, except that neighbours in the same position in
+            // the exploration order, or not positioned orthogonally, are 
+            // ordered by their edge's position in its EdgeList.
+            bool rotationLessThan(const VertInf *last, const VertInf *common,
+                    const Neighbour& rhs) const;
+        };
+        typedef std::vector<Neighbour> NeighbourList;
+
+        static const unsigned int noIndex = UINT_MAX;
+
+        CompactVisGraph();
+        ~CompactVisGraph();
+        // Takes a snapshot of both visibility graphs for the router.
+        void record(Router *router);
+        void clear(void);
+        // Returns the neighbours of vert in the polyline or orthogonal
+        // visibility graph, or false if vert has no current snapshot.
+        bool neighbours(const VertInf *vert, const bool orthogonal,
+                const Neighbour *& begin, const Neighbour *& end) const;
+        size_t size(void) const;
+
+    private:
+        std::vector<VertInf *> m_vertices;
+        std::vector<unsigned int> m_offsets;
+        std::vector<unsigned int> m_orthog_offsets;
+        NeighbourList m_neighbours;
+        NeighbourList m_orthog_neighbours;
+};
+
+
+// A log of the changes to the poly-line visibility graph, from which an
+// incremental route search can find the parts of its previous search that
+// need to be repaired.  A change is either to the edge between two 
+// vertices, which has been added, removed or changed length, or is a 
+// vertex that has been moved, in which case the second vertex is nullptr.
+//
+// Changes are numbered consecutively.  When the log is disabled or full,
+// or when a vertex is deleted, the changes recorded so far are discarded 
+// and firstPosition() moves past them.  A search that has not yet seen 
+// all the discarded changes must then start afresh.
+//
+class VisGraphChangeLog
+{
+    public:
+        typedef std::pair<VertInf *, VertInf *> Change;
+
+        VisGraphChangeLog();
+        void setEnabled(const bool enabled);
+        void recordEdgeChange(VertInf *vert1, VertInf *vert2);
+        void recordVertexMove(VertInf *vert);
+        void discard(void);
+        unsigned long long firstPosition(void) const;
+        unsigned long long endPosition(void) const;
+        const Change& at(const unsigned long long position) const;
+
+    private:
+        void record(const Change& change);
+
+        bool m_enabled;
+        unsigned long long m_first_position;
+        std::vector<Change> m_changes;
 };
 
 
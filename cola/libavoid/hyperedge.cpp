@@ -34,6 +34,8 @@
 #include "libavoid/assertions.h"
 #include "libavoid/debughandler.h"
 #include "libavoid/debug.h"
+#include "libavoid/parallel.h"
+#include "libavoid/timer.h"
 
 
 namespace Avoid {
@@ -306,8 +308,72 @@ void HyperedgeRerouter::performRerouting(void)
     }
 #endif
 
-    // For each hyperedge...
+    // Execute the MTST method to find good junction positions and an
+    // initial path for each hyperedge.  A hyperedge tree will be built 
+    // for each new route.  The tree searches only read the visibility 
+    // graph, so all the trees are built before any of the hyperedges are
+    // changed.  This means each is found for the same graph whether or 
+    // not they are built in parallel.
     const size_t num_hyperedges = count();
+    std::vector<JunctionHyperedgeTreeNodeMap> 
+            hyperedgeTreeJunctions(num_hyperedges);
+    std::vector<MinimumTerminalSpanningTree *> mtsts(num_hyperedges, nullptr);
+    for (size_t i = 0; i < num_hyperedges; ++i)
+    {
+        if (!m_terminal_vertices_vector[i].empty())
+        {
+            mtsts[i] = new MinimumTerminalSpanningTree(m_router, 
+                    m_terminal_vertices_vector[i], &hyperedgeTreeJunctions[i]);
+        }
+    }
+
+    // The tree searches keep their own state and don't touch the 
+    // vertices, but later connector searches may start from a vertex 
+    // with a stale pathNext.  Clear these, as the searches once did.
+    VertInf *endVert = m_router->vertices.end();
+    for (VertInf *k = m_router->vertices.connsBegin(); k != endVert;
+            k = k->lstNext)
+    {
+        k->pathNext = nullptr;
+    }
+
+    struct BuildTask
+    {
+        std::vector<MinimumTerminalSpanningTree *>& mtsts;
+
+        void operator()(const size_t index, const unsigned int thread)
+        {
+            COLA_UNUSED(thread);
+            if (mtsts[index])
+            {
+                // The older MTST construction method (faster, worse 
+                // results) is constructSequential().
+                //
+                // The preferred MTST construction method.
+                // Slightly slower, better quality results.
+                mtsts[index]->buildInterleaved();
+            }
+        }
+    };
+    unsigned int threads = 1;
+    if (m_router->routingOption(performParallelHyperedgeRerouting))
+    {
+        threads = effectiveThreadCount(m_router->routingThreadCount(), 
+                num_hyperedges);
+    }
+#ifdef DEBUGHANDLER
+    if (m_router->debugHandler())
+    {
+        // The debug handler expects to be called for one tree at a time.
+        threads = 1;
+    }
+#endif
+    TIMER_START(m_router, tmHyperedgeAlt);
+    BuildTask task = { mtsts };
+    parallelFor(m_router->threadPool(), num_hyperedges, threads, task);
+    TIMER_STOP(m_router);
+
+    // For each hyperedge...
     for (size_t i = 0; i < num_hyperedges; ++i)
     {
         if (m_terminal_vertices_vector[i].empty())
@@ -316,18 +382,9 @@ void HyperedgeRerouter::performRerouting(void)
             continue;
         }
 
-        // Execute the MTST method to find good junction positions and an
-        // initial path.  A hyperedge tree will be built for the new route.
-        JunctionHyperedgeTreeNodeMap hyperedgeTreeJunctions;
-        MinimumTerminalSpanningTree mtst(m_router, 
-                m_terminal_vertices_vector[i], &hyperedgeTreeJunctions);
-
-        // The older MTST construction method (faster, worse results).
-        //mtst.constructSequential();
-        
-        // The preferred MTST construction method.
-        // Slightly slower, better quality results.
-        mtst.constructInterleaved();
+        // Create the junctions for the tree, in order.
+        MinimumTerminalSpanningTree& mtst = *mtsts[i];
+        mtst.createJunctions();
 
         HyperedgeTreeNode *treeRoot = mtst.rootJunction();
         COLA_ASSERT(treeRoot);
@@ -365,6 +422,9 @@ void HyperedgeRerouter::performRerouting(void)
         {
             m_router->deleteJunction(*curr);
         }
+
+        delete mtsts[i];
+        mtsts[i] = nullptr;
     }
 
     // Clear the input to this class, so that new objects can be registered
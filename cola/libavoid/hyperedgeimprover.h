@@ -29,24 +29,16 @@
 #include <set>
 #include <list>
 
+#include "libavoid/hyperedgetree.h"
 
 namespace Avoid {
 
-struct HyperedgeTreeNode;
-struct HyperedgeTreeEdge;
 class HyperedgeShiftSegment;
-class ConnRef;
-class JunctionRef;
 class ShiftSegment;
-class VertInf;
 
 typedef std::list<ShiftSegment *> ShiftSegmentList;
-typedef std::map<JunctionRef *, ShiftSegmentList> RootSegmentsMap;
-typedef std::map<JunctionRef *, HyperedgeTreeNode *>
-        JunctionHyperedgeTreeNodeMap;
-typedef std::set<JunctionRef *> JunctionSet;
-typedef std::list<ConnRef *> ConnRefList;
-typedef std::list<JunctionRef *> JunctionRefList;
+typedef std::map<JunctionRef *, ShiftSegmentList, CmpJunctionRefIds> 
+        RootSegmentsMap;
 
 class HyperedgeImprover
 {
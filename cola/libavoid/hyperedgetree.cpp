@@ -799,6 +799,18 @@ void HyperedgeTreeEdge::deleteNodesExcept(HyperedgeTreeNode *ignored)
 }
 
 
+bool CmpJunctionRefIds::operator()(const JunctionRef *lhs, 
+        const JunctionRef *rhs) const
+{
+    // Lookups may be made for a null junction, which comes first.
+    if ((lhs == nullptr) || (rhs == nullptr))
+    {
+        return lhs < rhs;
+    }
+    return lhs->id() < rhs->id();
+}
+
+
 CmpNodesInDim::CmpNodesInDim(const size_t dim)
     : m_dimension(dim)
 {
@@ -51,9 +51,19 @@ class Router;
 struct HyperedgeTreeEdge;
 struct HyperedgeTreeNode;
 
-typedef std::map<JunctionRef *, HyperedgeTreeNode *>
+// Orders junctions by their IDs, so the choice of a root junction for 
+// each hyperedge tree doesn't depend on where the junctions were 
+// allocated.
+class CmpJunctionRefIds
+{
+    public:
+        bool operator()(const JunctionRef *lhs, 
+                const JunctionRef *rhs) const;
+};
+
+typedef std::map<JunctionRef *, HyperedgeTreeNode *, CmpJunctionRefIds>
         JunctionHyperedgeTreeNodeMap;
-typedef std::set<JunctionRef *> JunctionSet;
+typedef std::set<JunctionRef *, CmpJunctionRefIds> JunctionSet;
 typedef std::list<JunctionRef *> JunctionRefList;
 typedef std::list<ConnRef *> ConnRefList;
 
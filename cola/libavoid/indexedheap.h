@@ -0,0 +1,169 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ *
+ * Copyright (C) 2026  agent
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * Licensees holding a valid commercial license may use this file in
+ * accordance with the commercial license agreement provided with the
+ * library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):  agent
+*/
+
+
+#ifndef AVOID_INDEXEDHEAP_H
+#define AVOID_INDEXEDHEAP_H
+
+#include <cstddef>
+#include <vector>
+
+#include "libavoid/assertions.h"
+
+
+namespace Avoid {
+
+// A binary heap of nodes, ordered by Cmp, with the smallest at the top.
+// Each node records its position in the heap (Node::heapIndex, which is
+// Node::notInHeap when it is not in the heap), so a node whose key has 
+// changed can be moved to its new position, or removed, in logarithmic 
+// time, rather than the whole heap needing to be rebuilt.
+//
+// This is used for the A* search nodes when routing connectors and for the
+// vertices and bridging edges when building hyperedge MTSTs.
+//
+template <typename Node, typename Cmp>
+class IndexedNodeHeap
+{
+    public:
+        bool empty(void) const
+        {
+            return m_nodes.empty();
+        }
+        size_t size(void) const
+        {
+            return m_nodes.size();
+        }
+        void clear(void)
+        {
+            for (size_t i = 0; i < m_nodes.size(); ++i)
+            {
+                m_nodes[i]->heapIndex = Node::notInHeap;
+            }
+            m_nodes.clear();
+        }
+        bool contains(const Node *node) const
+        {
+            return node->heapIndex != Node::notInHeap;
+        }
+        // The nodes currently in the heap, in heap order.
+        const std::vector<Node *>& nodes(void) const
+        {
+            return m_nodes;
+        }
+        Node *top(void) const
+        {
+            return m_nodes.front();
+        }
+        void push(Node *node)
+        {
+            m_nodes.push_back(node);
+            siftUp(m_nodes.size() - 1, node);
+        }
+        Node *pop(void)
+        {
+            Node *top = m_nodes.front();
+            top->heapIndex = Node::notInHeap;
+            Node *last = m_nodes.back();
+            m_nodes.pop_back();
+            if (!m_nodes.empty())
+            {
+                // Like std::pop_heap, move the hole at the top down to a
+                // leaf, then place the last node there and sift it up.
+                siftUp(siftHoleToLeaf(0), last);
+            }
+            return top;
+        }
+        // Restores the heap order after the cost of node has been lowered.
+        void decreased(Node *node)
+        {
+            COLA_ASSERT(node->heapIndex < m_nodes.size());
+            siftUp(node->heapIndex, node);
+        }
+        // Restores the heap order after the key of node has changed in 
+        // either direction.
+        void changed(Node *node)
+        {
+            COLA_ASSERT(node->heapIndex < m_nodes.size());
+            siftUp(siftHoleToLeaf(node->heapIndex), node);
+        }
+        void remove(Node *node)
+        {
+            COLA_ASSERT(node->heapIndex < m_nodes.size());
+            size_t hole = node->heapIndex;
+            node->heapIndex = Node::notInHeap;
+            Node *last = m_nodes.back();
+            m_nodes.pop_back();
+            if (last != node)
+            {
+                siftUp(siftHoleToLeaf(hole), last);
+            }
+        }
+
+    private:
+        void place(Node *node, const size_t index)
+        {
+            m_nodes[index] = node;
+            node->heapIndex = index;
+        }
+        // Moves the hole at the given index down to a leaf, by repeatedly 
+        // filling it with its smaller child, and returns its new index.
+        size_t siftHoleToLeaf(size_t hole)
+        {
+            size_t child = (2 * hole) + 1;
+            while (child < m_nodes.size())
+            {
+                if (((child + 1) < m_nodes.size()) && 
+                        m_cmp(m_nodes[child], m_nodes[child + 1]))
+                {
+                    ++child;
+                }
+                place(m_nodes[child], hole);
+                hole = child;
+                child = (2 * hole) + 1;
+            }
+            return hole;
+        }
+        void siftUp(size_t hole, Node *node)
+        {
+            while (hole > 0)
+            {
+                size_t parent = (hole - 1) / 2;
+                if (!m_cmp(m_nodes[parent], node))
+                {
+                    break;
+                }
+                place(m_nodes[parent], hole);
+                hole = parent;
+            }
+            place(node, hole);
+        }
+
+        std::vector<Node *> m_nodes;
+        Cmp m_cmp;
+};
+
+}
+
+#endif
@@ -31,8 +31,14 @@
 
 #include <algorithm>
 #include <vector>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
 #include <climits>
+#include <cstdint>
 #include <cfloat>
+#include <new>
 
 #include "libavoid/makepath.h"
 #include "libavoid/vertices.h"
@@ -44,6 +50,7 @@
 #include "libavoid/debug.h"
 #include "libavoid/assertions.h"
 #include "libavoid/debughandler.h"
+#include "libavoid/indexedheap.h"
 
 //#define ESTIMATED_COST_DEBUG
 
@@ -60,6 +67,9 @@ class ANode
         ANode *prevNode; // VertInf for the previous ANode.
         int timeStamp;   // Time-stamp used to determine exploration order of
                          // seemingly equal paths during orthogonal routing.
+        size_t heapIndex; // Position in the PENDING heap, or notInHeap.
+
+        static const size_t notInHeap = SIZE_MAX;
 
         ANode(VertInf *vinf, int time)
             : inf(vinf),
@@ -67,7 +77,8 @@ class ANode
               h(0),
               f(0),
               prevNode(nullptr),
-              timeStamp(time)
+              timeStamp(time),
+              heapIndex(notInHeap)
         {
         }
         ANode()
@@ -76,65 +87,171 @@ class ANode
               h(0),
               f(0),
               prevNode(nullptr),
-              timeStamp(-1)
+              timeStamp(-1),
+              heapIndex(notInHeap)
         {
         }
 };
 
+// The number of ANodes in each block allocated by AStarPathPrivate.
+static const size_t aNodeBlockSize = 5000;
+
+
+// This returns the opposite result (>) so that when used with ANodeHeap, 
+// the head node of the heap will be the smallest value, rather than the 
+// largest.  This saves us from having to sort the heap (and then reorder
+// it back into a heap) when getting the next node to examine.  This way we
+// get better complexity -- logarithmic pushes and pops to the heap.
+//
+class ANodeCmp
+{
+    public:
+    ANodeCmp()
+    {
+    }
+bool operator()(const ANode *a, const ANode *b) const
+{
+    // We need to use an epsilon here since otherwise the multiple addition
+    // of floating point numbers that makes up the 'f' values cause a problem
+    // with routings occasionally being non-deterministic.
+    if (fabs(a->f - b->f) > 0.0000001)
+    {
+        return a->f > b->f;
+    }
+    if (a->timeStamp != b->timeStamp)
+    {
+        // Tiebreaker, if two paths have equal cost, then choose the one with
+        // the highest timeStamp.  This corresponds to the furthest point
+        // explored along the straight-line path.  When exploring we give the
+        // directions the following timeStamps; left:1, right:2 and forward:3,
+        // then we always try to explore forward first.
+        return a->timeStamp < b->timeStamp;
+    }
+    return false;
+}
+};
+
+
+// The PENDING set of an A* search.
+typedef IndexedNodeHeap<ANode, ANodeCmp> ANodeHeap;
+
+
+// The search state for a vertex depends on the vertex it was reached from,
+// so ANodes are looked up by this pair of vertices.  There is at most one 
+// ANode, either PENDING or Done, for each such pair.
+typedef std::pair<const VertInf *, const VertInf *> ANodeKey;
+
+static inline size_t combineHashes(const size_t h1, const size_t h2)
+{
+    return h1 ^ (h2 + 0x9e3779b9 + (h1 << 6) + (h1 >> 2));
+}
+
+// Hashes a vertex by its position rather than its address.  Hash tables 
+// free their nodes in hash order, and this order affects the addresses 
+// given to later allocations.  Some router state is ordered by address, 
+// so hashing addresses would let address space randomisation change the
+// routing results from one run to the next.
+struct VertInfHash
+{
+    size_t operator()(const VertInf *vert) const
+    {
+        if (vert == nullptr)
+        {
+            return 0;
+        }
+        return combineHashes(std::hash<double>()(vert->point.x),
+                std::hash<double>()(vert->point.y));
+    }
+};
+
+struct ANodeKeyHash
+{
+    size_t operator()(const ANodeKey& key) const
+    {
+        VertInfHash vertHash;
+        return combineHashes(vertHash(key.first), vertHash(key.second));
+    }
+};
+typedef std::unordered_map<ANodeKey, ANode *, ANodeKeyHash> ANodeSlotMap;
+
 class AStarPathPrivate
 {
     public:
         AStarPathPrivate()
             : m_available_nodes(),
-              m_available_array_size(0),
               m_available_array_index(0),
-              m_available_node_index(0)
+              m_available_node_index(0),
+              m_isolated(false)
         {
         }
         ~AStarPathPrivate()
         {
-            // Free memory
+            // Return the blocks to the router's pool.
             for (size_t i = 0; i < m_available_nodes.size(); ++i)
             {
-                delete[] m_available_nodes[i];
+                MemoryPool::deallocate(m_available_nodes[i]);
             }
         }
         // Returns a pointer to an ANode for aStar search, but allocates
-        // these in blocks 
-        ANode *newANode(const ANode& node, const bool addToPending = true)
+        // these in blocks.  Blocks are reused by subsequent searches, and
+        // come from the router's pool so they can be reused by later 
+        // AStarPath instances too.
+        ANode *newANode(const ANode& node)
         {
-            const size_t blockSize = 5000;
-            if ((m_available_array_index + 1 > m_available_array_size) ||
-                    (m_available_node_index >= blockSize))
+            if (m_available_node_index >= aNodeBlockSize)
             {
-                m_available_nodes.push_back(new ANode[blockSize]);
-                ++m_available_array_size;
+                ++m_available_array_index;
                 m_available_node_index = 0;
-                m_available_array_index = m_available_array_size - 1;
             }
-            
-            ANode *nodes = m_available_nodes[m_available_array_index];
-            ANode *newNode = &(nodes[m_available_node_index++]);
-            *newNode = node;
-            if (addToPending)
+            if (m_available_array_index >= m_available_nodes.size())
             {
-                node.inf->aStarPendingNodes.push_back(newNode);
+                Router *router = node.inf->_router;
+                m_available_nodes.push_back(static_cast<ANode *>(
+                        router->m_search_node_pool.allocate()));
             }
-            return newNode;
+            
+            ANode *nodes = m_available_nodes[m_available_array_index];
+            return new (&(nodes[m_available_node_index++])) ANode(node);
         }
         void search(ConnRef *lineRef, VertInf *src, VertInf *tar, 
-                VertInf *start);
+                VertInf *start, std::vector<VertInf *> *isolatedPath);
 
     private:
+        static ANodeKey nodeKey(const ANode *node)
+        {
+            return ANodeKey(node->inf, 
+                    (node->prevNode) ? node->prevNode->inf : nullptr);
+        }
+        // Adds a node to the PENDING set.  This takes the place of any 
+        // node for the same vertices in the Done set.
+        void addPendingNode(ANode *node)
+        {
+            m_node_slots[nodeKey(node)] = node;
+            m_pending.push(node);
+        }
+        // Adds a node directly to the Done set.
+        void addDoneNode(ANode *node)
+        {
+            m_node_slots.insert(std::make_pair(nodeKey(node), node));
+        }
+        void recordIsolatedPath(ANode *bestNode, VertInf *src, VertInf *tar,
+                std::vector<VertInf *>& path) const;
         void determineEndPointLocation(double dist, VertInf *start,
                 VertInf *target, VertInf *other, int level);
         double estimatedCost(ConnRef *lineRef, const Point *last,
                 const Point& curr) const;
 
         std::vector<ANode *> m_available_nodes;
-        size_t m_available_array_size;
         size_t m_available_array_index;
         size_t m_available_node_index;
+
+        // The PENDING and Done sets.  Done nodes are those in m_node_slots
+        // that are no longer in the m_pending heap.
+        ANodeHeap m_pending;
+        ANodeSlotMap m_node_slots;
+
+        bool m_isolated;
+        CompactVisGraph::NeighbourList m_neighbours;
  
         // For determining estimated cost target.
         std::vector<VertInf *> m_cost_targets;
@@ -144,41 +261,6 @@ class AStarPathPrivate
 
 
 
-// This returns the opposite result (>) so that when used with stl::make_heap, 
-// the head node of the heap will be the smallest value, rather than the 
-// largest.  This saves us from having to sort the heap (and then reorder
-// it back into a heap) when getting the next node to examine.  This way we
-// get better complexity -- logarithmic pushes and pops to the heap.
-//
-class ANodeCmp
-{
-    public:
-    ANodeCmp()
-    {
-    }
-bool operator()(const ANode *a, const ANode *b)
-{
-    // We need to use an epsilon here since otherwise the multiple addition
-    // of floating point numbers that makes up the 'f' values cause a problem
-    // with routings occasionally being non-deterministic.
-    if (fabs(a->f - b->f) > 0.0000001)
-    {
-        return a->f > b->f;
-    }
-    if (a->timeStamp != b->timeStamp)
-    {
-        // Tiebreaker, if two paths have equal cost, then choose the one with
-        // the highest timeStamp.  This corresponds to the furthest point
-        // explored along the straight-line path.  When exploring we give the
-        // directions the following timeStamps; left:1, right:2 and forward:3,
-        // then we always try to explore forward first.
-        return a->timeStamp < b->timeStamp;
-    }
-    return false;
-}
-};
-
-
 static double Dot(const Point& l, const Point& r)
 {
     return (l.x * r.x) + (l.y * r.y);
@@ -898,6 +980,25 @@ class CmpVisEdgeRotation
 };
 
 
+class CmpNeighbourRotation 
+{
+    public:
+        CmpNeighbourRotation(const VertInf *lastPt, const VertInf *commonPt)
+            : _lastPt(lastPt),
+              _commonPt(commonPt)
+        {
+        }
+        bool operator() (const CompactVisGraph::Neighbour& u, 
+                const CompactVisGraph::Neighbour& v) const 
+        {
+            return u.rotationLessThan(_lastPt, _commonPt, v);
+        }
+    private:
+        const VertInf *_lastPt;
+        const VertInf *_commonPt;
+};
+
+
 static inline bool pointAlignedWithOneOf(const Point& point, 
         const std::vector<Point>& points, const size_t dim)
 {
@@ -921,9 +1022,20 @@ AStarPath::~AStarPath(void)
     delete m_private;
 }
 
+size_t AStarPath::nodeBlockSize(void)
+{
+    return aNodeBlockSize * sizeof(ANode);
+}
+
 void AStarPath::search(ConnRef *lineRef, VertInf *src, VertInf *tar, VertInf *start)
 {
-    m_private->search(lineRef, src, tar, start);
+    m_private->search(lineRef, src, tar, start, nullptr);
+}
+
+void AStarPath::searchIsolated(ConnRef *lineRef, VertInf *src, VertInf *tar,
+        std::vector<VertInf *>& path)
+{
+    m_private->search(lineRef, src, tar, src, &path);
 }
 
 void AStarPathPrivate::determineEndPointLocation(double dist, VertInf *start, 
@@ -964,10 +1076,13 @@ void AStarPathPrivate::determineEndPointLocation(double dist, VertInf *start,
 // The aStar STL code is originally based on public domain code available 
 // on the internet.
 //
-void AStarPathPrivate::search(ConnRef *lineRef, VertInf *src, VertInf *tar, VertInf *start)
+// If isolatedPath is given, then the pathNext links are not written and 
+// instead the path is returned in isolatedPath.  In this case the search 
+// doesn't modify any shared state, see AStarPath::searchIsolated().
+//
+void AStarPathPrivate::search(ConnRef *lineRef, VertInf *src, VertInf *tar, 
+        VertInf *start, std::vector<VertInf *> *isolatedPath)
 {
-    ANodeCmp pendingCmp;
-
     bool isOrthogonal = (lineRef->routingType() == ConnType_Orthogonal);
 
     if (start == nullptr)
@@ -975,6 +1090,22 @@ void AStarPathPrivate::search(ConnRef *lineRef, VertInf *src, VertInf *tar, Vert
         start = src;
     }
 
+    // Reset any state left from a previous search with this object.
+    m_isolated = (isolatedPath != nullptr);
+    m_available_array_index = 0;
+    m_available_node_index = 0;
+    m_pending.clear();
+    m_node_slots.clear();
+    m_cost_targets.clear();
+    m_cost_targets_directions.clear();
+    m_cost_targets_displacements.clear();
+    if (m_isolated)
+    {
+        COLA_ASSERT(start == src);
+        COLA_ASSERT(!lineRef->router()->RubberBandRouting);
+        isolatedPath->clear();
+    }
+
 #ifdef DEBUGHANDLER
     if (lineRef->router()->debugHandler())
     {
@@ -1070,17 +1201,14 @@ void AStarPathPrivate::search(ConnRef *lineRef, VertInf *src, VertInf *tar, Vert
     }
     endPoints.push_back(tar->point);
     
-    // Heap of PENDING nodes.
-    std::vector<ANode *> PENDING;
-    PENDING.reserve(1000);
-
     size_t exploredCount = 0;
-    ANode node, ati;
+    ANode node;
     ANode *bestNode = nullptr;         // Temporary bestNode
-    bool bNodeFound = false;        // Flag if node is found in container
     int timestamp = 1;
 
     Router *router = lineRef->router();
+    bool useCompactGraph = 
+            router->routingOption(performRouteSearchOnCompactVisGraph);
     if (router->RubberBandRouting && (start != src))
     {
         COLA_ASSERT(router->IgnoreRegions == true);
@@ -1129,15 +1257,13 @@ void AStarPathPrivate::search(ConnRef *lineRef, VertInf *src, VertInf *tar, Vert
 
             if (curr != start)
             {
-                bool addToPending = false;
-                bestNode = newANode(node, addToPending);
-                bestNode->inf->aStarDoneNodes.push_back(bestNode);
+                bestNode = newANode(node);
+                addDoneNode(bestNode);
                 ++exploredCount;
             }
             else
             {
-                ANode * newNode = newANode(node);
-                PENDING.push_back(newNode);
+                addPendingNode(newANode(node));
             }
 
             rIndx++;
@@ -1154,10 +1280,8 @@ void AStarPathPrivate::search(ConnRef *lineRef, VertInf *src, VertInf *tar, Vert
             // nodes as if they were already in the Done set.  This causes 
             // us to first search in a collinear direction from the previous 
             // segment.
-            bool addToPending = false;
-            bestNode = newANode(ANode(start->pathNext, timestamp++), 
-                    addToPending);
-            bestNode->inf->aStarDoneNodes.push_back(bestNode);
+            bestNode = newANode(ANode(start->pathNext, timestamp++));
+            addDoneNode(bestNode);
             ++exploredCount;
         }
 
@@ -1170,24 +1294,21 @@ void AStarPathPrivate::search(ConnRef *lineRef, VertInf *src, VertInf *tar, Vert
         node.prevNode = bestNode;
 
         // Populate the PENDING container with the first location
-        ANode *newNode = newANode(node);
-        PENDING.push_back(newNode);
+        addPendingNode(newANode(node));
     }
 
-    tar->pathNext = nullptr;
-
-    // Create a heap from PENDING for sorting
-    using std::make_heap; using std::push_heap; using std::pop_heap;
-    make_heap( PENDING.begin(), PENDING.end(), pendingCmp);
+    if (!m_isolated)
+    {
+        tar->pathNext = nullptr;
+    }
 
     // Continue until the queue is empty.
-    while (!PENDING.empty())
+    while (!m_pending.empty())
     {
-        TIMER_VAR_ADD(router, 0, 1);
         // Set the Node with lowest f value to BESTNODE.
         // Since the ANode operator< is reversed, the head of the
         // heap is the node with the lowest f value.
-        bestNode = PENDING.front();
+        bestNode = m_pending.top();
         VertInf *bestNodeInf = bestNode->inf;
 
 #ifdef DEBUGHANDLER
@@ -1205,30 +1326,8 @@ void AStarPathPrivate::search(ConnRef *lineRef, VertInf *src, VertInf *tar, Vert
         }
 #endif
 
-        // Remove this node from the aStarPendingList
-        std::list<ANode *>::iterator finishIt = 
-                bestNodeInf->aStarPendingNodes.end();
-        for (std::list<ANode *>::iterator currInd = 
-                bestNodeInf->aStarPendingNodes.begin(); currInd != finishIt; 
-                ++currInd)
-        {
-            if (*currInd == bestNode)
-            {
-                bestNodeInf->aStarPendingNodes.erase(currInd);
-                break;
-            }
-        }
-
-        // Pop off the heap.  Actually this moves the
-        // far left value to the far right.  The node
-        // is not actually removed since the pop is to
-        // the heap and not the container.
-        pop_heap(PENDING.begin(), PENDING.end(), pendingCmp);
-        // Remove node from right (the value we pop_heap'd)
-        PENDING.pop_back();
-
-        // Add the bestNode into the Done set.
-        bestNodeInf->aStarDoneNodes.push_back(bestNode);
+        // Pop off the heap, moving the bestNode into the Done set.
+        m_pending.pop();
         ++exploredCount;
 
         VertInf *prevInf = (bestNode->prevNode) ? bestNode->prevNode->inf : nullptr;
@@ -1247,12 +1346,16 @@ void AStarPathPrivate::search(ConnRef *lineRef, VertInf *src, VertInf *tar, Vert
 
         if (bestNodeInf == tar)
         {
-            TIMER_VAR_ADD(router, 1, PENDING.size());
             // This node is our goal.
 #ifdef ASTAR_DEBUG
             db_printf("LINE %10d  Steps: %4d  Cost: %g\n", lineRef->id(), 
                     (int) exploredCount, bestNode->f);
 #endif
+            if (m_isolated)
+            {
+                recordIsolatedPath(bestNode, src, tar, *isolatedPath);
+                break;
+            }
      
             // Correct all the pathNext pointers.
             for (ANode *curr = bestNode; curr->prevNode; curr = curr->prevNode)
@@ -1271,26 +1374,54 @@ void AStarPathPrivate::search(ConnRef *lineRef, VertInf *src, VertInf *tar, Vert
         }
 
         // Check adjacent points in graph and add them to the queue.
-        EdgeInfList& visList = (!isOrthogonal) ?
-                bestNodeInf->visList : bestNodeInf->orthogVisList;
-        if (isOrthogonal)
+        const CompactVisGraph::Neighbour *compactBegin = nullptr;
+        const CompactVisGraph::Neighbour *compactEnd = nullptr;
+        if (useCompactGraph && router->compactVisGraph.neighbours(
+                bestNodeInf, isOrthogonal, compactBegin, compactEnd))
         {
-            // We would like to explore in a structured way, 
-            // so sort the points in the visList...
-            CmpVisEdgeRotation compare(prevInf);
-            visList.sort(compare);
+            m_neighbours.assign(compactBegin, compactEnd);
         }
-        EdgeInfList::const_iterator finish = visList.end();
-        for (EdgeInfList::const_iterator edge = visList.begin(); 
-                edge != finish; ++edge)
+        else
         {
-            if ((*edge)->isDisabled())
+            EdgeInfList& visList = (!isOrthogonal) ?
+                    bestNodeInf->visList : bestNodeInf->orthogVisList;
+            if (isOrthogonal && !m_isolated && !useCompactGraph)
+            {
+                // We would like to explore in a structured way, 
+                // so sort the points in the visList...
+                CmpVisEdgeRotation compare(prevInf);
+                visList.sort(compare);
+            }
+            m_neighbours.clear();
+            EdgeInfList::const_iterator visFinish = visList.end();
+            for (EdgeInfList::const_iterator edge = visList.begin(); 
+                    edge != visFinish; ++edge)
+            {
+                m_neighbours.push_back(
+                        CompactVisGraph::Neighbour(*edge, bestNodeInf));
+            }
+        }
+        if (isOrthogonal && (m_isolated || useCompactGraph))
+        {
+            // As above, but we can't reorder the shared list or snapshot, 
+            // so sort our copy instead.  Like std::list::sort, this is a 
+            // stable sort.
+            CmpNeighbourRotation compare(prevInf, bestNodeInf);
+            std::stable_sort(m_neighbours.begin(), m_neighbours.end(), 
+                    compare);
+        }
+        CompactVisGraph::NeighbourList::const_iterator finish = 
+                m_neighbours.end();
+        for (CompactVisGraph::NeighbourList::const_iterator neighbour = 
+                m_neighbours.begin(); neighbour != finish; ++neighbour)
+        {
+            if (neighbour->disabled)
             {
                 // Skip disabled edges.
                 continue;
             }
 
-            node = ANode((*edge)->otherVert(bestNodeInf), timestamp++);
+            node = ANode(neighbour->vert, timestamp++);
             
             // Set the index to the previous ANode that we reached
             // this ANode via.
@@ -1330,7 +1461,7 @@ void AStarPathPrivate::search(ConnRef *lineRef, VertInf *src, VertInf *tar, Vert
                 }
             }
 
-            if (isOrthogonal && !(*edge)->isDummyConnection())
+            if (isOrthogonal && !neighbour->dummyConnection)
             {
                 // Orthogonal routing optimisation.
                 // Skip the edges that don't lead to shape edges, or the 
@@ -1387,7 +1518,7 @@ void AStarPathPrivate::search(ConnRef *lineRef, VertInf *src, VertInf *tar, Vert
                 }
             }
 
-            double edgeDist = (*edge)->getDist();
+            double edgeDist = neighbour->dist;
 
             if (edgeDist == 0)
             {
@@ -1464,90 +1595,767 @@ void AStarPathPrivate::search(ConnRef *lineRef, VertInf *src, VertInf *tar, Vert
             db_printf(" - g: %3.1f h: %3.1f \n", node.g, node.h);
 #endif
 
-            bNodeFound = false;
+            // Check to see if this vertex has already been reached from
+            // bestNodeInf, i.e., whether it is already on PENDING or in 
+            // the Done set.
+            ANodeSlotMap::iterator slot = 
+                    m_node_slots.find(ANodeKey(node.inf, bestNodeInf));
+            if (slot == m_node_slots.end())
+            {
+                // Push NewNode onto PENDING
+                addPendingNode(newANode(node));
+            }
+            else if ((slot->second->heapIndex != ANode::notInHeap) && 
+                    (node.g < slot->second->g))
+            {
+                // Replace the existing node in PENDING, keeping its
+                // position in the heap, and then reposition it.
+                ANode *existing = slot->second;
+                size_t heapIndex = existing->heapIndex;
+                *existing = node;
+                existing->heapIndex = heapIndex;
+                m_pending.decreased(existing);
+            }
+            // Otherwise, it is already in the Done set, or on PENDING 
+            // with a lower cost, so we don't need to consider it.
+        }
+    }
+    router->profiler.countAStarNodesExpanded(exploredCount);
+}
+
 
-    
-            // Check to see if already on PENDING
-            std::list<ANode *>::const_iterator finish = node.inf->aStarPendingNodes.end();
-            for (std::list<ANode *>::const_iterator currInd = 
-                    node.inf->aStarPendingNodes.begin(); currInd != finish; ++currInd)
+
+// Given the goal ANode of an isolated search, writes the path into path.
+// This is equivalent to the pathNext links written by a normal search and 
+// their use via VertInf::pathLeadsBackTo(), but using a local map so that 
+// the shared vertices are not modified.
+//
+void AStarPathPrivate::recordIsolatedPath(ANode *bestNode, VertInf *src,
+        VertInf *tar, std::vector<VertInf *>& path) const
+{
+    std::unordered_map<const VertInf *, VertInf *, VertInfHash> pathNext;
+    for (ANode *curr = bestNode; curr->prevNode; curr = curr->prevNode)
+    {
+        pathNext[curr->inf] = curr->prevNode->inf;
+    }
+
+    path.clear();
+    for (VertInf *curr = tar; curr != src; )
+    {
+        if (!path.empty() && (curr == tar))
+        {
+            // We have a circular path, so path not found.
+            path.clear();
+            return;
+        }
+        path.push_back(curr);
+
+        std::unordered_map<const VertInf *, VertInf *, 
+                VertInfHash>::const_iterator next = pathNext.find(curr);
+        if (next == pathNext.end())
+        {
+            // Path not found.
+            path.clear();
+            return;
+        }
+        curr = next->second;
+
+        // Check we don't have an apparent infinite connector path.
+        COLA_ASSERT(path.size() < 20000);
+    }
+    path.push_back(src);
+    std::reverse(path.begin(), path.end());
+}
+
+
+// The state of an IncrementalPathSearch for reaching the vertex inf from
+// the vertex prev (nullptr for the source vertex).  As in LPA*, g is the
+// cost of the path found to this state and rhs is the cost of reaching it 
+// via its best predecessor, rhsPred, given that predecessor's g value.  A
+// node is in the heap while it is inconsistent (g != rhs) or stale.  A 
+// stale node's rhs needs recalculating, since the graph around it changed,
+// and a node with changedCosts also has steps to its successors whose 
+// costs may have changed.
+//
+class RepairNode
+{
+    public:
+        RepairNode(VertInf *vert, VertInf *prevVert)
+            : inf(vert),
+              prev(prevVert),
+              g(DBL_MAX),
+              rhs(DBL_MAX),
+              h(0),
+              keyF(0),
+              keyG(0),
+              rhsPred(nullptr),
+              order(0),
+              heapIndex(notInHeap),
+              stale(false),
+              changedCosts(false)
+        {
+        }
+
+        VertInf *inf;
+        VertInf *prev;
+        double g;
+        double rhs;
+        double h;
+        double keyF;
+        double keyG;
+        RepairNode *rhsPred;
+        unsigned long long order;
+        size_t heapIndex;
+        bool stale;
+        bool changedCosts;
+
+        static const size_t notInHeap = SIZE_MAX;
+};
+
+
+// Like ANodeCmp, this returns the opposite result so that the node with
+// the smallest key is at the top of the heap.  Nodes with equal keys are
+// taken most recently queued first, which, like the A* time-stamps, tends
+// to follow a single path rather than exploring several equal ones.
+//
+class RepairNodeCmp
+{
+    public:
+    bool operator()(const RepairNode *a, const RepairNode *b) const
+    {
+        if (fabs(a->keyF - b->keyF) > 0.0000001)
+        {
+            return a->keyF > b->keyF;
+        }
+        if (fabs(a->keyG - b->keyG) > 0.0000001)
+        {
+            return a->keyG > b->keyG;
+        }
+        return a->order < b->order;
+    }
+};
+
+
+// Search states are looked up by their pair of vertices.  Vertices move 
+// between searches, so these are hashed by their IDs, which don't change
+// while the search state is in use.
+//
+struct VertInfIDHash
+{
+    size_t operator()(const VertInf *vert) const
+    {
+        if (vert == nullptr)
+        {
+            return 0;
+        }
+        return combineHashes(std::hash<unsigned int>()(vert->id.objID),
+                std::hash<unsigned short>()(vert->id.vn));
+    }
+};
+
+struct RepairNodeKeyHash
+{
+    size_t operator()(const ANodeKey& key) const
+    {
+        VertInfIDHash vertHash;
+        return combineHashes(vertHash(key.first), vertHash(key.second));
+    }
+};
+typedef std::unordered_map<ANodeKey, RepairNode *, RepairNodeKeyHash> 
+        RepairNodeMap;
+
+
+class IncrementalPathSearchPrivate
+{
+    public:
+        IncrementalPathSearchPrivate()
+            : m_line_ref(nullptr),
+              m_src(nullptr),
+              m_tar(nullptr),
+              m_log_position(0),
+              m_next_order(0),
+              m_start(nullptr),
+              m_goal(nullptr, nullptr)
+        {
+        }
+        bool search(ConnRef *lineRef, std::vector<VertInf *>& path);
+
+    private:
+        bool canRepair(ConnRef *lineRef) const;
+        void reset(ConnRef *lineRef);
+        void applyGraphChanges(void);
+        void markChanged(VertInf *vert, VertInf *prev, 
+                const bool changedCosts);
+        RepairNode *findNode(const VertInf *vert, const VertInf *prev) const;
+        RepairNode *createNode(VertInf *vert, VertInf *prev);
+        double heuristic(const VertInf *vert) const;
+        double stepCost(const RepairNode *from, VertInf *to, 
+                EdgeInf *edge) const;
+        void calculateRhs(RepairNode *node);
+        void calculateGoalRhs(void);
+        void update(RepairNode *node);
+        void markStale(RepairNode *node);
+        void markDependentsStale(RepairNode *node);
+        void expand(RepairNode *node);
+        bool goalIsSettledBefore(const RepairNode *node) const;
+        void computeShortestPath(void);
+        bool recordPath(std::vector<VertInf *>& path) const;
+
+        // The connector and parameters the search state is for.
+        ConnRef *m_line_ref;
+        VertInf *m_src;
+        VertInf *m_tar;
+        Point m_src_point;
+        Point m_tar_point;
+        std::vector<double> m_parameters;
+        // The position in the router's VisGraphChangeLog up to which the
+        // changes have been applied to the search state.
+        unsigned long long m_log_position;
+
+        unsigned long long m_next_order;
+        std::deque<RepairNode> m_nodes;
+        RepairNodeMap m_node_map;
+        IndexedNodeHeap<RepairNode, RepairNodeCmp> m_heap;
+        // Vertices that have been reached by the search, and so from 
+        // which new edges need to be considered.
+        std::unordered_set<const VertInf *, VertInfIDHash> m_reached;
+        // The start state, and a state for having reached the target 
+        // (from any vertex).
+        RepairNode *m_start;
+        RepairNode m_goal;
+};
+
+
+// Returns the visibility edge between two vertices, or nullptr.
+static EdgeInf *visEdgeBetween(VertInf *vert1, VertInf *vert2)
+{
+    VertInf *from = vert1;
+    VertInf *to = vert2;
+    if (from->visListSize > to->visListSize)
+    {
+        std::swap(from, to);
+    }
+    for (EdgeInfList::const_iterator edge = from->visList.begin(); 
+            edge != from->visList.end(); ++edge)
+    {
+        if ((*edge)->otherVert(from) == to)
+        {
+            return *edge;
+        }
+    }
+    return nullptr;
+}
+
+
+bool IncrementalPathSearchPrivate::canRepair(ConnRef *lineRef) const
+{
+    Router *router = lineRef->router();
+    if ((lineRef != m_line_ref) || (m_start == nullptr) ||
+            (lineRef->src() != m_src) || (lineRef->dst() != m_tar) ||
+            (m_src->point != m_src_point) || (m_tar->point != m_tar_point) ||
+            (m_log_position < router->visGraphChanges.firstPosition()))
+    {
+        return false;
+    }
+    for (size_t p = 0; p < m_parameters.size(); ++p)
+    {
+        if (router->routingParameter((RoutingParameter) p) != m_parameters[p])
+        {
+            return false;
+        }
+    }
+    // Start afresh rather than keeping states for much of the graph that 
+    // may no longer be of use.
+    return m_nodes.size() <=
+            ((4 * (size_t) router->visGraph.size()) + 1024);
+}
+
+
+void IncrementalPathSearchPrivate::reset(ConnRef *lineRef)
+{
+    Router *router = lineRef->router();
+    m_line_ref = lineRef;
+    m_src = lineRef->src();
+    m_tar = lineRef->dst();
+    m_src_point = m_src->point;
+    m_tar_point = m_tar->point;
+    m_parameters.resize(lastRoutingParameterMarker);
+    for (size_t p = 0; p < m_parameters.size(); ++p)
+    {
+        m_parameters[p] = router->routingParameter((RoutingParameter) p);
+    }
+    m_log_position = router->visGraphChanges.endPosition();
+
+    m_heap.clear();
+    m_node_map.clear();
+    m_nodes.clear();
+    m_reached.clear();
+    m_next_order = 0;
+
+    m_goal = RepairNode(nullptr, nullptr);
+    m_start = createNode(m_src, nullptr);
+    m_start->rhs = 0;
+    update(m_start);
+}
+
+
+// Marks the states affected by the graph changes logged since the last 
+// search as stale, so they will be reconsidered.
+//
+void IncrementalPathSearchPrivate::applyGraphChanges(void)
+{
+    const VisGraphChangeLog& changes = m_src->_router->visGraphChanges;
+    for (unsigned long long pos = m_log_position; 
+            pos < changes.endPosition(); ++pos)
+    {
+        const VisGraphChangeLog::Change& change = changes.at(pos);
+        if (change.second)
+        {
+            markChanged(change.first, change.second, false);
+            markChanged(change.second, change.first, false);
+        }
+        else
+        {
+            // A moved vertex changes the costs of all the steps to, from
+            // and through it.  States for edges it no longer has are 
+            // covered by the changes that removed them.
+            VertInf *vert = change.first;
+            for (EdgeInfList::const_iterator edge = vert->visList.begin(); 
+                    edge != vert->visList.end(); ++edge)
             {
-                ati = **currInd;
-                // The (node.prevNode == ati.prevNode) is redundant, but may
-                // save checking the mosre costly prevNode->inf test if the
-                // Nodes are the same.
-                if ((node.inf == ati.inf) && 
-                        ((node.prevNode == ati.prevNode) ||
-                         (node.prevNode->inf == ati.prevNode->inf)))
-                {
-                    // If already on PENDING
-                    if (node.g < ati.g)
-                    {
-                        // Replace the existing node in PENDING
-                        **currInd = node;
-                        make_heap( PENDING.begin(), PENDING.end(), pendingCmp);
-                    }
-                    bNodeFound = true;
-                    break;
-                }
+                VertInf *other = (*edge)->otherVert(vert);
+                markChanged(vert, other, true);
+                markChanged(other, vert, true);
+            }
+        }
+    }
+    m_log_position = changes.endPosition();
+}
+
+
+void IncrementalPathSearchPrivate::markChanged(VertInf *vert, VertInf *prev,
+        const bool changedCosts)
+{
+    RepairNode *node = findNode(vert, prev);
+    if (node == nullptr)
+    {
+        // Only states whose predecessor vertex has been reached could have
+        // become reachable.
+        if ((prev == m_tar) || (m_reached.find(prev) == m_reached.end()))
+        {
+            return;
+        }
+        node = createNode(vert, prev);
+    }
+    node->h = heuristic(vert);
+    if (changedCosts)
+    {
+        node->changedCosts = true;
+    }
+    markStale(node);
+}
+
+
+RepairNode *IncrementalPathSearchPrivate::findNode(const VertInf *vert, 
+        const VertInf *prev) const
+{
+    RepairNodeMap::const_iterator found = 
+            m_node_map.find(ANodeKey(vert, prev));
+    return (found != m_node_map.end()) ? found->second : nullptr;
+}
+
+
+RepairNode *IncrementalPathSearchPrivate::createNode(VertInf *vert, 
+        VertInf *prev)
+{
+    m_nodes.push_back(RepairNode(vert, prev));
+    RepairNode *node = &(m_nodes.back());
+    node->h = heuristic(vert);
+    m_node_map[ANodeKey(vert, prev)] = node;
+    return node;
+}
+
+
+double IncrementalPathSearchPrivate::heuristic(const VertInf *vert) const
+{
+    return (vert == m_tar) ? 0 : euclideanDist(vert->point, m_tar->point);
+}
+
+
+// Returns the cost of the step from the state from to the vertex to, along
+// edge, or DBL_MAX if AStarPath wouldn't take this step.
+//
+double IncrementalPathSearchPrivate::stepCost(const RepairNode *from, 
+        VertInf *to, EdgeInf *edge) const
+{
+    VertInf *vert = from->inf;
+    VertInf *prev = from->prev;
+    if ((vert == m_tar) || edge->isDisabled() || (to == prev))
+    {
+        return DBL_MAX;
+    }
+    if (to->id.isConnPt() && (to != m_tar))
+    {
+        // Connectors searched for incrementally aren't attached to pins,
+        // so don't route through other connection points or pins.
+        return DBL_MAX;
+    }
+    double dist = edge->getDist();
+    if ((dist == 0) || !validateBendPoint(prev, vert, to))
+    {
+        return DBL_MAX;
+    }
+    ANode prevNode(prev, 0);
+    return cost(m_line_ref, dist, vert, to, (prev) ? &prevNode : nullptr);
+}
+
+
+void IncrementalPathSearchPrivate::calculateRhs(RepairNode *node)
+{
+    node->rhsPred = nullptr;
+    if (node == m_start)
+    {
+        node->rhs = 0;
+        return;
+    }
+    node->rhs = DBL_MAX;
+
+    VertInf *vert = node->inf;
+    VertInf *prev = node->prev;
+    EdgeInf *edge = visEdgeBetween(prev, vert);
+    if (edge == nullptr)
+    {
+        return;
+    }
+
+    std::vector<RepairNode *> preds;
+    if (prev == m_src)
+    {
+        preds.push_back(m_start);
+    }
+    for (EdgeInfList::const_iterator prevEdge = prev->visList.begin(); 
+            prevEdge != prev->visList.end(); ++prevEdge)
+    {
+        RepairNode *pred = findNode(prev, (*prevEdge)->otherVert(prev));
+        if (pred && (pred->g != DBL_MAX))
+        {
+            preds.push_back(pred);
+        }
+    }
+    for (size_t i = 0; i < preds.size(); ++i)
+    {
+        double step = stepCost(preds[i], vert, edge);
+        if ((step != DBL_MAX) && ((preds[i]->g + step) < node->rhs))
+        {
+            node->rhs = preds[i]->g + step;
+            node->rhsPred = preds[i];
+        }
+    }
+}
+
+
+void IncrementalPathSearchPrivate::calculateGoalRhs(void)
+{
+    m_goal.rhs = DBL_MAX;
+    m_goal.rhsPred = nullptr;
+    for (EdgeInfList::const_iterator edge = m_tar->visList.begin(); 
+            edge != m_tar->visList.end(); ++edge)
+    {
+        RepairNode *pred = findNode(m_tar, (*edge)->otherVert(m_tar));
+        if (pred && (pred->g < m_goal.rhs))
+        {
+            m_goal.rhs = pred->g;
+            m_goal.rhsPred = pred;
+        }
+    }
+}
+
+
+// Places the node in the heap with its current key if it is inconsistent 
+// or stale, or removes it from the heap otherwise.  A stale node's rhs is
+// unknown, so it is queued at the lowest cost it could possibly have.
+//
+void IncrementalPathSearchPrivate::update(RepairNode *node)
+{
+    if (!node->stale && (node->g == node->rhs))
+    {
+        if (node->heapIndex != RepairNode::notInHeap)
+        {
+            m_heap.remove(node);
+        }
+        return;
+    }
+
+    double key = std::min(node->g, node->rhs);
+    if (node->stale)
+    {
+        double lowerBound = (node->inf) ? 
+                euclideanDist(m_src->point, node->inf->point) :
+                euclideanDist(m_src->point, m_tar->point);
+        key = std::min(key, std::max(0.0, lowerBound - 0.000001));
+    }
+    node->keyG = key;
+    node->keyF = key + node->h;
+    node->order = m_next_order++;
+    if (node->heapIndex == RepairNode::notInHeap)
+    {
+        m_heap.push(node);
+    }
+    else
+    {
+        m_heap.changed(node);
+    }
+}
+
+
+void IncrementalPathSearchPrivate::markStale(RepairNode *node)
+{
+    node->stale = true;
+    update(node);
+}
+
+
+// Marks the states whose best path is via node as stale, since its cost 
+// has increased.
+//
+void IncrementalPathSearchPrivate::markDependentsStale(RepairNode *node)
+{
+    VertInf *vert = node->inf;
+    for (EdgeInfList::const_iterator edge = vert->visList.begin(); 
+            edge != vert->visList.end(); ++edge)
+    {
+        RepairNode *succ = findNode((*edge)->otherVert(vert), vert);
+        if (succ && (succ->rhsPred == node))
+        {
+            markStale(succ);
+        }
+    }
+    if (m_goal.rhsPred == node)
+    {
+        markStale(&m_goal);
+    }
+}
+
+
+// Settles the cost of the state as its rhs, and lowers the rhs of its 
+// successors where this gives them a cheaper path.
+//
+void IncrementalPathSearchPrivate::expand(RepairNode *node)
+{
+    node->g = node->rhs;
+    update(node);
+
+    VertInf *vert = node->inf;
+    m_reached.insert(vert);
+    if (vert == m_tar)
+    {
+        if (node->g < m_goal.rhs)
+        {
+            m_goal.rhs = node->g;
+            m_goal.rhsPred = node;
+            update(&m_goal);
+        }
+        return;
+    }
+
+    for (EdgeInfList::const_iterator edge = vert->visList.begin(); 
+            edge != vert->visList.end(); ++edge)
+    {
+        VertInf *other = (*edge)->otherVert(vert);
+        double step = stepCost(node, other, *edge);
+        if (step == DBL_MAX)
+        {
+            continue;
+        }
+        RepairNode *succ = findNode(other, vert);
+        if (succ == nullptr)
+        {
+            succ = createNode(other, vert);
+        }
+        if (!succ->stale && ((node->g + step) < succ->rhs))
+        {
+            succ->rhs = node->g + step;
+            succ->rhsPred = node;
+            update(succ);
+        }
+    }
+}
+
+
+// Returns whether the search can stop before the node at the top of the 
+// heap, with the goal's cost settled.  Nodes with an equal key to the goal
+// are not left, since they may be on the goal's path, but not yet have 
+// passed a cost increase on to the goal.
+//
+bool IncrementalPathSearchPrivate::goalIsSettledBefore(
+        const RepairNode *node) const
+{
+    if (m_goal.stale || (m_goal.g != m_goal.rhs) || (m_goal.g == DBL_MAX))
+    {
+        return false;
+    }
+    return (m_goal.g + 0.0000001) < node->keyF;
+}
+
+
+void IncrementalPathSearchPrivate::computeShortestPath(void)
+{
+    unsigned int exploredCount = 0;
+    while (!m_heap.empty())
+    {
+        RepairNode *node = m_heap.top();
+        if (goalIsSettledBefore(node))
+        {
+            break;
+        }
+        m_heap.pop();
+        ++exploredCount;
+
+        if (node == &m_goal)
+        {
+            if (m_goal.stale)
+            {
+                m_goal.stale = false;
+                calculateGoalRhs();
             }
-            if ( !bNodeFound ) // If Node NOT found on PENDING
+            else
             {
-                // Check to see if it is already in the Done set for this
-                // vertex.
-                for (std::list<ANode *>::const_iterator currInd = 
-                        node.inf->aStarDoneNodes.begin();
-                        currInd != node.inf->aStarDoneNodes.end(); ++currInd)
-                {
-                    ati = **currInd;
-                    // The (node.prevNode == ati.prevNode) is redundant, but may
-                    // save checking the mosre costly prevNode->inf test if the
-                    // Nodes are the same.
-                    if ((node.inf == ati.inf) && ati.prevNode &&
-                            ((node.prevNode == ati.prevNode) ||
-                             (node.prevNode->inf == ati.prevNode->inf)))
-                    {
-                        //COLA_ASSERT(node.g >= (ati.g - 10e-10));
-                        // This node is already in the Done set and the 
-                        // current node also has a higher g-value, so we 
-                        // don't need to consider this node.
-                        bNodeFound = true;
-                        break;
-                    }
-                }
+                m_goal.g = (m_goal.g > m_goal.rhs) ? m_goal.rhs : DBL_MAX;
             }
+            update(&m_goal);
+            continue;
+        }
 
-            if (!bNodeFound ) // If Node NOT in either Pending or Done.
+        if (node->stale)
+        {
+            node->stale = false;
+            calculateRhs(node);
+            if (node->changedCosts)
             {
-                // Push NewNode onto PENDING
-                ANode *newNode = newANode(node);
-                PENDING.push_back(newNode);
-                // Push NewNode onto heap
-                push_heap( PENDING.begin(), PENDING.end(), pendingCmp);
-
-#if 0
-                using std::cout; using std::endl;
-                // Display PENDING container (For Debugging)
-                cout << "PENDING:   ";
-                for (unsigned int i = 0; i < PENDING.size(); i++)
+                node->changedCosts = false;
+                if (node->g != DBL_MAX)
                 {
-                    cout << PENDING[i]->g << "," << PENDING[i]->h << ",";
-                    cout << PENDING[i]->inf << "," << PENDING[i]->pp << "  ";
+                    // The costs of steps from this state may have gone up,
+                    // so treat its path as if it has become more costly.
+                    node->g = DBL_MAX;
+                    markDependentsStale(node);
                 }
-                cout << endl << endl;
-#endif
             }
+            update(node);
+            continue;
+        }
+
+        if (node->g > node->rhs)
+        {
+            expand(node);
+        }
+        else
+        {
+            node->g = DBL_MAX;
+            markDependentsStale(node);
+            update(node);
+        }
+    }
+    m_src->_router->profiler.countAStarNodesExpanded(exploredCount);
+}
+
+
+// Records the path to the goal, checking that it is consistent with the 
+// costs of its steps.
+//
+bool IncrementalPathSearchPrivate::recordPath(
+        std::vector<VertInf *>& path) const
+{
+    path.clear();
+    if (m_goal.rhsPred == nullptr)
+    {
+        // There is no path.
+        return (m_goal.rhs == DBL_MAX);
+    }
+
+    double total = 0;
+    const RepairNode *curr = m_goal.rhsPred;
+    path.push_back(curr->inf);
+    while (curr != m_start)
+    {
+        const RepairNode *pred = curr->rhsPred;
+        if ((pred == nullptr) || (path.size() > m_nodes.size()))
+        {
+            return false;
+        }
+        EdgeInf *edge = visEdgeBetween(pred->inf, curr->inf);
+        double step = (edge) ? stepCost(pred, curr->inf, edge) : DBL_MAX;
+        if (step == DBL_MAX)
+        {
+            return false;
+        }
+        total += step;
+        path.push_back(pred->inf);
+        curr = pred;
+    }
+    std::reverse(path.begin(), path.end());
+    return fabs(total - m_goal.g) <= (0.000001 * std::max(1.0, total));
+}
+
+
+bool IncrementalPathSearchPrivate::search(ConnRef *lineRef, 
+        std::vector<VertInf *>& path)
+{
+    if (canRepair(lineRef))
+    {
+        applyGraphChanges();
+        computeShortestPath();
+        if (recordPath(path))
+        {
+            return true;
         }
     }
 
-    // Cleanup lists used to store Done and Pending sets for each vertex.
-    VertInf *endVert = router->vertices.end();
-    for (VertInf *k = router->vertices.connsBegin(); k != endVert;
-            k = k->lstNext)
+    // Search afresh.
+    reset(lineRef);
+    computeShortestPath();
+    if (recordPath(path))
+    {
+        return true;
+    }
+    reset(lineRef);
+    path.clear();
+    return false;
+}
+
+
+IncrementalPathSearch::IncrementalPathSearch()
+    : m_private(new IncrementalPathSearchPrivate())
+{
+}
+
+
+IncrementalPathSearch::~IncrementalPathSearch()
+{
+    delete m_private;
+}
+
+
+bool IncrementalPathSearch::canSearch(ConnRef *lineRef)
+{
+    Router *router = lineRef->router();
+    if ((lineRef->routingType() != ConnType_PolyLine) ||
+            !router->routingOption(performIncrementalPolylineRouteSearch) ||
+            router->RubberBandRouting ||
+            router->isInCrossingPenaltyReroutingStage())
     {
-        k->aStarDoneNodes.clear();
-        k->aStarPendingNodes.clear();
+        return false;
     }
+    // Cluster crossing penalties depend on the whole path so far.
+    return !(router->ClusteredRouting && !router->clusterRefs.empty() &&
+            (router->routingParameter(clusterCrossingPenalty) > 0));
+}
+
+
+bool IncrementalPathSearch::search(ConnRef *lineRef, 
+        std::vector<VertInf *>& path)
+{
+    return m_private->search(lineRef, path);
 }
 
 
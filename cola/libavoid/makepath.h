@@ -26,6 +26,8 @@
 #ifndef AVOID_MAKEPATH_H
 #define AVOID_MAKEPATH_H
 
+#include <cstddef>
+#include <vector>
 
 namespace Avoid {
 
@@ -41,10 +43,55 @@ class AStarPath
         ~AStarPath();
         void search(ConnRef *lineRef, VertInf *src, VertInf *tar, 
                 VertInf *start);
+        // Performs the same search as search(), but keeps all scratch
+        // state for the search within this object rather than on the 
+        // shared VertInf objects, and doesn't modify the visibility graph.
+        // Several isolated searches can thus be run concurrently, each 
+        // with its own AStarPath instance.  The vertices on the path found
+        // are returned in path (src first), which will be empty if there 
+        // is no path.  This does not support rubber-band routing or 
+        // checkpoints.
+        void searchIsolated(ConnRef *lineRef, VertInf *src, VertInf *tar,
+                std::vector<VertInf *>& path);
+        // The size in bytes of the blocks of search nodes that searches
+        // allocate from the router's memory pool.
+        static size_t nodeBlockSize(void);
     private:
         AStarPathPrivate *m_private;        
 };
 
+
+class IncrementalPathSearchPrivate;
+
+// Performs the route search for a poly-line connector, keeping the search
+// state between transactions.  When the connector next needs rerouting, 
+// the changes to the visibility graph recorded since then by the router's
+// VisGraphChangeLog are used to repair only the affected parts of the 
+// search, in the manner of Lifelong Planning A* (Koenig, Likhachev and 
+// Furcy, 2004), rather than searching afresh.  This finds routes of the 
+// same cost as AStarPath, though where several routes have equal cost it 
+// may choose a different one.
+//
+// Only connectors that AStarPath::searchIsolated() could route, and whose
+// route costs depend only on the vertices involved (i.e., no cluster
+// crossing or crossing penalties), can be searched for incrementally.
+class IncrementalPathSearch
+{
+    public:
+        IncrementalPathSearch();
+        ~IncrementalPathSearch();
+        // Returns whether lineRef can currently be routed incrementally.
+        static bool canSearch(ConnRef *lineRef);
+        // Searches for the route between the endpoints of lineRef, reusing
+        // the previous search if possible.  The vertices on the path are 
+        // returned in path (source first), which will be empty if there 
+        // is no path.  Returns false if the search could not be completed,
+        // in which case the connector should be routed with AStarPath.
+        bool search(ConnRef *lineRef, std::vector<VertInf *>& path);
+    private:
+        IncrementalPathSearchPrivate *m_private;
+};
+
 }
 
 #endif
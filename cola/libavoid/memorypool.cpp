@@ -0,0 +1,164 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ *
+ * Copyright (C) 2026  agent
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * Licensees holding a valid commercial license may use this file in
+ * accordance with the commercial license agreement provided with the
+ * library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):  agent
+*/
+
+
+#include <algorithm>
+
+#include "libavoid/memorypool.h"
+#include "libavoid/assertions.h"
+
+
+namespace Avoid {
+
+
+MemoryPool::MemoryPool(const size_t objectSize, const size_t objectsPerChunk,
+        const bool threadSafe)
+    : m_slot_size(0),
+      m_objects_per_chunk(std::max(objectsPerChunk, static_cast<size_t>(1))),
+      m_free_list(nullptr),
+      m_unused_chunk(0),
+      m_unused_slot(0),
+      m_thread_safe(threadSafe)
+{
+    // Each slot holds a header followed by the object, rounded up so that
+    // every header in a chunk is aligned.
+    const size_t headerSize = sizeof(Header);
+    m_slot_size = headerSize + 
+            ((objectSize + headerSize - 1) / headerSize) * headerSize;
+    m_stats.objectSize = objectSize;
+}
+
+
+MemoryPool::~MemoryPool()
+{
+    for (size_t i = 0; i < m_chunks.size(); ++i)
+    {
+        delete[] m_chunks[i];
+    }
+}
+
+
+void MemoryPool::addChunk(void)
+{
+    // Memory from new[] is suitably aligned for any type.
+    char *chunk = new char[m_slot_size * m_objects_per_chunk];
+    m_chunks.push_back(chunk);
+    m_stats.chunks++;
+    m_stats.capacity += m_objects_per_chunk;
+}
+
+
+std::unique_lock<std::mutex> MemoryPool::guard(void) const
+{
+    std::unique_lock<std::mutex> lock(m_mutex, std::defer_lock);
+    if (m_thread_safe)
+    {
+        lock.lock();
+    }
+    return lock;
+}
+
+
+void *MemoryPool::allocate(void)
+{
+    std::unique_lock<std::mutex> guard = this->guard();
+
+    Header *header = m_free_list;
+    if (header)
+    {
+        m_free_list = header->nextFree;
+    }
+    else
+    {
+        // Take the next unused slot, so consecutive allocations are
+        // adjacent in memory.
+        if (m_unused_slot == m_objects_per_chunk)
+        {
+            m_unused_chunk++;
+            m_unused_slot = 0;
+        }
+        if (m_unused_chunk == m_chunks.size())
+        {
+            addChunk();
+        }
+        header = reinterpret_cast<Header *>(m_chunks[m_unused_chunk] + 
+                (m_unused_slot * m_slot_size));
+        m_unused_slot++;
+    }
+    header->owner = this;
+
+    m_stats.liveObjects++;
+    m_stats.totalAllocations++;
+    m_stats.peakLiveObjects = 
+            std::max(m_stats.peakLiveObjects, m_stats.liveObjects);
+
+    return header + 1;
+}
+
+
+void MemoryPool::deallocate(void *ptr)
+{
+    if (ptr == nullptr)
+    {
+        return;
+    }
+
+    Header *header = static_cast<Header *>(ptr) - 1;
+    MemoryPool *pool = header->owner;
+    COLA_ASSERT(pool != nullptr);
+
+    std::unique_lock<std::mutex> guard = pool->guard();
+    COLA_ASSERT(pool->m_stats.liveObjects > 0);
+    header->nextFree = pool->m_free_list;
+    pool->m_free_list = header;
+    pool->m_stats.liveObjects--;
+}
+
+
+void MemoryPool::reset(void)
+{
+    std::unique_lock<std::mutex> guard = this->guard();
+    m_free_list = nullptr;
+    m_unused_chunk = 0;
+    m_unused_slot = 0;
+    m_stats.liveObjects = 0;
+}
+
+
+const MemoryPool *MemoryPool::owner(const void *ptr)
+{
+    COLA_ASSERT(ptr != nullptr);
+    return (static_cast<const Header *>(ptr) - 1)->owner;
+}
+
+
+MemoryPoolStatistics MemoryPool::statistics(void) const
+{
+    std::unique_lock<std::mutex> guard = this->guard();
+    return m_stats;
+}
+
+
+}
+
@@ -0,0 +1,137 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ *
+ * Copyright (C) 2026  agent
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * Licensees holding a valid commercial license may use this file in
+ * accordance with the commercial license agreement provided with the
+ * library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):  agent
+*/
+
+// A simple fixed-size object pool, used by the router to allocate the
+// many small graph objects it creates and destroys during routing.
+
+
+#ifndef AVOID_MEMORYPOOL_H
+#define AVOID_MEMORYPOOL_H
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "libavoid/dllexport.h"
+
+
+namespace Avoid {
+
+//! @brief  Usage information for one of the router's memory pools.
+//!
+struct AVOID_EXPORT MemoryPoolStatistics
+{
+    MemoryPoolStatistics()
+        : objectSize(0),
+          liveObjects(0),
+          peakLiveObjects(0),
+          totalAllocations(0),
+          chunks(0),
+          capacity(0)
+    {
+    }
+
+    //! @brief  The size in bytes of each object in the pool.
+    size_t objectSize;
+    //! @brief  The number of objects currently allocated.
+    size_t liveObjects;
+    //! @brief  The largest number of objects allocated at any one time.
+    size_t peakLiveObjects;
+    //! @brief  The number of allocations made over the pool's lifetime.
+    size_t totalAllocations;
+    //! @brief  The number of chunks obtained from the system allocator.
+    size_t chunks;
+    //! @brief  The number of objects that fit in the allocated chunks.
+    size_t capacity;
+};
+
+
+// Hands out fixed-size pieces of memory carved from larger chunks.  Freed
+// pieces are kept on a free list and reused by later allocations, and all
+// chunks are returned to the system when the pool is destroyed.  
+//
+// reset() frees every piece at once, keeping the chunks for later use.
+// The objects in the pool are not destroyed, so the caller must have
+// finished with them.
+//
+// Each piece is preceded by a small header recording its owning pool, so
+// memory can be returned with the static deallocate() method.  This lets
+// classes use the pool from their operator delete, where the object (and
+// hence its router) can no longer be examined.
+//
+// A pool is only locked if it is constructed as threadSafe, which is 
+// needed only for pools used from worker threads during routing.
+//
+class MemoryPool
+{
+    public:
+        MemoryPool(const size_t objectSize, const size_t objectsPerChunk,
+                const bool threadSafe = false);
+        ~MemoryPool();
+
+        void *allocate(void);
+        static void deallocate(void *ptr);
+        void reset(void);
+        // Returns the pool a piece of memory was allocated from.
+        static const MemoryPool *owner(const void *ptr);
+
+        MemoryPoolStatistics statistics(void) const;
+
+    private:
+        // Not copyable.
+        MemoryPool(const MemoryPool& other);
+        MemoryPool& operator=(const MemoryPool& rhs);
+
+        union Header
+        {
+            MemoryPool *owner;
+            Header *nextFree;
+            // Keep the objects following the header suitably aligned.
+            long double alignLongDouble;
+            void *alignPointer;
+        };
+
+        void addChunk(void);
+        // Returns a lock on the pool, which is only held if the pool is
+        // thread-safe.
+        std::unique_lock<std::mutex> guard(void) const;
+
+        size_t m_slot_size;
+        size_t m_objects_per_chunk;
+        std::vector<char *> m_chunks;
+        Header *m_free_list;
+        // Slots that have not been used since the last reset are handed
+        // out in address order from this position, before new chunks are
+        // added.
+        size_t m_unused_chunk;
+        size_t m_unused_slot;
+        MemoryPoolStatistics m_stats;
+        bool m_thread_safe;
+        mutable std::mutex m_mutex;
+};
+
+
+}
+
+#endif
@@ -32,6 +32,7 @@
 */
 
 #include <cfloat>
+#include <cstdlib>
 #include <vector>
 #include <algorithm>
 #include <string>
@@ -63,6 +64,64 @@ bool CmpEdgeInf::operator()(const EdgeInf *a, const EdgeInf *b) const
 }
 
 
+// Comparison for the vertex heap in the interleaved construction.
+bool HeapCmpMTSTVertex::operator()(const MTSTVertex *a, 
+        const MTSTVertex *b) const
+{
+    return a->sptfDist > b->sptfDist;
+}
+
+
+// Comparison for the bridging edge heap in the interleaved construction.
+bool CmpMTSTEdge::operator()(const MTSTEdge *a, const MTSTEdge *b) const
+{
+    return a->mtstDist > b->mtstDist;
+}
+
+
+// Orders vertices by their VertInf, with orthogonal partners after the 
+// real vertex at the same position.
+bool CmpMTSTVertexPtr::operator()(const MTSTVertex *a, 
+        const MTSTVertex *b) const
+{
+    if (a->vert != b->vert)
+    {
+        return a->vert < b->vert;
+    }
+    return a->isPartner < b->isPartner;
+}
+
+
+MTSTVertex::MTSTVertex(VertInf *vert, const bool isPartner)
+    : vert(vert),
+      isPartner(isPartner),
+      orthogonalPartner(nullptr),
+      partnerEdge(nullptr),
+      pathNext(nullptr),
+      treeRootPointer(nullptr),
+      sptfDist(DBL_MAX),
+      treeNode(nullptr),
+      heapIndex(notInHeap)
+{
+}
+
+
+MTSTVertex *MTSTVertex::treeRoot(void) const
+{
+    return (treeRootPointer) ? *treeRootPointer : nullptr;
+}
+
+
+MTSTEdge::MTSTEdge(MTSTVertex *vert1, MTSTVertex *vert2, const double dist)
+    : vert1(vert1),
+      vert2(vert2),
+      dist(dist),
+      mtstDist(DBL_MAX),
+      heapIndex(notInHeap)
+{
+}
+
+
 struct delete_vertex
 {
     void operator()(VertInf *ptr)
@@ -135,39 +194,42 @@ void MinimumTerminalSpanningTree::unionSets(VertexSetList::iterator s1,
 HyperedgeTreeNode *MinimumTerminalSpanningTree::addNode(VertInf *vertex,
         HyperedgeTreeNode *prevNode)
 {
-    HyperedgeTreeNode *node = nullptr;
+    return addNode(nodes[vertex], vertex->point, prevNode);
+}
 
+HyperedgeTreeNode *MinimumTerminalSpanningTree::addNode(MTSTVertex *vertex,
+        HyperedgeTreeNode *prevNode)
+{
+    return addNode(vertex->treeNode, vertex->vert->point, prevNode);
+}
+
+// Adds the hyperedge tree node for a vertex, given the slot that stores 
+// the vertex's node.
+HyperedgeTreeNode *MinimumTerminalSpanningTree::addNode(
+        HyperedgeTreeNode *&node, const Point& point, 
+        HyperedgeTreeNode *prevNode)
+{
     // Do we already have a node for this vertex?
-    VertexNodeMap::iterator match = nodes.find(vertex);
-    if (match == nodes.end())
+    if (node == nullptr)
     {
         // Not found.  Create new node.
-        HyperedgeTreeNode *newNode = new HyperedgeTreeNode();
-        newNode->point = vertex->point;
-        // Remember it.
-        nodes[vertex] = newNode;
-
-        node = newNode;
+        node = new HyperedgeTreeNode();
+        node->point = point;
     }
-    else
+    else if (!isJunctionNode(node))
     {
-        // Found.
-        HyperedgeTreeNode *junctionNode = match->second;
-        if (junctionNode->junction == nullptr)
+        // Found.  It needs a junction, if one has not already been noted.
+        // The junctions are created later by createJunctions(), since 
+        // this may be running on a worker thread.
+        junctionNodes.push_back(node);
+        junctionNodeSet.insert(node);
+        if (m_rootJunction == nullptr)
         {
-            // Create a junction, if one has not already been created.
-            junctionNode->junction = new JunctionRef(router, vertex->point);
-            if (m_rootJunction == nullptr)
-            {
-                // Remember the first junction node, so we can use it to
-                // traverse the tree, added and connecting connectors to
-                // junctions and endpoints.
-                m_rootJunction = junctionNode;
-            }
-            router->removeObjectFromQueuedActions(junctionNode->junction);
-            junctionNode->junction->makeActive();
+            // Remember the first junction node, so we can use it to
+            // traverse the tree, added and connecting connectors to
+            // junctions and endpoints.
+            m_rootJunction = node;
         }
-        node = junctionNode;
     }
 
     if (prevNode)
@@ -179,10 +241,29 @@ HyperedgeTreeNode *MinimumTerminalSpanningTree::addNode(VertInf *vertex,
     return node;
 }
 
+bool MinimumTerminalSpanningTree::isJunctionNode(HyperedgeTreeNode *node) const
+{
+    return (node->junction != nullptr) || 
+            (junctionNodeSet.find(node) != junctionNodeSet.end());
+}
+
+void MinimumTerminalSpanningTree::createJunctions(void)
+{
+    for (size_t i = 0; i < junctionNodes.size(); ++i)
+    {
+        HyperedgeTreeNode *junctionNode = junctionNodes[i];
+        junctionNode->junction = new JunctionRef(router, junctionNode->point);
+        router->removeObjectFromQueuedActions(junctionNode->junction);
+        junctionNode->junction->makeActive();
+    }
+    junctionNodes.clear();
+    junctionNodeSet.clear();
+}
+
 void MinimumTerminalSpanningTree::buildHyperedgeTreeToRoot(VertInf *currVert,
-        HyperedgeTreeNode *prevNode, VertInf *prevVert, bool markEdges)
+        HyperedgeTreeNode *prevNode)
 {
-    if (prevNode->junction)
+    if (isJunctionNode(prevNode))
     {
         // We've reached a junction, so stop.
         return;
@@ -197,31 +278,58 @@ void MinimumTerminalSpanningTree::buildHyperedgeTreeToRoot(VertInf *currVert,
         // Add the node, if necessary.
         HyperedgeTreeNode *currentNode = addNode(currVert, prevNode);
 
-        if (markEdges)
+        if (isJunctionNode(currentNode))
         {
-            //COLA_ASSERT( !(currVert->id == dimensionChangeVertexID) );
-            //COLA_ASSERT( !(prevVert->id == dimensionChangeVertexID) );
-            EdgeInf *edge = prevVert->hasNeighbour(currVert, isOrthogonal);
-            if (edge == nullptr && (currVert->id == dimensionChangeVertexID))
-            {
-                VertInf *modCurr = (currVert->id == dimensionChangeVertexID) ?
-                        currVert->m_orthogonalPartner : currVert;
-                VertInf *modPrev = (prevVert->id == dimensionChangeVertexID) ?
-                        prevVert->m_orthogonalPartner : prevVert;
-                edge = modPrev->hasNeighbour(modCurr, isOrthogonal);
-            }
-            COLA_ASSERT(edge);
-            edge->setHyperedgeSegment(true);
+            // We've reached a junction, so stop.
+            break;
+        }
+
+        if (currVert->pathNext == nullptr)
+        {
+            // This is a terminal of the hyperedge, mark the node with the
+            // vertex representing the endpoint of the connector so we can
+            // later use this to set the correct ConnEnd for the connector.
+            currentNode->finalVertex = currVert;
+        }
+
+        if (currVert->id.isDummyPinHelper())
+        {
+            // Note if we have an extra dummy vertex for connecting
+            // to possible connection pins.
+            currentNode->isPinDummyEndpoint = true;
         }
 
 #ifdef DEBUGHANDLER
-        if (router->debugHandler())
+        if (router->debugHandler() && currVert->pathNext)
         {
-            router->debugHandler()->mtstCommitToEdge(currVert, prevVert, false);
+            router->debugHandler()->mtstCommitToEdge(currVert->pathNext,
+                    currVert, false);
         }
 #endif
 
-        if (currentNode->junction)
+        prevNode = currentNode;
+        currVert = currVert->pathNext;
+    }
+}
+
+// As above, but for the search vertices of the interleaved construction.
+void MinimumTerminalSpanningTree::buildHyperedgeTreeToRoot(
+        MTSTVertex *currVert, HyperedgeTreeNode *prevNode)
+{
+    if (isJunctionNode(prevNode))
+    {
+        // We've reached a junction, so stop.
+        return;
+    }
+
+    COLA_ASSERT(currVert != nullptr);
+
+    while (currVert)
+    {
+        // Add the node, if necessary.
+        HyperedgeTreeNode *currentNode = addNode(currVert, prevNode);
+
+        if (isJunctionNode(currentNode))
         {
             // We've reached a junction, so stop.
             break;
@@ -229,27 +337,32 @@ void MinimumTerminalSpanningTree::buildHyperedgeTreeToRoot(VertInf *currVert,
 
         if (currVert->pathNext == nullptr)
         {
-            // This is a terminal of the hyperedge, mark the node with the
-            // vertex representing the endpoint of the connector so we can
-            // later use this to set the correct ConnEnd for the connector.
-            currentNode->finalVertex = currVert;
+            // This is a terminal of the hyperedge.
+            currentNode->finalVertex = currVert->vert;
         }
 
-        if (currVert->id.isDummyPinHelper())
+        if (!currVert->isPartner && currVert->vert->id.isDummyPinHelper())
         {
             // Note if we have an extra dummy vertex for connecting
             // to possible connection pins.
             currentNode->isPinDummyEndpoint = true;
         }
 
+#ifdef DEBUGHANDLER
+        if (router->debugHandler() && currVert->pathNext)
+        {
+            router->debugHandler()->mtstCommitToEdge(
+                    currVert->pathNext->vert, currVert->vert, false);
+        }
+#endif
+
         prevNode = currentNode;
-        prevVert = currVert;
         currVert = currVert->pathNext;
     }
 }
 
-
-VertInf **MinimumTerminalSpanningTree::resetDistsForPath(VertInf *currVert, VertInf **newRootVertPtr)
+MTSTVertex **MinimumTerminalSpanningTree::resetDistsForPath(
+        MTSTVertex *currVert, MTSTVertex **newRootVertPtr)
 {
     COLA_ASSERT(currVert != nullptr);
 
@@ -259,16 +372,16 @@ VertInf **MinimumTerminalSpanningTree::resetDistsForPath(VertInf *currVert, Vert
     {
         if (currVert->sptfDist == 0)
         {
-            VertInf **oldTreeRootPtr = currVert->treeRootPointer();
+            MTSTVertex **oldTreeRootPtr = currVert->treeRootPointer;
             // We've reached a junction, so stop.
             rewriteRestOfHyperedge(currVert, newRootVertPtr);
             return oldTreeRootPtr;
         }
 
         currVert->sptfDist = 0;
-        currVert->setTreeRootPointer(newRootVertPtr);
+        currVert->treeRootPointer = newRootVertPtr;
 
-        terminals.insert(currVert);
+        treeTerminals.insert(currVert);
 
         currVert = currVert->pathNext;
     }
@@ -390,8 +503,8 @@ void MinimumTerminalSpanningTree::constructSequential(void)
                 if ( ! extraVertex )
                 {
                     // Create the dummy node if necessary.
-                    extraVertex = new VertInf(router, dimensionChangeVertexID,
-                           u->point, false);
+                    extraVertex = new (router) VertInf(router,
+                            dimensionChangeVertexID, u->point, false);
                     extraVertices.push_back(extraVertex);
                     extraVertex->sptfDist = bendPenalty + u->sptfDist;
                     extraVertex->pathNext = u;
@@ -401,7 +514,8 @@ void MinimumTerminalSpanningTree::constructSequential(void)
                 }
                 // Add a copy of the ignored edge to the dummy node, so it
                 // may be explored later.
-                EdgeInf *extraEdge = new EdgeInf(extraVertex, v, isOrthogonal);
+                EdgeInf *extraEdge = new (router) EdgeInf(extraVertex, v,
+                        isOrthogonal);
                 extraEdge->setDist(edgeDist);
                 continue;
             }
@@ -506,10 +620,11 @@ void MinimumTerminalSpanningTree::constructSequential(void)
             }
 #endif
 
-            buildHyperedgeTreeToRoot(e->m_vert1->pathNext, node1, e->m_vert1);
-            buildHyperedgeTreeToRoot(e->m_vert2->pathNext, node2, e->m_vert2);
+            buildHyperedgeTreeToRoot(e->m_vert1->pathNext, node1);
+            buildHyperedgeTreeToRoot(e->m_vert2->pathNext, node2);
         }
     }
+    createJunctions();
 
     // Free the dummy nodes and edges created earlier.
     for_each(extraVertices.begin(), extraVertices.end(), delete_vertex());
@@ -520,62 +635,90 @@ void MinimumTerminalSpanningTree::constructSequential(void)
     TIMER_STOP(router);
 }
 
-VertInf *MinimumTerminalSpanningTree::orthogonalPartner(VertInf *vert,
+MTSTVertex *MinimumTerminalSpanningTree::searchVertex(VertInf *vert)
+{
+    std::unordered_map<const VertInf *, MTSTVertex *>::iterator found =
+            searchVertexMap.find(vert);
+    if (found != searchVertexMap.end())
+    {
+        return found->second;
+    }
+    searchVertices.push_back(MTSTVertex(vert, false));
+    MTSTVertex *vertex = &(searchVertices.back());
+    searchVertexMap[vert] = vertex;
+    return vertex;
+}
+
+MTSTEdge *MinimumTerminalSpanningTree::searchEdge(EdgeInf *edge)
+{
+    std::unordered_map<const EdgeInf *, MTSTEdge *>::iterator found =
+            searchEdgeMap.find(edge);
+    if (found != searchEdgeMap.end())
+    {
+        return found->second;
+    }
+    searchEdges.push_back(MTSTEdge(searchVertex(edge->m_vert1), 
+            searchVertex(edge->m_vert2), edge->getDist()));
+    MTSTEdge *searchEdge = &(searchEdges.back());
+    searchEdgeMap[edge] = searchEdge;
+    return searchEdge;
+}
+
+MTSTVertex **MinimumTerminalSpanningTree::makeTreeRootPointer(
+        MTSTVertex *root)
+{
+    treeRootSlots.push_back(root);
+    return &(treeRootSlots.back());
+}
+
+MTSTVertex *MinimumTerminalSpanningTree::orthogonalPartner(MTSTVertex *vert,
         double penalty)
 {
     if (penalty == 0)
     {
         penalty = bendPenalty;
     }
-    if (vert->m_orthogonalPartner == nullptr)
+    if (vert->orthogonalPartner == nullptr)
     {
-        vert->m_orthogonalPartner = new VertInf(router,
-                dimensionChangeVertexID, vert->point, false);
-        vert->m_orthogonalPartner->m_orthogonalPartner = vert;
-        extraVertices.push_back(vert->m_orthogonalPartner);
-        EdgeInf *extraEdge = new EdgeInf(vert->m_orthogonalPartner, vert,
-                isOrthogonal);
-        extraEdge->setDist(penalty);
+        searchVertices.push_back(MTSTVertex(vert->vert, true));
+        MTSTVertex *partner = &(searchVertices.back());
+        partner->orthogonalPartner = vert;
+        vert->orthogonalPartner = partner;
+        searchEdges.push_back(MTSTEdge(partner, vert, penalty));
+        partner->partnerEdge = &(searchEdges.back());
+        vert->partnerEdge = partner->partnerEdge;
     }
-    return vert->m_orthogonalPartner;
+    return vert->orthogonalPartner;
 }
 
 void MinimumTerminalSpanningTree::removeInvalidBridgingEdges()
 {
     // Look through the bridging edge heap for any now invalidated edges and
-    // remove these by only copying valid edges to the beHeapNew array.
-    size_t beHeapSize = beHeap.size();
-    std::vector<EdgeInf *> beHeapNew(beHeapSize);
-    size_t j = 0;
-    for (size_t i = 0; i < beHeapSize; ++i)
+    // then remove these from the heap.
+    const std::vector<MTSTEdge *>& edges = beHeap.nodes();
+    std::vector<MTSTEdge *> invalidEdges;
+    for (size_t i = 0; i < edges.size(); ++i)
     {
-        EdgeInf *e = beHeap[i];
+        MTSTEdge *e = edges[i];
 
-        VertexPair ends = realVerticesCountingPartners(e);
+        MTSTVertexPair ends = realVerticesCountingPartners(e);
         bool valid = (ends.first->treeRoot() != ends.second->treeRoot()) &&
                 ends.first->treeRoot() && ends.second->treeRoot() &&
-                (origTerminals.find(ends.first->treeRoot()) != origTerminals.end()) &&
-                (origTerminals.find(ends.second->treeRoot()) != origTerminals.end());
+                (treeRoots.find(ends.first->treeRoot()) != treeRoots.end()) &&
+                (treeRoots.find(ends.second->treeRoot()) != treeRoots.end());
         if (!valid)
         {
-            // This is an invalid edge, don't copy it to beHeapNew.
-            continue;
+            invalidEdges.push_back(e);
         }
-
-        // Copy the other bridging edges to beHeapNew.
-        beHeapNew[j] = beHeap[i];
-        ++j;
     }
-    beHeapNew.resize(j);
-    // Replace beHeap with beHeapNew
-    beHeap = beHeapNew;
-
-    // Remake the bridging edge heap, since we've deleted many elements.
-    std::make_heap(beHeap.begin(), beHeap.end(), beHeapCompare);
+    for (size_t i = 0; i < invalidEdges.size(); ++i)
+    {
+        beHeap.remove(invalidEdges[i]);
+    }
 }
 
 LayeredOrthogonalEdgeList MinimumTerminalSpanningTree::
-        getOrthogonalEdgesFromVertex(VertInf *vert, VertInf *prev)
+        getOrthogonalEdgesFromVertex(MTSTVertex *vert, MTSTVertex *prev)
 {
     LayeredOrthogonalEdgeList edgeList;
 
@@ -584,46 +727,47 @@ LayeredOrthogonalEdgeList MinimumTerminalSpanningTree::
     double penalty = (prev == nullptr) ? 0.1 : 0;
     orthogonalPartner(vert, penalty);
 
-    bool isRealVert = (vert->id != dimensionChangeVertexID);
-    VertInf *realVert = (isRealVert) ? vert : orthogonalPartner(vert);
-    COLA_ASSERT(realVert->id != dimensionChangeVertexID);
-    EdgeInfList& visList = (!isOrthogonal) ? realVert->visList : realVert->orthogVisList;
+    bool isRealVert = !vert->isPartner;
+    MTSTVertex *realVert = (isRealVert) ? vert : orthogonalPartner(vert);
+    COLA_ASSERT(!realVert->isPartner);
+
+    // The edge to the vertex's orthogonal partner comes first.
+    MTSTVertex *partner = (isRealVert) ? realVert->orthogonalPartner : 
+            realVert;
+    if (partner != prev)
+    {
+        edgeList.push_back(std::make_pair(realVert->partnerEdge, partner));
+    }
+
+    const Point& realPoint = realVert->vert->point;
+    EdgeInfList& visList = (!isOrthogonal) ? realVert->vert->visList : 
+            realVert->vert->orthogVisList;
     EdgeInfList::const_iterator finish = visList.end();
     for (EdgeInfList::const_iterator edge = visList.begin(); edge != finish; ++edge)
     {
-        VertInf *other = (*edge)->otherVert(realVert);
-
-        if (other == orthogonalPartner(realVert))
-        {
-            VertInf *partner = (isRealVert) ? other : orthogonalPartner(other);
-            if (partner != prev)
-            {
-                edgeList.push_back(std::make_pair(*edge, partner));
-            }
-            continue;
-        }
+        MTSTVertex *other = searchVertex((*edge)->otherVert(realVert->vert));
 
-        VertInf *partner = (isRealVert) ? other : orthogonalPartner(other);
+        MTSTVertex *partner = (isRealVert) ? other : orthogonalPartner(other);
         COLA_ASSERT(partner);
 
-        if (other->point.y == realVert->point.y)
+        if (other->vert->point.y == realPoint.y)
         {
             if (isRealVert && (prev != partner))
             {
-                edgeList.push_back(std::make_pair(*edge, partner));
+                edgeList.push_back(std::make_pair(searchEdge(*edge), partner));
             }
         }
-        else if (other->point.x == realVert->point.x)
+        else if (other->vert->point.x == realPoint.x)
         {
             if (!isRealVert && (prev != partner))
             {
-                edgeList.push_back(std::make_pair(*edge, partner));
+                edgeList.push_back(std::make_pair(searchEdge(*edge), partner));
             }
         }
         else
         {
             printf("Warning, nonorthogonal edge.\n");
-            edgeList.push_back(std::make_pair(*edge, other));
+            edgeList.push_back(std::make_pair(searchEdge(*edge), other));
         }
     }
 
@@ -632,24 +776,21 @@ LayeredOrthogonalEdgeList MinimumTerminalSpanningTree::
 
 void MinimumTerminalSpanningTree::constructInterleaved(void)
 {
-    // Perform an interleaved construction of the MTST and SPTF
-    // ========================================================
-    //
     TIMER_START(router, tmHyperedgeAlt);
+    buildInterleaved();
+    TIMER_STOP(router);
 
-    origTerminals = terminals;
+    createJunctions();
+}
 
-    // Initialisation
+void MinimumTerminalSpanningTree::buildInterleaved(void)
+{
+    // Perform an interleaved construction of the MTST and SPTF
+    // ========================================================
     //
-    VertInf *endVert = router->vertices.end();
-    for (VertInf *k = router->vertices.connsBegin(); k != endVert;
-            k = k->lstNext)
-    {
-        k->sptfDist = DBL_MAX;
-        k->pathNext = nullptr;
-        k->setTreeRootPointer(nullptr);
-        k->m_orthogonalPartner = nullptr;
-    }
+    // The search state of each vertex and edge is kept in an MTSTVertex
+    // or MTSTEdge, created when the search first reaches it, so that the
+    // router's visibility graph is only read.
 
 #ifdef DEBUGHANDLER
     if (router->debugHandler())
@@ -659,53 +800,44 @@ void MinimumTerminalSpanningTree::constructInterleaved(void)
     }
 #endif
 
-    COLA_ASSERT(rootVertexPointers.empty());
+    COLA_ASSERT(treeRootSlots.empty());
     for (std::set<VertInf *>::iterator ti = terminals.begin();
             ti != terminals.end(); ++ti)
     {
-        VertInf *t = *ti;
+        MTSTVertex *t = searchVertex(*ti);
         // This is a terminal, set a distance of zero.
         t->sptfDist = 0;
-        rootVertexPointers.push_back(t->makeTreeRootPointer(t));
-        vHeap.push_back(t);
-    }
-    for (EdgeInf *t = router->visOrthogGraph.begin();
-            t != router->visOrthogGraph.end(); t = t->lstNext)
-    {
-        t->setHyperedgeSegment(false);
+        t->treeRootPointer = makeTreeRootPointer(t);
+        treeTerminals.insert(t);
+        treeRoots.insert(t);
+        vHeap.push(t);
     }
 
-    std::make_heap(vHeap.begin(), vHeap.end(), vHeapCompare);
-
     // Shortest Path Terminal Forest construction
     //
     while ( ! vHeap.empty() )
     {
         // Take the lowest vertex from heap.
-        VertInf *u = vHeap.front();
+        MTSTVertex *u = vHeap.top();
 
         // There should be no orphaned vertices.
         COLA_ASSERT(u->treeRoot() != nullptr);
         COLA_ASSERT(u->pathNext || (u->sptfDist == 0));
 
-        if (!beHeap.empty() && u->sptfDist >= (0.5 * beHeap.front()->mtstDist()))
+        if (!beHeap.empty() && u->sptfDist >= (0.5 * beHeap.top()->mtstDist))
         {
-            // Take the lowest cost edge.
-            EdgeInf *e = beHeap.front();
-
-            // Pop the lowest cost edge off of the heap.
-            std::pop_heap(beHeap.begin(), beHeap.end(), beHeapCompare);
-            beHeap.pop_back();
+            // Take the lowest cost edge and pop it off of the heap.
+            MTSTEdge *e = beHeap.pop();
 
 #ifndef NDEBUG
-            VertexPair ends = realVerticesCountingPartners(e);
+            MTSTVertexPair ends = realVerticesCountingPartners(e);
 #endif
-            COLA_ASSERT(origTerminals.find(ends.first->treeRoot()) != origTerminals.end());
-            COLA_ASSERT(origTerminals.find(ends.second->treeRoot()) != origTerminals.end());
+            COLA_ASSERT(treeRoots.find(ends.first->treeRoot()) != treeRoots.end());
+            COLA_ASSERT(treeRoots.find(ends.second->treeRoot()) != treeRoots.end());
 
             commitToBridgingEdge(e);
 
-            if (origTerminals.size() == 1)
+            if (treeRoots.size() == 1)
             {
                 break;
             }
@@ -717,8 +849,7 @@ void MinimumTerminalSpanningTree::constructInterleaved(void)
         }
 
         // Pop the lowest vertex off the heap.
-        std::pop_heap(vHeap.begin(), vHeap.end(), vHeapCompare);
-        vHeap.pop_back();
+        vHeap.pop();
 
         // For each edge from this vertex...
         LayeredOrthogonalEdgeList edgeList = getOrthogonalEdgesFromVertex(u,
@@ -726,13 +857,14 @@ void MinimumTerminalSpanningTree::constructInterleaved(void)
         for (LayeredOrthogonalEdgeList::const_iterator edge = edgeList.begin();
                 edge != edgeList.end(); ++edge)
         {
-            VertInf *v = edge->second;
-            EdgeInf *e = edge->first;
-            double edgeDist = e->getDist();
+            MTSTVertex *v = edge->second;
+            MTSTEdge *e = edge->first;
+            double edgeDist = e->dist;
 
             // Assign a distance (length) of 1 for dummy visibility edges
             // which may not accurately reflect the real distance of the edge.
-            if (v->id.isDummyPinHelper() || u->id.isDummyPinHelper())
+            if ((!v->isPartner && v->vert->id.isDummyPinHelper()) || 
+                    (!u->isPartner && u->vert->id.isDummyPinHelper()))
             {
                 edgeDist = 1;
             }
@@ -765,16 +897,15 @@ void MinimumTerminalSpanningTree::constructInterleaved(void)
                 // to the heap of potentials to explore.
                 v->sptfDist = newCost;
                 v->pathNext = u;
-                v->setTreeRootPointer(u->treeRootPointer());
-                vHeap.push_back(v);
-                // This can change the cost of other vertices in the heap,
-                // so we need to remake it.
-                std::make_heap(vHeap.begin(), vHeap.end(), vHeapCompare);
+                v->treeRootPointer = u->treeRootPointer;
+                COLA_ASSERT(!vHeap.contains(v));
+                vHeap.push(v);
 
 #ifdef DEBUGHANDLER
                 if (router->debugHandler())
                 {
-                    router->debugHandler()->mtstGrowForestWithEdge(u, v, true);
+                    router->debugHandler()->mtstGrowForestWithEdge(u->vert, 
+                            v->vert, true);
                 }
 #endif
             }
@@ -784,49 +915,46 @@ void MinimumTerminalSpanningTree::constructInterleaved(void)
                 // a different tree.  Set the MTST distance for the bridging
                 // edge and push it to the priority queue of edges to consider
                 // during the extended Kruskal's algorithm.
-                double cost = v->sptfDist + u->sptfDist + e->getDist();
-                bool found = std::find(beHeap.begin(), beHeap.end(), e) != beHeap.end();
-                if (!found)
+                double cost = v->sptfDist + u->sptfDist + e->dist;
+                if (!beHeap.contains(e))
                 {
                     // We need to add the edge to the bridging edge heap.
-                    e->setMtstDist(cost);
-                    beHeap.push_back(e);
-                    std::push_heap(beHeap.begin(), beHeap.end(), beHeapCompare);
+                    e->mtstDist = cost;
+                    beHeap.push(e);
 #ifdef DEBUGHANDLER
                     if (router->debugHandler())
                     {
-                        router->debugHandler()->mtstPotentialBridgingEdge(u, v);
+                        router->debugHandler()->mtstPotentialBridgingEdge(
+                                u->vert, v->vert);
                     }
 #endif
                 }
                 else
                 {
                     // This edge is already in the bridging edge heap.
-                    if (cost < e->mtstDist())
+                    if (cost < e->mtstDist)
                     {
                         // Update the edge's mtstDist if we compute a lower
                         // cost than we had before.
-                        e->setMtstDist(cost);
-                        std::make_heap(beHeap.begin(), beHeap.end(), beHeapCompare);
+                        e->mtstDist = cost;
+                        beHeap.decreased(e);
                     }
                 }
             }
         }
     }
-    COLA_ASSERT(origTerminals.size() == 1);
-    TIMER_STOP(router);
-
-    // Free Root Vertex Points from all vertices.
-    for (std::list<VertInf **>::iterator curr = rootVertexPointers.begin();
-            curr != rootVertexPointers.end(); ++curr)
-    {
-        free(*curr);
-    }
-    rootVertexPointers.clear();
-
-    // Free the dummy nodes and edges created earlier.
-    for_each(extraVertices.begin(), extraVertices.end(), delete_vertex());
-    extraVertices.clear();
+    COLA_ASSERT(treeRoots.size() == 1);
+
+    // Free the search state.  The hyperedge tree refers only to VertInfs.
+    vHeap.clear();
+    beHeap.clear();
+    treeTerminals.clear();
+    treeRoots.clear();
+    searchVertexMap.clear();
+    searchEdgeMap.clear();
+    searchVertices.clear();
+    searchEdges.clear();
+    treeRootSlots.clear();
 }
 
 bool MinimumTerminalSpanningTree::connectsWithoutBend(VertInf *oldLeaf,
@@ -883,19 +1011,19 @@ bool MinimumTerminalSpanningTree::connectsWithoutBend(VertInf *oldLeaf,
     }
 }
 
-void MinimumTerminalSpanningTree::rewriteRestOfHyperedge(VertInf *vert,
-        VertInf **newTreeRootPtr)
+void MinimumTerminalSpanningTree::rewriteRestOfHyperedge(MTSTVertex *vert,
+        MTSTVertex **newTreeRootPtr)
 {
-    vert->setTreeRootPointer(newTreeRootPtr);
+    vert->treeRootPointer = newTreeRootPtr;
 
     LayeredOrthogonalEdgeList edgeList = getOrthogonalEdgesFromVertex(vert,
                 nullptr);
     for (LayeredOrthogonalEdgeList::const_iterator edge = edgeList.begin();
             edge != edgeList.end(); ++edge)
     {
-        VertInf *v = edge->second;
+        MTSTVertex *v = edge->second;
 
-        if (v->treeRootPointer() == newTreeRootPtr)
+        if (v->treeRootPointer == newTreeRootPtr)
         {
             // Already marked.
             continue;
@@ -910,7 +1038,8 @@ void MinimumTerminalSpanningTree::rewriteRestOfHyperedge(VertInf *vert,
     }
 }
 
-void MinimumTerminalSpanningTree::drawForest(VertInf *vert, VertInf *prev)
+void MinimumTerminalSpanningTree::drawForest(MTSTVertex *vert, 
+        MTSTVertex *prev)
 {
     if (prev == nullptr)
     {
@@ -927,7 +1056,7 @@ void MinimumTerminalSpanningTree::drawForest(VertInf *vert, VertInf *prev)
             colour = "red";
         }
 
-        COLA_ASSERT(vert->treeRootPointer() != nullptr);
+        COLA_ASSERT(vert->treeRootPointer != nullptr);
         COLA_ASSERT(vert->treeRoot() != nullptr);
         //fprintf(debug_fp, "<circle cx=\"%g\" cy=\"%g\" r=\"3\" db:sptfDist=\"%g\" "
         //        "style=\"fill: %s; stroke: %s; fill-opacity: 0.5; "
@@ -940,7 +1069,7 @@ void MinimumTerminalSpanningTree::drawForest(VertInf *vert, VertInf *prev)
     for (LayeredOrthogonalEdgeList::const_iterator edge = edgeList.begin();
             edge != edgeList.end(); ++edge)
     {
-        VertInf *v = edge->second;
+        MTSTVertex *v = edge->second;
 
         if (v->sptfDist == 0)
         {
@@ -951,9 +1080,10 @@ void MinimumTerminalSpanningTree::drawForest(VertInf *vert, VertInf *prev)
         {
             if (v->pathNext == vert)
             {
-                if (vert->point != v->point)
+                if (vert->vert->point != v->vert->point)
                 {
-                    router->debugHandler()->mtstGrowForestWithEdge(vert, v, false);
+                    router->debugHandler()->mtstGrowForestWithEdge(
+                            vert->vert, v->vert, false);
                 }
                 drawForest(v, vert);
             }
@@ -961,26 +1091,25 @@ void MinimumTerminalSpanningTree::drawForest(VertInf *vert, VertInf *prev)
     }
 }
 
-VertexPair MinimumTerminalSpanningTree::
-        realVerticesCountingPartners(EdgeInf *edge)
+MTSTVertexPair MinimumTerminalSpanningTree::
+        realVerticesCountingPartners(MTSTEdge *edge)
 {
-    VertInf *v1 = edge->m_vert1;
-    VertInf *v2 = edge->m_vert2;
+    MTSTVertex *v1 = edge->vert1;
+    MTSTVertex *v2 = edge->vert2;
 
-    VertexPair realVertices = std::make_pair(v1, v2);
+    MTSTVertexPair realVertices = std::make_pair(v1, v2);
 
-    if ((v1->id != dimensionChangeVertexID) &&
-            (v2->id != dimensionChangeVertexID) &&
-            (v1->point != v2->point) &&
-            (v1->point.x == v2->point.x))
+    if (!v1->isPartner && !v2->isPartner &&
+            (v1->vert->point != v2->vert->point) &&
+            (v1->vert->point.x == v2->vert->point.x))
     {
-        if (v1->m_orthogonalPartner)
+        if (v1->orthogonalPartner)
         {
-            realVertices.first = v1->m_orthogonalPartner;
+            realVertices.first = v1->orthogonalPartner;
         }
-        if (v2->m_orthogonalPartner)
+        if (v2->orthogonalPartner)
         {
-            realVertices.second = v2->m_orthogonalPartner;
+            realVertices.second = v2->orthogonalPartner;
         }
     }
 
@@ -988,52 +1117,58 @@ VertexPair MinimumTerminalSpanningTree::
 }
 
 
-void MinimumTerminalSpanningTree::commitToBridgingEdge(EdgeInf *e)
+void MinimumTerminalSpanningTree::commitToBridgingEdge(MTSTEdge *e)
 {
-    VertexPair ends = realVerticesCountingPartners(e);
-    VertInf *newRoot = std::min(ends.first->treeRoot(), ends.second->treeRoot());
-    VertInf *oldRoot = std::max(ends.first->treeRoot(), ends.second->treeRoot());
+    MTSTVertexPair ends = realVerticesCountingPartners(e);
+    // The tree roots are always real terminal vertices.  Keep the root 
+    // with the lower VertInf.
+    MTSTVertex *newRoot = ends.first->treeRoot();
+    MTSTVertex *oldRoot = ends.second->treeRoot();
+    if (oldRoot->vert < newRoot->vert)
+    {
+        std::swap(newRoot, oldRoot);
+    }
 
     // Connect this edge into the MTST by building HyperedgeTree nodes
     // and edges for this edge and the path back to the tree root.
     HyperedgeTreeNode *node1 = nullptr;
     HyperedgeTreeNode *node2 = nullptr;
 
-    VertInf *vert1 = ends.first;
-    VertInf *vert2 = ends.second;
+    MTSTVertex *vert1 = ends.first;
+    MTSTVertex *vert2 = ends.second;
     if (hyperedgeTreeJunctions)
     {
         node1 = addNode(vert1, nullptr);
         node2 = addNode(vert2, node1);
-        e->setHyperedgeSegment(true);
     }
 
 #ifdef DEBUGHANDLER
     if (router->debugHandler())
     {
-        router->debugHandler()->mtstCommitToEdge(vert1, vert2, true);
-        for (std::set<VertInf *>::iterator ti = terminals.begin();
-                ti != terminals.end(); ++ti)
+        router->debugHandler()->mtstCommitToEdge(vert1->vert, vert2->vert, 
+                true);
+        for (MTSTVertexSet::iterator ti = treeTerminals.begin();
+                ti != treeTerminals.end(); ++ti)
         {
             drawForest(*ti, nullptr);
         }
     }
 #endif
 
-    buildHyperedgeTreeToRoot(vert1->pathNext, node1, vert1, true);
-    buildHyperedgeTreeToRoot(vert2->pathNext, node2, vert2, true);
+    buildHyperedgeTreeToRoot(vert1->pathNext, node1);
+    buildHyperedgeTreeToRoot(vert2->pathNext, node2);
 
     // We are commmitting to a particular path and pruning back the shortest
     // path terminal forests from the roots of that path.  We do this by
     // rewriting the treeRootPointers for all the points on the current
     // hyperedge path to newTreeRootPtr.  The rest of the vertices in the
     // forest will be pruned by rewriting their treeRootPointer to nullptr.
-    VertInf **oldTreeRootPtr1 = vert1->treeRootPointer();
-    VertInf **oldTreeRootPtr2 = vert2->treeRootPointer();
-    origTerminals.erase(oldRoot);
-    VertInf **newTreeRootPtr = vert1->makeTreeRootPointer(newRoot);
-    rootVertexPointers.push_back(newTreeRootPtr);
-    vert2->setTreeRootPointer(newTreeRootPtr);
+    MTSTVertex **oldTreeRootPtr1 = vert1->treeRootPointer;
+    MTSTVertex **oldTreeRootPtr2 = vert2->treeRootPointer;
+    treeRoots.erase(oldRoot);
+    MTSTVertex **newTreeRootPtr = makeTreeRootPointer(newRoot);
+    vert1->treeRootPointer = newTreeRootPtr;
+    vert2->treeRootPointer = newTreeRootPtr;
 
     // Zero paths and rewrite the vertices on the hyperedge path to the
     // newTreeRootPtr.  Also, add vertices on path to the terminal set.
@@ -1050,45 +1185,43 @@ void MinimumTerminalSpanningTree::commitToBridgingEdge(EdgeInf *e)
 
     // We have found the full hyperedge path when we have joined all the
     // terminal sets into one.
-    if (origTerminals.size() == 1)
+    if (treeRoots.size() == 1)
     {
         return;
     }
 
-    // Remove newly orphaned vertices from vertex heap by only copying the
-    // valid vertices to vHeapNew array which then replaces vHeap.
-    std::vector<VertInf *> vHeapNew(vHeap.size());
-    size_t j = 0;
-    size_t vHeapSize = vHeap.size();
-    for (size_t i = 0; i < vHeapSize; ++i)
+    // Add all terminals back to the vertex heap, so they are explored from
+    // again.  Vertices on the new hyperedge path have become terminals and
+    // had their distances lowered to zero, so any of these still in the 
+    // heap need to be moved up to their new position.
+    for (MTSTVertexSet::iterator v2 = treeTerminals.begin();
+            v2 != treeTerminals.end(); ++v2)
     {
-        VertInf *v = vHeap[i];
-
-        if ((v->treeRoot() == nullptr))
+        COLA_ASSERT((*v2)->sptfDist == 0);
+        if (vHeap.contains(*v2))
         {
-            // This is an orphaned vertex.
-            continue;
+            vHeap.decreased(*v2);
+        }
+        else
+        {
+            vHeap.push(*v2);
         }
-
-        // Copy the other vertices to vHeapNew.
-        vHeapNew[j] = vHeap[i];
-        ++j;
     }
-    vHeapNew.resize(j);
-    // Replace vHeap with vHeapNew
-    vHeap = vHeapNew;
 
-    // Reset all terminals to zero.
-    for (std::set<VertInf *>::iterator v2 = terminals.begin();
-            v2 != terminals.end(); ++v2)
+    // Remove newly orphaned vertices from vertex heap.
+    const std::vector<MTSTVertex *>& heapVertices = vHeap.nodes();
+    std::vector<MTSTVertex *> orphanedVertices;
+    for (size_t i = 0; i < heapVertices.size(); ++i)
     {
-        COLA_ASSERT((*v2)->sptfDist == 0);
-        vHeap.push_back(*v2);
+        if (heapVertices[i]->treeRoot() == nullptr)
+        {
+            orphanedVertices.push_back(heapVertices[i]);
+        }
+    }
+    for (size_t i = 0; i < orphanedVertices.size(); ++i)
+    {
+        vHeap.remove(orphanedVertices[i]);
     }
-
-    // Rebuild the heap since some terminals will have had distances
-    // rewritten as well as the orphaned vertices being removed.
-    std::make_heap(vHeap.begin(), vHeap.end(), vHeapCompare);
 }
 
 }
@@ -26,12 +26,18 @@
 #define AVOID_MTST_H
 
 #include <cstdio>
+#include <cstdint>
 #include <set>
 #include <list>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 
 #include "libavoid/vertices.h"
 #include "libavoid/hyperedgetree.h"
+#include "libavoid/indexedheap.h"
 
 
 namespace Avoid {
@@ -43,7 +49,53 @@ class EdgeInf;
 
 typedef std::list<VertexSet> VertexSetList;
 
-typedef std::pair<EdgeInf *, VertInf *> LayeredOrthogonalEdge;
+struct MTSTEdge;
+
+// The state of a vertex in the shortest path terminal forest during the
+// interleaved construction of an MTST.  This is kept apart from the 
+// VertInf, so that the trees for separate hyperedges can be built at the
+// same time.  Each vertex may have an orthogonal partner at the same 
+// position, which continues paths in the other dimension and is joined 
+// to it by an edge with the cost of a bend.
+struct MTSTVertex
+{
+    MTSTVertex(VertInf *vert, const bool isPartner);
+
+    MTSTVertex *treeRoot(void) const;
+
+    VertInf *vert;
+    bool isPartner;
+    MTSTVertex *orthogonalPartner;
+    // The edge joining this vertex and its orthogonal partner.
+    MTSTEdge *partnerEdge;
+    MTSTVertex *pathNext;
+    MTSTVertex **treeRootPointer;
+    double sptfDist;
+    // The hyperedge tree node for this vertex, once it is on the tree.
+    HyperedgeTreeNode *treeNode;
+    size_t heapIndex;
+
+    static const size_t notInHeap = SIZE_MAX;
+};
+
+// A visibility edge, or the edge joining a vertex and its orthogonal 
+// partner, during the interleaved construction of an MTST.
+struct MTSTEdge
+{
+    MTSTEdge(MTSTVertex *vert1, MTSTVertex *vert2, const double dist);
+
+    MTSTVertex *vert1;
+    MTSTVertex *vert2;
+    double dist;
+    // The cost of joining the trees at either end with this edge.
+    double mtstDist;
+    size_t heapIndex;
+
+    static const size_t notInHeap = SIZE_MAX;
+};
+
+typedef std::pair<MTSTVertex *, MTSTVertex *> MTSTVertexPair;
+typedef std::pair<MTSTEdge *, MTSTVertex *> LayeredOrthogonalEdge;
 typedef std::list<LayeredOrthogonalEdge> LayeredOrthogonalEdgeList;
 
 // Comparison for the vertex heap in the extended Dijkstra's algorithm.
@@ -59,6 +111,30 @@ struct CmpEdgeInf
     bool operator()(const EdgeInf *a, const EdgeInf *b) const;
 };
 
+// Comparison for the vertex heap in the interleaved construction.
+struct HeapCmpMTSTVertex
+{
+    bool operator()(const MTSTVertex *a, const MTSTVertex *b) const;
+};
+
+
+// Comparison for the bridging edge heap in the interleaved construction.
+struct CmpMTSTEdge
+{
+    bool operator()(const MTSTEdge *a, const MTSTEdge *b) const;
+};
+
+
+// Orders the terminals of the interleaved construction by their vertices.
+struct CmpMTSTVertexPtr
+{
+    bool operator()(const MTSTVertex *a, const MTSTVertex *b) const;
+};
+
+typedef IndexedNodeHeap<MTSTVertex, HeapCmpMTSTVertex> MTSTVertexHeap;
+typedef IndexedNodeHeap<MTSTEdge, CmpMTSTEdge> MTSTEdgeHeap;
+typedef std::set<MTSTVertex *, CmpMTSTVertexPtr> MTSTVertexSet;
+
 
 // This class is not intended for public use.
 // It is used by the hyperedge routing code to build a minimum terminal
@@ -74,6 +150,15 @@ class MinimumTerminalSpanningTree
         // Uses Interleaved construction of the MTST and SPTF (heuristic 2 
         // from paper).  This is the preferred construction approach.
         void constructInterleaved(void);
+        // Performs constructInterleaved() up to building the hyperedge 
+        // tree, but without creating its junctions.  This only reads the
+        // router's visibility graph, so may be called for separate trees
+        // on separate threads.  createJunctions() must then be called on 
+        // the transaction's thread.
+        void buildInterleaved(void);
+        // Creates the junctions at the branching nodes of the hyperedge
+        // tree, in the order the nodes were found.
+        void createJunctions(void);
         // Uses Sequential construction of the MTST (heuristic 1 from paper).
         void constructSequential(void);
         
@@ -82,30 +167,40 @@ class MinimumTerminalSpanningTree
 
     private:
         void buildHyperedgeTreeToRoot(VertInf *curr, 
-                HyperedgeTreeNode *prevNode, VertInf *prevVert, 
-                bool markEdges = false);
-        VertInf **resetDistsForPath(VertInf *currVert, VertInf **newRootVertPtr);
-        void rewriteRestOfHyperedge(VertInf *vert, VertInf **newTreeRootPtr);
-        void drawForest(VertInf *vert, VertInf *prev);
+                HyperedgeTreeNode *prevNode);
+        void buildHyperedgeTreeToRoot(MTSTVertex *curr, 
+                HyperedgeTreeNode *prevNode);
+        MTSTVertex **resetDistsForPath(MTSTVertex *currVert, 
+                MTSTVertex **newRootVertPtr);
+        void rewriteRestOfHyperedge(MTSTVertex *vert, 
+                MTSTVertex **newTreeRootPtr);
+        void drawForest(MTSTVertex *vert, MTSTVertex *prev);
 
         void makeSet(VertInf *vertex);
         VertexSetList::iterator findSet(VertInf *vertex);
         void unionSets(VertexSetList::iterator s1, VertexSetList::iterator s2);
         HyperedgeTreeNode *addNode(VertInf *vertex, HyperedgeTreeNode *prevNode);
-
+        HyperedgeTreeNode *addNode(MTSTVertex *vertex, 
+                HyperedgeTreeNode *prevNode);
+        HyperedgeTreeNode *addNode(HyperedgeTreeNode *&node, 
+                const Point& point, HyperedgeTreeNode *prevNode);
+        bool isJunctionNode(HyperedgeTreeNode *node) const;
+
+        MTSTVertex *searchVertex(VertInf *vert);
+        MTSTEdge *searchEdge(EdgeInf *edge);
+        MTSTVertex **makeTreeRootPointer(MTSTVertex *root);
         void removeInvalidBridgingEdges(void);
-        void commitToBridgingEdge(EdgeInf *e);
+        void commitToBridgingEdge(MTSTEdge *e);
         bool connectsWithoutBend(VertInf *oldLeaf, VertInf *newLeaf);
-        LayeredOrthogonalEdgeList getOrthogonalEdgesFromVertex(VertInf *vert, 
-                VertInf *prev);
-        VertInf *orthogonalPartner(VertInf *vert, double penalty = 0);
-        VertexPair realVerticesCountingPartners(EdgeInf *edge);
+        LayeredOrthogonalEdgeList getOrthogonalEdgesFromVertex(
+                MTSTVertex *vert, MTSTVertex *prev);
+        MTSTVertex *orthogonalPartner(MTSTVertex *vert, double penalty = 0);
+        MTSTVertexPair realVerticesCountingPartners(MTSTEdge *edge);
 
 
         Router *router;
         bool isOrthogonal;
         std::set<VertInf *> terminals;
-        std::set<VertInf *> origTerminals;
         JunctionHyperedgeTreeNodeMap *hyperedgeTreeJunctions;
 
         VertexNodeMap nodes;
@@ -115,15 +210,30 @@ class MinimumTerminalSpanningTree
         std::list<VertInf *> visitedVertices;
         std::list<VertInf *> extraVertices;
         std::list<VertInf *> unusedVertices;
-        std::list<VertInf **> rootVertexPointers;
 
-        // Vertex heap for extended Dijkstra's algorithm.
-        std::vector<VertInf *> vHeap;
-        HeapCmpVertInf vHeapCompare;
+        // Nodes that need junctions, waiting for createJunctions().
+        std::vector<HyperedgeTreeNode *> junctionNodes;
+        std::unordered_set<HyperedgeTreeNode *> junctionNodeSet;
+
+        // The search state for the interleaved construction.
+        std::deque<MTSTVertex> searchVertices;
+        std::deque<MTSTEdge> searchEdges;
+        std::unordered_map<const VertInf *, MTSTVertex *> searchVertexMap;
+        std::unordered_map<const EdgeInf *, MTSTEdge *> searchEdgeMap;
+        std::deque<MTSTVertex *> treeRootSlots;
+        // The current tree terminals, including vertices on the paths 
+        // committed to, and the roots of the trees not yet joined.
+        MTSTVertexSet treeTerminals;
+        std::set<MTSTVertex *> treeRoots;
+
+        // Vertex heap for extended Dijkstra's algorithm.  This and the
+        // bridging edge heap are addressable, so entries can be updated
+        // in place when their distances change during the interleaved
+        // construction.
+        MTSTVertexHeap vHeap;
 
         // Bridging edge heap for the extended Kruskal's algorithm.
-        std::vector<EdgeInf *> beHeap;
-        CmpEdgeInf beHeapCompare;
+        MTSTEdgeHeap beHeap;
 
         const VertID dimensionChangeVertexID;
 };
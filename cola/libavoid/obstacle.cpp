@@ -49,7 +49,8 @@ Obstacle::Obstacle(Router *router, Polygon ply, const unsigned int id)
     VertInf *node = nullptr;
     for (size_t pt_i = 0; pt_i < routingPoly.size(); ++pt_i)
     {
-        node = new VertInf(m_router, i, routingPoly.ps[pt_i], addToRouterNow);
+        node = new (m_router) VertInf(m_router,
+                i, routingPoly.ps[pt_i], addToRouterNow);
 
         if (!m_first_vert)
         {
@@ -118,6 +119,11 @@ void Obstacle::setNewPoly(const Polygon& poly)
         curr = curr->shNext;
     }
     COLA_ASSERT(curr == m_first_vert);
+
+    if (m_active)
+    {
+        m_router->indexObstacle(this);
+    }
         
     // It may be that the polygon for the obstacle has been updated after
     // creating the shape.  These events may have been combined for a single
@@ -151,6 +157,8 @@ void Obstacle::makeActive(void)
     while (it != m_first_vert);
    
     m_active = true;
+
+    m_router->indexObstacle(this);
 }
 
 
@@ -160,6 +168,7 @@ void Obstacle::makeInactive(void)
     
     // Remove from shapeRefs list.
     m_router->m_obstacles.erase(m_router_obstacles_pos);
+    m_router->unindexObstacle(this);
 
     // Remove points from vertex list.
     VertInf *it = m_first_vert;
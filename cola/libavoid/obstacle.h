@@ -32,6 +32,7 @@
 
 #include <list>
 #include <set>
+#include <vector>
 
 #include <cstdio>
 
@@ -110,6 +111,16 @@ class Obstacle
         // Defined in visibility.cpp:
         void computeVisibilityNaive(void);
         void computeVisibilitySweep(void);
+        // Computes the visibility of the vertices of each of the given 
+        // obstacles and their connection pins, giving the same graph as 
+        // calling computeVisibilitySweep() and then 
+        // updatePinPolyLineVisibility() on each in turn.  The sweeps are 
+        // performed concurrently on up to threadCount threads (zero 
+        // meaning the number of hardware threads), then the edges are 
+        // added to the graph in order on the calling thread.
+        static void computeVisibilitySweeps(
+                const std::vector<Obstacle *>& obstacles,
+                const unsigned int threadCount);
        
         virtual void outputCode(FILE *fp) const = 0;
         void makeActive(void);
@@ -28,7 +28,11 @@
 #include <cmath>
 #include <set>
 #include <list>
+#include <map>
+#include <vector>
 #include <algorithm>
+#include <memory>
+#include <iterator>
 
 #include "libavoid/router.h"
 #include "libavoid/geomtypes.h"
@@ -41,6 +45,7 @@
 #include "libavoid/assertions.h"
 #include "libavoid/scanline.h"
 #include "libavoid/debughandler.h"
+#include "libavoid/parallel.h"
 
 // For debugging:
 //#define NUDGE_DEBUG
@@ -643,11 +648,190 @@ struct CmpVertInf
         {
             return u->point.y < v->point.y;
         }
-        return u < v;
+        // Vertices at the same position are ordered by creation, so the 
+        // same one is chosen for an intersection however the vertices 
+        // were allocated, e.g., when incrementally updating the graph.
+        return u->creationOrder < v->creationOrder;
     }
 };
 
 
+// A set of closed intervals in one dimension, used to describe the bands of
+// the orthogonal visibility graph that need regenerating.
+class IntervalSet
+{
+    public:
+        void add(double min, double max)
+        {
+            m_intervals.push_back(std::make_pair(min, max));
+        }
+        // Sorts the intervals and merges those that overlap.  Must be 
+        // called after adding intervals, before the set is queried.
+        void finalise(void)
+        {
+            std::sort(m_intervals.begin(), m_intervals.end());
+            std::vector<std::pair<double, double> > merged;
+            for (size_t i = 0; i < m_intervals.size(); ++i)
+            {
+                if (!merged.empty() && 
+                        (m_intervals[i].first <= merged.back().second))
+                {
+                    merged.back().second = std::max(merged.back().second,
+                            m_intervals[i].second);
+                }
+                else
+                {
+                    merged.push_back(m_intervals[i]);
+                }
+            }
+            m_intervals.swap(merged);
+        }
+        bool overlaps(double min, double max) const
+        {
+            // Find the first interval that doesn't finish before min.
+            std::vector<std::pair<double, double> >::const_iterator it =
+                    std::lower_bound(m_intervals.begin(), m_intervals.end(),
+                        min, finishesBefore);
+            return (it != m_intervals.end()) && (it->first <= max);
+        }
+        bool contains(double value) const
+        {
+            return overlaps(value, value);
+        }
+        // Finds the extent, from the start of the first to the end of the
+        // last, of the intervals overlapping min--max.  Returns false if
+        // there are none.
+        bool overlappingExtent(double min, double max, double& start,
+                double& end) const
+        {
+            std::vector<std::pair<double, double> >::const_iterator first =
+                    std::lower_bound(m_intervals.begin(), m_intervals.end(),
+                        min, finishesBefore);
+            std::vector<std::pair<double, double> >::const_iterator last =
+                    std::upper_bound(m_intervals.begin(), m_intervals.end(),
+                        max, startsAfter);
+            if (first >= last)
+            {
+                return false;
+            }
+            start = first->first;
+            end = (last - 1)->second;
+            return true;
+        }
+        size_t size(void) const
+        {
+            return m_intervals.size();
+        }
+        const std::pair<double, double>& operator[](size_t index) const
+        {
+            return m_intervals[index];
+        }
+    private:
+        static bool finishesBefore(const std::pair<double, double>& interval,
+                double value)
+        {
+            return interval.second < value;
+        }
+        static bool startsAfter(double value,
+                const std::pair<double, double>& interval)
+        {
+            return value < interval.first;
+        }
+
+        std::vector<std::pair<double, double> > m_intervals;
+};
+
+
+// The part of the orthogonal visibility graph being regenerated during an
+// incremental update.  This is made up of vertical bands (intervals of x
+// positions) and horizontal bands (intervals of y positions) that contain
+// obstacles and connection points that have changed.  Visibility edges 
+// overlapping any band are regenerated, the rest of the graph is kept.
+//
+// The sweeps only generate the visibility lines overlapping the region, 
+// and only sweep the obstacles and connection points overlapping its bands.
+// This finds the lines at positions within the bands, and the vertices of
+// the others within the region, see CrossingLines.  Where these lines meet
+// kept lines outside the region, the existing vertices are used as their 
+// breakpoints.
+//
+class OrthogonalVisGraphRegion
+{
+    public:
+        void addBox(const Box& box)
+        {
+            m_bands[XDIM].add(box.min.x, box.max.x);
+            m_bands[YDIM].add(box.min.y, box.max.y);
+        }
+        void addPoint(const Point& point)
+        {
+            m_bands[XDIM].add(point.x, point.x);
+            m_bands[YDIM].add(point.y, point.y);
+        }
+        void finalise(void)
+        {
+            m_bands[XDIM].finalise();
+            m_bands[YDIM].finalise();
+        }
+
+        // Whether the edge or point between a and b overlaps the region.
+        bool intersects(const Point& a, const Point& b) const
+        {
+            return m_bands[XDIM].overlaps(std::min(a.x, b.x),
+                        std::max(a.x, b.x)) ||
+                    m_bands[YDIM].overlaps(std::min(a.y, b.y),
+                        std::max(a.y, b.y));
+        }
+        // Whether a visibility line at pos in dimension dim, spanning 
+        // begin--finish in the other dimension, overlaps the region.
+        bool intersectsLine(size_t dim, double pos, double begin,
+                double finish) const
+        {
+            return m_bands[dim].contains(pos) ||
+                    m_bands[(dim + 1) % 2].overlaps(begin, finish);
+        }
+        // Whether a visibility line at pos in dimension dim lies entirely
+        // within the region.
+        bool containsLine(size_t dim, double pos) const
+        {
+            return m_bands[dim].contains(pos);
+        }
+        const IntervalSet& bands(size_t dim) const
+        {
+            return m_bands[dim];
+        }
+
+        // The obstacles and connection points overlapping the bands, which
+        // are all the sweeps consider.
+        std::vector<Obstacle *> m_obstacles;
+        std::vector<VertInf *> m_conn_points;
+        // The extent of the whole diagram, which is unchanged.
+        Box m_extent;
+
+    private:
+        // Indexed by dimension, i.e., XDIM gives the vertical bands.
+        IntervalSet m_bands[2];
+};
+
+
+// Adds an edge to the orthogonal visibility graph.  If region is given, 
+// then the graph is being incrementally updated and only edges within 
+// that region are added.
+static void addOrthogonalVisEdge(Router *router, VertInf *vert1,
+        VertInf *vert2, double dist, const OrthogonalVisGraphRegion *region)
+{
+    if (region && !region->intersects(vert1->point, vert2->point))
+    {
+        // This part of the graph has been kept.
+        return;
+    }
+    const bool orthogonal = true;
+    EdgeInf *edge = new (router, EdgeInf::OrthogonalGraphEdge) 
+            EdgeInf(vert1, vert2, orthogonal);
+    edge->setDist(dist);
+}
+
+
 typedef std::set<VertInf *, CmpVertInf> VertSet;
 
 // A set of points to break the line segment,
@@ -664,7 +848,14 @@ public:
         : begin(b),
           finish(f),
           pos(p),
-          shapeSide(ss)
+          shapeSide(ss),
+          line(nullptr),
+          lineFirst(),
+          lineLast(),
+          connBefore(false),
+          shapeEdgeBefore(false),
+          connAfter(false),
+          shapeEdgeAfter(false)
     {
         COLA_ASSERT(begin < finish);
 
@@ -681,7 +872,14 @@ public:
         : begin(bf),
           finish(bf),
           pos(p),
-          shapeSide(false)
+          shapeSide(false),
+          line(nullptr),
+          lineFirst(),
+          lineLast(),
+          connBefore(false),
+          shapeEdgeBefore(false),
+          connAfter(false),
+          shapeEdgeAfter(false)
     {
         if (bfvi)
         {
@@ -781,7 +979,8 @@ public:
         }
         if (!found)
         {
-            found = new VertInf(router, dummyOrthogID, Point(posX, pos));
+            found = new (router, VertInf::OrthogonalGraphVertex)
+                    VertInf(router, dummyOrthogID, Point(posX, pos));
             vertInfs.insert(found);
         }
         return found;
@@ -799,7 +998,7 @@ public:
         {
             if (begin != -DBL_MAX)
             {
-                vertInfs.insert(new
+                vertInfs.insert(new (router, VertInf::OrthogonalGraphVertex)
                         VertInf(router, dummyOrthogID, Point(begin, pos)));
             }
         }
@@ -818,7 +1017,7 @@ public:
         {
             if (finish != DBL_MAX)
             {
-                vertInfs.insert(new
+                vertInfs.insert(new (router, VertInf::OrthogonalGraphVertex)
                         VertInf(router, dummyOrthogID, Point(finish, pos)));
             }
         }
@@ -863,16 +1062,17 @@ public:
 
     // Set flags to show what can be passed on this visibility line.
     // This can be used later to disregard some edges in the visibility
-    // graph when routing particular connectors.
+    // graph when routing particular connectors.  The breakpoints are also
+    // marked as being on a line in this dimension.
     void setLongRangeVisibilityFlags(size_t dim)
     {
         // First, travel in one direction
-        bool seenConnPt = false;
-        bool seenShapeEdge = false;
+        bool seenConnPt = connBefore;
+        bool seenShapeEdge = shapeEdgeBefore;
         for (BreakpointSet::iterator nvert = breakPoints.begin();
                 nvert != breakPoints.end(); ++nvert)
         {
-            VertIDProps mask = 0;
+            VertIDProps mask = (dim == XDIM) ? X_LINE : Y_LINE;
             if (dim == XDIM)
             {
                 if (seenConnPt)
@@ -907,8 +1107,8 @@ public:
             }
         }
         // Then in the other direction
-        seenConnPt = false;
-        seenShapeEdge = false;
+        seenConnPt = connAfter;
+        seenShapeEdge = shapeEdgeAfter;
         for (BreakpointSet::reverse_iterator rvert = breakPoints.rbegin();
                 rvert != breakPoints.rend(); ++rvert)
         {
@@ -1032,7 +1232,8 @@ public:
             }
         }
     }
-    void generateVisibilityEdgesFromBreakpointSet(Router *router, size_t dim)
+    void generateVisibilityEdgesFromBreakpointSet(Router *router, size_t dim,
+            const OrthogonalVisGraphRegion *region = nullptr)
     {
         if (breakPoints.empty() || ((breakPoints.begin())->pos > begin))
         {
@@ -1051,7 +1252,8 @@ public:
                 // Add begin point.
                 Point point(pos, pos);
                 point[dim] = begin;
-                VertInf *vert = new VertInf(router, dummyOrthogID, point);
+                VertInf *vert = new (router, VertInf::OrthogonalGraphVertex)
+                        VertInf(router, dummyOrthogID, point);
                 breakPoints.insert(PosVertInf(begin, vert));
             }
         }
@@ -1071,15 +1273,16 @@ public:
                 // Add finish point.
                 Point point(pos, pos);
                 point[dim] = finish;
-                VertInf *vert = new VertInf(router, dummyOrthogID, point);
+                VertInf *vert = new (router, VertInf::OrthogonalGraphVertex)
+                        VertInf(router, dummyOrthogID, point);
                 breakPoints.insert(PosVertInf(finish, vert));
             }
         }
 
         // Set flags for orthogonal routing optimisation.
         setLongRangeVisibilityFlags(dim);
+        recordLineVertices(dim);
 
-        const bool orthogonal = true;
         BreakpointSet::iterator vert, last;
 #if 0
         last = breakPoints.end();
@@ -1132,10 +1335,9 @@ public:
                     bool canSeeDown = (vert->dirs & VisDirDown);
                     if (canSeeDown && !(side->vert->id.isConnPt()))
                     {
-                        EdgeInf *edge = new
-                                EdgeInf(side->vert, vert->vert, orthogonal);
-                        edge->setDist(vert->vert->point[dim] -
-                                side->vert->point[dim]);
+                        addOrthogonalVisEdge(router, side->vert, vert->vert,
+                                vert->vert->point[dim] -
+                                side->vert->point[dim], region);
                     }
 
                     // Give last visibility back to the first non-connector
@@ -1149,10 +1351,9 @@ public:
                     bool canSeeUp = (last->dirs & VisDirUp);
                     if (canSeeUp && (side != breakPoints.end()))
                     {
-                        EdgeInf *edge = new
-                                EdgeInf(last->vert, side->vert, orthogonal);
-                        edge->setDist(side->vert->point[dim] -
-                                last->vert->point[dim]);
+                        addOrthogonalVisEdge(router, last->vert, side->vert,
+                                side->vert->point[dim] -
+                                last->vert->point[dim], region);
                     }
                 }
 
@@ -1178,10 +1379,9 @@ public:
                 }
                 if (generateEdge)
                 {
-                    EdgeInf *edge =
-                            new EdgeInf(last->vert, vert->vert, orthogonal);
-                    edge->setDist(vert->vert->point[dim] -
-                            last->vert->point[dim]);
+                    addOrthogonalVisEdge(router, last->vert, vert->vert,
+                            vert->vert->point[dim] -
+                            last->vert->point[dim], region);
                 }
 
                 ++last;
@@ -1203,6 +1403,95 @@ public:
         }
     }
 
+    // Sets the record of the line this segment is, so that its vertices
+    // are recorded as it is generated.
+    void setLine(OrthogonalVisGraphSnapshot::Line *record)
+    {
+        line = record;
+        lineFirst = lineLast = line->second.vertices.end();
+    }
+
+    // Replaces the vertices of the recorded line from lineFirst to 
+    // lineLast with the breakpoints of this segment.  Where the segment is 
+    // only part of the line, the visibility property flags of the vertices
+    // either side of it depend on the breakpoints, so are updated too. 
+    // Moving away from the segment, these flags only change until one 
+    // is found that is already correct.  Connection points keep the flags
+    // of every line they have been on, so theirs aren't considered.
+    void recordLineVertices(size_t dim)
+    {
+        if (line == nullptr)
+        {
+            return;
+        }
+        const unsigned int lowConn = (dim == XDIM) ? XL_CONN : YL_CONN;
+        const unsigned int lowEdge = (dim == XDIM) ? XL_EDGE : YL_EDGE;
+        const unsigned int highConn = (dim == XDIM) ? XH_CONN : YH_CONN;
+        const unsigned int highEdge = (dim == XDIM) ? XH_EDGE : YH_EDGE;
+
+        bool hasConnPt = false;
+        bool hasShapeEdge = false;
+        for (BreakpointSet::iterator vert = breakPoints.begin();
+                vert != breakPoints.end(); ++vert)
+        {
+            hasConnPt |= vert->vert->id.isConnPt();
+            hasShapeEdge |= vert->vert->id.isOrthShapeEdge();
+        }
+
+        OrthogonalVisGraphSnapshot::LineVertices& vertices = 
+                line->second.vertices;
+        bool seenConnPt = hasConnPt || connAfter;
+        bool seenShapeEdge = hasShapeEdge || shapeEdgeAfter;
+        for (OrthogonalVisGraphSnapshot::LineVertices::iterator curr = 
+                lineFirst; curr != vertices.begin(); )
+        {
+            --curr;
+            VertInf *vert = curr->second;
+            if (vert->id.isConnPt())
+            {
+                seenConnPt = true;
+                continue;
+            }
+            unsigned int flags = (seenConnPt ? highConn : 0) | 
+                    (seenShapeEdge ? highEdge : 0);
+            if ((vert->orthogVisPropFlags & (highConn | highEdge)) == flags)
+            {
+                break;
+            }
+            vert->orthogVisPropFlags &= ~(highConn | highEdge);
+            vert->orthogVisPropFlags |= flags;
+            seenShapeEdge |= vert->id.isOrthShapeEdge();
+        }
+        seenConnPt = hasConnPt || connBefore;
+        seenShapeEdge = hasShapeEdge || shapeEdgeBefore;
+        for (OrthogonalVisGraphSnapshot::LineVertices::iterator curr = 
+                lineLast; curr != vertices.end(); ++curr)
+        {
+            VertInf *vert = curr->second;
+            if (vert->id.isConnPt())
+            {
+                seenConnPt = true;
+                continue;
+            }
+            unsigned int flags = (seenConnPt ? lowConn : 0) | 
+                    (seenShapeEdge ? lowEdge : 0);
+            if ((vert->orthogVisPropFlags & (lowConn | lowEdge)) == flags)
+            {
+                break;
+            }
+            vert->orthogVisPropFlags &= ~(lowConn | lowEdge);
+            vert->orthogVisPropFlags |= flags;
+            seenShapeEdge |= vert->id.isOrthShapeEdge();
+        }
+
+        vertices.erase(lineFirst, lineLast);
+        for (BreakpointSet::iterator vert = breakPoints.begin();
+                vert != breakPoints.end(); ++vert)
+        {
+            vertices.insert(lineLast, std::make_pair(vert->pos, vert->vert));
+        }
+    }
+
     double begin;
     double finish;
     double pos;
@@ -1212,6 +1501,18 @@ public:
 
     VertSet vertInfs;
     BreakpointSet breakPoints;
+
+    // If the lines are being recorded, the record of the line this segment
+    // is, or is part of, see CrossingLines.  The segment replaces its 
+    // vertices from lineFirst up to lineLast.  The other vertices may 
+    // include connection points or shape edges before and after these.
+    OrthogonalVisGraphSnapshot::Line *line;
+    OrthogonalVisGraphSnapshot::LineVertices::iterator lineFirst;
+    OrthogonalVisGraphSnapshot::LineVertices::iterator lineLast;
+    bool connBefore;
+    bool shapeEdgeBefore;
+    bool connAfter;
+    bool shapeEdgeAfter;
 private:
     // MSVC wants to generate the assignment operator and the default
     // constructor, but fails.  Therefore we declare them private and
@@ -1270,18 +1571,289 @@ class SegmentListWrapper
 };
 
 
+// The segments of a sweep, grouped by their position.
+typedef std::map<double, SegmentList> SegmentListsByPosition;
+
+// During an incremental update, the visibility lines that overlap the 
+// region but are at positions outside its bands.  These lines are 
+// unchanged, so they are created from the records the snapshot keeps
+// rather than by sweeping the whole diagram.  Only the part of each line
+// around the region is regenerated.  The sweeps find its vertices within 
+// the region, see addVertices(), and the kept vertices that bound it are 
+// taken from the record.
+//
+class CrossingLines
+{
+    public:
+        // The lines at positions in dimension dim.  This must be done 
+        // before the graph or the snapshot are changed.
+        CrossingLines(const OrthogonalVisGraphRegion& region,
+                OrthogonalVisGraphSnapshot& snapshot, size_t dim)
+            : m_region(region),
+              m_dim(dim)
+        {
+            typedef OrthogonalVisGraphSnapshot::LineVertices LineVertices;
+            const size_t otherDim = (dim + 1) % 2;
+            const IntervalSet& bands = region.bands(otherDim);
+            std::vector<OrthogonalVisGraphSnapshot::Line *> lines;
+            for (size_t i = 0; i < bands.size(); ++i)
+            {
+                snapshot.linesOverlapping(dim, bands[i].first, 
+                        bands[i].second, lines);
+            }
+            // Lines may overlap more than one band.
+            std::sort(lines.begin(), lines.end());
+            lines.erase(std::unique(lines.begin(), lines.end()), lines.end());
+
+            // The flags set by lines in this dimension.
+            const unsigned int lowConn = (otherDim == XDIM) ? 
+                    XL_CONN : YL_CONN;
+            const unsigned int lowEdge = (otherDim == XDIM) ? 
+                    XL_EDGE : YL_EDGE;
+            const unsigned int highConn = (otherDim == XDIM) ? 
+                    XH_CONN : YH_CONN;
+            const unsigned int highEdge = (otherDim == XDIM) ? 
+                    XH_EDGE : YH_EDGE;
+            for (size_t i = 0; i < lines.size(); ++i)
+            {
+                double pos = lines[i]->first;
+                double begin = lines[i]->second.begin;
+                double finish = lines[i]->second.finish;
+                double regionBegin, regionFinish;
+                if (region.containsLine(dim, pos) || 
+                        !bands.overlappingExtent(begin, finish, 
+                            regionBegin, regionFinish))
+                {
+                    continue;
+                }
+
+                // The vertices replaced are those from the first to last 
+                // band the line overlaps, and then those out to the 
+                // nearest vertices either side that are not connection
+                // points, since edges can pass over connection points.
+                LineVertices& vertices = lines[i]->second.vertices;
+                LineVertices::iterator first = 
+                        vertices.lower_bound(regionBegin);
+                LineVertices::iterator last = 
+                        vertices.upper_bound(regionFinish);
+                while (first != vertices.begin())
+                {
+                    const double firstPos = (--first)->first;
+                    bool connPoints = first->second->id.isConnPt();
+                    while ((first != vertices.begin()) && 
+                            (std::prev(first)->first == firstPos))
+                    {
+                        connPoints &= (--first)->second->id.isConnPt();
+                    }
+                    if (!connPoints)
+                    {
+                        break;
+                    }
+                }
+                while (last != vertices.end())
+                {
+                    const double lastPos = last->first;
+                    bool connPoints = true;
+                    while ((last != vertices.end()) && 
+                            (last->first == lastPos))
+                    {
+                        connPoints &= (last++)->second->id.isConnPt();
+                    }
+                    if (!connPoints)
+                    {
+                        break;
+                    }
+                }
+
+                // The line is shortened to the kept vertices at the ends
+                // of this part.
+                if (first != vertices.begin())
+                {
+                    begin = first->first;
+                }
+                if (last != vertices.end())
+                {
+                    finish = std::prev(last)->first;
+                }
+                SegmentList& atPos = m_lines[pos];
+                if (begin < finish)
+                {
+                    atPos.push_back(LineSegment(begin, finish, pos));
+                }
+                else
+                {
+                    atPos.push_back(LineSegment(begin, pos));
+                }
+                LineSegment& segment = atPos.back();
+                segment.line = lines[i];
+                segment.lineFirst = first;
+                segment.lineLast = last;
+                // Whether there are connection points or shape edges 
+                // before and after these vertices is found from the flags
+                // of those at their ends.  Only the flags of vertices that
+                // are not connection points are kept correct.
+                if (first != vertices.begin())
+                {
+                    LineVertices::iterator curr = first;
+                    while (curr->second->id.isConnPt())
+                    {
+                        ++curr;
+                    }
+                    unsigned int flags = curr->second->orthogVisPropFlags;
+                    segment.connBefore = false && ((flags & lowConn) != 0);
+                    segment.shapeEdgeBefore = false && ((flags & lowEdge) != 0);
+                }
+                if (last != vertices.end())
+                {
+                    LineVertices::iterator curr = std::prev(last);
+                    while (curr->second->id.isConnPt())
+                    {
+                        --curr;
+                    }
+                    unsigned int flags = curr->second->orthogVisPropFlags;
+                    segment.connAfter = ((flags & highConn) != 0);
+                    segment.shapeEdgeAfter = ((flags & highEdge) != 0);
+                }
+
+                for (LineVertices::iterator curr = first; curr != last; 
+                        ++curr)
+                {
+                    VertInf *vert = curr->second;
+                    if (region.intersects(vert->point, vert->point))
+                    {
+                        m_replaced_vertices.push_back(vert);
+                        continue;
+                    }
+                    // The kept vertices become breakpoints of the segment,
+                    // and their visibility property flags for the line are
+                    // set again.  Those at the ends of the line may also 
+                    // be at the end of another line here, which sets the 
+                    // flags for the other direction.
+                    m_kept_vertices.push_back(vert);
+                    if (!vert->id.isConnPt() && 
+                            (curr->first != vertices.begin()->first))
+                    {
+                        vert->orthogVisPropFlags &= ~(lowConn | lowEdge);
+                    }
+                    if (!vert->id.isConnPt() && 
+                            (curr->first != vertices.rbegin()->first))
+                    {
+                        vert->orthogVisPropFlags &= ~(highConn | highEdge);
+                    }
+                    if (dim == YDIM)
+                    {
+                        segment.vertInfs.insert(vert);
+                    }
+                    else
+                    {
+                        segment.breakPoints.insert(PosVertInf(curr->first,
+                                vert, getPosVertInfDirections(vert, YDIM)));
+                    }
+                }
+            }
+            for (SegmentListsByPosition::iterator curr = m_lines.begin();
+                    curr != m_lines.end(); ++curr)
+            {
+                curr->second.sort();
+            }
+        }
+
+        // The vertices of the lines within the region, which are replaced.
+        const std::vector<VertInf *>& replacedVertices(void) const
+        {
+            return m_replaced_vertices;
+        }
+        // The vertices of the lines that are kept, but whose edges crossing
+        // the region are replaced.
+        const std::vector<VertInf *>& keptVertices(void) const
+        {
+            return m_kept_vertices;
+        }
+
+        // Adds the vertices within the region of the segments the sweep 
+        // found at pos to the lines there.  Only the obstacles and 
+        // connection points overlapping the bands are swept, so the 
+        // vertices within the region are exactly those of a full sweep, 
+        // but the segments' extents and other vertices can differ.
+        void addVertices(double pos, const SegmentList& segments)
+        {
+            const size_t otherDim = (m_dim + 1) % 2;
+            SegmentListsByPosition::iterator lines = m_lines.find(pos);
+            for (SegmentList::const_iterator segment = segments.begin();
+                    segment != segments.end(); ++segment)
+            {
+                for (VertSet::const_iterator v = segment->vertInfs.begin();
+                        v != segment->vertInfs.end(); ++v)
+                {
+                    VertInf *vert = *v;
+                    if (!m_region.intersects(vert->point, vert->point))
+                    {
+                        continue;
+                    }
+                    COLA_ASSERT(lines != m_lines.end());
+                    if (lines == m_lines.end())
+                    {
+                        continue;
+                    }
+                    for (SegmentList::iterator line = lines->second.begin();
+                            line != lines->second.end(); ++line)
+                    {
+                        if ((line->begin <= vert->point[otherDim]) &&
+                                (vert->point[otherDim] <= line->finish))
+                        {
+                            line->vertInfs.insert(vert);
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        // Moves the lines into segments.
+        void moveTo(SegmentList& segments)
+        {
+            for (SegmentListsByPosition::iterator curr = m_lines.begin();
+                    curr != m_lines.end(); ++curr)
+            {
+                segments.splice(segments.end(), curr->second);
+            }
+            m_lines.clear();
+        }
+        // Moves the lines into the groups of segments at each position.
+        void moveTo(SegmentListsByPosition& groups)
+        {
+            for (SegmentListsByPosition::iterator curr = m_lines.begin();
+                    curr != m_lines.end(); ++curr)
+            {
+                SegmentList& group = groups[curr->first];
+                COLA_ASSERT(group.empty());
+                group.splice(group.end(), curr->second);
+            }
+            m_lines.clear();
+        }
+    private:
+        const OrthogonalVisGraphRegion& m_region;
+        size_t m_dim;
+        SegmentListsByPosition m_lines;
+        std::vector<VertInf *> m_replaced_vertices;
+        std::vector<VertInf *> m_kept_vertices;
+};
+
+
 // Given a router instance and a set of possible horizontal segments, and a
-// possible vertical visibility segment, compute and add edges to the
-// orthogonal visibility graph for all the visibility edges.
-static void intersectSegments(Router *router, SegmentList& segments,
-        LineSegment& vertLine)
+// possible vertical visibility segment, add the horizontal visibility 
+// edges up to the vertical segment, and the breakpoints where they 
+// intersect it.
+static void addIntersections(Router *router, SegmentList& segments,
+        LineSegment& vertLine, const OrthogonalVisGraphRegion *region)
 {
     // XXX: It seems that this case can sometimes occur... maybe when
     // there are many overlapping rectangles.
     //COLA_ASSERT(vertLine.beginVertInf() == nullptr);
     //COLA_ASSERT(vertLine.finishVertInf() == nullptr);
 
-    COLA_ASSERT(!segments.empty());
+    // For incremental updates, only the segments near the region are kept.
+    COLA_ASSERT(!segments.empty() || region);
     for (SegmentList::iterator it = segments.begin(); it != segments.end(); )
     {
         LineSegment& horiLine = *it;
@@ -1291,9 +1863,9 @@ static void intersectSegments(Router *router, SegmentList& segments,
 
         if (vertLine.pos < horiLine.begin)
         {
-            // We've yet to reach this segment in the sweep, so ignore.
-            ++it;
-            continue;
+            // We've yet to reach this segment in the sweep.  The segments
+            // are ordered by their beginning, so nor the rest of them.
+            break;
         }
         else if (vertLine.pos == horiLine.begin)
         {
@@ -1312,7 +1884,8 @@ static void intersectSegments(Router *router, SegmentList& segments,
                 horiLine.insertBreakpointsFinish(router, vertLine);
 
                 size_t dim = XDIM; // x-dimension
-                horiLine.generateVisibilityEdgesFromBreakpointSet(router, dim);
+                horiLine.generateVisibilityEdgesFromBreakpointSet(router, dim,
+                        region);
 
                 // And we've now finished with the segment, so delete.
                 it = segments.erase(it);
@@ -1325,7 +1898,8 @@ static void intersectSegments(Router *router, SegmentList& segments,
             horiLine.addEdgeHorizontal(router);
 
             size_t dim = XDIM; // x-dimension
-            horiLine.generateVisibilityEdgesFromBreakpointSet(router, dim);
+            horiLine.generateVisibilityEdgesFromBreakpointSet(router, dim,
+                    region);
 
             // We've now swept past this horizontal segment, so delete.
             it = segments.erase(it);
@@ -1353,10 +1927,21 @@ static void intersectSegments(Router *router, SegmentList& segments,
         }
         ++it;
     }
+}
+
+
+// Given a router instance and a set of possible horizontal segments, and a
+// possible vertical visibility segment, compute and add edges to the
+// orthogonal visibility graph for all the visibility edges.
+static void intersectSegments(Router *router, SegmentList& segments,
+        LineSegment& vertLine, const OrthogonalVisGraphRegion *region)
+{
+    addIntersections(router, segments, vertLine, region);
 
     // Split breakPoints set into visibility segments.
     size_t dimension = YDIM; // y-dimension
-    vertLine.generateVisibilityEdgesFromBreakpointSet(router, dimension);
+    vertLine.generateVisibilityEdgesFromBreakpointSet(router, dimension,
+            region);
 }
 
 
@@ -1415,10 +2000,12 @@ static void processEventVert(Router *router, NodeSet& scanline,
             if (minLimitMax >= maxLimitMin)
             {
                 // These vertices represent the shape corners.
-                VertInf *vI1 = new VertInf(router, dummyOrthogShapeID,
-                            Point(minShape, lineY));
-                VertInf *vI2 = new VertInf(router, dummyOrthogShapeID,
-                            Point(maxShape, lineY));
+                VertInf *vI1 = new (router, VertInf::OrthogonalGraphVertex)
+                        VertInf(router, dummyOrthogShapeID,
+                                Point(minShape, lineY));
+                VertInf *vI2 = new (router, VertInf::OrthogonalGraphVertex)
+                        VertInf(router, dummyOrthogShapeID,
+                                Point(maxShape, lineY));
 
                 // There are no overlapping shapes, so give full visibility.
                 if (minLimit < minShape)
@@ -1443,8 +2030,9 @@ static void processEventVert(Router *router, NodeSet& scanline,
                     LineSegment *line = segments.insert(
                             LineSegment(minLimit, minLimitMax, lineY, true));
                     // Shape corner:
-                    VertInf *vI1 = new VertInf(router, dummyOrthogShapeID,
-                                Point(minShape, lineY));
+                    VertInf *vI1 = new (router, VertInf::OrthogonalGraphVertex)
+                            VertInf(router, dummyOrthogShapeID,
+                                    Point(minShape, lineY));
                     line->vertInfs.insert(vI1);
                 }
                 if ((maxLimitMin < maxLimit) && (maxLimitMin <= maxShape))
@@ -1452,8 +2040,9 @@ static void processEventVert(Router *router, NodeSet& scanline,
                     LineSegment *line = segments.insert(
                             LineSegment(maxLimitMin, maxLimit, lineY, true));
                     // Shape corner:
-                    VertInf *vI2 = new VertInf(router, dummyOrthogShapeID,
-                                Point(maxShape, lineY));
+                    VertInf *vI2 = new (router, VertInf::OrthogonalGraphVertex)
+                            VertInf(router, dummyOrthogShapeID,
+                                    Point(maxShape, lineY));
                     line->vertInfs.insert(vI2);
                 }
             }
@@ -1498,7 +2087,8 @@ static void processEventVert(Router *router, NodeSet& scanline,
                 // *through* connector endpoint vertices).
                 if (line1 || line2)
                 {
-                    VertInf *cent = new VertInf(router, dummyOrthogID, cp);
+                    VertInf *cent = new (router, VertInf::OrthogonalGraphVertex)
+                            VertInf(router, dummyOrthogID, cp);
                     if (line1)
                     {
                         line1->vertInfs.insert(cent);
@@ -1600,10 +2190,12 @@ static void processEventHori(Router *router, NodeSet& scanline,
                         LineSegment(minLimit, maxLimit, lineX));
 
                 // Shape corners:
-                VertInf *vI1 = new VertInf(router, dummyOrthogShapeID,
-                        Point(lineX, minShape));
-                VertInf *vI2 = new VertInf(router, dummyOrthogShapeID,
-                        Point(lineX, maxShape));
+                VertInf *vI1 = new (router, VertInf::OrthogonalGraphVertex)
+                        VertInf(router, dummyOrthogShapeID,
+                                Point(lineX, minShape));
+                VertInf *vI2 = new (router, VertInf::OrthogonalGraphVertex)
+                        VertInf(router, dummyOrthogShapeID,
+                                Point(lineX, maxShape));
                 line->vertInfs.insert(vI1);
                 line->vertInfs.insert(vI2);
             }
@@ -1615,8 +2207,9 @@ static void processEventHori(Router *router, NodeSet& scanline,
                             LineSegment(minLimit, minLimitMax, lineX));
 
                     // Shape corner:
-                    VertInf *vI1 = new VertInf(router, dummyOrthogShapeID,
-                                Point(lineX, minShape));
+                    VertInf *vI1 = new (router, VertInf::OrthogonalGraphVertex)
+                            VertInf(router, dummyOrthogShapeID,
+                                    Point(lineX, minShape));
                     line->vertInfs.insert(vI1);
                 }
                 if ((maxLimitMin < maxLimit) && (maxLimitMin <= maxShape))
@@ -1625,8 +2218,9 @@ static void processEventHori(Router *router, NodeSet& scanline,
                             LineSegment(maxLimitMin, maxLimit, lineX));
 
                     // Shape corner:
-                    VertInf *vI2 = new VertInf(router, dummyOrthogShapeID,
-                                Point(lineX, maxShape));
+                    VertInf *vI2 = new (router, VertInf::OrthogonalGraphVertex)
+                            VertInf(router, dummyOrthogShapeID,
+                                    Point(lineX, maxShape));
                     line->vertInfs.insert(vI2);
                 }
             }
@@ -1727,61 +2321,116 @@ void fixConnectionPointVisibilityOnOutsideOfVisibilityGraph(Event **events,
     }
 }
 
-extern void generateStaticOrthogonalVisGraph(Router *router)
+// Orders boxes by position, so that sets of them can be compared.
+struct CmpBox
 {
-    const size_t n = router->m_obstacles.size();
-    const unsigned cpn = router->vertices.connsSize();
-    // Set up the events for the vertical sweep.
-    size_t totalEvents = (2 * n) + cpn;
-    Event **events = new Event*[totalEvents];
-    unsigned ctr = 0;
-    ObstacleList::iterator obstacleIt = router->m_obstacles.begin();
-    for (unsigned i = 0; i < n; i++)
+    bool operator()(const Box& lhs, const Box& rhs) const
     {
-        Obstacle *obstacle = *obstacleIt;
-#ifndef PAPER
-        JunctionRef *junction = dynamic_cast<JunctionRef *> (obstacle);
-        if (junction && ! junction->positionFixed())
+        if (lhs.min.x != rhs.min.x)
         {
-            // Junctions that are free to move are not treated as obstacles.
-            ++obstacleIt;
-            totalEvents -= 2;
-            continue;
+            return lhs.min.x < rhs.min.x;
         }
-#endif
+        if (lhs.min.y != rhs.min.y)
+        {
+            return lhs.min.y < rhs.min.y;
+        }
+        if (lhs.max.x != rhs.max.x)
+        {
+            return lhs.max.x < rhs.max.x;
+        }
+        return lhs.max.y < rhs.max.y;
+    }
+};
 
-        Box bbox = obstacle->routingBox();
-        double midX = bbox.min.x + ((bbox.max.x - bbox.min.x) / 2);
-        Node *v = new Node(obstacle, midX);
-        events[ctr++] = new Event(Open, v, bbox.min.y);
-        events[ctr++] = new Event(Close, v, bbox.max.y);
 
-        ++obstacleIt;
-    }
+// Orders connection point records by just their vertices, which they are
+// sorted by first.
+static bool cmpConnPointVerts(const OrthogonalVisGraphSnapshot::ConnPoint& lhs,
+        const OrthogonalVisGraphSnapshot::ConnPoint& rhs)
+{
+    return lhs.vert < rhs.vert;
+}
 
-#ifdef DEBUGHANDLER
-    if (router->debugHandler())
+
+// Adds the events for an obstacle to a sweep in dimension dim.
+static void addObstacleEvents(Obstacle *obstacle, size_t dim, Event **events,
+        size_t& totalEvents)
+{
+    const size_t otherDim = (dim + 1) % 2;
+    Box bbox = obstacle->routingBox();
+    double mid = bbox.min[otherDim] + 
+            ((bbox.max[otherDim] - bbox.min[otherDim]) / 2);
+    Node *v = new Node(obstacle, mid);
+    events[totalEvents++] = new Event(Open, v, bbox.min[dim]);
+    events[totalEvents++] = new Event(Close, v, bbox.max[dim]);
+}
+
+
+// Adds the event for a connection point to a sweep in dimension dim.
+static void addConnPointEvent(VertInf *vert, size_t dim, Event **events,
+        size_t& totalEvents)
+{
+    const size_t otherDim = (dim + 1) % 2;
+    Point& point = vert->point;
+
+    Node *v = new Node(vert, point[otherDim]);
+    events[totalEvents++] = new Event(ConnPoint, v, point[dim]);
+}
+
+
+// Sets up the sorted events for a sweep in dimension dim, i.e., the 
+// vertical sweep is in YDIM.  If region is given, only its obstacles and
+// connection points are swept.  Returns the number of events.
+static size_t createSweepEvents(Router *router, size_t dim, Event **events,
+        const OrthogonalVisGraphRegion *region)
+{
+    const ConnDirFlags addedVisibility = (dim == YDIM) ? 
+            (ConnDirLeft | ConnDirRight) : (ConnDirUp | ConnDirDown);
+    size_t totalEvents = 0;
+    if (region)
     {
-        std::vector<Box> obstacleBoxes;
-        ObstacleList::iterator obstacleIt = router->m_obstacles.begin();
-        for (unsigned i = 0; i < n; i++)
+        for (size_t i = 0; i < region->m_obstacles.size(); ++i)
         {
-            Obstacle *obstacle = *obstacleIt;
-            JunctionRef *junction = dynamic_cast<JunctionRef *> (obstacle);
-            if (junction && ! junction->positionFixed())
+            addObstacleEvents(region->m_obstacles[i], dim, events, 
+                    totalEvents);
+        }
+        for (size_t i = 0; i < region->m_conn_points.size(); ++i)
+        {
+            addConnPointEvent(region->m_conn_points[i], dim, events,
+                    totalEvents);
+        }
+        qsort((Event*)events, (size_t) totalEvents, sizeof(Event*), 
+                compare_events);
+
+        // Correct the visibility of connection points on the leading or 
+        // trailing edge of the visibility graph, as below.  These events
+        // are only part of the diagram, so look for those on its extent.
+        for (size_t i = 0; i < totalEvents; ++i)
+        {
+            VertInf *vert = events[i]->v->c;
+            if (vert && ((events[i]->pos == region->m_extent.min[dim]) ||
+                        (events[i]->pos == region->m_extent.max[dim])))
             {
-                // Junctions that are free to move are not treated as obstacles.
-                ++obstacleIt;
-                continue;
+                vert->visDirections |= addedVisibility;
             }
-            Box bbox = obstacle->routingBox();
-            obstacleBoxes.push_back(bbox);
-            ++obstacleIt;
         }
-        router->debugHandler()->updateObstacleBoxes(obstacleBoxes);
+        return totalEvents;
     }
-#endif
 
+    for (ObstacleList::iterator obstacleIt = router->m_obstacles.begin();
+            obstacleIt != router->m_obstacles.end(); ++obstacleIt)
+    {
+        Obstacle *obstacle = *obstacleIt;
+#ifndef PAPER
+        JunctionRef *junction = dynamic_cast<JunctionRef *> (obstacle);
+        if (junction && ! junction->positionFixed())
+        {
+            // Junctions that are free to move are not treated as obstacles.
+            continue;
+        }
+#endif
+        addObstacleEvents(obstacle, dim, events, totalEvents);
+    }
     for (VertInf *curr = router->vertices.connsBegin();
             curr && (curr != router->vertices.shapesBegin());
             curr = curr->lstNext)
@@ -1790,27 +2439,35 @@ extern void generateStaticOrthogonalVisGraph(Router *router)
         {
             // This is a connector endpoint that is attached to a connection
             // pin on a shape, so it doesn't need to be given visibility.
-            // Thus, skip it and record that there is one less total event.
-            --totalEvents;
+            // Thus, skip it.
             continue;
         }
-        Point& point = curr->point;
-
-        Node *v = new Node(curr, point.x);
-        events[ctr++] = new Event(ConnPoint, v, point.y);
+        addConnPointEvent(curr, dim, events, totalEvents);
     }
     qsort((Event*)events, (size_t) totalEvents, sizeof(Event*), compare_events);
 
     // Correct visibility for pins or connector endpoints on the leading or
     // trailing edge of the visibility graph which may only have visibility in
     // the outward direction where there will not be a possible path.  We
-    // fix this by giving them visibility left and right.
+    // fix this by giving them visibility along the sweep line.
     fixConnectionPointVisibilityOnOutsideOfVisibilityGraph(events, totalEvents,
-            (ConnDirLeft | ConnDirRight));
+            addedVisibility);
+    return totalEvents;
+}
 
-    // Process the vertical sweep -- creating cadidate horizontal edges.
+
+// Process the vertical sweep -- creating candidate horizontal edges, which
+// are added to horiSegments.  If crossingLines is given, the graph is being
+// incrementally updated, so only the segments at positions within the 
+// region's bands are added, along with crossingLines.
+static void sweepVertically(Router *router, Event **events, 
+        size_t totalEvents, SegmentList& horiSegments,
+        const OrthogonalVisGraphRegion *region, CrossingLines *crossingLines)
+{
     // We do multiple passes over sections of the list so we can add relevant
     // entries to the scanline that might follow, before processing them.
+    // The segments at each position are collected separately, since they 
+    // can only be merged with others at the same position.
     SegmentListWrapper segments;
     NodeSet scanline;
     double thisPos = (totalEvents > 0) ? events[0]->pos : 0;
@@ -1836,6 +2493,15 @@ extern void generateStaticOrthogonalVisGraph(Router *router)
                             events[j], pass);
                 }
             }
+            if (region && !region->containsLine(YDIM, thisPos))
+            {
+                crossingLines->addVertices(thisPos, segments.list());
+                segments.list().clear();
+            }
+            else
+            {
+                horiSegments.splice(horiSegments.end(), segments.list());
+            }
 
             if (i == totalEvents)
             {
@@ -1858,60 +2524,33 @@ extern void generateStaticOrthogonalVisGraph(Router *router)
         delete events[i];
     }
 
-    segments.list().sort();
-
-    // Set up the events for the horizontal sweep.
-    SegmentListWrapper vertSegments;
-    ctr = 0;
-    obstacleIt = router->m_obstacles.begin();
-    for (unsigned i = 0; i < n; i++)
-    {
-        Obstacle *obstacle = *obstacleIt;
-#ifndef PAPER
-        JunctionRef *junction = dynamic_cast<JunctionRef *> (obstacle);
-        if (junction && ! junction->positionFixed())
-        {
-            // Junctions that are free to move are not treated as obstacles.
-            ++obstacleIt;
-            continue;
-        }
-#endif
-        Box bbox = obstacle->routingBox();
-        double midY = bbox.min.y + ((bbox.max.y - bbox.min.y) / 2);
-        Node *v = new Node(obstacle, midY);
-        events[ctr++] = new Event(Open, v, bbox.min.x);
-        events[ctr++] = new Event(Close, v, bbox.max.x);
-
-        ++obstacleIt;
-    }
-    for (VertInf *curr = router->vertices.connsBegin();
-            curr && (curr != router->vertices.shapesBegin());
-            curr = curr->lstNext)
+    if (region)
     {
-        if (curr->visDirections == ConnDirNone)
-        {
-            // This is a connector endpoint that is attached to a connection
-            // pin on a shape, so it doesn't need to be given visibility.
-            // Thus, skip it.
-            continue;
-        }
-        Point& point = curr->point;
-
-        Node *v = new Node(curr, point.y);
-        events[ctr++] = new Event(ConnPoint, v, point.x);
+        crossingLines->moveTo(horiSegments);
     }
-    qsort((Event*)events, (size_t) totalEvents, sizeof(Event*), compare_events);
+}
 
-    // Correct visibility for pins or connector endpoints on the leading or
-    // trailing edge of the visibility graph which may only have visibility in
-    // the outward direction where there will not be a possible path.  We
-    // fix this by giving them visibility up and down.
-    fixConnectionPointVisibilityOnOutsideOfVisibilityGraph(events, totalEvents,
-            (ConnDirUp | ConnDirDown));
 
-    // Process the horizontal sweep -- creating vertical visibility edges.
-    thisPos = (totalEvents > 0) ? events[0]->pos : 0;
-    posStartIndex = 0;
+// Process the horizontal sweep -- creating vertical visibility edges by
+// intersecting the candidate vertical segments with horiSegments.  If 
+// region is given, the graph is being incrementally updated, so only the
+// vertical segments at positions within the region's bands are created, 
+// along with crossingLines, and only the edges within region are 
+// generated.  The segments are then only intersected once the sweep is
+// complete, in order of position with crossingLines, since these may be at
+// positions the sweep didn't visit.  If snapshot is given, the vertical 
+// segments created by the sweep are recorded in it.
+static void sweepHorizontally(Router *router, Event **events, 
+        size_t totalEvents, SegmentList& horiSegments,
+        const OrthogonalVisGraphRegion *region, CrossingLines *crossingLines,
+        OrthogonalVisGraphSnapshot *snapshot)
+{
+    SegmentListWrapper vertSegments;
+    SegmentListsByPosition vertSegmentGroups;
+    NodeSet scanline;
+    double thisPos = (totalEvents > 0) ? events[0]->pos : 0;
+    unsigned int posStartIndex = 0;
+    unsigned int posFinishIndex = 0;
     for (unsigned i = 0; i <= totalEvents; ++i)
     {
         // Progress reporting and continuation check.
@@ -1935,10 +2574,28 @@ extern void generateStaticOrthogonalVisGraph(Router *router)
 
             // Process the merged line segments.
             vertSegments.list().sort();
+            if (region && !region->containsLine(XDIM, thisPos))
+            {
+                crossingLines->addVertices(thisPos, vertSegments.list());
+                vertSegments.list().clear();
+            }
             for (SegmentList::iterator curr = vertSegments.list().begin();
                     curr != vertSegments.list().end(); ++curr)
             {
-                intersectSegments(router, segments.list(), *curr);
+                if (snapshot)
+                {
+                    curr->setLine(snapshot->addLine(XDIM, curr->pos, 
+                                curr->begin, curr->finish));
+                }
+                if (!region)
+                {
+                    intersectSegments(router, horiSegments, *curr, region);
+                }
+            }
+            if (region && !vertSegments.list().empty())
+            {
+                SegmentList& group = vertSegmentGroups[thisPos];
+                group.splice(group.end(), vertSegments.list());
             }
             vertSegments.list().clear();
 
@@ -1960,24 +2617,626 @@ extern void generateStaticOrthogonalVisGraph(Router *router)
     COLA_ASSERT(scanline.size() == 0);
     for (unsigned i = 0; i < totalEvents; ++i)
     {
-        delete events[i];
+        delete events[i];
+    }
+
+    if (region)
+    {
+        crossingLines->moveTo(vertSegmentGroups);
+
+        // Lines crossing the region in both dimensions only meet outside 
+        // it, at kept vertices, so these lines aren't intersected.
+        SegmentList crossingHoriSegments;
+        for (SegmentList::iterator curr = horiSegments.begin();
+                curr != horiSegments.end(); )
+        {
+            SegmentList::iterator next = curr;
+            ++next;
+            if (!region->containsLine(YDIM, curr->pos))
+            {
+                crossingHoriSegments.splice(crossingHoriSegments.end(),
+                        horiSegments, curr);
+            }
+            curr = next;
+        }
+        for (SegmentListsByPosition::iterator group = 
+                vertSegmentGroups.begin(); group != vertSegmentGroups.end();
+                ++group)
+        {
+            for (SegmentList::iterator curr = group->second.begin(); 
+                    curr != group->second.end(); ++curr)
+            {
+                addIntersections(router, horiSegments, *curr, region);
+                if (region->containsLine(XDIM, curr->pos))
+                {
+                    addIntersections(router, crossingHoriSegments, *curr,
+                            region);
+                }
+
+                // Split breakPoints set into visibility segments.
+                curr->generateVisibilityEdgesFromBreakpointSet(router, YDIM,
+                        region);
+            }
+        }
+        horiSegments.splice(horiSegments.end(), crossingHoriSegments);
+    }
+}
+
+
+// Generates the static orthogonal visibility graph.  If region is given, 
+// then this only generates the edges of the graph within that region, 
+// along with the lines crossing it in each dimension, see
+// updateStaticOrthogonalVisGraph().  If snapshot is given, the visibility 
+// lines and their vertices are recorded in it.
+//
+static void generateOrthogonalVisGraph(Router *router, 
+        const OrthogonalVisGraphRegion *region, 
+        OrthogonalVisGraphSnapshot *snapshot,
+        CrossingLines *horiCrossingLines = nullptr,
+        CrossingLines *vertCrossingLines = nullptr)
+{
+    size_t maxEvents = 0;
+    if (region)
+    {
+        maxEvents = (2 * region->m_obstacles.size()) + 
+                region->m_conn_points.size();
+    }
+    else
+    {
+        const size_t n = router->m_obstacles.size();
+        const unsigned cpn = router->vertices.connsSize();
+        maxEvents = (2 * n) + cpn;
+    }
+    Event **events = new Event*[maxEvents];
+
+#ifdef DEBUGHANDLER
+    if (router->debugHandler())
+    {
+        std::vector<Box> obstacleBoxes;
+        ObstacleList::iterator obstacleIt = router->m_obstacles.begin();
+        for (unsigned i = 0; i < router->m_obstacles.size(); i++)
+        {
+            Obstacle *obstacle = *obstacleIt;
+            JunctionRef *junction = dynamic_cast<JunctionRef *> (obstacle);
+            if (junction && ! junction->positionFixed())
+            {
+                // Junctions that are free to move are not treated as obstacles.
+                ++obstacleIt;
+                continue;
+            }
+            Box bbox = obstacle->routingBox();
+            obstacleBoxes.push_back(bbox);
+            ++obstacleIt;
+        }
+        router->debugHandler()->updateObstacleBoxes(obstacleBoxes);
+    }
+#endif
+
+    COLA_ASSERT(!region || (snapshot && horiCrossingLines && 
+                vertCrossingLines));
+
+    SegmentList horiSegments;
+    size_t totalEvents = createSweepEvents(router, YDIM, events, region);
+    sweepVertically(router, events, totalEvents, horiSegments, region,
+            horiCrossingLines);
+    horiSegments.sort();
+    if (snapshot)
+    {
+        for (SegmentList::iterator curr = horiSegments.begin();
+                curr != horiSegments.end(); ++curr)
+        {
+            if (!region || region->containsLine(YDIM, curr->pos))
+            {
+                curr->setLine(snapshot->addLine(YDIM, curr->pos, 
+                            curr->begin, curr->finish));
+            }
+        }
+    }
+
+    totalEvents = createSweepEvents(router, XDIM, events, region);
+    sweepHorizontally(router, events, totalEvents, horiSegments, region,
+            vertCrossingLines, snapshot);
+    delete [] events;
+
+    // Add portions of horizontal lines that are after the final vertical
+    // position we considered.
+    for (SegmentList::iterator it = horiSegments.begin();
+            it != horiSegments.end(); )
+    {
+        LineSegment& horiLine = *it;
+
+        horiLine.addEdgeHorizontal(router);
+
+        size_t dim = XDIM; // x-dimension
+        horiLine.generateVisibilityEdgesFromBreakpointSet(router, dim,
+                region);
+
+        it = horiSegments.erase(it);
+    }
+}
+
+
+extern void generateStaticOrthogonalVisGraph(Router *router,
+        OrthogonalVisGraphSnapshot *snapshot)
+{
+    generateOrthogonalVisGraph(router, nullptr, snapshot);
+}
+
+
+// Deletes the dummy vertices from first onwards that are no longer part of
+// the orthogonal visibility graph, i.e., those without edges that are not 
+// breakpoints of any visibility line.  These are created where existing 
+// vertices end up being used instead.  Breakpoints without edges are kept,
+// as they are by a full regeneration, since they affect the visibility 
+// flags of their lines.
+static void removeOrphanedOrthogonalVertices(Router *router, VertInf *first)
+{
+    VertInf *curr = first;
+    while (curr)
+    {
+        if ((curr->id == dummyOrthogID) && curr->orphaned() && 
+                !(curr->orthogVisPropFlags & (X_LINE | Y_LINE)))
+        {
+            VertInf *following = router->vertices.removeVertex(curr);
+            delete curr;
+            curr = following;
+            continue;
+        }
+        curr = curr->lstNext;
+    }
+}
+
+
+// Deletes the orthogonal visibility graph edges of vert.  If region is 
+// given, only those overlapping it are deleted.
+static void removeOrthogonalVisEdges(VertInf *vert,
+        const OrthogonalVisGraphRegion *region = nullptr)
+{
+    EdgeInfList::const_iterator edge = vert->orthogVisList.begin();
+    while (edge != vert->orthogVisList.end())
+    {
+        EdgeInf *curr = *edge;
+        ++edge;
+        std::pair<Point, Point> points = curr->points();
+        if (!region || region->intersects(points.first, points.second))
+        {
+            delete curr;
+        }
+    }
+}
+
+
+// Updates the static orthogonal visibility graph to reflect changes to 
+// obstacles and connection points since the graph was generated from the 
+// router state recorded in previous.  Only the edges that lie within bands 
+// around the obstacles and connection points that have been added, moved 
+// or removed are regenerated.  The resulting graph is the same as would 
+// be generated from scratch.
+//
+// Returns false, without changing the graph, if the graph should instead be
+// regenerated from scratch.  This is the case if there is no previous 
+// record, if the extent of the diagram has changed (which can change the
+// visibility of connection points at its edges), or if a large proportion 
+// of the diagram has changed.
+//
+extern bool updateStaticOrthogonalVisGraph(Router *router,
+        OrthogonalVisGraphSnapshot& previous)
+{
+    if (!previous.isValid())
+    {
+        return false;
+    }
+
+    OrthogonalVisGraphSnapshot current;
+    current.record(router);
+    if ((current.m_extent.min != previous.m_extent.min) ||
+            (current.m_extent.max != previous.m_extent.max))
+    {
+        return false;
+    }
+
+    // Moved obstacles and connection points will be seen as both removed
+    // and added, so give both their old and new positions.
+    std::vector<Box> changedBoxes;
+    std::set_symmetric_difference(previous.m_obstacle_boxes.begin(),
+            previous.m_obstacle_boxes.end(), current.m_obstacle_boxes.begin(),
+            current.m_obstacle_boxes.end(), std::back_inserter(changedBoxes),
+            CmpBox());
+    std::vector<OrthogonalVisGraphSnapshot::ConnPoint> changedPoints;
+    std::set_symmetric_difference(previous.m_conn_points.begin(),
+            previous.m_conn_points.end(), current.m_conn_points.begin(),
+            current.m_conn_points.end(), std::back_inserter(changedPoints));
+
+    size_t changes = changedBoxes.size() + changedPoints.size();
+    if (changes == 0)
+    {
+        // Nothing affecting the graph has changed.
+        return true;
+    }
+    size_t total = current.m_obstacle_boxes.size() + 
+            current.m_conn_points.size();
+    if (changes > (total / 4))
+    {
+        // Simpler and likely faster to regenerate the whole graph.
+        return false;
+    }
+
+    OrthogonalVisGraphRegion region;
+    for (size_t i = 0; i < changedBoxes.size(); ++i)
+    {
+        region.addBox(changedBoxes[i]);
+    }
+    for (size_t i = 0; i < changedPoints.size(); ++i)
+    {
+        region.addPoint(changedPoints[i].point);
+    }
+    region.finalise();
+    region.m_extent = current.m_extent;
+
+    // Find the obstacles overlapping the bands, from the strips spanning 
+    // the diagram along each band.  The index is keyed on routing polygons,
+    // whose bounding boxes may differ slightly from the routing boxes, so 
+    // the strips are widened a little before the exact test.
+    const double margin = 1e-9 * (1 + std::max(
+            current.m_extent.max.x - current.m_extent.min.x,
+            current.m_extent.max.y - current.m_extent.min.y) + 
+            std::max(std::fabs(current.m_extent.min.x), 
+                std::fabs(current.m_extent.max.x)) + 
+            std::max(std::fabs(current.m_extent.min.y), 
+                std::fabs(current.m_extent.max.y)));
+    for (size_t dim = 0; dim < 2; ++dim)
+    {
+        const size_t otherDim = (dim + 1) % 2;
+        const IntervalSet& bands = region.bands(dim);
+        for (size_t i = 0; i < bands.size(); ++i)
+        {
+            Box strip;
+            strip.min[dim] = bands[i].first - margin;
+            strip.max[dim] = bands[i].second + margin;
+            strip.min[otherDim] = current.m_extent.min[otherDim] - margin;
+            strip.max[otherDim] = current.m_extent.max[otherDim] + margin;
+            std::vector<Obstacle *> nearbyObstacles;
+            router->obstaclesOverlappingBox(strip, nearbyObstacles);
+            for (size_t j = 0; j < nearbyObstacles.size(); ++j)
+            {
+                Obstacle *obstacle = nearbyObstacles[j];
+                JunctionRef *junction = 
+                        dynamic_cast<JunctionRef *> (obstacle);
+                if (junction && ! junction->positionFixed())
+                {
+                    // Junctions that are free to move are not treated as 
+                    // obstacles.
+                    continue;
+                }
+                Box bbox = obstacle->routingBox();
+                if (region.bands(XDIM).overlaps(bbox.min.x, bbox.max.x) ||
+                        region.bands(YDIM).overlaps(bbox.min.y, bbox.max.y))
+                {
+                    region.m_obstacles.push_back(obstacle);
+                }
+            }
+        }
+    }
+    // Obstacles may overlap more than one band.
+    std::sort(region.m_obstacles.begin(), region.m_obstacles.end());
+    region.m_obstacles.erase(std::unique(region.m_obstacles.begin(),
+                region.m_obstacles.end()), region.m_obstacles.end());
+    for (size_t i = 0; i < current.m_conn_points.size(); ++i)
+    {
+        const Point& point = current.m_conn_points[i].point;
+        if (region.intersects(point, point))
+        {
+            region.m_conn_points.push_back(
+                    const_cast<VertInf *> (current.m_conn_points[i].vert));
+        }
+    }
+
+    // Find the lines crossing the region, and the vertices on them within
+    // and around it, before the graph or the snapshot change.
+    CrossingLines horiCrossingLines(region, previous, YDIM);
+    CrossingLines vertCrossingLines(region, previous, XDIM);
+
+    // The vertices within the region are those of the lines crossing it,
+    // and those of the lines at positions within its bands.  The latter 
+    // may include connection points that have since been deleted.  These
+    // are skipped, and had no edges left by then.
+    std::vector<const VertInf *> removedConnPoints;
+    for (size_t i = 0; i < changedPoints.size(); ++i)
+    {
+        if (!std::binary_search(current.m_conn_points.begin(),
+                    current.m_conn_points.end(), changedPoints[i],
+                    cmpConnPointVerts))
+        {
+            removedConnPoints.push_back(changedPoints[i].vert);
+        }
+    }
+    std::sort(removedConnPoints.begin(), removedConnPoints.end());
+    std::vector<VertInf *> regionVertices(
+            horiCrossingLines.replacedVertices());
+    regionVertices.insert(regionVertices.end(), 
+            vertCrossingLines.replacedVertices().begin(),
+            vertCrossingLines.replacedVertices().end());
+    for (size_t dim = 0; dim < 2; ++dim)
+    {
+        const IntervalSet& bands = region.bands(dim);
+        for (size_t i = 0; i < bands.size(); ++i)
+        {
+            OrthogonalVisGraphSnapshot::LineMap::iterator line = 
+                    previous.m_lines[dim].lower_bound(bands[i].first);
+            OrthogonalVisGraphSnapshot::LineMap::iterator linesEnd = 
+                    previous.m_lines[dim].upper_bound(bands[i].second);
+            for ( ; line != linesEnd; ++line)
+            {
+                const OrthogonalVisGraphSnapshot::LineVertices& vertices =
+                        line->second.vertices;
+                for (OrthogonalVisGraphSnapshot::LineVertices::
+                        const_iterator curr = vertices.begin();
+                        curr != vertices.end(); ++curr)
+                {
+                    if (!std::binary_search(removedConnPoints.begin(),
+                                removedConnPoints.end(), curr->second))
+                    {
+                        regionVertices.push_back(curr->second);
+                    }
+                }
+            }
+            previous.removeLines(dim, bands[i].first, bands[i].second);
+        }
+    }
+    // Vertices are on lines in both dimensions.
+    std::sort(regionVertices.begin(), regionVertices.end());
+    regionVertices.erase(std::unique(regionVertices.begin(), 
+                regionVertices.end()), regionVertices.end());
+
+    // Remove the edges within the region.  These are those of the vertices 
+    // within it, and those of the kept vertices around it that cross it.
+    for (size_t i = 0; i < regionVertices.size(); ++i)
+    {
+        removeOrthogonalVisEdges(regionVertices[i]);
+    }
+    const CrossingLines *crossingLines[2] = 
+            { &horiCrossingLines, &vertCrossingLines };
+    for (size_t dim = 0; dim < 2; ++dim)
+    {
+        const std::vector<VertInf *>& keptVertices = 
+                crossingLines[dim]->keptVertices();
+        for (size_t i = 0; i < keptVertices.size(); ++i)
+        {
+            removeOrthogonalVisEdges(keptVertices[i], &region);
+        }
+    }
+    // Any dummy connection edges for connection pins are removed too, as 
+    // they are for a full regeneration.
+    for (VertInf *curr = router->vertices.connsBegin();
+            curr && (curr != router->vertices.shapesBegin());
+            curr = curr->lstNext)
+    {
+        EdgeInfList::const_iterator edge = curr->orthogVisList.begin();
+        while (edge != curr->orthogVisList.end())
+        {
+            EdgeInf *dummyEdge = *edge;
+            ++edge;
+            if (!dummyEdge->isOrthogonalGraphEdge())
+            {
+                delete dummyEdge;
+            }
+        }
+    }
+
+    // The dummy vertices within the region are now orphaned and are 
+    // replaced.
+    for (size_t i = 0; i < regionVertices.size(); ++i)
+    {
+        VertInf *vert = regionVertices[i];
+        if (vert->id == dummyOrthogID)
+        {
+            COLA_ASSERT(vert->orphaned());
+            router->vertices.removeVertex(vert);
+            delete vert;
+        }
+    }
+
+    VertInf *lastKept = router->vertices.shapesLast();
+    generateOrthogonalVisGraph(router, &region, &previous, 
+            &horiCrossingLines, &vertCrossingLines);
+
+    // Clean up the new vertices that kept vertices were used in place of.
+    removeOrphanedOrthogonalVertices(router, (lastKept) ? 
+            lastKept->lstNext : router->vertices.shapesBegin());
+    return true;
+}
+
+
+OrthogonalVisGraphSnapshot::OrthogonalVisGraphSnapshot()
+    : m_valid(false),
+      m_lines_indexed(false)
+{
+}
+
+
+void OrthogonalVisGraphSnapshot::clear(void)
+{
+    m_valid = false;
+    m_obstacle_boxes.clear();
+    m_conn_points.clear();
+    for (size_t dim = 0; dim < 2; ++dim)
+    {
+        m_lines[dim].clear();
+        m_line_index[dim].clear();
+    }
+    m_lines_indexed = false;
+}
+
+
+bool OrthogonalVisGraphSnapshot::isValid(void) const
+{
+    return m_valid;
+}
+
+
+// Records the obstacles and connection points used by the orthogonal 
+// visibility graph, in the same way as generateOrthogonalVisGraph().
+void OrthogonalVisGraphSnapshot::record(Router *router)
+{
+    m_valid = false;
+    m_obstacle_boxes.clear();
+    m_conn_points.clear();
+    m_extent.min = Point(DBL_MAX, DBL_MAX);
+    m_extent.max = Point(-DBL_MAX, -DBL_MAX);
+
+    for (ObstacleList::const_iterator obstacleIt = 
+            router->m_obstacles.begin(); 
+            obstacleIt != router->m_obstacles.end(); ++obstacleIt)
+    {
+        Obstacle *obstacle = *obstacleIt;
+#ifndef PAPER
+        JunctionRef *junction = dynamic_cast<JunctionRef *> (obstacle);
+        if (junction && ! junction->positionFixed())
+        {
+            // Junctions that are free to move are not treated as obstacles.
+            continue;
+        }
+#endif
+        Box bbox = obstacle->routingBox();
+        m_obstacle_boxes.push_back(bbox);
+        m_extent.min.x = std::min(m_extent.min.x, bbox.min.x);
+        m_extent.min.y = std::min(m_extent.min.y, bbox.min.y);
+        m_extent.max.x = std::max(m_extent.max.x, bbox.max.x);
+        m_extent.max.y = std::max(m_extent.max.y, bbox.max.y);
+    }
+    std::sort(m_obstacle_boxes.begin(), m_obstacle_boxes.end(), CmpBox());
+
+    for (VertInf *curr = router->vertices.connsBegin();
+            curr && (curr != router->vertices.shapesBegin());
+            curr = curr->lstNext)
+    {
+        if (curr->visDirections == ConnDirNone)
+        {
+            // Not given visibility in the orthogonal visibility graph.
+            continue;
+        }
+        ConnPoint connPoint;
+        connPoint.vert = curr;
+        connPoint.point = curr->point;
+        connPoint.directions = curr->visDirections;
+        // Count the visibility graph edges of this point, so we notice if 
+        // they have been removed, e.g., by VertInf::removeFromGraph().
+        connPoint.edgeCount = 0;
+        for (EdgeInfList::const_iterator edge = curr->orthogVisList.begin();
+                edge != curr->orthogVisList.end(); ++edge)
+        {
+            if (!(*edge)->isDummyConnection())
+            {
+                ++connPoint.edgeCount;
+            }
+        }
+        m_conn_points.push_back(connPoint);
+        m_extent.min.x = std::min(m_extent.min.x, curr->point.x);
+        m_extent.min.y = std::min(m_extent.min.y, curr->point.y);
+        m_extent.max.x = std::max(m_extent.max.x, curr->point.x);
+        m_extent.max.y = std::max(m_extent.max.y, curr->point.y);
+    }
+    std::sort(m_conn_points.begin(), m_conn_points.end());
+
+    if (!m_lines_indexed)
+    {
+        for (size_t dim = 0; dim < 2; ++dim)
+        {
+            for (LineMap::iterator line = m_lines[dim].begin();
+                    line != m_lines[dim].end(); ++line)
+            {
+                indexLine(dim, &(*line));
+            }
+        }
+        m_lines_indexed = true;
+    }
+
+    m_valid = true;
+}
+
+
+OrthogonalVisGraphSnapshot::Line *OrthogonalVisGraphSnapshot::addLine(
+        size_t dim, double pos, double begin, double finish)
+{
+    LineMap::iterator line = m_lines[dim].insert(
+            std::make_pair(pos, LineExtent(begin, finish)));
+    if (m_lines_indexed)
+    {
+        indexLine(dim, &(*line));
     }
-    delete [] events;
+    return &(*line);
+}
 
-    // Add portions of horizontal lines that are after the final vertical
-    // position we considered.
-    for (SegmentList::iterator it = segments.list().begin();
-            it != segments.list().end(); )
+
+void OrthogonalVisGraphSnapshot::removeLines(size_t dim, double min, 
+        double max)
+{
+    LineMap::iterator begin = m_lines[dim].lower_bound(min);
+    LineMap::iterator end = m_lines[dim].upper_bound(max);
+    for (LineMap::iterator line = begin; line != end; ++line)
     {
-        LineSegment& horiLine = *it;
+        m_line_index[dim].remove(&(*line));
+    }
+    m_lines[dim].erase(begin, end);
+}
 
-        horiLine.addEdgeHorizontal(router);
 
-        size_t dim = XDIM; // x-dimension
-        horiLine.generateVisibilityEdgesFromBreakpointSet(router, dim);
+void OrthogonalVisGraphSnapshot::linesOverlapping(size_t dim, double min,
+        double max, std::vector<Line *>& lines) const
+{
+    COLA_ASSERT(m_lines_indexed);
+    const size_t otherDim = (dim + 1) % 2;
+    Box query;
+    query.min[dim] = m_extent.min[dim];
+    query.max[dim] = m_extent.max[dim];
+    query.min[otherDim] = min;
+    query.max[otherDim] = max;
+    m_line_index[dim].query(query, lines);
+}
+
+
+// Indexes the line by the part of it within the extent.  The lines at
+// the edges of the diagram are infinite, so can't be indexed as they are.
+void OrthogonalVisGraphSnapshot::indexLine(size_t dim, Line *line)
+{
+    const size_t otherDim = (dim + 1) % 2;
+    Box bbox;
+    bbox.min[dim] = bbox.max[dim] = line->first;
+    bbox.min[otherDim] = std::max(line->second.begin, 
+            m_extent.min[otherDim]);
+    bbox.max[otherDim] = std::min(line->second.finish, 
+            m_extent.max[otherDim]);
+    m_line_index[dim].insert(line, bbox);
+}
 
-        it = segments.list().erase(it);
+
+bool OrthogonalVisGraphSnapshot::ConnPoint::operator<(
+        const ConnPoint& rhs) const
+{
+    if (vert != rhs.vert)
+    {
+        return vert < rhs.vert;
+    }
+    if (point.x != rhs.point.x)
+    {
+        return point.x < rhs.point.x;
+    }
+    if (point.y != rhs.point.y)
+    {
+        return point.y < rhs.point.y;
+    }
+    if (directions != rhs.directions)
+    {
+        return directions < rhs.directions;
     }
+    return edgeCount < rhs.edgeCount;
+}
+
+
+bool OrthogonalVisGraphSnapshot::ConnPoint::operator==(
+        const ConnPoint& rhs) const
+{
+    return !(*this < rhs) && !(rhs < *this);
 }
 
 
@@ -2506,6 +3765,23 @@ class PotentialSegmentConstraint
 };
 
 
+// A group of overlapping segments that are nudged together, along with 
+// the solver problem for positioning them.  Regions share no variables, so
+// they can be solved independently of each other.
+struct NudgingRegion
+{
+    NudgingRegion()
+        : satisfied(false)
+    {
+    }
+
+    ShiftSegmentList segments;
+    Variables vs;
+    Constraints cs;
+    bool satisfied;
+};
+
+
 class ImproveOrthogonalRoutes
 {
 public:
@@ -2517,6 +3793,9 @@ private:
     void buildOrthogonalNudgingOrderInfo(void);
     void nudgeOrthogonalRoutes(size_t dimension,
            bool justUnifying = false);
+    void solveNudgingRegion(NudgingRegion& region, size_t dimension,
+            bool justUnifying) const;
+    void applyNudgingRegion(NudgingRegion& region, bool justUnifying) const;
 
     Router *m_router;
     PtOrderMap m_point_orders;
@@ -2552,16 +3831,19 @@ void ImproveOrthogonalRoutes::execute(void)
     // a fixedSharedPathPenalty since these routes include extra segments
     // we want to keep apart which prevent some shared paths.
     if (m_router->routingOption(performUnifyingNudgingPreprocessingStep) &&
-            (m_router->routingParameter(fixedSharedPathPenalty) == 0))
+            (m_router->routingParameter(fixedSharedPathPenalty) == 0) &&
+            !m_router->isTransactionAborted())
     {
         for (size_t dimension = 0; dimension < 2; ++dimension)
         {
             // Just perform Unifying operation.
             bool justUnifying = true;
+            TIMER_START(m_router, tmOrthogCentre);
             m_segment_list.clear();
             buildOrthogonalNudgingSegments(m_router, dimension, m_segment_list);
             buildOrthogonalChannelInfo(m_router, dimension, m_segment_list);
             nudgeOrthogonalRoutes(dimension, justUnifying);
+            TIMER_STOP(m_router);
         }
     }
 
@@ -2569,6 +3851,11 @@ void ImproveOrthogonalRoutes::execute(void)
     // Do the Nudging and centring.
     for (size_t dimension = 0; dimension < 2; ++dimension)
     {
+        if (m_router->isTransactionAborted())
+        {
+            // Out of time, so leave the remaining segments where they are.
+            break;
+        }
         m_point_orders.clear();
         // Build nudging info.
         // XXX Needs to be rebuilt for each dimension, cause of shifting
@@ -2580,13 +3867,22 @@ void ImproveOrthogonalRoutes::execute(void)
         buildOrthogonalNudgingSegments(m_router, dimension, m_segment_list);
         buildOrthogonalChannelInfo(m_router, dimension, m_segment_list);
         nudgeOrthogonalRoutes(dimension);
+        if (!m_router->isTransactionAborted())
+        {
+            m_router->markTransactionPhaseCompleted((dimension == XDIM) ?
+                    TransactionPhaseOrthogonalNudgingX :
+                    TransactionPhaseOrthogonalNudgingY);
+        }
     }
 #endif // DEBUG_JUST_UNIFY
 
     // Resimplify all the display routes that may have been split.
     simplifyOrthogonalRoutes();
 
-    m_router->improveOrthogonalTopology();
+    if (!m_router->isTransactionAborted())
+    {
+        m_router->improveOrthogonalTopology();
+    }
 
     // Clear the segment-checkpoint cache for connectors.
     clearConnectorRouteCheckpointCache(m_router);
@@ -2599,13 +3895,10 @@ void ImproveOrthogonalRoutes::nudgeOrthogonalRoutes(size_t dimension,
 {
     bool nudgeFinalSegments = m_router->routingOption(
             nudgeOrthogonalSegmentsConnectedToShapes);
-    bool nudgeSharedPathsWithCommonEnd = m_router->routingOption(
-            nudgeSharedPathsWithCommonEndPoint);
-    double baseSepDist = m_router->routingParameter(idealNudgingDistance);
-    COLA_ASSERT(baseSepDist >= 0);
-    // If we can fit things with the desired separation distance, then
-    // we try 10 times, reducing each time by a 10th of the original amount.
-    double reductionSteps = 10.0;
+    // In parallel mode, regions are only collected here and then solved 
+    // together afterwards.
+    bool parallel = m_router->routingOption(performParallelOrthogonalNudging);
+    std::vector<NudgingRegion *> regions;
 
     size_t totalSegmentsToShift = m_segment_list.size();
     size_t numOfSegmentsShifted = 0;
@@ -2619,6 +3912,14 @@ void ImproveOrthogonalRoutes::nudgeOrthogonalRoutes(size_t dimension,
                 (dimension == XDIM) ? TransactionPhaseOrthogonalNudgingX :
                 TransactionPhaseOrthogonalNudgingY, numOfSegmentsShifted,
                 totalSegmentsToShift);
+        if (m_router->isTransactionAborted())
+        {
+            // Out of time, so leave the remaining segments where they are.
+            for_each(m_segment_list.begin(), m_segment_list.end(),
+                    delete_object());
+            m_segment_list.clear();
+            break;
+        }
 
         // Take a reference segment
         ShiftSegment *currentSegment = m_segment_list.front();
@@ -2671,461 +3972,572 @@ void ImproveOrthogonalRoutes::nudgeOrthogonalRoutes(size_t dimension,
             }
         }
 
+        NudgingRegion *region = new NudgingRegion();
+        region->segments.swap(currentRegion);
+        if (parallel)
+        {
+            regions.push_back(region);
+            continue;
+        }
+
         // Process these segments.
-        std::list<size_t> freeIndexes;
-        Variables vs;
-        Constraints cs;
-        Constraints gapcs;
-        ShiftSegmentPtrList prevVars;
-        double sepDist = baseSepDist;
+        solveNudgingRegion(*region, dimension, justUnifying);
+        applyNudgingRegion(*region, justUnifying);
+        delete region;
+    }
+
+    if (regions.empty())
+    {
+        return;
+    }
+
+    struct SolveTask
+    {
+        const ImproveOrthogonalRoutes *improver;
+        std::vector<NudgingRegion *>& regions;
+        size_t dimension;
+        bool justUnifying;
+
+        void operator()(const size_t index, const unsigned int thread)
+        {
+            COLA_UNUSED(thread);
+            improver->solveNudgingRegion(*regions[index], dimension, 
+                    justUnifying);
+        }
+    };
+    if (!m_router->isTransactionAborted())
+    {
+        SolveTask task = { this, regions, dimension, justUnifying };
+        unsigned int threads = effectiveThreadCount(
+                m_router->routingThreadCount(), regions.size());
+        parallelFor(m_router->threadPool(), regions.size(), threads, 
+                task);
+    }
+
+    // Apply the results in the order the regions were found, so that the
+    // outcome doesn't depend on the number of threads.  If the transaction
+    // was aborted, the unsolved regions are just freed.
+    for (size_t i = 0; i < regions.size(); ++i)
+    {
+        applyNudgingRegion(*regions[i], justUnifying);
+        delete regions[i];
+    }
+}
+
+
+// Builds and solves the problem for positioning the segments in a region.
+// This only modifies the region and its segments, so separate regions can
+// be solved concurrently.
+void ImproveOrthogonalRoutes::solveNudgingRegion(NudgingRegion& region,
+        size_t dimension, bool justUnifying) const
+{
+    bool nudgeSharedPathsWithCommonEnd = m_router->routingOption(
+            nudgeSharedPathsWithCommonEndPoint);
+    double baseSepDist = m_router->routingParameter(idealNudgingDistance);
+    COLA_ASSERT(baseSepDist >= 0);
+    // If we can fit things with the desired separation distance, then
+    // we try 10 times, reducing each time by a 10th of the original amount.
+    double reductionSteps = 10.0;
+
+    ShiftSegmentList& currentRegion = region.segments;
+    Variables& vs = region.vs;
+    Constraints& cs = region.cs;
+
+    std::list<size_t> freeIndexes;
+    Constraints gapcs;
+    ShiftSegmentPtrList prevVars;
+    double sepDist = baseSepDist;
 #ifdef NUDGE_DEBUG
-        fprintf(stderr, "-------------------------------------------------------\n");
-        fprintf(stderr, "%s -- size: %d\n", (justUnifying) ? "Unifying" : "Nudging",
-                (int) currentRegion.size());
+    fprintf(stderr, "-------------------------------------------------------\n");
+    fprintf(stderr, "%s -- size: %d\n", (justUnifying) ? "Unifying" : "Nudging",
+            (int) currentRegion.size());
 #endif
 #ifdef NUDGE_DEBUG_SVG
-        printf("\n\n");
+    printf("\n\n");
 #endif
-        for (ShiftSegmentList::iterator currSegmentIt = currentRegion.begin();
-                currSegmentIt != currentRegion.end(); ++currSegmentIt )
-        {
-            NudgingShiftSegment *currSegment = static_cast<NudgingShiftSegment *> (*currSegmentIt);
+    for (ShiftSegmentList::iterator currSegmentIt = currentRegion.begin();
+            currSegmentIt != currentRegion.end(); ++currSegmentIt )
+    {
+        NudgingShiftSegment *currSegment = static_cast<NudgingShiftSegment *> (*currSegmentIt);
 
-            // Create a solver variable for the position of this segment.
-            currSegment->createSolverVariable(justUnifying);
+        // Create a solver variable for the position of this segment.
+        currSegment->createSolverVariable(justUnifying);
 
-            vs.push_back(currSegment->variable);
-            size_t index = vs.size() - 1;
+        vs.push_back(currSegment->variable);
+        size_t index = vs.size() - 1;
 #ifdef NUDGE_DEBUG
-            fprintf(stderr,"line(%d)  %.15f  dim: %d pos: %.16f\n"
-                   "min: %.16f  max: %.16f\n"
-                   "minEndPt: %.16f  maxEndPt: %.16f weight: %g cc: %d\n",
-                    currSegment->connRef->id(),
-                    currSegment->lowPoint()[dimension], (int) dimension,
-                    currSegment->variable->desiredPosition,
-                    currSegment->minSpaceLimit, currSegment->maxSpaceLimit,
-                    currSegment->lowPoint()[!dimension], currSegment->highPoint()[!dimension],
-                    currSegment->variable->weight,
-                    (int) currSegment->checkpoints.size());
+        fprintf(stderr,"line(%d)  %.15f  dim: %d pos: %.16f\n"
+               "min: %.16f  max: %.16f\n"
+               "minEndPt: %.16f  maxEndPt: %.16f weight: %g cc: %d\n",
+                currSegment->connRef->id(),
+                currSegment->lowPoint()[dimension], (int) dimension,
+                currSegment->variable->desiredPosition,
+                currSegment->minSpaceLimit, currSegment->maxSpaceLimit,
+                currSegment->lowPoint()[!dimension], currSegment->highPoint()[!dimension],
+                currSegment->variable->weight,
+                (int) currSegment->checkpoints.size());
 #endif
 #ifdef NUDGE_DEBUG_SVG
-            // Debugging info:
-            double minP = std::max(currSegment->minSpaceLimit, -5000.0);
-            double maxP = std::min(currSegment->maxSpaceLimit, 5000.0);
-            fprintf(stdout, "<rect style=\"fill: #f00; opacity: 0.2;\" "
-                    "x=\"%g\" y=\"%g\" width=\"%g\" height=\"%g\" />\n",
-                    currSegment->lowPoint()[XDIM], minP,
-                    currSegment->highPoint()[XDIM] - currSegment->lowPoint()[XDIM],
-                    maxP - minP);
-            fprintf(stdout, "<line style=\"stroke: #000;\" x1=\"%g\" "
-                    "y1=\"%g\" x2=\"%g\" y2=\"%g\" />\n",
-                    currSegment->lowPoint()[XDIM], currSegment->lowPoint()[YDIM],
-                    currSegment->highPoint()[XDIM], currSegment->highPoint()[YDIM]);
+        // Debugging info:
+        double minP = std::max(currSegment->minSpaceLimit, -5000.0);
+        double maxP = std::min(currSegment->maxSpaceLimit, 5000.0);
+        fprintf(stdout, "<rect style=\"fill: #f00; opacity: 0.2;\" "
+                "x=\"%g\" y=\"%g\" width=\"%g\" height=\"%g\" />\n",
+                currSegment->lowPoint()[XDIM], minP,
+                currSegment->highPoint()[XDIM] - currSegment->lowPoint()[XDIM],
+                maxP - minP);
+        fprintf(stdout, "<line style=\"stroke: #000;\" x1=\"%g\" "
+                "y1=\"%g\" x2=\"%g\" y2=\"%g\" />\n",
+                currSegment->lowPoint()[XDIM], currSegment->lowPoint()[YDIM],
+                currSegment->highPoint()[XDIM], currSegment->highPoint()[YDIM]);
 #endif
 
-            if (justUnifying)
+        if (justUnifying)
+        {
+            // Just doing centring, not nudging.
+            // Record the index of the variable so we can use it as
+            // a segment to potentially constrain to other segments.
+            if (currSegment->variable->weight == freeWeight)
             {
-                // Just doing centring, not nudging.
-                // Record the index of the variable so we can use it as
-                // a segment to potentially constrain to other segments.
-                if (currSegment->variable->weight == freeWeight)
-                {
-                    freeIndexes.push_back(index);
-                }
-                // Thus, we don't need to constrain position against other
-                // segments.
-                prevVars.push_back(&(*currSegment));
-                continue;
+                freeIndexes.push_back(index);
             }
+            // Thus, we don't need to constrain position against other
+            // segments.
+            prevVars.push_back(&(*currSegment));
+            continue;
+        }
 
-            // The constraints generated here must be in order of
-            // leftBoundary-segment ... segment-segment ... segment-rightBoundary
-            // since this order is leveraged later for rewriting the
-            // separations of unsatisfable channel groups.
+        // The constraints generated here must be in order of
+        // leftBoundary-segment ... segment-segment ... segment-rightBoundary
+        // since this order is leveraged later for rewriting the
+        // separations of unsatisfable channel groups.
 
-            // Constrain to channel boundary.
-            if (!currSegment->fixed)
+        // Constrain to channel boundary.
+        if (!currSegment->fixed)
+        {
+            // If this segment sees a channel boundary to its left,
+            // then constrain its placement as such.
+            if (currSegment->minSpaceLimit > -CHANNEL_MAX)
             {
-                // If this segment sees a channel boundary to its left,
-                // then constrain its placement as such.
-                if (currSegment->minSpaceLimit > -CHANNEL_MAX)
-                {
-                    vs.push_back(new Variable(channelLeftID,
-                                currSegment->minSpaceLimit, fixedWeight));
-                    cs.push_back(new Constraint(vs[vs.size() - 1], vs[index],
-                                0.0));
-                }
+                vs.push_back(new Variable(channelLeftID,
+                            currSegment->minSpaceLimit, fixedWeight));
+                cs.push_back(new Constraint(vs[vs.size() - 1], vs[index],
+                            0.0));
             }
+        }
 
-            // Constrain position in relation to previously seen segments,
-            // if necessary (i.e. when they could overlap).
-            for (ShiftSegmentPtrList::iterator prevVarIt = prevVars.begin();
-                    prevVarIt != prevVars.end(); ++prevVarIt)
-            {
-                NudgingShiftSegment *prevSeg =
-                        static_cast<NudgingShiftSegment *> (*prevVarIt);
-                Variable *prevVar = prevSeg->variable;
+        // Constrain position in relation to previously seen segments,
+        // if necessary (i.e. when they could overlap).
+        for (ShiftSegmentPtrList::iterator prevVarIt = prevVars.begin();
+                prevVarIt != prevVars.end(); ++prevVarIt)
+        {
+            NudgingShiftSegment *prevSeg =
+                    static_cast<NudgingShiftSegment *> (*prevVarIt);
+            Variable *prevVar = prevSeg->variable;
 
-                if (currSegment->overlapsWith(prevSeg, dimension) &&
-                        (!(currSegment->fixed) || !(prevSeg->fixed)))
+            if (currSegment->overlapsWith(prevSeg, dimension) &&
+                    (!(currSegment->fixed) || !(prevSeg->fixed)))
+            {
+                // If there is a previous segment to the left that
+                // could overlap this in the shift direction, then
+                // constrain the two segments to be separated.
+                // Though don't add the constraint if both the
+                // segments are fixed in place.
+                double thisSepDist = sepDist;
+                bool equality = false;
+                if (currSegment->shouldAlignWith(prevSeg, dimension))
                 {
-                    // If there is a previous segment to the left that
-                    // could overlap this in the shift direction, then
-                    // constrain the two segments to be separated.
-                    // Though don't add the constraint if both the
-                    // segments are fixed in place.
-                    double thisSepDist = sepDist;
-                    bool equality = false;
-                    if (currSegment->shouldAlignWith(prevSeg, dimension))
-                    {
-                        // Handles the case where the two end segments can
-                        // be brought together to make a single segment. This
-                        // can help in situations where having the small kink
-                        // can restrict other kinds of nudging.
-                        thisSepDist = 0;
-                        equality = true;
-                    }
-                    else if (currSegment->canAlignWith(prevSeg, dimension))
-                    {
-                        // We need to address the problem of two neighbouring
-                        // segments of the same connector being kept separated
-                        // due only to a kink created in the other dimension.
-                        // Here, we let such segments drift back together.
-                        thisSepDist = 0;
-                    }
-                    else if (!nudgeSharedPathsWithCommonEnd &&
-                            (m_shared_path_connectors_with_common_endpoints.count(
-                                 UnsignedPair(currSegment->connRef->id(), prevSeg->connRef->id())) > 0))
-                    {
-                        // We don't want to nudge apart these two segments
-                        // since they are from a shared path with a common
-                        // endpoint.  There might be multiple chains of
-                        // segments that don't all have the same endpoints
-                        // so we need to make this an equality to prevent
-                        // some of them possibly getting nudged apart.
-                        thisSepDist = 0;
-                        equality = true;
-                    }
-
-                    Constraint *constraint = new Constraint(prevVar,
-                            vs[index], thisSepDist, equality);
-                    cs.push_back(constraint);
-                    if (thisSepDist)
-                    {
-                        // Add to the list of gap constraints so we can
-                        // rewrite the separation distance later.
-                        gapcs.push_back(constraint);
-                    }
+                    // Handles the case where the two end segments can
+                    // be brought together to make a single segment. This
+                    // can help in situations where having the small kink
+                    // can restrict other kinds of nudging.
+                    thisSepDist = 0;
+                    equality = true;
+                }
+                else if (currSegment->canAlignWith(prevSeg, dimension))
+                {
+                    // We need to address the problem of two neighbouring
+                    // segments of the same connector being kept separated
+                    // due only to a kink created in the other dimension.
+                    // Here, we let such segments drift back together.
+                    thisSepDist = 0;
+                }
+                else if (!nudgeSharedPathsWithCommonEnd &&
+                        (m_shared_path_connectors_with_common_endpoints.count(
+                             UnsignedPair(currSegment->connRef->id(), prevSeg->connRef->id())) > 0))
+                {
+                    // We don't want to nudge apart these two segments
+                    // since they are from a shared path with a common
+                    // endpoint.  There might be multiple chains of
+                    // segments that don't all have the same endpoints
+                    // so we need to make this an equality to prevent
+                    // some of them possibly getting nudged apart.
+                    thisSepDist = 0;
+                    equality = true;
                 }
-            }
 
-            if (!currSegment->fixed)
-            {
-                // If this segment sees a channel boundary to its right,
-                // then constrain its placement as such.
-                if (currSegment->maxSpaceLimit < CHANNEL_MAX)
+                Constraint *constraint = new Constraint(prevVar,
+                        vs[index], thisSepDist, equality);
+                cs.push_back(constraint);
+                if (thisSepDist)
                 {
-                    vs.push_back(new Variable(channelRightID,
-                                currSegment->maxSpaceLimit, fixedWeight));
-                    cs.push_back(new Constraint(vs[index], vs[vs.size() - 1],
-                                0.0));
+                    // Add to the list of gap constraints so we can
+                    // rewrite the separation distance later.
+                    gapcs.push_back(constraint);
                 }
             }
+        }
 
-            prevVars.push_back(&(*currSegment));
+        if (!currSegment->fixed)
+        {
+            // If this segment sees a channel boundary to its right,
+            // then constrain its placement as such.
+            if (currSegment->maxSpaceLimit < CHANNEL_MAX)
+            {
+                vs.push_back(new Variable(channelRightID,
+                            currSegment->maxSpaceLimit, fixedWeight));
+                cs.push_back(new Constraint(vs[index], vs[vs.size() - 1],
+                            0.0));
+            }
         }
 
-        std::list<PotentialSegmentConstraint> potentialConstraints;
-        if (justUnifying)
+        prevVars.push_back(&(*currSegment));
+    }
+
+    std::list<PotentialSegmentConstraint> potentialConstraints;
+    if (justUnifying)
+    {
+        for (std::list<size_t>::iterator curr = freeIndexes.begin();
+                curr != freeIndexes.end(); ++curr)
         {
-            for (std::list<size_t>::iterator curr = freeIndexes.begin();
-                    curr != freeIndexes.end(); ++curr)
+            for (std::list<size_t>::iterator curr2 = curr;
+                    curr2 != freeIndexes.end(); ++curr2)
             {
-                for (std::list<size_t>::iterator curr2 = curr;
-                        curr2 != freeIndexes.end(); ++curr2)
+                if (curr == curr2)
                 {
-                    if (curr == curr2)
-                    {
-                        continue;
-                    }
-                    potentialConstraints.push_back(
-                            PotentialSegmentConstraint(*curr, *curr2, vs));
+                    continue;
                 }
+                potentialConstraints.push_back(
+                        PotentialSegmentConstraint(*curr, *curr2, vs));
             }
         }
+    }
 #ifdef NUDGE_DEBUG
-        for (unsigned i = 0;i < vs.size(); ++i)
+    for (unsigned i = 0;i < vs.size(); ++i)
+    {
+        fprintf(stderr, "-vs[%d]=%f\n", i, vs[i]->desiredPosition);
+    }
+#endif
+    // Repeatedly try solving this.  There are two cases:
+    //  -  When Unifying, we greedily place as many free segments as
+    //     possible at the same positions, that way they have more
+    //     accurate nudging orders determined for them in the Nudging
+    //     stage.
+    //  -  When Nudging, if we can't fit all the segments with the
+    //     default nudging distance we try smaller separation
+    //     distances till we find a solution that is satisfied.
+    bool justAddedConstraint = false;
+    bool satisfied;
+
+    typedef std::pair<size_t, size_t> UnsatisfiedRange;
+    std::list<UnsatisfiedRange> unsatisfiedRanges;
+#ifndef USELIBVPSC
+    // Each attempt only changes a few constraints, so if requested, the 
+    // solver is kept between attempts and re-solved starting from its 
+    // previous block structure.
+    bool warmStart = m_router->routingOption(performIncrementalNudgingSolve);
+#else
+    // libvpsc's IncSolver can't have constraints removed or changed, so
+    // it is always rebuilt for each attempt.
+    bool warmStart = false;
+#endif
+    std::unique_ptr<IncSolver> f;
+    size_t attempts = 0;
+    do
+    {
+        if (!f || !warmStart)
         {
-            fprintf(stderr, "-vs[%d]=%f\n", i, vs[i]->desiredPosition);
+            f.reset(new IncSolver(vs, cs));
         }
-#endif
-        // Repeatedly try solving this.  There are two cases:
-        //  -  When Unifying, we greedily place as many free segments as
-        //     possible at the same positions, that way they have more
-        //     accurate nudging orders determined for them in the Nudging
-        //     stage.
-        //  -  When Nudging, if we can't fit all the segments with the
-        //     default nudging distance we try smaller separation
-        //     distances till we find a solution that is satisfied.
-        bool justAddedConstraint = false;
-        bool satisfied;
-
-        typedef std::pair<size_t, size_t> UnsatisfiedRange;
-        std::list<UnsatisfiedRange> unsatisfiedRanges;
-        do
-        {
-            IncSolver f(vs, cs);
-            f.solve();
-
-            // Determine if the problem was satisfied.
-            satisfied = true;
-            for (size_t i = 0; i < vs.size(); ++i)
-            {
-                // For each variable...
-                if (vs[i]->id != freeSegmentID)
-                {
-                    // If it is a fixed segment (should stay still)...
-                    if (fabs(vs[i]->finalPosition -
-                            vs[i]->desiredPosition) > 0.0001)
-                    {
-                        // and it is not at it's desired position, then
-                        // we consider the problem to be unsatisfied.
-                        satisfied = false;
+        f->solve();
+        ++attempts;
+
+        // Determine if the problem was satisfied.
+        satisfied = true;
+        for (size_t i = 0; i < vs.size(); ++i)
+        {
+            // For each variable...
+            if (vs[i]->id != freeSegmentID)
+            {
+                // If it is a fixed segment (should stay still)...
+                if (fabs(vs[i]->finalPosition -
+                        vs[i]->desiredPosition) > 0.0001)
+                {
+                    // and it is not at it's desired position, then
+                    // we consider the problem to be unsatisfied.
+                    satisfied = false;
 
-                        // We record ranges of unsatisfied variables based on
-                        // the channel edges.
-                        if (vs[i]->id == channelLeftID)
+                    // We record ranges of unsatisfied variables based on
+                    // the channel edges.
+                    if (vs[i]->id == channelLeftID)
+                    {
+                        // This is the left-hand-side of a channel.
+                        if (unsatisfiedRanges.empty() ||
+                                (unsatisfiedRanges.back().first !=
+                                unsatisfiedRanges.back().second))
                         {
-                            // This is the left-hand-side of a channel.
-                            if (unsatisfiedRanges.empty() ||
-                                    (unsatisfiedRanges.back().first !=
-                                    unsatisfiedRanges.back().second))
-                            {
-                                // There are no existing unsatisfied ranges,
-                                // or there are but they are a valid range
-                                // (we've encountered the right-hand channel
-                                // edges already).
-                                // So, start a new unsatisfied range.
-                                unsatisfiedRanges.push_back(
-                                        std::make_pair(i, i + 1));
-                            }
+                            // There are no existing unsatisfied ranges,
+                            // or there are but they are a valid range
+                            // (we've encountered the right-hand channel
+                            // edges already).
+                            // So, start a new unsatisfied range.
+                            unsatisfiedRanges.push_back(
+                                    std::make_pair(i, i + 1));
                         }
-                        else if (vs[i]->id == channelRightID)
+                    }
+                    else if (vs[i]->id == channelRightID)
+                    {
+                        // This is the right-hand-side of a channel.
+                        if (unsatisfiedRanges.empty())
                         {
-                            // This is the right-hand-side of a channel.
-                            if (unsatisfiedRanges.empty())
-                            {
-                                // There are no existing unsatisfied ranges,
-                                // so start a new unsatisfied range.
-                                // We are looking at a unsatisfied right side
-                                // where the left side was satisfied, so the
-                                // range begins at the previous variable
-                                // which should be a left channel side.
-                                COLA_ASSERT(i > 0);
-                                COLA_ASSERT(vs[i - 1]->id == channelLeftID);
-                                unsatisfiedRanges.push_back(
-                                        std::make_pair(i - 1, i));
-                            }
-                            else
-                            {
-                                // Expand the existing range to include index.
-                                unsatisfiedRanges.back().second = i;
-                            }
+                            // There are no existing unsatisfied ranges,
+                            // so start a new unsatisfied range.
+                            // We are looking at a unsatisfied right side
+                            // where the left side was satisfied, so the
+                            // range begins at the previous variable
+                            // which should be a left channel side.
+                            COLA_ASSERT(i > 0);
+                            COLA_ASSERT(vs[i - 1]->id == channelLeftID);
+                            unsatisfiedRanges.push_back(
+                                    std::make_pair(i - 1, i));
                         }
-                        else if (vs[i]->id == fixedSegmentID)
+                        else
                         {
-                            // Fixed connector segments can also start and
-                            // extend unsatisfied variable ranges.
-                            if (unsatisfiedRanges.empty())
-                            {
-                                // There are no existing unsatisfied ranges,
-                                // so start a new unsatisfied range.
-                                unsatisfiedRanges.push_back(
-                                        std::make_pair(i, i));
-                            }
-                            else
-                            {
-                                // Expand the existing range to include index.
-                                unsatisfiedRanges.back().second = i;
-                            }
+                            // Expand the existing range to include index.
+                            unsatisfiedRanges.back().second = i;
+                        }
+                    }
+                    else if (vs[i]->id == fixedSegmentID)
+                    {
+                        // Fixed connector segments can also start and
+                        // extend unsatisfied variable ranges.
+                        if (unsatisfiedRanges.empty())
+                        {
+                            // There are no existing unsatisfied ranges,
+                            // so start a new unsatisfied range.
+                            unsatisfiedRanges.push_back(
+                                    std::make_pair(i, i));
+                        }
+                        else
+                        {
+                            // Expand the existing range to include index.
+                            unsatisfiedRanges.back().second = i;
                         }
                     }
                 }
             }
+        }
 
 #ifdef NUDGE_DEBUG
-            if (!satisfied)
-            {
-                fprintf(stderr,"unsatisfied\n");
-            }
+        if (!satisfied)
+        {
+            fprintf(stderr,"unsatisfied\n");
+        }
 #endif
 
-            if (justUnifying)
-            {
-                // When we're centring, we'd like to greedily place as many
-                // segments as possible at the same positions, that way they
-                // have more accurate nudging orders determined for them.
-                //
-                // We do this by taking pairs of adjoining free segments and
-                // attempting to constrain them to have the same position,
-                // starting from the closest up to the furthest.
-
-                if (justAddedConstraint)
-                {
-                    COLA_ASSERT(potentialConstraints.size() > 0);
-                    if (!satisfied)
-                    {
-                        // We couldn't satisfy the problem with the added
-                        // potential constraint, so we can't position these
-                        // segments together.  Roll back.
-                        potentialConstraints.pop_front();
-                        delete cs.back();
-                        cs.pop_back();
-                    }
-                    else
-                    {
-                        // We could position these two segments together.
-                        PotentialSegmentConstraint& pc =
-                                potentialConstraints.front();
-
-                        // Rewrite the indexes of these two variables to
-                        // one, so we need not worry about redundant
-                        // equality constraints.
-                        for (std::list<PotentialSegmentConstraint>::iterator
-                                it = potentialConstraints.begin();
-                                it != potentialConstraints.end(); ++it)
-                        {
-                            it->rewriteIndex(pc.index1, pc.index2);
-                        }
-                        potentialConstraints.pop_front();
-                    }
-                }
-                potentialConstraints.sort();
-                justAddedConstraint = false;
+        if (justUnifying)
+        {
+            // When we're centring, we'd like to greedily place as many
+            // segments as possible at the same positions, that way they
+            // have more accurate nudging orders determined for them.
+            //
+            // We do this by taking pairs of adjoining free segments and
+            // attempting to constrain them to have the same position,
+            // starting from the closest up to the furthest.
 
-                // Remove now invalid potential segment constraints.
-                // This could have been caused by the variable rewriting.
-                while (!potentialConstraints.empty() &&
-                       !potentialConstraints.front().stillValid())
+            if (justAddedConstraint)
+            {
+                COLA_ASSERT(potentialConstraints.size() > 0);
+                if (!satisfied)
                 {
+                    // We couldn't satisfy the problem with the added
+                    // potential constraint, so we can't position these
+                    // segments together.  Roll back.
                     potentialConstraints.pop_front();
+#ifndef USELIBVPSC
+                    f->removeConstraint(cs.back());
+#endif
+                    delete cs.back();
+                    cs.pop_back();
                 }
-
-                if (!potentialConstraints.empty())
+                else
                 {
-                    // We still have more possibilities to consider.
-                    // Create a constraint for this, add it, and mark as
-                    // unsatisfied, so the problem gets re-solved.
+                    // We could position these two segments together.
                     PotentialSegmentConstraint& pc =
                             potentialConstraints.front();
-                    COLA_ASSERT(pc.index1 != pc.index2);
-                    cs.push_back(new Constraint(vs[pc.index1], vs[pc.index2],
-                            0, true));
-                    satisfied = false;
-                    justAddedConstraint = true;
+
+                    // Rewrite the indexes of these two variables to
+                    // one, so we need not worry about redundant
+                    // equality constraints.
+                    for (std::list<PotentialSegmentConstraint>::iterator
+                            it = potentialConstraints.begin();
+                            it != potentialConstraints.end(); ++it)
+                    {
+                        it->rewriteIndex(pc.index1, pc.index2);
+                    }
+                    potentialConstraints.pop_front();
                 }
             }
-            else
+            potentialConstraints.sort();
+            justAddedConstraint = false;
+
+            // Remove now invalid potential segment constraints.
+            // This could have been caused by the variable rewriting.
+            while (!potentialConstraints.empty() &&
+                   !potentialConstraints.front().stillValid())
             {
-                if (!satisfied)
-                {
-                    COLA_ASSERT(unsatisfiedRanges.size() > 0);
-                    // Reduce the separation distance.
-                    sepDist -= (baseSepDist / reductionSteps);
+                potentialConstraints.pop_front();
+            }
+
+            if (!potentialConstraints.empty())
+            {
+                // We still have more possibilities to consider.
+                // Create a constraint for this, add it, and mark as
+                // unsatisfied, so the problem gets re-solved.
+                PotentialSegmentConstraint& pc =
+                        potentialConstraints.front();
+                COLA_ASSERT(pc.index1 != pc.index2);
+                cs.push_back(new Constraint(vs[pc.index1], vs[pc.index2],
+                        0, true));
+#ifndef USELIBVPSC
+                f->addConstraint(cs.back());
+#endif
+                satisfied = false;
+                justAddedConstraint = true;
+            }
+        }
+        else
+        {
+            if (!satisfied)
+            {
+                COLA_ASSERT(unsatisfiedRanges.size() > 0);
+                // Reduce the separation distance.
+                sepDist -= (baseSepDist / reductionSteps);
 #ifndef NDEBUG
-                    for (std::list<UnsatisfiedRange>::iterator it =
-                            unsatisfiedRanges.begin();
-                            it != unsatisfiedRanges.end(); ++it)
-                    {
-                        COLA_ASSERT(vs[it->first]->id != freeSegmentID);
-                        COLA_ASSERT(vs[it->second]->id != freeSegmentID);
-                    }
+                for (std::list<UnsatisfiedRange>::iterator it =
+                        unsatisfiedRanges.begin();
+                        it != unsatisfiedRanges.end(); ++it)
+                {
+                    COLA_ASSERT(vs[it->first]->id != freeSegmentID);
+                    COLA_ASSERT(vs[it->second]->id != freeSegmentID);
+                }
 #endif
 #ifdef NUDGE_DEBUG
-                    for (std::list<UnsatisfiedRange>::iterator it =
-                            unsatisfiedRanges.begin();
-                            it != unsatisfiedRanges.end(); ++it)
-                    {
-                        fprintf(stderr, "unsatisfiedVarRange(%ld, %ld)\n",
-                                it->first, it->second);
-                    }
-                    fprintf(stderr, "unsatisfied, trying %g\n", sepDist);
+                for (std::list<UnsatisfiedRange>::iterator it =
+                        unsatisfiedRanges.begin();
+                        it != unsatisfiedRanges.end(); ++it)
+                {
+                    fprintf(stderr, "unsatisfiedVarRange(%ld, %ld)\n",
+                            it->first, it->second);
+                }
+                fprintf(stderr, "unsatisfied, trying %g\n", sepDist);
 #endif
-                    // And rewrite all the gap constraints to have the new
-                    // reduced separation distance.
-                    bool withinUnsatisfiedGroup = false;
-                    for (Constraints::iterator cIt = cs.begin();
-                            cIt != cs.end(); ++cIt)
-                    {
-                        UnsatisfiedRange& range = unsatisfiedRanges.front();
-                        Constraint *constraint = *cIt;
+                // And rewrite all the gap constraints to have the new
+                // reduced separation distance.
+                bool withinUnsatisfiedGroup = false;
+                for (Constraints::iterator cIt = cs.begin();
+                        cIt != cs.end(); ++cIt)
+                {
+                    UnsatisfiedRange& range = unsatisfiedRanges.front();
+                    Constraint *constraint = *cIt;
 
-                        if (constraint->left == vs[range.first])
-                        {
-                            // Entered an unsatisfied range of variables.
-                            withinUnsatisfiedGroup = true;
-                        }
+                    if (constraint->left == vs[range.first])
+                    {
+                        // Entered an unsatisfied range of variables.
+                        withinUnsatisfiedGroup = true;
+                    }
 
-                        if (withinUnsatisfiedGroup && (constraint->gap > 0))
-                        {
-                            // Rewrite constraints in unsatisfied ranges
-                            // that have a non-zero gap.
-                            constraint->gap = sepDist;
-                        }
+                    if (withinUnsatisfiedGroup && (constraint->gap > 0))
+                    {
+                        // Rewrite constraints in unsatisfied ranges
+                        // that have a non-zero gap.
+#ifndef USELIBVPSC
+                        f->setConstraintGap(constraint, sepDist);
+#else
+                        constraint->gap = sepDist;
+#endif
+                    }
 
-                        if (constraint->right == vs[range.second])
+                    if (constraint->right == vs[range.second])
+                    {
+                        // Left an unsatisfied range of variables.
+                        withinUnsatisfiedGroup = false;
+                        unsatisfiedRanges.pop_front();
+                        if (unsatisfiedRanges.empty())
                         {
-                            // Left an unsatisfied range of variables.
-                            withinUnsatisfiedGroup = false;
-                            unsatisfiedRanges.pop_front();
-                            if (unsatisfiedRanges.empty())
-                            {
-                                // And there are no more unsatisfied variables.
-                                break;
-                            }
+                            // And there are no more unsatisfied variables.
+                            break;
                         }
                     }
                 }
             }
         }
-        while (!satisfied && (sepDist > 0.0001));
+    }
+    while (!satisfied && (sepDist > 0.0001));
+    m_router->profiler.countVpscSolves(attempts, attempts - 1);
 
-        if (satisfied)
-        {
+    region.satisfied = satisfied;
 #ifdef NUDGE_DEBUG
-            fprintf(stderr,"satisfied at nudgeDist = %g\n", sepDist);
+    if (satisfied)
+    {
+        fprintf(stderr,"satisfied at nudgeDist = %g\n", sepDist);
+    }
 #endif
-            for (ShiftSegmentList::iterator currSegment = currentRegion.begin();
-                    currSegment != currentRegion.end(); ++currSegment)
-            {
-                NudgingShiftSegment *segment =
-                        static_cast<NudgingShiftSegment *> (*currSegment);
+}
 
-                segment->updatePositionsFromSolver(justUnifying);
-            }
-        }
-#ifdef NUDGE_DEBUG
-        for(unsigned i=0;i<vs.size();i++) {
-            fprintf(stderr, "+vs[%d]=%f\n",i,vs[i]->finalPosition);
-        }
-#endif
-#ifdef NUDGE_DEBUG_SVG
+
+// Moves the segments of a solved region to their new positions, then 
+// frees the region's segments and solver problem.  The region should be
+// deleted afterwards.
+void ImproveOrthogonalRoutes::applyNudgingRegion(NudgingRegion& region,
+        bool justUnifying) const
+{
+    ShiftSegmentList& currentRegion = region.segments;
+    Variables& vs = region.vs;
+    Constraints& cs = region.cs;
+
+    if (region.satisfied)
+    {
         for (ShiftSegmentList::iterator currSegment = currentRegion.begin();
                 currSegment != currentRegion.end(); ++currSegment)
         {
             NudgingShiftSegment *segment =
                     static_cast<NudgingShiftSegment *> (*currSegment);
 
-            fprintf(stdout, "<line style=\"stroke: #00F;\" x1=\"%g\" "
-                    "y1=\"%g\" x2=\"%g\" y2=\"%g\" />\n",
-                    segment->lowPoint()[XDIM], segment->variable->finalPosition,
-                    segment->highPoint()[XDIM], segment->variable->finalPosition);
+            segment->updatePositionsFromSolver(justUnifying);
         }
+    }
+#ifdef NUDGE_DEBUG
+    for(unsigned i=0;i<vs.size();i++) {
+        fprintf(stderr, "+vs[%d]=%f\n",i,vs[i]->finalPosition);
+    }
 #endif
-        for_each(currentRegion.begin(), currentRegion.end(), delete_object());
-        for_each(vs.begin(), vs.end(), delete_object());
-        for_each(cs.begin(), cs.end(), delete_object());
+#ifdef NUDGE_DEBUG_SVG
+    for (ShiftSegmentList::iterator currSegment = currentRegion.begin();
+            currSegment != currentRegion.end(); ++currSegment)
+    {
+        NudgingShiftSegment *segment =
+                static_cast<NudgingShiftSegment *> (*currSegment);
+
+        fprintf(stdout, "<line style=\"stroke: #00F;\" x1=\"%g\" "
+                "y1=\"%g\" x2=\"%g\" y2=\"%g\" />\n",
+                segment->lowPoint()[XDIM], segment->variable->finalPosition,
+                segment->highPoint()[XDIM], segment->variable->finalPosition);
     }
+#endif
+    for_each(currentRegion.begin(), currentRegion.end(), delete_object());
+    for_each(vs.begin(), vs.end(), delete_object());
+    for_each(cs.begin(), cs.end(), delete_object());
 }
 
 
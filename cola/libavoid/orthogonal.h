@@ -26,11 +26,104 @@
 #ifndef AVOID_ORTHOGONAL_H
 #define AVOID_ORTHOGONAL_H
 
+#include <map>
+#include <vector>
+
+#include "libavoid/geomtypes.h"
+#include "libavoid/spatialindex.h"
+
 namespace Avoid {
 
 class Router;
+class VertInf;
+
+
+// A record of the obstacle boxes and connection points that the static
+// orthogonal visibility graph was last generated from.  This is compared
+// with the current router state to find the parts of the graph that need
+// regenerating, see updateStaticOrthogonalVisGraph().
+//
+// It also keeps the extents of the visibility lines the sweeps found, 
+// and the vertices that split them into edges.  Lines crossing the 
+// regenerated part of the graph, but at positions outside it, are 
+// unchanged, so they are created from these rather than being found by 
+// sweeping again, and only their vertices near that part are replaced.
+//
+class OrthogonalVisGraphSnapshot
+{
+    public:
+        OrthogonalVisGraphSnapshot();
+
+        // Records the current state of the router.  The lines must have 
+        // been recorded already, as the graph was generated.
+        void record(Router *router);
+        // Forgets any recorded state, including the lines.
+        void clear(void);
+        bool isValid(void) const;
+
+        // The vertices of a line, by their position along it.  Those at
+        // the same position are in the order the line was generated with.
+        typedef std::multimap<double, VertInf *> LineVertices;
+        // A line spanning begin--finish, and its vertices once generated.
+        struct LineExtent
+        {
+            LineExtent(double b, double f)
+                : begin(b),
+                  finish(f)
+            {
+            }
+
+            double begin;
+            double finish;
+            LineVertices vertices;
+        };
+        // The lines at each position.
+        typedef std::multimap<double, LineExtent> LineMap;
+        typedef LineMap::value_type Line;
+
+        // Records a line at pos in dimension dim, i.e., horizontal lines 
+        // are at positions in YDIM, spanning begin--finish in the other 
+        // dimension.  Its vertices are added as it is generated.
+        Line *addLine(size_t dim, double pos, double begin, double finish);
+        // Forgets the lines at positions from min to max in dimension dim.
+        void removeLines(size_t dim, double min, double max);
+        // Appends the lines at positions in dimension dim that may overlap
+        // min--max in the other dimension.
+        void linesOverlapping(size_t dim, double min, double max,
+                std::vector<Line *>& lines) const;
+
+        struct ConnPoint
+        {
+            const VertInf *vert;
+            Point point;
+            unsigned int directions;
+            size_t edgeCount;
+
+            bool operator<(const ConnPoint& rhs) const;
+            bool operator==(const ConnPoint& rhs) const;
+        };
+
+        bool m_valid;
+        // Sorted, so that the records can be compared.
+        std::vector<Box> m_obstacle_boxes;
+        std::vector<ConnPoint> m_conn_points;
+        // The extent of all obstacle boxes and connection points.
+        Box m_extent;
+        // Indexed by the dimension of the lines' positions.
+        LineMap m_lines[2];
+    private:
+        void indexLine(size_t dim, Line *line);
+
+        // The lines are indexed by the boxes they span within the extent,
+        // once it is known.
+        SpatialIndex<Line> m_line_index[2];
+        bool m_lines_indexed;
+};
 
-extern void generateStaticOrthogonalVisGraph(Router *router);
+extern void generateStaticOrthogonalVisGraph(Router *router,
+        OrthogonalVisGraphSnapshot *snapshot = nullptr);
+extern bool updateStaticOrthogonalVisGraph(Router *router,
+        OrthogonalVisGraphSnapshot& previous);
 extern void improveOrthogonalRoutes(Router *router);
 
 
@@ -0,0 +1,166 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ *
+ * Copyright (C) 2026  agent
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * Licensees holding a valid commercial license may use this file in
+ * accordance with the commercial license agreement provided with the
+ * library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):  agent
+*/
+
+
+#include <algorithm>
+
+#include "libavoid/parallel.h"
+#include "libavoid/assertions.h"
+
+
+namespace Avoid {
+
+
+unsigned int effectiveThreadCount(const unsigned int requestedThreads,
+        const size_t taskCount)
+{
+    unsigned int threads = requestedThreads;
+    if (threads == 0)
+    {
+        // May return zero if the value is not computable.
+        threads = std::thread::hardware_concurrency();
+    }
+    threads = std::max(threads, 1u);
+
+    if (taskCount < threads)
+    {
+        threads = std::max(static_cast<unsigned int>(taskCount), 1u);
+    }
+    return threads;
+}
+
+
+ThreadPool::ThreadPool()
+    : m_task(nullptr),
+      m_task_count(0),
+      m_next_task(0),
+      m_thread_count(1),
+      m_generation(0),
+      m_active_workers(0),
+      m_stopping(false)
+{
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_work_available.notify_all();
+    for (size_t t = 0; t < m_workers.size(); ++t)
+    {
+        m_workers[t].join();
+    }
+}
+
+
+void ThreadPool::parallelFor(const size_t taskCount, 
+        const unsigned int threadCount, const Task& task)
+{
+    COLA_ASSERT(m_task == nullptr);
+
+    if ((threadCount <= 1) || (taskCount <= 1))
+    {
+        for (size_t i = 0; i < taskCount; ++i)
+        {
+            task(i, 0);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Start any further worker threads needed.  They wait for the
+        // generation after the current one.
+        for (unsigned int t = m_workers.size() + 1; t < threadCount; ++t)
+        {
+            m_workers.push_back(std::thread(&ThreadPool::workerLoop, this, 
+                    t, m_generation));
+        }
+        m_task = &task;
+        m_task_count = taskCount;
+        m_next_task = 0;
+        m_thread_count = threadCount;
+        m_active_workers = threadCount - 1;
+        ++m_generation;
+    }
+    m_work_available.notify_all();
+
+    runTasks(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_active_workers > 0)
+    {
+        m_work_done.wait(lock);
+    }
+    m_task = nullptr;
+}
+
+
+void ThreadPool::workerLoop(const unsigned int threadIndex, 
+        unsigned int generation)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        while (!m_stopping && (m_generation == generation))
+        {
+            m_work_available.wait(lock);
+        }
+        if (m_stopping)
+        {
+            return;
+        }
+        generation = m_generation;
+        if (threadIndex >= m_thread_count)
+        {
+            // Not needed for this call.
+            continue;
+        }
+
+        lock.unlock();
+        runTasks(threadIndex);
+        lock.lock();
+
+        if (--m_active_workers == 0)
+        {
+            m_work_done.notify_one();
+        }
+    }
+}
+
+
+void ThreadPool::runTasks(const unsigned int threadIndex)
+{
+    size_t index;
+    while ((index = m_next_task.fetch_add(1)) < m_task_count)
+    {
+        (*m_task)(index, threadIndex);
+    }
+}
+
+
+}
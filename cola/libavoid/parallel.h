@@ -0,0 +1,124 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ *
+ * Copyright (C) 2026  agent
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * Licensees holding a valid commercial license may use this file in
+ * accordance with the commercial license agreement provided with the
+ * library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):  agent
+*/
+
+// Simple helpers for running independent pieces of router work on
+// several threads.  The router itself is not thread-safe, so callers
+// are responsible for ensuring the tasks only read shared state and
+// write to their own (per-task or per-thread) storage.
+
+
+#ifndef AVOID_PARALLEL_H
+#define AVOID_PARALLEL_H
+
+#include <cstddef>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace Avoid {
+
+// Returns the number of threads that should be used to perform the given
+// number of tasks.  A requestedThreads value of zero means use the number
+// of hardware threads available.  The result is always at least one and
+// never more than the number of tasks.
+extern unsigned int effectiveThreadCount(const unsigned int requestedThreads,
+        const size_t taskCount);
+
+
+// A set of worker threads that is reused by each call to parallelFor().
+// Each Router owns one of these.  Worker threads are only started the 
+// first time they are needed, so a pool that is only asked to run tasks 
+// on one thread never creates any.
+//
+class ThreadPool
+{
+    public:
+        typedef std::function<void(size_t, unsigned int)> Task;
+
+        ThreadPool();
+        ~ThreadPool();
+
+        // Calls task(taskIndex, threadIndex) for each taskIndex from 0 to
+        // taskCount - 1, distributing the calls dynamically over 
+        // threadCount threads.  Thread zero is the calling thread.  Returns
+        // once all tasks are complete.  Tasks must not throw, and must not
+        // themselves call parallelFor() on the same pool.
+        void parallelFor(const size_t taskCount, 
+                const unsigned int threadCount, const Task& task);
+
+    private:
+        ThreadPool(const ThreadPool&);
+        ThreadPool& operator=(const ThreadPool&);
+
+        void workerLoop(const unsigned int threadIndex, 
+                unsigned int generation);
+        void runTasks(const unsigned int threadIndex);
+
+        std::vector<std::thread> m_workers;
+        std::mutex m_mutex;
+        std::condition_variable m_work_available;
+        std::condition_variable m_work_done;
+        const Task *m_task;
+        size_t m_task_count;
+        std::atomic<size_t> m_next_task;
+        // The number of threads, including the calling thread, taking part
+        // in the current call to parallelFor().
+        unsigned int m_thread_count;
+        unsigned int m_generation;
+        unsigned int m_active_workers;
+        bool m_stopping;
+};
+
+
+// Calls task(taskIndex, threadIndex) for each taskIndex from 0 to
+// taskCount - 1, distributing the calls dynamically over threadCount
+// threads from pool.  Thread zero is the calling thread.  threadIndex can
+// be used to index per-thread scratch state, so it will always be less 
+// than threadCount.  Returns once all tasks are complete.
+//
+template <typename Task>
+void parallelFor(ThreadPool& pool, const size_t taskCount, 
+        const unsigned int threadCount, Task& task)
+{
+    if ((threadCount <= 1) || (taskCount <= 1))
+    {
+        for (size_t i = 0; i < taskCount; ++i)
+        {
+            task(i, 0);
+        }
+        return;
+    }
+
+    pool.parallelFor(taskCount, threadCount, 
+            ThreadPool::Task(std::ref(task)));
+}
+
+
+}
+
+#endif
@@ -0,0 +1,295 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ *
+ * Copyright (C) 2026  agent
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * Licensees holding a valid commercial license may use this file in
+ * accordance with the commercial license agreement provided with the
+ * library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):  agent
+*/
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "libavoid/routecache.h"
+#include "libavoid/connector.h"
+#include "libavoid/geometry.h"
+#include "libavoid/graph.h"
+#include "libavoid/obstacle.h"
+#include "libavoid/router.h"
+#include "libavoid/vertices.h"
+
+namespace Avoid {
+
+
+// Mixes a value into a hash, using the finaliser from SplitMix64.
+static uint64_t hashMix(uint64_t hash, const uint64_t value)
+{
+    hash += value + 0x9e3779b97f4a7c15ULL;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+    return hash ^ (hash >> 31);
+}
+
+static uint64_t hashMix(uint64_t hash, double value)
+{
+    if (value == 0)
+    {
+        // Treat -0.0 the same as 0.0.
+        value = 0;
+    }
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return hashMix(hash, bits);
+}
+
+static uint64_t hashMix(uint64_t hash, const Point& point)
+{
+    return hashMix(hashMix(hash, point.x), point.y);
+}
+
+
+static bool inBox(const Box& box, const Point& point)
+{
+    return (point.x >= box.min.x) && (point.x <= box.max.x) &&
+            (point.y >= box.min.y) && (point.y <= box.max.y);
+}
+
+
+RouteCache::RouteCache()
+    : m_valid(false),
+      m_fingerprint(0)
+{
+}
+
+
+bool RouteCache::canUse(ConnRef *lineRef)
+{
+    Router *router = lineRef->router();
+    if (!router->routingOption(performRouteCaching) ||
+            router->isInCrossingPenaltyReroutingStage() ||
+            !lineRef->canSearchPathInIsolation())
+    {
+        return false;
+    }
+    // Cluster crossing penalties depend on the clusters, which aren't
+    // part of the fingerprint.
+    return !(router->ClusteredRouting && !router->clusterRefs.empty() &&
+            (router->routingParameter(clusterCrossingPenalty) > 0));
+}
+
+
+bool RouteCache::isValid(ConnRef *lineRef) const
+{
+    return m_valid && lineRef->canKeepPreviousRoute() &&
+            (fingerprint(lineRef, m_corridor) == m_fingerprint);
+}
+
+
+void RouteCache::store(ConnRef *lineRef)
+{
+    m_corridor = corridor(lineRef);
+    m_fingerprint = fingerprint(lineRef, m_corridor);
+    m_valid = true;
+}
+
+
+void RouteCache::reuse(ConnRef *lineRef)
+{
+    Router *router = lineRef->router();
+    lineRef->m_needs_reroute_flag = false;
+    // Nudging starts again from the unimproved route.
+    lineRef->m_display_route.clear();
+
+    if ((lineRef->routingType() == ConnType_PolyLine) &&
+            router->InvisibilityGrph)
+    {
+        // Edges along the route may have been replaced by identical ones,
+        // so ask the visibility edges to flag the connector again if they
+        // are invalidated, as setGeneratedPath() does.
+        const PolyLine& route = lineRef->m_route;
+        std::vector<EdgeInf *> edges;
+        router->m_vis_edge_index.query(m_corridor, edges);
+        for (size_t i = 0; i < edges.size(); ++i)
+        {
+            std::pair<Point, Point> points = edges[i]->points();
+            for (size_t j = 1; j < route.size(); ++j)
+            {
+                if (((points.first == route.ps[j - 1]) &&
+                            (points.second == route.ps[j])) ||
+                        ((points.first == route.ps[j]) &&
+                            (points.second == route.ps[j - 1])))
+                {
+                    edges[i]->addConn(lineRef->m_reroute_flag_ptr);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+
+void RouteCache::clear(void)
+{
+    m_valid = false;
+}
+
+
+Box RouteCache::corridor(ConnRef *lineRef)
+{
+    Router *router = lineRef->router();
+    const PolyLine& route = lineRef->m_route;
+    const Point& srcPoint = lineRef->m_src_vert->point;
+    const Point& dstPoint = lineRef->m_dst_vert->point;
+
+    // Overestimate the cost the route was found with, allowing the 
+    // largest angle penalty for each bend and the reverse direction 
+    // penalty for each segment.
+    const double segmtPenalty = router->routingParameter(segmentPenalty);
+    const double anglePenaltyValue = router->routingParameter(anglePenalty);
+    const double reversePenalty = 
+            router->routingParameter(reverseDirectionPenalty);
+    double cost = 0;
+    for (size_t i = 1; i < route.size(); ++i)
+    {
+        const Point& a = route.ps[i - 1];
+        const Point& b = route.ps[i];
+        cost += euclideanDist(a, b);
+        cost += reversePenalty;
+        if (i < 2)
+        {
+            continue;
+        }
+        const Point& prev = route.ps[i - 2];
+        if (vecDir(prev, a, b) != 0)
+        {
+            cost += segmtPenalty + anglePenaltyValue;
+        }
+        else if (((a.x - prev.x) * (b.x - a.x) + 
+                    (a.y - prev.y) * (b.y - a.y)) < 0)
+        {
+            // The route doubles back.
+            cost += (2 * segmtPenalty) + anglePenaltyValue;
+        }
+    }
+
+    // Allow for rounding in the cost of the search.
+    cost += 1;
+
+    double slack;
+    if (lineRef->routingType() == ConnType_Orthogonal)
+    {
+        // Points with a Manhattan distance to both endpoints summing to
+        // at most the cost are within this distance of the endpoints'
+        // bounding box.
+        slack = (cost - manhattanDist(srcPoint, dstPoint)) / 2;
+    }
+    else
+    {
+        // The ellipse lies within its semi-minor axis of the line
+        // between its foci.
+        double semiMajor = cost / 2;
+        double focalDist = euclideanDist(srcPoint, dstPoint) / 2;
+        slack = sqrt(std::max(0.0,
+                (semiMajor * semiMajor) - (focalDist * focalDist)));
+    }
+    slack = std::max(0.0, slack);
+
+    Box box;
+    box.min.x = std::min(srcPoint.x, dstPoint.x) - slack;
+    box.min.y = std::min(srcPoint.y, dstPoint.y) - slack;
+    box.max.x = std::max(srcPoint.x, dstPoint.x) + slack;
+    box.max.y = std::max(srcPoint.y, dstPoint.y) + slack;
+    return box;
+}
+
+
+uint64_t RouteCache::fingerprint(ConnRef *lineRef, const Box& corridor)
+{
+    Router *router = lineRef->router();
+
+    uint64_t hash = hashMix(0, (uint64_t) lineRef->routingType());
+    hash = hashMix(hash, lineRef->m_src_vert->point);
+    hash = hashMix(hash, (uint64_t) lineRef->m_src_vert->visDirections);
+    hash = hashMix(hash, lineRef->m_dst_vert->point);
+    hash = hashMix(hash, (uint64_t) lineRef->m_dst_vert->visDirections);
+    const PolyLine& route = lineRef->m_route;
+    hash = hashMix(hash, (uint64_t) route.size());
+    for (size_t i = 0; i < route.size(); ++i)
+    {
+        hash = hashMix(hash, route.ps[i]);
+    }
+    for (size_t p = 0; p < lastRoutingParameterMarker; ++p)
+    {
+        hash = hashMix(hash, router->routingParameter((RoutingParameter) p));
+    }
+
+    // The obstacles and edges are reported in no particular order, so
+    // their hashes are summed.
+    std::vector<Obstacle *> obstacles;
+    router->obstaclesOverlappingBox(corridor, obstacles);
+    uint64_t obstaclesHash = 0;
+    for (size_t i = 0; i < obstacles.size(); ++i)
+    {
+        const Polygon& poly = obstacles[i]->routingPolygon();
+        uint64_t obstacleHash = hashMix(0, (uint64_t) obstacles[i]->id());
+        for (size_t j = 0; j < poly.size(); ++j)
+        {
+            obstacleHash = hashMix(obstacleHash, poly.ps[j]);
+        }
+        obstaclesHash += obstacleHash;
+    }
+    hash = hashMix(hash, (uint64_t) obstacles.size());
+    hash = hashMix(hash, obstaclesHash);
+
+    if (lineRef->routingType() == ConnType_PolyLine)
+    {
+        // Any cheaper route only visits vertices within the corridor, so
+        // include the visibility edges between such vertices.  The 
+        // orthogonal visibility graph is generated from the obstacles and 
+        // always contains an optimal route, so its edges aren't needed.
+        std::vector<EdgeInf *> edges;
+        router->m_vis_edge_index.query(corridor, edges);
+        uint64_t edgesHash = 0;
+        size_t edgesCount = 0;
+        for (size_t i = 0; i < edges.size(); ++i)
+        {
+            std::pair<Point, Point> points = edges[i]->points();
+            if (!inBox(corridor, points.first) || 
+                    !inBox(corridor, points.second))
+            {
+                continue;
+            }
+            if (points.second < points.first)
+            {
+                std::swap(points.first, points.second);
+            }
+            edgesHash += hashMix(hashMix(0, points.first), points.second);
+            ++edgesCount;
+        }
+        hash = hashMix(hash, (uint64_t) edgesCount);
+        hash = hashMix(hash, edgesHash);
+    }
+    return hash;
+}
+
+
+}
+
@@ -0,0 +1,83 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ *
+ * Copyright (C) 2026  agent
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * Licensees holding a valid commercial license may use this file in
+ * accordance with the commercial license agreement provided with the
+ * library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):  agent
+*/
+
+// The route cache lets a connector keep its route between transactions
+// when nothing that could change that route has moved.
+//
+// A route cheaper than the connector's current route can be no longer
+// than the current route's cost, so it lies within the ellipse (or for
+// orthogonal routes, the diamond) with the connector's endpoints as foci
+// and that cost as the sum of distances.  The corridor is the bounding
+// box of this region.  The cache records a fingerprint of the route, the
+// connector's endpoints, the routing parameters, the obstacles overlapping
+// the corridor and, for poly-line routes, the visibility edges within it.
+// While the fingerprint is unchanged, a new search would find a route of
+// the same cost, so the connector is not searched for again.
+
+
+#ifndef AVOID_ROUTECACHE_H
+#define AVOID_ROUTECACHE_H
+
+#include <cstdint>
+
+#include "libavoid/geomtypes.h"
+
+
+namespace Avoid {
+
+class ConnRef;
+
+class RouteCache
+{
+    public:
+        RouteCache();
+        // Returns whether the cache can be used for lineRef, which must
+        // currently need rerouting.  This is the case for connectors
+        // that AStarPath::searchIsolated() could route and whose route
+        // costs aren't affected by cluster crossing penalties.
+        static bool canUse(ConnRef *lineRef);
+        // Returns whether the route of lineRef was stored by store(), still
+        // joins its endpoints and nothing within its corridor has changed
+        // since.
+        bool isValid(ConnRef *lineRef) const;
+        // Records the fingerprint of the route just found for lineRef.
+        void store(ConnRef *lineRef);
+        // Keeps the previous route of lineRef, for which isValid() holds,
+        // as if it had just been found again.
+        void reuse(ConnRef *lineRef);
+        void clear(void);
+    private:
+        static Box corridor(ConnRef *lineRef);
+        static uint64_t fingerprint(ConnRef *lineRef, const Box& corridor);
+
+        bool m_valid;
+        Box m_corridor;
+        uint64_t m_fingerprint;
+};
+
+
+}
+
+#endif
+
@@ -26,6 +26,7 @@
 #include <algorithm>
 #include <cmath>
 #include <cfloat>
+#include <iterator>
 
 #include "libavoid/shape.h"
 #include "libavoid/router.h"
@@ -38,13 +39,23 @@
 #include "libavoid/orthogonal.h"
 #include "libavoid/assertions.h"
 #include "libavoid/connectionpin.h"
+#include "libavoid/makepath.h"
+#include "libavoid/parallel.h"
+#include "libavoid/routecache.h"
+#include "libavoid/snapshot.h"
+#include "libavoid/tiledrouting.h"
 
 
 namespace Avoid {
 
 
 Router::Router(const unsigned int flags)
-    : visOrthogGraph(),
+    : m_vertex_pool(sizeof(VertInf), 1024),
+      m_orthogonal_vertex_pool(sizeof(VertInf), 1024),
+      m_edge_pool(sizeof(EdgeInf), 1024),
+      m_orthogonal_edge_pool(sizeof(EdgeInf), 1024),
+      m_search_node_pool(AStarPath::nodeBlockSize(), 1, true),
+      visOrthogGraph(),
       PartialTime(false),
       SimpleRouting(false),
       ClusteredRouting(true),
@@ -59,8 +70,19 @@ Router::Router(const unsigned int flags)
       // Instrumentation:
       st_checked_edges(0),
       m_largest_assigned_id(0),
+      m_vertices_created(0),
       m_consolidate_actions(true),
       m_currently_calling_destructors(false),
+      m_bulk_loading(false),
+      m_routing_thread_count(0),
+      m_thread_pool(new ThreadPool()),
+      m_obstacle_index_buffer(0.0),
+      m_abort_transaction(false),
+      m_transaction_time_limit(0),
+      m_completed_transaction_phases(0),
+      m_route_cache_hits(0),
+      m_route_cache_misses(0),
+      m_route_snapshot(new RouteSnapshot()),
       m_topology_addon(new TopologyAddonInterface()),
       // Mode options:
       m_allows_polyline_routing(false),
@@ -89,6 +111,7 @@ Router::Router(const unsigned int flags)
     m_routing_parameters[segmentPenalty] = 10;
     m_routing_parameters[clusterCrossingPenalty] = 4000;
     m_routing_parameters[idealNudgingDistance] = 4.0;
+    m_routing_parameters[routingTileSize] = 1000;
 
     m_routing_options[nudgeOrthogonalSegmentsConnectedToShapes] = false;
     m_routing_options[improveHyperedgeRoutesMovingJunctions] = true;
@@ -98,6 +121,17 @@ Router::Router(const unsigned int flags)
     m_routing_options[improveHyperedgeRoutesMovingAddingAndDeletingJunctions] =
             false;
     m_routing_options[nudgeSharedPathsWithCommonEndPoint] = true;
+    m_routing_options[performParallelRouteSearch] = false;
+    m_routing_options[performIncrementalOrthogonalVisGraphUpdate] = false;
+    m_routing_options[performRouteSearchOnCompactVisGraph] = false;
+    m_routing_options[performParallelOrthogonalNudging] = false;
+    m_routing_options[performIncrementalNudgingSolve] = false;
+    m_routing_options[performParallelPolylineVisibility] = false;
+    m_routing_options[performIncrementalPolylineRouteSearch] = false;
+    m_routing_options[performParallelHyperedgeRerouting] = false;
+    m_routing_options[performRouteCaching] = false;
+    m_routing_options[performTiledOrthogonalRouting] = false;
+    m_routing_options[publishRouteSnapshots] = false;
 
     m_hyperedge_improver.setRouter(this);
     m_hyperedge_rerouter.setRouter(this);
@@ -138,11 +172,15 @@ Router::~Router()
     // Cleanup orphaned orthogonal graph vertices.
     destroyOrthogonalVisGraph();
 
+    // Free any remaining invisibility edges while the edge indexes exist.
+    invisGraph.clear();
+
     COLA_ASSERT(m_obstacles.size() == 0);
     COLA_ASSERT(connRefs.size() == 0);
     COLA_ASSERT(visGraph.size() == 0);
 
     delete m_topology_addon;
+    delete m_thread_pool;
 }
 
 void Router::setDebugHandler(DebugHandler *handler)
@@ -178,8 +216,20 @@ void Router::modifyConnector(ConnRef *conn, const unsigned int type,
 {
     ActionInfo modInfo(ConnChange, conn);
     
-    ActionInfoList::iterator found = 
-            find(actionList.begin(), actionList.end(), modInfo);
+    ActionInfoList::iterator found = actionList.end();
+    if (m_bulk_loading)
+    {
+        // The connector is new, so the only matching action could be the
+        // one just queued for its other endpoint.
+        if (!actionList.empty() && (actionList.back() == modInfo))
+        {
+            found = std::prev(actionList.end());
+        }
+    }
+    else
+    {
+        found = find(actionList.begin(), actionList.end(), modInfo);
+    }
     if (found == actionList.end())
     {
         // Matching action not found, so add.
@@ -254,6 +304,13 @@ void Router::removeObjectFromQueuedActions(const void *object)
 
 void Router::addShape(ShapeRef *shape)
 {
+    if (m_bulk_loading)
+    {
+        // The shape is new, so there can't be any other actions for it.
+        actionList.push_back(ActionInfo(ShapeAdd, shape));
+        return;
+    }
+
     // There shouldn't be remove events or move events for the same shape
     // already in the action list.
     // XXX: Possibly we could handle this by ordering them intelligently.
@@ -278,6 +335,58 @@ void Router::addShape(ShapeRef *shape)
 }
 
 
+std::vector<ShapeRef *> Router::addShapes(
+        const std::vector<Polygon>& polygons)
+{
+    std::vector<ShapeRef *> shapes;
+    shapes.reserve(polygons.size());
+
+    // Queue the shapes together, processing them afterwards if not using
+    // transactions.
+    bool consolidateActions = m_consolidate_actions;
+    m_consolidate_actions = true;
+    m_bulk_loading = true;
+    for (size_t i = 0; i < polygons.size(); ++i)
+    {
+        Polygon poly(polygons[i]);
+        shapes.push_back(new ShapeRef(this, poly));
+    }
+    m_bulk_loading = false;
+    m_consolidate_actions = consolidateActions;
+
+    if (!m_consolidate_actions)
+    {
+        processTransaction();
+    }
+    return shapes;
+}
+
+
+std::vector<ConnRef *> Router::addConnectors(
+        const std::vector<std::pair<ConnEnd, ConnEnd> >& endpoints)
+{
+    std::vector<ConnRef *> conns;
+    conns.reserve(endpoints.size());
+
+    bool consolidateActions = m_consolidate_actions;
+    m_consolidate_actions = true;
+    m_bulk_loading = true;
+    for (size_t i = 0; i < endpoints.size(); ++i)
+    {
+        conns.push_back(new ConnRef(this, endpoints[i].first, 
+                endpoints[i].second));
+    }
+    m_bulk_loading = false;
+    m_consolidate_actions = consolidateActions;
+
+    if (!m_consolidate_actions)
+    {
+        processTransaction();
+    }
+    return conns;
+}
+
+
 void Router::deleteShape(ShapeRef *shape)
 {
     // There shouldn't be add events events for the same shape already 
@@ -408,22 +517,38 @@ void Router::setStaticGraphInvalidated(const bool invalidated)
 
 void Router::destroyOrthogonalVisGraph(void)
 {
-    // Remove orthogonal visibility graph edges.
-    visOrthogGraph.clear();
-
-    // Remove the now orphaned vertices.
+    // Remove orthogonal visibility graph edges.  This is done in bulk, 
+    // since the whole graph is being discarded.
+    visOrthogGraph.clearOrthogonal();
+    m_orthogonal_graph_snapshot.clear();
+
+    // Remove the now orphaned dummy vertices, then free them all at once
+    // by resetting their pool.
+    size_t pooledVertices = 0;
     VertInf *curr = vertices.shapesBegin();
     while (curr)
     {
         if (curr->orphaned() && (curr->id == dummyOrthogID))
         {
             VertInf *following = vertices.removeVertex(curr);
-            delete curr;
+            if (MemoryPool::owner(curr) == &m_orthogonal_vertex_pool)
+            {
+                curr->~VertInf();
+                ++pooledVertices;
+            }
+            else
+            {
+                delete curr;
+            }
             curr = following;
             continue;
         }
         curr = curr->lstNext;
     }
+    COLA_ASSERT(m_orthogonal_vertex_pool.statistics().liveObjects == 
+            pooledVertices);
+    COLA_UNUSED(pooledVertices);
+    m_orthogonal_vertex_pool.reset();
 }
 
 
@@ -435,19 +560,46 @@ void Router::regenerateStaticBuiltGraph(void)
     {
         if (m_allows_orthogonal_routing)
         {
-            destroyOrthogonalVisGraph();
+            bool incremental = 
+                    routingOption(performIncrementalOrthogonalVisGraphUpdate);
 
             TIMER_START(this, tmOrthogGraph);
-            // Regenerate a new visibility graph.
-            generateStaticOrthogonalVisGraph(this);
-            
+            if (!incremental || !updateStaticOrthogonalVisGraph(this,
+                        m_orthogonal_graph_snapshot))
+            {
+                destroyOrthogonalVisGraph();
+
+                // Regenerate a new visibility graph, recording its lines
+                // for the next update.
+                generateStaticOrthogonalVisGraph(this, 
+                        (incremental) ? &m_orthogonal_graph_snapshot : nullptr);
+            }
             TIMER_STOP(this);
+
+            if (incremental)
+            {
+                // Record the state the graph reflects for the next update.
+                m_orthogonal_graph_snapshot.record(this);
+            }
         }
         m_static_orthogonal_graph_invalidated = false;
     }
 }
 
 
+// Updates the visibility graphs that connectors are routed over, if
+// necessary.
+void Router::prepareRouteSearchGraphs(void)
+{
+    regenerateStaticBuiltGraph();
+
+    if (routingOption(performRouteSearchOnCompactVisGraph))
+    {
+        compactVisGraph.record(this);
+    }
+}
+
+
 bool Router::transactionUse(void) const
 {
     return m_consolidate_actions;
@@ -466,8 +618,9 @@ void Router::processActions(void)
     bool notPartialTime = !(PartialFeedback && PartialTime);
     bool seenShapeMovesOrDeletes = false;
 
-    m_transaction_start_time = clock();
+    m_transaction_start_time = std::chrono::steady_clock::now();
     m_abort_transaction = false;
+    m_completed_transaction_phases = 0;
 
     std::list<unsigned int> deletedObstacles;
     actionList.sort();
@@ -560,6 +713,16 @@ void Router::processActions(void)
         }
     }
 
+    // When computing polyline visibility in parallel, the obstacles to 
+    // sweep are collected here and swept together once all are in place.
+    // This is slower than sweeping each obstacle in turn on one thread.
+    bool parallelVisibility = m_allows_polyline_routing && 
+            UseLeesAlgorithm && 
+            routingOption(performParallelPolylineVisibility) &&
+            (effectiveThreadCount(m_routing_thread_count, 
+                    actionList.size()) > 1);
+    std::vector<Obstacle *> sweepObstacles;
+
     for (curr = actionList.begin(); curr != finish; ++curr)
     {
         ActionInfo& actInf = *curr;
@@ -606,6 +769,12 @@ void Router::processActions(void)
                 newBlockingShape(shapePoly, pid);
             }
 
+            if (parallelVisibility)
+            {
+                sweepObstacles.push_back(obstacle);
+                continue;
+            }
+
             // o  Calculate visibility for the new vertices.
             if (UseLeesAlgorithm)
             {
@@ -619,6 +788,13 @@ void Router::processActions(void)
         }
     }
 
+    if (!sweepObstacles.empty())
+    {
+        // o  Calculate visibility for the new vertices.
+        Obstacle::computeVisibilitySweeps(sweepObstacles, 
+                m_routing_thread_count);
+    }
+
     // Update connector endpoints.
     for (curr = actionList.begin(); curr != finish; ++curr)
     {
@@ -647,11 +823,22 @@ bool Router::processTransaction(void)
     }
     m_settings_changes = false;
 
+    profiler.beginTransaction();
+
+    TIMER_START(this, tmProcessActions);
     processActions();
+    TIMER_STOP(this);
 
     m_static_orthogonal_graph_invalidated = true;
     rerouteAndCallbackConnectors();
 
+    if (routingOption(publishRouteSnapshots))
+    {
+        publishRouteSnapshot();
+    }
+
+    profiler.endTransaction(this);
+
     return true;
 }
 
@@ -928,8 +1115,19 @@ void Router::rerouteAndCallbackConnectors(void)
     
     this->m_conn_reroute_flags.alertConns();
 
-    // Updating the orthogonal visibility graph if necessary. 
-    regenerateStaticBuiltGraph();
+    // Updating the orthogonal visibility graph if necessary.  This is 
+    // always performed in full.  With tiled routing, this is postponed 
+    // until it is known whether any connectors need the graph.
+    bool tiledRouting = routingOption(performTiledOrthogonalRouting) &&
+            (m_hyperedge_rerouter.count() == 0);
+    if (!tiledRouting)
+    {
+        prepareRouteSearchGraphs();
+    }
+    markTransactionPhaseCompleted(
+            TransactionPhaseOrthogonalVisibilityGraphScanX);
+    markTransactionPhaseCompleted(
+            TransactionPhaseOrthogonalVisibilityGraphScanY);
 
     for (ConnRefList::const_iterator i = connRefs.begin(); i != fin; ++i) 
     {
@@ -946,8 +1144,76 @@ void Router::rerouteAndCallbackConnectors(void)
     //       smallest to largest estimated cost.  This way we likely get 
     //       better exclusive pin assignment during initial routing.
 
+    // If enabled, find the connectors whose previous routes can be kept
+    // because nothing has changed within their corridors.
+    ConnRefSet cachedConns;
+    if (routingOption(performRouteCaching))
+    {
+        for (ConnRefList::const_iterator i = connRefs.begin(); i != fin; ++i) 
+        {
+            ConnRef *connector = *i;
+            if ((hyperedgeConns.find(connector) == hyperedgeConns.end()) &&
+                    !connector->hasFixedRoute() &&
+                    connector->m_route_cache &&
+                    RouteCache::canUse(connector) &&
+                    connector->m_route_cache->isValid(connector))
+            {
+                cachedConns.insert(connector);
+            }
+        }
+    }
+
+    ConnRefSet excludedConns = hyperedgeConns;
+    excludedConns.insert(cachedConns.begin(), cachedConns.end());
+
+    // If enabled, route the connectors lying within tiles of the diagram,
+    // and then generate the visibility graphs if other connectors need 
+    // them.
+    ConnRefRouteMap tiledRoutes;
+    if (tiledRouting)
+    {
+        TIMER_START(this, tmOrthogRoute);
+        TiledOrthogonalRouting(this).execute(excludedConns, tiledRoutes);
+        TIMER_STOP(this);
+
+        bool needsGraphs = (routingParameter(crossingPenalty) > 0) ||
+                (routingParameter(fixedSharedPathPenalty) > 0);
+        for (ConnRefList::const_iterator i = connRefs.begin(); 
+                !needsGraphs && (i != fin); ++i) 
+        {
+            ConnRef *connector = *i;
+            needsGraphs = (excludedConns.find(connector) == 
+                        excludedConns.end()) &&
+                    (tiledRoutes.find(connector) == tiledRoutes.end()) &&
+                    !connector->hasFixedRoute() &&
+                    (connector->m_false_path || 
+                     connector->m_needs_reroute_flag);
+        }
+        if (needsGraphs)
+        {
+            prepareRouteSearchGraphs();
+        }
+        for (ConnRefRouteMap::const_iterator i = tiledRoutes.begin();
+                i != tiledRoutes.end(); ++i)
+        {
+            excludedConns.insert(i->first);
+        }
+    }
+
+    // If enabled, perform route searches that don't modify the visibility
+    // graph concurrently up front.  The resulting paths are then applied 
+    // below, in the same order as connectors are normally routed.
+    std::map<ConnRef *, std::vector<VertInf *> > searchedPaths;
+    if (routingOption(performParallelRouteSearch))
+    {
+        TIMER_START(this, tmOrthogRoute);
+        searchPathsInIsolation(excludedConns, searchedPaths);
+        TIMER_STOP(this);
+    }
+
     size_t totalConns = connRefs.size();
     size_t numOfReroutedConns = 0;
+    bool keptPreviousRoutes = false;
     for (ConnRefList::const_iterator i = connRefs.begin(); i != fin; ++i) 
     {
         // Progress reporting and continuation check.
@@ -968,14 +1234,76 @@ void Router::rerouteAndCallbackConnectors(void)
             continue;
         }
 
+        if (m_abort_transaction && connector->canKeepPreviousRoute())
+        {
+            // We have run out of time, so keep the previous route.  The
+            // connector stays marked as needing rerouting.
+            keptPreviousRoutes = true;
+            continue;
+        }
+
+        if (cachedConns.find(connector) != cachedConns.end())
+        {
+            // Nothing in the connector's corridor has changed, so keep 
+            // its previous route.
+            connector->m_needs_repaint = false;
+            connector->m_route_cache->reuse(connector);
+            reroutedConns.push_back(connector);
+            ++m_route_cache_hits;
+            continue;
+        }
+
+        bool cacheable = RouteCache::canUse(connector);
         TIMER_START(this, tmOrthogRoute);
         connector->m_needs_repaint = false;
-        bool rerouted = connector->generatePath();
+        bool rerouted = false;
+        ConnRefRouteMap::const_iterator tiled = tiledRoutes.find(connector);
+        std::map<ConnRef *, std::vector<VertInf *> >::const_iterator 
+                searched = searchedPaths.find(connector);
+        if (tiled != tiledRoutes.end())
+        {
+            rerouted = connector->generatePathFromTile(tiled->second);
+        }
+        else if (searched != searchedPaths.end())
+        {
+            rerouted = connector->generatePathFromIsolatedSearch(
+                    searched->second);
+        }
+        else if (connector->canSearchPathInIsolation() &&
+                IncrementalPathSearch::canSearch(connector))
+        {
+            rerouted = connector->generatePathIncrementally();
+        }
+        else
+        {
+            rerouted = connector->generatePath();
+        }
         if (rerouted)
         {
             reroutedConns.push_back(connector);
         }
         TIMER_STOP(this);
+
+        if (cacheable)
+        {
+            if (connector->m_route_cache == nullptr)
+            {
+                connector->m_route_cache = new RouteCache();
+            }
+            if (rerouted && !connector->m_needs_reroute_flag)
+            {
+                connector->m_route_cache->store(connector);
+            }
+            else
+            {
+                connector->m_route_cache->clear();
+            }
+            ++m_route_cache_misses;
+        }
+    }
+    if (!keptPreviousRoutes)
+    {
+        markTransactionPhaseCompleted(TransactionPhaseRouteSearch);
     }
 
 
@@ -983,7 +1311,9 @@ void Router::rerouteAndCallbackConnectors(void)
     m_hyperedge_rerouter.performRerouting();
 
     // Find and reroute crossing connectors if crossing penalties are set.
+    TIMER_START(this, tmCrossings);
     improveCrossings();
+    TIMER_STOP(this);
 
     bool withMinorImprovements = routingOption(
             improveHyperedgeRoutesMovingJunctions);
@@ -992,7 +1322,10 @@ void Router::rerouteAndCallbackConnectors(void)
     if (withMinorImprovements || withMajorImprovements)
     {
         m_hyperedge_improver.clear();
-        m_hyperedge_improver.execute(withMajorImprovements);
+        if (!m_abort_transaction)
+        {
+            m_hyperedge_improver.execute(withMajorImprovements);
+        }
     }
 
     // Perform centring and nudging for orthogonal routes.
@@ -1030,8 +1363,246 @@ void Router::rerouteAndCallbackConnectors(void)
 
     // Progress reporting.
     performContinuationCheck(TransactionPhaseCompleted, 1, 1);
+    if (m_completed_transaction_phases == 
+            ((1u << TransactionPhaseCompleted) - 2))
+    {
+        // All the phases, from 1 onwards, were completed.
+        markTransactionPhaseCompleted(TransactionPhaseCompleted);
+    }
+}
+
+// Performs the route search for each connector needing rerouting which
+// can be searched for in isolation, dividing these over multiple threads.
+// The resulting paths are returned in searchedPaths.  If the transaction
+// is aborted, only the paths searched for so far are returned.
+//
+void Router::searchPathsInIsolation(const ConnRefSet& excludedConns,
+        std::map<ConnRef *, std::vector<VertInf *> >& searchedPaths)
+{
+    std::vector<ConnRef *> conns;
+    ConnRefList::const_iterator fin = connRefs.end();
+    for (ConnRefList::const_iterator i = connRefs.begin(); i != fin; ++i) 
+    {
+        ConnRef *connector = *i;
+        if ((excludedConns.find(connector) == excludedConns.end()) &&
+                !connector->hasFixedRoute() &&
+                connector->canSearchPathInIsolation() &&
+                !IncrementalPathSearch::canSearch(connector))
+        {
+            // Connectors searched for incrementally are left to be routed
+            // in order below, since their searches are usually quick.
+            conns.push_back(connector);
+        }
+    }
+    if (conns.empty())
+    {
+        return;
+    }
+
+    // Each thread has its own AStarPath, which holds the scratch state
+    // for its searches.
+    unsigned int threads = effectiveThreadCount(m_routing_thread_count,
+            conns.size());
+    std::vector<AStarPath> searches(threads);
+    std::vector<std::vector<VertInf *> > paths(conns.size());
+
+    struct SearchTask
+    {
+        std::vector<ConnRef *>& conns;
+        std::vector<AStarPath>& searches;
+        std::vector<std::vector<VertInf *> >& paths;
+        size_t batchStart;
+
+        void operator()(const size_t index, const unsigned int thread)
+        {
+            ConnRef *conn = conns[batchStart + index];
+            searches[thread].searchIsolated(conn, conn->src(), conn->dst(),
+                    paths[batchStart + index]);
+        }
+    };
+    // The searches are performed in batches, with a continuation check 
+    // after each, so that the transaction can be cut short during them.
+    // The connectors not searched for before an abort are left to be 
+    // handled in order, like any others.
+    const size_t batchSize = 4 * threads;
+    size_t searched = 0;
+    while ((searched < conns.size()) && !m_abort_transaction)
+    {
+        size_t batchEnd = std::min(searched + batchSize, conns.size());
+        SearchTask task = { conns, searches, paths, searched };
+        parallelFor(threadPool(), batchEnd - searched, threads, task);
+        searched = batchEnd;
+
+        performContinuationCheck(TransactionPhaseRouteSearch, searched, 
+                conns.size());
+    }
+
+    for (size_t i = 0; i < searched; ++i)
+    {
+        searchedPaths[conns[i]].swap(paths[i]);
+    }
+}
+
+
+void Router::setRoutingThreadCount(const unsigned int threads)
+{
+    m_routing_thread_count = threads;
+}
+
+
+unsigned int Router::routingThreadCount(void) const
+{
+    return m_routing_thread_count;
+}
+
+
+ThreadPool& Router::threadPool(void)
+{
+    return *m_thread_pool;
+}
+
+
+void Router::setProfilingEnabled(const bool enabled)
+{
+    profiler.setEnabled(enabled);
+}
+
+
+bool Router::profilingEnabled(void) const
+{
+    return profiler.enabled();
+}
+
+
+const RouterProfile& Router::lastTransactionProfile(void) const
+{
+    return profiler.profile();
+}
+
+
+bool Router::outputProfileAsChromeTrace(const std::string& filename) const
+{
+    return profiler.outputChromeTrace(filename);
+}
+
+
+void Router::setTransactionTimeLimit(const unsigned int msec)
+{
+    m_transaction_time_limit = msec;
+}
+
+
+unsigned int Router::transactionTimeLimit(void) const
+{
+    return m_transaction_time_limit;
+}
+
+
+bool Router::transactionPhaseCompleted(const TransactionPhases phase) const
+{
+    return m_completed_transaction_phases & (1u << phase);
+}
+
+
+bool Router::isTransactionAborted(void) const
+{
+    return m_abort_transaction;
+}
+
+
+void Router::markTransactionPhaseCompleted(unsigned int phaseNumber)
+{
+    m_completed_transaction_phases |= (1u << phaseNumber);
 }
 
+
+RouterAllocatorStatistics Router::allocatorStatistics(void) const
+{
+    RouterAllocatorStatistics stats;
+    stats.vertices = m_vertex_pool.statistics();
+    stats.orthogonalVertices = m_orthogonal_vertex_pool.statistics();
+    stats.edges = m_edge_pool.statistics();
+    stats.orthogonalEdges = m_orthogonal_edge_pool.statistics();
+    stats.searchNodeBlocks = m_search_node_pool.statistics();
+    return stats;
+}
+
+
+RouteSnapshotPtr Router::routeSnapshot(void) const
+{
+    return std::atomic_load(&m_route_snapshot);
+}
+
+
+// Publishes a new RouteSnapshot of the connectors' display routes.  The 
+// previous snapshot may still be in use by readers, so it is left as it 
+// is, but routes that haven't changed are shared with it.
+void Router::publishRouteSnapshot(void)
+{
+    RouteSnapshotPtr previous = std::atomic_load(&m_route_snapshot);
+    std::shared_ptr<RouteSnapshot> snapshot(new RouteSnapshot());
+    snapshot->m_version = previous->m_version + 1;
+
+    for (ConnRefList::const_iterator i = connRefs.begin(); 
+            i != connRefs.end(); ++i)
+    {
+        ConnRef *conn = *i;
+        const PolyLine& route = conn->displayRoute();
+        RouteSnapshot::RouteMap::const_iterator found = 
+                previous->m_routes.find(conn->id());
+        if ((found != previous->m_routes.end()) && 
+                (found->second->ps == route.ps))
+        {
+            snapshot->m_routes[conn->id()] = found->second;
+        }
+        else
+        {
+            snapshot->m_routes[conn->id()] = 
+                    std::make_shared<const PolyLine>(route);
+        }
+    }
+
+    std::atomic_store(&m_route_snapshot, RouteSnapshotPtr(snapshot));
+}
+
+
+size_t Router::routeCacheHitCount(void) const
+{
+    return m_route_cache_hits;
+}
+
+
+size_t Router::routeCacheMissCount(void) const
+{
+    return m_route_cache_misses;
+}
+
+
+RouteSnapshot::RouteSnapshot()
+    : m_version(0)
+{
+}
+
+
+unsigned long long RouteSnapshot::version(void) const
+{
+    return m_version;
+}
+
+
+const PolyLine *RouteSnapshot::route(const unsigned int connId) const
+{
+    RouteMap::const_iterator found = m_routes.find(connId);
+    return (found != m_routes.end()) ? found->second.get() : nullptr;
+}
+
+
+const RouteSnapshot::RouteMap& RouteSnapshot::routes(void) const
+{
+    return m_routes;
+}
+
+
 // Type holding a cost estimate and ConnRef.
 typedef std::pair<double, ConnRef *> ConnCostRef;
 
@@ -1358,8 +1929,15 @@ void Router::performContinuationCheck(unsigned int phaseNumber,
 {
     // Compute the elapsed time in msec since the beginning of the transaction.
     unsigned int elapsedMsec = (unsigned int) 
-            ((clock() - m_transaction_start_time) / 
-             (CLOCKS_PER_SEC / (double) 1000));
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - 
+                m_transaction_start_time).count();
+
+    if (m_transaction_time_limit && (elapsedMsec >= m_transaction_time_limit))
+    {
+        // Out of time, so cut short the rest of the transaction.
+        m_abort_transaction = true;
+    }
 
     bool shouldContinue = shouldContinueTransactionWithProgress(elapsedMsec, 
             phaseNumber, TransactionPhaseCompleted, 
@@ -1401,8 +1979,102 @@ class CmpOrderedConnCostRef
         {
             return (u.first < v.first);
         }
-};
-typedef std::list<ConnCostRef> ConnCostRefList;
+};
+typedef std::list<ConnCostRef> ConnCostRefList;
+
+
+// The bounding box of a segment of a connector route, used for finding 
+// pairs of connectors whose routes may cross or share paths.
+struct RouteSegmentBox
+{
+    size_t conn;
+    Box box;
+};
+
+static bool routeSegmentBoxMinXLessThan(const RouteSegmentBox& lhs, 
+        const RouteSegmentBox& rhs)
+{
+    return lhs.box.min.x < rhs.box.min.x;
+}
+
+
+// Determines the pairs of connector routes that have segments whose 
+// bounding boxes overlap or touch, since only these may cross or share 
+// part of their paths.  This is done with a sweep over the segments in 
+// the x-dimension, maintaining the set of segments that span the current
+// x position.  For each route index i, partners[i] is set to the sorted 
+// indices j > i of the routes it may interact with.
+//
+static void findPossiblyCrossingRoutes(
+        const std::vector<const Polygon *>& routes, 
+        std::vector<std::vector<size_t> >& partners)
+{
+    // The crossing tests allow for some very small numerical error, so 
+    // boxes are expanded slightly to ensure nothing is missed.
+    const double slack = 1e-6;
+
+    std::vector<RouteSegmentBox> segments;
+    for (size_t c = 0; c < routes.size(); ++c)
+    {
+        const Polygon& route = *routes[c];
+        for (size_t i = 0; i < route.size(); ++i)
+        {
+            if ((i == 0) && (route.size() > 1))
+            {
+                continue;
+            }
+            // A route with a single point is treated as a zero-length 
+            // segment.
+            const Point& a = route.ps[(i > 0) ? (i - 1) : i];
+            const Point& b = route.ps[i];
+            RouteSegmentBox segment;
+            segment.conn = c;
+            segment.box.min.x = std::min(a.x, b.x) - slack;
+            segment.box.min.y = std::min(a.y, b.y) - slack;
+            segment.box.max.x = std::max(a.x, b.x) + slack;
+            segment.box.max.y = std::max(a.y, b.y) + slack;
+            segments.push_back(segment);
+        }
+    }
+    std::sort(segments.begin(), segments.end(), 
+            routeSegmentBoxMinXLessThan);
+
+    partners.assign(routes.size(), std::vector<size_t>());
+    std::vector<const RouteSegmentBox *> active;
+    for (size_t s = 0; s < segments.size(); ++s)
+    {
+        const RouteSegmentBox& segment = segments[s];
+        size_t kept = 0;
+        for (size_t a = 0; a < active.size(); ++a)
+        {
+            const RouteSegmentBox *other = active[a];
+            if (other->box.max.x < segment.box.min.x)
+            {
+                // This segment has been passed by the sweep.
+                continue;
+            }
+            active[kept++] = other;
+
+            if ((other->conn != segment.conn) && 
+                    (other->box.min.y <= segment.box.max.y) &&
+                    (segment.box.min.y <= other->box.max.y))
+            {
+                size_t first = std::min(other->conn, segment.conn);
+                size_t second = std::max(other->conn, segment.conn);
+                partners[first].push_back(second);
+            }
+        }
+        active.resize(kept);
+        active.push_back(&segment);
+    }
+
+    for (size_t c = 0; c < partners.size(); ++c)
+    {
+        std::vector<size_t>& list = partners[c];
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+}
 
 
 void Router::improveCrossings(void)
@@ -1412,6 +2084,8 @@ void Router::improveCrossings(void)
     if ((crossing_penalty == 0) && (shared_path_penalty == 0))
     {
         // No penalties, return.
+        markTransactionPhaseCompleted(TransactionPhaseCrossingDetection);
+        markTransactionPhaseCompleted(TransactionPhaseRerouteSearch);
         return;
     }
 
@@ -1421,11 +2095,24 @@ void Router::improveCrossings(void)
     size_t numOfConns = connRefs.size();
     size_t numOfConnsChecked = 0;
 
+    // Only pairs of connectors whose routes come near each other need to
+    // be checked for crossings.  These are considered in the same order 
+    // as connRefs.
+    std::vector<ConnRef *> conns(connRefs.begin(), connRefs.end());
+    std::vector<const Polygon *> routes(conns.size());
+    for (size_t i = 0; i < conns.size(); ++i)
+    {
+        routes[i] = &(conns[i]->routeRef());
+    }
+    std::vector<std::vector<size_t> > partners;
+    findPossiblyCrossingRoutes(routes, partners);
+
     // Find crossings and reroute connectors.
     m_in_crossing_rerouting_stage = true;
-    ConnRefList::iterator fin = connRefs.end();
-    for (ConnRefList::iterator i = connRefs.begin(); i != fin; ++i) 
+    for (size_t iIndex = 0; iIndex < conns.size(); ++iIndex) 
     {
+        ConnRef *iConn = conns[iIndex];
+
         // Progress reporting and continuation check.
         ++numOfConnsChecked;
         performContinuationCheck(TransactionPhaseCrossingDetection,
@@ -1436,25 +2123,26 @@ void Router::improveCrossings(void)
             return;
         }
     
-        Avoid::Polygon& iRoute = (*i)->routeRef();
+        Avoid::Polygon& iRoute = iConn->routeRef();
         if (iRoute.size() == 0)
         {
             // Rerouted hyperedges will have an empty route.
             // We can't reroute these.
             continue;
         }
-        ConnRefList::iterator j = i;
-        for (++j; j != fin; ++j) 
+        const std::vector<size_t>& iPartners = partners[iIndex];
+        for (size_t p = 0; p < iPartners.size(); ++p) 
         {
-            if (crossingConnInfo.connsKnownToCross(*i, *j))
+            ConnRef *jConn = conns[iPartners[p]];
+            if (crossingConnInfo.connsKnownToCross(iConn, jConn))
             {
                 // We already know both these have crossings.
                 continue;
             }
 
             // Determine if this pair cross.
-            Avoid::Polygon& jRoute = (*j)->routeRef();
-            ConnectorCrossings cross(iRoute, true, jRoute, *i, *j);
+            Avoid::Polygon& jRoute = jConn->routeRef();
+            ConnectorCrossings cross(iRoute, true, jRoute, iConn, jConn);
             for (size_t jInd = 1; jInd < jRoute.size(); ++jInd)
             {
                 const bool finalSegment = ((jInd + 1) == jRoute.size());
@@ -1468,19 +2156,21 @@ void Router::improveCrossings(void)
                 {
                     // We are penalising fixedSharedPaths and there is a
                     // fixedSharedPath.
-                    crossingConnInfo.addCrossing(*i, *j);
+                    crossingConnInfo.addCrossing(iConn, jConn);
                     break;
                 }
                 else if ((crossing_penalty > 0) && (cross.crossingCount > 0))
                 {
                     // We are penalising crossings and this is a crossing.
-                    crossingConnInfo.addCrossing(*i, *j);
+                    crossingConnInfo.addCrossing(iConn, jConn);
                     break;
                 }
             }
         }
     }
 
+    markTransactionPhaseCompleted(TransactionPhaseCrossingDetection);
+
     // Find the list of connector sets that need to be removed to avoid any
     // crossings in all crossing groups.  This is our candidate set for 
     // rerouting.  Where these connectors connect to exlusive pins, all 
@@ -1499,6 +2189,13 @@ void Router::improveCrossings(void)
     for (ConnCostRefSetList::iterator setIt = crossingConnsGroups.begin();
          setIt != crossingConnsGroups.end(); ++setIt)
     {
+        if (m_abort_transaction)
+        {
+            // Leave the remaining groups with their current routes.
+            m_in_crossing_rerouting_stage = false;
+            return;
+        }
+
         // Sort the connectors we will be rerouting from lowest to
         // highest cost.
         ConnCostRefList orderedConnList(setIt->begin(), setIt->end());
@@ -1528,13 +2225,10 @@ void Router::improveCrossings(void)
                 else if (pass == 1)
                 {
                     // Progress reporting and continuation check.
+                    // The routes of this group have been freed, so it is
+                    // finished even if the transaction is being aborted.
                     performContinuationCheck(TransactionPhaseRerouteSearch, 
                             numOfConnsRerouted, numOfConnsToReroute);
-                    if (m_abort_transaction)
-                    {
-                        m_in_crossing_rerouting_stage = false;
-                        return;
-                    }
                     ++numOfConnsRerouted;
                     
                     // Recompute this path.
@@ -1544,18 +2238,25 @@ void Router::improveCrossings(void)
         }
     }
     m_in_crossing_rerouting_stage = false;
+    markTransactionPhaseCompleted(TransactionPhaseRerouteSearch);
 }
 
 
 void Router::newBlockingShape(const Polygon& poly, int pid)
 {
-    // o  Check all visibility edges to see if this one shape
-    //    blocks them.
-    EdgeInf *finish = visGraph.end();
-    for (EdgeInf *iter = visGraph.begin(); iter != finish ; )
+    COLA_ASSERT(m_vis_edge_index.size() == (size_t) visGraph.size());
+
+    // o  Check all visibility edges near this shape to see if it
+    //    blocks them.  Only edges with a bounding box overlapping the
+    //    shape can intersect it.  These are processed in the order they
+    //    appear in visGraph.
+    std::vector<EdgeInf *> nearbyEdges;
+    m_vis_edge_index.query(poly.offsetBoundingBox(0), nearbyEdges);
+    std::sort(nearbyEdges.begin(), nearbyEdges.end(), CmpEdgeInfListOrder());
+
+    for (size_t e = 0; e < nearbyEdges.size(); ++e)
     {
-        EdgeInf *tmp = iter;
-        iter = iter->lstNext;
+        EdgeInf *tmp = nearbyEdges[e];
 
         if (tmp->getDist() != 0)
         {
@@ -1616,10 +2317,28 @@ void Router::checkAllBlockedEdges(int pid)
 {
     COLA_ASSERT(InvisibilityGrph);
 
-    for (EdgeInf *iter = invisGraph.begin(); iter != invisGraph.end() ; )
+    // Only edges blocked by this obstacle or by a cycle need to be checked.
+    // Gather these up front, in the order they appear in invisGraph,
+    // since checking them will move them between index entries.
+    std::vector<EdgeInf *> blockedEdges;
+    const EdgeInfListOrderSet noEdges;
+    std::map<int, EdgeInfListOrderSet>::const_iterator cycleBlocked =
+            m_invis_edges_by_blocker.find(-1);
+    std::map<int, EdgeInfListOrderSet>::const_iterator pidBlocked =
+            m_invis_edges_by_blocker.find(pid);
+    const EdgeInfListOrderSet& cycleEdges =
+            (cycleBlocked != m_invis_edges_by_blocker.end()) ?
+            cycleBlocked->second : noEdges;
+    const EdgeInfListOrderSet& pidEdges =
+            (pidBlocked != m_invis_edges_by_blocker.end()) ?
+            pidBlocked->second : noEdges;
+    std::merge(cycleEdges.begin(), cycleEdges.end(),
+            pidEdges.begin(), pidEdges.end(),
+            std::back_inserter(blockedEdges), CmpEdgeInfListOrder());
+
+    for (size_t e = 0; e < blockedEdges.size(); ++e)
     {
-        EdgeInf *tmp = iter;
-        iter = iter->lstNext;
+        EdgeInf *tmp = blockedEdges[e];
 
         if (tmp->blocker() == -1)
         {
@@ -1679,12 +2398,16 @@ void Router::generateContains(VertInf *pt)
     bool countBorder = false;
 
     // Compute enclosing shapes.
-    ObstacleList::const_iterator finish = m_obstacles.end();
-    for (ObstacleList::const_iterator i = m_obstacles.begin(); i != finish; ++i)
+    Box pointBox;
+    pointBox.min = pointBox.max = pt->point;
+    std::vector<Obstacle *> nearbyObstacles;
+    obstaclesOverlappingBox(pointBox, nearbyObstacles);
+    for (size_t i = 0; i < nearbyObstacles.size(); ++i)
     {
-        if (inPoly((*i)->routingPolygon(), pt->point, countBorder))
+        if (inPoly(nearbyObstacles[i]->routingPolygon(), pt->point,
+                countBorder))
         {
-            contains[pt->id].insert((*i)->id());
+            contains[pt->id].insert(nearbyObstacles[i]->id());
         }
     }
 
@@ -1725,6 +2448,86 @@ void Router::adjustClustersWithDel(const int p_cluster)
 }
 
 
+void Router::indexObstacle(Obstacle *obstacle)
+{
+    if (routingParameter(shapeBufferDistance) != m_obstacle_index_buffer)
+    {
+        // The index is out of date and will be rebuilt when next queried.
+        return;
+    }
+    m_obstacle_index.insert(obstacle,
+            obstacle->routingPolygon().offsetBoundingBox(0));
+}
+
+
+void Router::unindexObstacle(Obstacle *obstacle)
+{
+    m_obstacle_index.remove(obstacle);
+}
+
+
+void Router::obstaclesOverlappingBox(const Box& box,
+        std::vector<Obstacle *>& obstacles)
+{
+    const double bufferDistance = routingParameter(shapeBufferDistance);
+    if (bufferDistance != m_obstacle_index_buffer)
+    {
+        // Routing polygons depend on the buffer distance, so rebuild.
+        m_obstacle_index_buffer = bufferDistance;
+        m_obstacle_index.clear();
+        for (ObstacleList::const_iterator i = m_obstacles.begin();
+                i != m_obstacles.end(); ++i)
+        {
+            indexObstacle(*i);
+        }
+    }
+    m_obstacle_index.query(box, obstacles);
+}
+
+
+void Router::indexEdge(EdgeInf *edge)
+{
+    COLA_ASSERT(!edge->m_orthogonal);
+
+    if (edge->m_visible)
+    {
+        std::pair<Point, Point> points = edge->points();
+        Box bbox;
+        bbox.min.x = std::min(points.first.x, points.second.x);
+        bbox.min.y = std::min(points.first.y, points.second.y);
+        bbox.max.x = std::max(points.first.x, points.second.x);
+        bbox.max.y = std::max(points.first.y, points.second.y);
+        m_vis_edge_index.insert(edge, bbox);
+    }
+    else
+    {
+        m_invis_edges_by_blocker[edge->m_blocker].insert(edge);
+    }
+}
+
+
+void Router::unindexEdge(EdgeInf *edge)
+{
+    COLA_ASSERT(!edge->m_orthogonal);
+
+    if (edge->m_visible)
+    {
+        m_vis_edge_index.remove(edge);
+    }
+    else
+    {
+        std::map<int, EdgeInfListOrderSet>::iterator blocked =
+                m_invis_edges_by_blocker.find(edge->m_blocker);
+        COLA_ASSERT(blocked != m_invis_edges_by_blocker.end());
+        blocked->second.erase(edge);
+        if (blocked->second.empty())
+        {
+            m_invis_edges_by_blocker.erase(blocked);
+        }
+    }
+}
+
+
 void Router::adjustContainsWithAdd(const Polygon& poly, const int p_shape)
 {
     // Don't count points on the border as being inside.
@@ -2022,6 +2825,9 @@ void Router::setRoutingParameter(const RoutingParameter parameter,
             case portDirectionPenalty:
                 m_routing_parameters[parameter] = 100;
                 break;
+            case routingTileSize:
+                m_routing_parameters[parameter] = 1000;
+                break;
             default:
                 m_routing_parameters[parameter] = 50;
                 break;
@@ -2047,6 +2853,10 @@ void Router::setRoutingOption(const RoutingOption option, const bool value)
     COLA_ASSERT(option < lastRoutingOptionMarker);
     m_routing_options[option] = value;
     m_settings_changes = true;
+    if (option == performIncrementalPolylineRouteSearch)
+    {
+        visGraphChanges.setEnabled(value);
+    }
 }
 
 
@@ -2151,10 +2961,19 @@ void Router::printInfo(void)
     fprintf(fp, "checkVisEdge tally: %d\n", st_checked_edges);
     fprintf(fp, "----------------------\n");
 
-#ifdef AVOID_PROFILE
-    timers.printAll(fp);
-    timers.reset();
-#endif
+    if (profiler.enabled())
+    {
+        const RouterProfile& profile = profiler.profile();
+        for (size_t i = 0; i < tmCount; ++i)
+        {
+            fprintf(fp, "%s: %.3f ms (%u)\n", timerIndexName((TimerIndex) i),
+                    profile.phaseTime[i], profile.phaseCount[i]);
+        }
+        fprintf(fp, "A* nodes expanded: %zu\n", profile.aStarNodesExpanded);
+        fprintf(fp, "VPSC solves: %zu (%zu retries)\n", profile.vpscSolves,
+                profile.nudgingRetries);
+        fprintf(fp, "----------------------\n");
+    }
 }
 
 
@@ -3000,6 +3819,419 @@ void Router::outputDiagramSVG(std::string instanceName, LineReps *lineReps)
     fclose(fp);
 }
 
+// Object kinds recorded in instance snapshots.
+enum SnapshotObjectKind
+{
+    SnapshotShape = 1,
+    SnapshotJunction = 2
+};
+
+typedef std::map<unsigned int, Obstacle *> SnapshotObstacleMap;
+
+
+static void writeSnapshotConnEnd(SnapshotWriter& out, const ConnEnd& connEnd)
+{
+    out.writeUInt(connEnd.type());
+    if (connEnd.type() == ConnEndPoint)
+    {
+        out.writePoint(connEnd.position());
+        out.writeUInt(connEnd.directions());
+    }
+    else if (connEnd.type() == ConnEndShapePin)
+    {
+        out.writeUInt(connEnd.shape()->id());
+        out.writeUInt(connEnd.pinClassId());
+    }
+    else if (connEnd.type() == ConnEndJunction)
+    {
+        out.writeUInt(connEnd.junction()->id());
+    }
+}
+
+
+// Reads a ConnEnd, returning false if it refers to an unknown object.
+static bool readSnapshotConnEnd(SnapshotReader& in, 
+        const SnapshotObstacleMap& obstacles, ConnEnd& connEnd)
+{
+    unsigned int type = in.readUInt();
+    if (type == ConnEndPoint)
+    {
+        Point point = in.readPoint();
+        ConnDirFlags directions = (ConnDirFlags) in.readUInt();
+        connEnd = ConnEnd(point, directions);
+    }
+    else if ((type == ConnEndShapePin) || (type == ConnEndJunction))
+    {
+        SnapshotObstacleMap::const_iterator found = 
+                obstacles.find(in.readUInt());
+        if (found == obstacles.end())
+        {
+            return false;
+        }
+        if (type == ConnEndShapePin)
+        {
+            ShapeRef *shape = dynamic_cast<ShapeRef *> (found->second);
+            unsigned int pinClassId = in.readUInt();
+            if (shape == nullptr)
+            {
+                return false;
+            }
+            connEnd = ConnEnd(shape, pinClassId);
+        }
+        else
+        {
+            JunctionRef *junction = 
+                    dynamic_cast<JunctionRef *> (found->second);
+            if (junction == nullptr)
+            {
+                return false;
+            }
+            connEnd = ConnEnd(junction);
+        }
+    }
+    else
+    {
+        connEnd = ConnEnd();
+    }
+    return in.good();
+}
+
+
+bool Router::outputInstanceSnapshot(const std::string& filename) const
+{
+    SnapshotWriter out(filename);
+    if (!out.good())
+    {
+        return false;
+    }
+
+    out.writeBool(m_allows_polyline_routing);
+    out.writeBool(m_allows_orthogonal_routing);
+    out.writeUInt(lastRoutingParameterMarker);
+    for (size_t p = 0; p < lastRoutingParameterMarker; ++p)
+    {
+        out.writeDouble(m_routing_parameters[p]);
+    }
+    out.writeUInt(lastRoutingOptionMarker);
+    for (size_t p = 0; p < lastRoutingOptionMarker; ++p)
+    {
+        out.writeBool(m_routing_options[p]);
+    }
+
+    // Objects are written in the order they were created, as in the code
+    // output by outputInstanceToSVG().
+    out.writeUInt((uint32_t) clusterRefs.size());
+    for (ClusterRefList::const_reverse_iterator it = clusterRefs.rbegin();
+            it != clusterRefs.rend(); ++it)
+    {
+        out.writeUInt((*it)->id());
+        out.writePolygon((*it)->polygon());
+    }
+
+    out.writeUInt((uint32_t) m_obstacles.size());
+    for (ObstacleList::const_reverse_iterator it = m_obstacles.rbegin();
+            it != m_obstacles.rend(); ++it)
+    {
+        ShapeRef *shape = dynamic_cast<ShapeRef *> (*it);
+        JunctionRef *junction = dynamic_cast<JunctionRef *> (*it);
+        if (shape)
+        {
+            out.writeUInt(SnapshotShape);
+            out.writeUInt(shape->id());
+            out.writePolygon(shape->polygon());
+            out.writeUInt((uint32_t) shape->m_connection_pins.size());
+            for (ShapeConnectionPinSet::const_iterator curr = 
+                    shape->m_connection_pins.begin(); 
+                    curr != shape->m_connection_pins.end(); ++curr)
+            {
+                const ShapeConnectionPin *pin = *curr;
+                out.writeUInt(pin->m_class_id);
+                out.writeDouble(pin->m_x_offset);
+                out.writeDouble(pin->m_y_offset);
+                out.writeBool(pin->m_using_proportional_offsets);
+                out.writeDouble(pin->m_inside_offset);
+                out.writeUInt(pin->m_visibility_directions);
+                out.writeBool(pin->m_exclusive);
+            }
+        }
+        else
+        {
+            // Junction pins are created by the JunctionRef constructor,
+            // so aren't recorded.
+            COLA_ASSERT(junction);
+            out.writeUInt(SnapshotJunction);
+            out.writeUInt(junction->id());
+            out.writePoint(junction->position());
+            out.writeBool(junction->positionFixed());
+        }
+    }
+
+    out.writeUInt((uint32_t) connRefs.size());
+    for (ConnRefList::const_reverse_iterator it = connRefs.rbegin();
+            it != connRefs.rend(); ++it)
+    {
+        const ConnRef *connRef = *it;
+        out.writeUInt(connRef->id());
+        out.writeUInt(connRef->routingType());
+        for (size_t e = 0; e < 2; ++e)
+        {
+            ConnEnd *connEnd = (e == 0) ? 
+                    connRef->m_src_connend : connRef->m_dst_connend;
+            VertInf *vertex = (e == 0) ? connRef->src() : connRef->dst();
+            if (connEnd)
+            {
+                writeSnapshotConnEnd(out, *connEnd);
+            }
+            else if (vertex)
+            {
+                writeSnapshotConnEnd(out, 
+                        ConnEnd(vertex->point, vertex->visDirections));
+            }
+            else
+            {
+                writeSnapshotConnEnd(out, ConnEnd());
+            }
+        }
+
+        out.writeBool(connRef->m_has_fixed_route);
+        if (connRef->m_has_fixed_route)
+        {
+            const PolyLine& route = connRef->route();
+            out.writeUInt((uint32_t) route.size());
+            for (size_t i = 0; i < route.size(); ++i)
+            {
+                out.writePoint(route.ps[i]);
+                out.writeUInt(route.ps[i].id);
+                out.writeUInt(route.ps[i].vn);
+            }
+        }
+
+        out.writeUInt((uint32_t) connRef->m_checkpoints.size());
+        for (size_t i = 0; i < connRef->m_checkpoints.size(); ++i)
+        {
+            const Checkpoint& checkpoint = connRef->m_checkpoints[i];
+            out.writePoint(checkpoint.point);
+            out.writeUInt(checkpoint.arrivalDirections);
+            out.writeUInt(checkpoint.departureDirections);
+        }
+    }
+
+    const HyperedgeRerouter& rerouter = m_hyperedge_rerouter;
+    out.writeUInt((uint32_t) rerouter.count());
+    for (size_t i = 0; i < rerouter.count(); ++i)
+    {
+        JunctionRef *root = rerouter.m_root_junction_vector[i];
+        out.writeBool(root != nullptr);
+        if (root)
+        {
+            out.writeUInt(root->id());
+        }
+        else
+        {
+            const ConnEndList& terminals = rerouter.m_terminals_vector[i];
+            out.writeUInt((uint32_t) terminals.size());
+            for (ConnEndList::const_iterator it = terminals.begin();
+                    it != terminals.end(); ++it)
+            {
+                writeSnapshotConnEnd(out, *it);
+            }
+        }
+    }
+
+    return out.close();
+}
+
+
+Router *Router::createFromInstanceSnapshot(const std::string& filename)
+{
+    SnapshotReader in(filename);
+    if (!in.good())
+    {
+        return nullptr;
+    }
+
+    unsigned int flags = 0;
+    if (in.readBool())
+    {
+        flags |= PolyLineRouting;
+    }
+    if (in.readBool())
+    {
+        flags |= OrthogonalRouting;
+    }
+    if (!in.good() || (flags == 0))
+    {
+        return nullptr;
+    }
+    Router *router = new Router(flags);
+
+    // Values for parameters and options unknown to this version of the
+    // library are ignored.
+    uint32_t count = in.readUInt();
+    for (size_t p = 0; p < count; ++p)
+    {
+        double value = in.readDouble();
+        if (p < lastRoutingParameterMarker)
+        {
+            router->setRoutingParameter((RoutingParameter) p, value);
+        }
+    }
+    count = in.readUInt();
+    for (size_t p = 0; p < count; ++p)
+    {
+        bool value = in.readBool();
+        if (p < lastRoutingOptionMarker)
+        {
+            router->setRoutingOption((RoutingOption) p, value);
+        }
+    }
+
+    count = in.readUInt();
+    for (size_t i = 0; in.good() && (i < count); ++i)
+    {
+        unsigned int id = in.readUInt();
+        Polygon polygon = in.readPolygon();
+        new ClusterRef(router, polygon, id);
+    }
+
+    bool valid = true;
+    SnapshotObstacleMap obstacles;
+    count = in.readUInt();
+    for (size_t i = 0; valid && in.good() && (i < count); ++i)
+    {
+        unsigned int kind = in.readUInt();
+        unsigned int id = in.readUInt();
+        if (kind == SnapshotShape)
+        {
+            Polygon polygon = in.readPolygon();
+            ShapeRef *shape = new ShapeRef(router, polygon, id);
+            obstacles[id] = shape;
+
+            uint32_t pinCount = in.readUInt();
+            for (size_t p = 0; in.good() && (p < pinCount); ++p)
+            {
+                unsigned int classId = in.readUInt();
+                double xOffset = in.readDouble();
+                double yOffset = in.readDouble();
+                bool proportional = in.readBool();
+                double insideOffset = in.readDouble();
+                ConnDirFlags visDirs = (ConnDirFlags) in.readUInt();
+                bool exclusive = in.readBool();
+                ShapeConnectionPin *pin = new ShapeConnectionPin(shape, 
+                        classId, xOffset, yOffset, proportional, 
+                        insideOffset, visDirs);
+                pin->setExclusive(exclusive);
+            }
+        }
+        else if (kind == SnapshotJunction)
+        {
+            Point position = in.readPoint();
+            bool fixed = in.readBool();
+            JunctionRef *junction = new JunctionRef(router, position, id);
+            junction->setPositionFixed(fixed);
+            obstacles[id] = junction;
+        }
+        else
+        {
+            valid = false;
+        }
+    }
+
+    count = in.readUInt();
+    for (size_t i = 0; valid && in.good() && (i < count); ++i)
+    {
+        unsigned int id = in.readUInt();
+        ConnType routingType = (ConnType) in.readUInt();
+        ConnEnd srcEnd, dstEnd;
+        valid = readSnapshotConnEnd(in, obstacles, srcEnd) && 
+                readSnapshotConnEnd(in, obstacles, dstEnd);
+        if (!valid)
+        {
+            break;
+        }
+
+        ConnRef *connRef = new ConnRef(router, id);
+        if (srcEnd.type() != ConnEndEmpty)
+        {
+            connRef->setSourceEndpoint(srcEnd);
+        }
+        if (dstEnd.type() != ConnEndEmpty)
+        {
+            connRef->setDestEndpoint(dstEnd);
+        }
+        connRef->setRoutingType(routingType);
+
+        if (in.readBool())
+        {
+            PolyLine route(in.readPointCount());
+            for (size_t p = 0; in.good() && (p < route.size()); ++p)
+            {
+                route.ps[p] = in.readPoint();
+                route.ps[p].id = in.readUInt();
+                route.ps[p].vn = in.readUInt();
+            }
+            route._id = id;
+            connRef->setFixedRoute(route);
+        }
+
+        uint32_t checkpointCount = in.readPointCount();
+        if (checkpointCount > 0)
+        {
+            std::vector<Checkpoint> checkpoints;
+            for (size_t p = 0; in.good() && (p < checkpointCount); ++p)
+            {
+                Point point = in.readPoint();
+                ConnDirFlags arrival = (ConnDirFlags) in.readUInt();
+                ConnDirFlags departure = (ConnDirFlags) in.readUInt();
+                checkpoints.push_back(Checkpoint(point, arrival, departure));
+            }
+            connRef->setRoutingCheckpoints(checkpoints);
+        }
+    }
+
+    count = in.readUInt();
+    for (size_t i = 0; valid && in.good() && (i < count); ++i)
+    {
+        if (in.readBool())
+        {
+            SnapshotObstacleMap::const_iterator found = 
+                    obstacles.find(in.readUInt());
+            JunctionRef *root = (found != obstacles.end()) ?
+                    dynamic_cast<JunctionRef *> (found->second) : nullptr;
+            valid = (root != nullptr);
+            if (valid)
+            {
+                router->hyperedgeRerouter()->registerHyperedgeForRerouting(
+                        root);
+            }
+        }
+        else
+        {
+            ConnEndList terminals;
+            uint32_t terminalCount = in.readUInt();
+            for (size_t t = 0; valid && (t < terminalCount); ++t)
+            {
+                ConnEnd connEnd;
+                valid = readSnapshotConnEnd(in, obstacles, connEnd);
+                terminals.push_back(connEnd);
+            }
+            if (valid)
+            {
+                router->hyperedgeRerouter()->registerHyperedgeForRerouting(
+                        terminals);
+            }
+        }
+    }
+
+    if (!valid || !in.good())
+    {
+        delete router;
+        return nullptr;
+    }
+    return router;
+}
+
+
 void Router::outputDiagram(std::string instanceName)
 {
     outputDiagramText(instanceName);
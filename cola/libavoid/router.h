@@ -29,10 +29,13 @@
 #ifndef AVOID_ROUTER_H
 #define AVOID_ROUTER_H
 
-#include <ctime>
+#include <chrono>
 #include <list>
 #include <utility>
 #include <string>
+#include <map>
+#include <memory>
+#include <vector>
 
 #include "libavoid/dllexport.h"
 #include "libavoid/connector.h"
@@ -42,6 +45,9 @@
 #include "libavoid/hyperedge.h"
 #include "libavoid/actioninfo.h"
 #include "libavoid/hyperedgeimprover.h"
+#include "libavoid/spatialindex.h"
+#include "libavoid/memorypool.h"
+#include "libavoid/orthogonal.h"
 
 
 namespace Avoid {
@@ -64,6 +70,7 @@ typedef std::list<ClusterRef *> ClusterRefList;
 class Obstacle;
 typedef std::list<Obstacle *> ObstacleList;
 class DebugHandler;
+class ThreadPool;
 
 //! @brief  Flags that can be passed to the router during initialisation 
 //!         to specify options.
@@ -161,6 +168,12 @@ enum RoutingParameter
     //!         to loop around obstacles.
     reverseDirectionPenalty,
 
+    //! @brief This parameter defines the width and height of the tiles 
+    //!        the diagram is split into when the 
+    //!        ::performTiledOrthogonalRouting option is set.  By default, 
+    //!        this is set to a value of 1000.
+    routingTileSize,
+
     // Used for determining the size of the routing parameter array.
     // This should always we the last value in the enum.
     lastRoutingParameterMarker
@@ -284,6 +297,167 @@ enum RoutingOption
     //!
     nudgeSharedPathsWithCommonEndPoint,
 
+    //! This option causes the route searches for connectors to be performed
+    //! concurrently on multiple threads.  The number of threads used can be
+    //! set with Router::setRoutingThreadCount().
+    //!
+    //! Defaults to false.
+    //!
+    //! Connectors attached to connection pins or junctions, or that have 
+    //! checkpoints, still have their routes searched for one at a time, 
+    //! after the others.  The routes produced are the same as when this 
+    //! option is not set.
+    //!
+    performParallelRouteSearch,
+
+    //! This option causes the orthogonal visibility graph to be updated 
+    //! incrementally when obstacles or connector endpoints are added, moved
+    //! or removed, rather than being regenerated from scratch.  Only the 
+    //! parts of the graph within horizontal and vertical bands around the 
+    //! changed objects are regenerated.
+    //!
+    //! Defaults to false.
+    //!
+    //! The resulting graph is the same as a full regeneration would give.
+    //! The full regeneration is still used where the extent of the diagram 
+    //! changes, or where a large proportion of the diagram has changed.
+    //!
+    performIncrementalOrthogonalVisGraphUpdate,
+
+    //! This option causes a compact copy of the visibility graph to be 
+    //! taken before connectors are routed in each transaction.  Route 
+    //! searches then read the neighbours of each vertex from contiguous 
+    //! arrays rather than from linked lists of edges, which is faster for
+    //! large diagrams.  Vertices whose edges change during routing, such 
+    //! as connector endpoints, are still read from their edge lists.
+    //!
+    //! Defaults to false.
+    //!
+    //! Route costs are unaffected, though the compact graph breaks ties in
+    //! the order neighbours are explored differently, so where several 
+    //! routes have equal cost a different one may be chosen.
+    //!
+    performRouteSearchOnCompactVisGraph,
+
+    //! This option causes the independent regions of overlapping segments
+    //! found during orthogonal nudging to be solved concurrently, using up
+    //! to Router::routingThreadCount() threads.  The new segment positions
+    //! are then applied in the same order as they would be serially.
+    //!
+    //! Defaults to false.
+    //!
+    //! The resulting routes are the same as when this option is not set.
+    //!
+    performParallelOrthogonalNudging,
+
+    //! This option causes the solver used for each region of overlapping 
+    //! segments during orthogonal nudging to be kept between attempts, 
+    //! when constraints are added or separation distances are reduced, 
+    //! and re-solved from its previous state rather than from scratch.
+    //! This is much faster for heavily congested channels.
+    //!
+    //! Defaults to false.
+    //!
+    //! Since the solver stops within a small tolerance of the optimal
+    //! solution, segments with little preference for their position may
+    //! occasionally be placed slightly differently than when this option
+    //! is not set.
+    //!
+    performIncrementalNudgingSolve,
+
+    //! This option causes the visibility of the vertices of obstacles that
+    //! are added or moved in a transaction to be computed concurrently 
+    //! when polyline routing is used, using up to 
+    //! Router::routingThreadCount() threads.  The rotational sweep for 
+    //! each vertex is performed on its own, then the resulting edges are 
+    //! added to the visibility graph in order on a single thread.  This 
+    //! speeds up building the graph for a new diagram, or rebuilding it 
+    //! after Router::markAllObstaclesAsMoved().
+    //!
+    //! Defaults to false.
+    //!
+    //! The visibility is computed once all the added and moved obstacles 
+    //! are in place, rather than for each obstacle in turn.  The 
+    //! resulting visibility graph has the same edges, though they are 
+    //! added in a different order, so where several routes have equal 
+    //! cost a different one may be chosen.  The exception is edges running 
+    //! exactly along the overlapping boundaries of two obstacles, which 
+    //! may be treated as blocked where they would otherwise not be.
+    //!
+    //! The option has no effect when only one thread is available, since
+    //! sweeping the obstacles together is then slower.
+    //!
+    performParallelPolylineVisibility,
+
+    //! This option causes the router to keep the route search of each 
+    //! poly-line connector between transactions, and to reroute it by
+    //! repairing only the parts of that search affected by the changes to
+    //! the visibility graph since.  This makes rerouting much faster when 
+    //! each transaction changes only a small part of the diagram, such as
+    //! when interactively dragging shapes.
+    //!
+    //! Defaults to false.
+    //!
+    //! Routes found in this way have the same cost as those from a full 
+    //! search, though where several routes have equal cost a different 
+    //! one may be chosen.  It is not used for connectors affected by 
+    //! cluster crossing penalties, or when rerouting connectors to reduce
+    //! crossings, nor with rubber-band routing.
+    //!
+    performIncrementalPolylineRouteSearch,
+
+    //! This option causes the trees for hyperedges being rerouted by the
+    //! HyperedgeRerouter to be searched for concurrently, using up to 
+    //! Router::routingThreadCount() threads.  The junctions and 
+    //! connectors for each hyperedge are then created in the order the 
+    //! hyperedges were registered.
+    //!
+    //! Defaults to false.
+    //!
+    //! The resulting routes are the same as when this option is not set.
+    //!
+    performParallelHyperedgeRerouting,
+
+    //! This option causes each connector to remember a fingerprint of 
+    //! the obstacles, connection points and visibility within the 
+    //! corridor its route could be improved in.  If none of these have 
+    //! changed when the connector would otherwise be rerouted, its 
+    //! previous route is kept rather than being searched for again.
+    //! This only applies to connectors not attached to pins, junctions 
+    //! or checkpoints.
+    //!
+    //! Defaults to false.
+    //!
+    //! The number of reroutes avoided can be queried with 
+    //! Router::routeCacheHitCount().
+    //!
+    performRouteCaching,
+
+    //! This option causes the diagram to be split into overlapping tiles
+    //! of size ::routingTileSize.  Orthogonal connectors whose endpoints 
+    //! lie within a single tile are routed around just the obstacles in 
+    //! that tile, with the tiles being routed concurrently using up to 
+    //! Router::routingThreadCount() threads.  The orthogonal visibility 
+    //! graph for the whole diagram is then only generated if there are 
+    //! other connectors to route.  All connectors are nudged together.
+    //!
+    //! Defaults to false.
+    //!
+    //! Connectors whose route within their tile would leave the tile are 
+    //! routed over the whole diagram instead.  The routes of connectors 
+    //! routed within a tile may be longer than necessary if a better 
+    //! route would leave the tile.
+    //!
+    performTiledOrthogonalRouting,
+
+    //! This option causes a RouteSnapshot of the display routes of all 
+    //! connectors to be published at the end of each transaction.  This 
+    //! can be retrieved with Router::routeSnapshot(), from any thread.
+    //!
+    //! Defaults to false.
+    //!
+    publishRouteSnapshots,
+
 
     // Used for determining the size of the routing options array.
     // This should always we the last value in the enum.
@@ -378,12 +552,98 @@ class TopologyAddonInterface
 };
 
 
+//! @brief  Usage information for the memory pools owned by a router,
+//!         as returned by Router::allocatorStatistics().
+//!
+struct AVOID_EXPORT RouterAllocatorStatistics
+{
+    //! @brief  The pool for visibility graph vertices, other than the 
+    //!         dummy vertices of the orthogonal visibility graph.
+    MemoryPoolStatistics vertices;
+    //! @brief  The pool for orthogonal visibility graph dummy vertices.
+    MemoryPoolStatistics orthogonalVertices;
+    //! @brief  The pool for visibility graph edges, other than those of
+    //!         the orthogonal visibility graph.
+    MemoryPoolStatistics edges;
+    //! @brief  The pool for orthogonal visibility graph edges.
+    MemoryPoolStatistics orthogonalEdges;
+    //! @brief  The pool for blocks of nodes used by A* route searches.
+    MemoryPoolStatistics searchNodeBlocks;
+};
+
+
+//! @brief  An immutable record of the display routes of all connectors in
+//!         a router, as returned by Router::routeSnapshot().
+//!
+//! Snapshots are never modified once published, so they can be read from
+//! any thread without locking, even while the router is processing a 
+//! later transaction.  Routes that are unchanged between transactions
+//! are shared by successive snapshots.
+//!
+class AVOID_EXPORT RouteSnapshot
+{
+    public:
+        //! @brief  A map from connector IDs to their display routes.
+        typedef std::map<unsigned int, std::shared_ptr<const PolyLine> >
+                RouteMap;
+
+        //! @brief  Constructs an empty snapshot, with a version of zero.
+        RouteSnapshot();
+
+        //! @brief  Returns the version of this snapshot.
+        //!
+        //! The version increases by one with each snapshot published by 
+        //! a router.  The empty snapshot available before any have been
+        //! published has a version of zero.
+        //!
+        //! @return  The version number.
+        //!
+        unsigned long long version(void) const;
+
+        //! @brief  Returns the display route of a connector.
+        //!
+        //! @param[in]  connId  The ID of the connector.
+        //! @return  The connector's route, or nullptr if there was no 
+        //!          connector with that ID.
+        //!
+        const PolyLine *route(const unsigned int connId) const;
+
+        //! @brief  Returns the display routes of all connectors.
+        //!
+        //! @return  A map from connector IDs to their routes.
+        //!
+        const RouteMap& routes(void) const;
+
+    private:
+        friend class Router;
+
+        unsigned long long m_version;
+        RouteMap m_routes;
+};
+
+//! @brief  A shared pointer to a published RouteSnapshot.
+typedef std::shared_ptr<const RouteSnapshot> RouteSnapshotPtr;
+
+
 //! @brief   The Router class represents a libavoid router instance.
 //!
 //! Usually you would keep a separate Router instance for each diagram
 //! or layout you have open in your application.
 //
 class AVOID_EXPORT Router {
+    private:
+        // Pools for visibility graph vertices and edges, and for blocks of
+        // A* search nodes.  These are declared before the graphs so that
+        // they are destroyed after them.  The dummy vertices and edges of 
+        // the orthogonal visibility graph have their own pools, which are
+        // reset when the whole graph is discarded.  Only the search node 
+        // pool is used from worker threads, so only it is thread-safe.
+        MemoryPool m_vertex_pool;
+        MemoryPool m_orthogonal_vertex_pool;
+        MemoryPool m_edge_pool;
+        MemoryPool m_orthogonal_edge_pool;
+        MemoryPool m_search_node_pool;
+
     public:
         //! @brief  Constructor for router instance.
         //!
@@ -398,12 +658,18 @@ class AVOID_EXPORT Router {
         //!         pointers to them.
         virtual ~Router();
 
+        // Changes to the poly-line visibility graph, for incremental route
+        // searches.  This is declared before the graph and vertices so 
+        // that it is destroyed after them.
+        VisGraphChangeLog visGraphChanges;
+
         ObstacleList m_obstacles;
         ConnRefList connRefs;
         ClusterRefList clusterRefs;
         EdgeList visGraph;
         EdgeList invisGraph;
         EdgeList visOrthogGraph;
+        CompactVisGraph compactVisGraph;
         ContainsMap contains;
         VertInfList vertices;
         ContainsMap enclosingClusters;
@@ -425,9 +691,7 @@ class AVOID_EXPORT Router {
         
 
         // Instrumentation:
-#ifdef AVOID_PROFILE
-        Timer timers;
-#endif
+        Profiler profiler;
         int st_checked_edges;
 
         //! @brief Allows setting of the behaviour of the router in regard
@@ -478,6 +742,47 @@ class AVOID_EXPORT Router {
         //!
         bool processTransaction(void);
 
+        //! @brief Adds many shapes to the router scene at once.
+        //!
+        //! This creates a ShapeRef for each of the given polygons, with an 
+        //! automatically assigned ID, as if each were constructed in turn.
+        //! It is much faster for loading large diagrams, though, since each
+        //! new shape is queued without being checked against all the other
+        //! queued actions, and when not using transactions the shapes are
+        //! all processed, and connectors rerouted, just once.
+        //!
+        //! If the router is using transactions, then the shapes are added 
+        //! the next time Router::processTransaction() is called, otherwise 
+        //! they are added before this method returns.
+        //!
+        //! The router will handle freeing of the shapes' memory.
+        //!
+        //! @param[in]  polygons  The polygon boundaries of the new shapes.
+        //! @return     The new shapes, in the same order as polygons.
+        //!
+        std::vector<ShapeRef *> addShapes(const std::vector<Polygon>& polygons);
+
+        //! @brief Adds many connectors to the router scene at once.
+        //!
+        //! This creates a ConnRef for each pair of source and destination 
+        //! endpoints, with an automatically assigned ID, as if each were
+        //! constructed in turn.  Like addShapes(), this avoids checking
+        //! each connector against the other queued actions.
+        //!
+        //! If the router is using transactions, then the connectors are 
+        //! added and routed the next time Router::processTransaction() is 
+        //! called, otherwise they are added and routed before this method 
+        //! returns.
+        //!
+        //! The router will handle freeing of the connectors' memory.
+        //!
+        //! @param[in]  endpoints  The source and destination endpoints of 
+        //!                        the new connectors.
+        //! @return     The new connectors, in the same order as endpoints.
+        //!
+        std::vector<ConnRef *> addConnectors(
+                const std::vector<std::pair<ConnEnd, ConnEnd> >& endpoints);
+
         //! @brief Delete a shape from the router scene.
         //!
         //! Connectors that could have a better (usually shorter) path after
@@ -648,6 +953,145 @@ class AVOID_EXPORT Router {
         //!
         bool routingOption(const RoutingOption option) const;
 
+        //! @brief  Sets the number of threads the router may use for the 
+        //!         phases of routing that can be performed concurrently.
+        //!
+        //! These phases are only performed concurrently when enabled via
+        //! their routing options, e.g., ::performParallelRouteSearch.  The
+        //! worker threads are started when first needed and are reused by
+        //! later transactions.
+        //!
+        //! @param[in] threads  The maximum number of threads to use.  A 
+        //!                     value of zero (the default) means use the 
+        //!                     number of hardware threads available.
+        //!
+        void setRoutingThreadCount(const unsigned int threads);
+
+        //! @brief  Returns the number of threads the router may use for 
+        //!         phases of routing that can be performed concurrently.
+        //!
+        //! @return  The thread count, or zero for the number of hardware 
+        //!          threads available.
+        //!
+        unsigned int routingThreadCount(void) const;
+
+        //! @brief  Sets a limit on the wall-clock time that each transaction
+        //!         may take.
+        //!
+        //! Once the limit is reached, the remaining work of the transaction
+        //! is cut short rather than being abandoned part way through:
+        //!  - connectors needing rerouting keep their previous route if it 
+        //!    still ends at their endpoints, otherwise they are routed,
+        //!  - no further groups of crossing connectors are rerouted,
+        //!  - hyperedge improvement is skipped, and
+        //!  - no further orthogonal segments are nudged apart.
+        //!
+        //! Connectors that kept their previous routes will be rerouted as
+        //! part of the next transaction.  Use transactionPhaseCompleted() to
+        //! find which phases were performed in full.
+        //!
+        //! Note that the time limit may be overrun by the work that has to
+        //! be done regardless, such as building the visibility graph.
+        //!
+        //! @param[in] msec  The time limit in milliseconds.  A value of zero
+        //!                  (the default) means no limit.
+        //!
+        void setTransactionTimeLimit(const unsigned int msec);
+
+        //! @brief  Returns the wall-clock time limit for each transaction.
+        //!
+        //! @return  The time limit in milliseconds, or zero for no limit.
+        //!
+        unsigned int transactionTimeLimit(void) const;
+
+        //! @brief  Returns whether a phase was performed in full during the
+        //!         most recently processed transaction.
+        //!
+        //! Phases may be cut short by the transaction time limit, or by 
+        //! shouldContinueTransactionWithProgress() returning false.  Phases
+        //! that had nothing to do are considered completed.
+        //!
+        //! @param[in] phase  The phase, a TransactionPhases value.  For
+        //!                   Avoid::TransactionPhaseCompleted, this returns
+        //!                   whether the whole transaction was completed.
+        //! @return  A boolean denoting whether the phase was completed.
+        //!
+        bool transactionPhaseCompleted(const TransactionPhases phase) const;
+
+        //! @brief  Sets whether the router should record a profile of each
+        //!         transaction it processes.
+        //!
+        //! The profile records the wall-clock time spent in each phase of 
+        //! routing, along with counts of the work done, such as the size
+        //! of the visibility graph and the number of nodes expanded by 
+        //! route searches.  Profiling is cheap, but not free, so it is
+        //! disabled by default.
+        //!
+        //! @param[in] enabled  Whether transactions should be profiled.
+        //!
+        void setProfilingEnabled(const bool enabled);
+
+        //! @brief  Returns whether the router is profiling transactions.
+        //!
+        //! @return  A boolean denoting whether profiling is enabled.
+        //!
+        bool profilingEnabled(void) const;
+
+        //! @brief  Returns the profile of the most recent transaction
+        //!         processed while profiling was enabled.
+        //!
+        //! @return  A RouterProfile describing the transaction.
+        //!
+        const RouterProfile& lastTransactionProfile(void) const;
+
+        //! @brief  Writes the profile of the most recent transaction 
+        //!         processed while profiling was enabled to a file, in the
+        //!         Chrome trace event format.
+        //!
+        //! The resulting file can be viewed with chrome://tracing or 
+        //! Perfetto.
+        //!
+        //! @param[in] filename  The path of the file to write.
+        //! @return  Whether the file was written successfully.
+        //!
+        bool outputProfileAsChromeTrace(const std::string& filename) const;
+
+        //! @brief  Returns usage information for the memory pools the 
+        //!         router allocates its internal graph objects from.
+        //!
+        //! @return  A RouterAllocatorStatistics structure.
+        //!
+        RouterAllocatorStatistics allocatorStatistics(void) const;
+
+        //! @brief  Returns the most recently published snapshot of the 
+        //!         connector routes.
+        //!
+        //! Snapshots are published at the end of each transaction when the
+        //! ::publishRouteSnapshots option is set.  Unlike other methods, 
+        //! this may be called from any thread, including while another 
+        //! thread is processing a transaction.  It never waits for the 
+        //! transaction to finish.
+        //!
+        //! @return  The latest snapshot, or an empty snapshot with a 
+        //!          version of zero if none have been published.
+        //!
+        RouteSnapshotPtr routeSnapshot(void) const;
+
+        //! @brief  Returns the number of times a connector kept its
+        //!         previous route because of the performRouteCaching 
+        //!         option.
+        //!
+        //! @return  The number of route cache hits.
+        //!
+        size_t routeCacheHitCount(void) const;
+
+        //! @brief  Returns the number of times a connector that could use
+        //!         the route cache had to be searched for again.
+        //!
+        //! @return  The number of route cache misses.
+        //!
+        size_t routeCacheMissCount(void) const;
+
         //! @brief  Sets or removes penalty values that are applied during 
         //!         connector routing.
         //!
@@ -681,6 +1125,39 @@ class AVOID_EXPORT Router {
         //!
         void outputInstanceToSVG(std::string filename = std::string());
 
+        //! @brief  Writes a compact binary snapshot of the router instance
+        //!         that can be loaded by createFromInstanceSnapshot().
+        //!
+        //! The snapshot contains the routing parameters and options,
+        //! clusters, shapes and their connection pins, junctions,
+        //! connectors (including fixed routes and checkpoints) and
+        //! hyperedges registered for rerouting.  Unlike the code output
+        //! by outputInstanceToSVG(), it can be replayed without compiling
+        //! anything, so is suitable for capturing slow or problematic
+        //! instances in production.  Any topology addon is not included.
+        //!
+        //! If transactions are being used, then this method should be called
+        //! after processTransaction() has been called, so that it includes any
+        //! changes being queued by the router.
+        //!
+        //! @param[in] filename  The path of the file to write.
+        //! @return  Whether the file was written successfully.
+        //!
+        bool outputInstanceSnapshot(const std::string& filename) const;
+
+        //! @brief  Creates a new router from a snapshot written by
+        //!         outputInstanceSnapshot().
+        //!
+        //! All objects are created with their original IDs.  No routing is
+        //! performed until processTransaction() is called on the returned
+        //! router.  The caller takes ownership of the router.
+        //!
+        //! @param[in] filename  The path of the snapshot file to read.
+        //! @return  A new Router, or nullptr if the file could not be read
+        //!          or was not a valid snapshot.
+        //!
+        static Router *createFromInstanceSnapshot(const std::string& filename);
+
         //! @brief  Returns the object ID used for automatically generated 
         //!         objects, such as during hyperedge routing.
         //! 
@@ -787,6 +1264,11 @@ class AVOID_EXPORT Router {
         ShapeRef *shapeContainingPoint(const Point& point);
         void performContinuationCheck(unsigned int phaseNumber,
                 size_t stepNumber, size_t totalSteps);
+        bool isTransactionAborted(void) const;
+        // The worker threads used for the phases of routing that are
+        // performed concurrently.
+        ThreadPool& threadPool(void);
+        void markTransactionPhaseCompleted(unsigned int phaseNumber);
         void registerSettingsChange(void);
 
         /** 
@@ -819,6 +1301,10 @@ class AVOID_EXPORT Router {
     private:
         friend class ShapeRef;
         friend class ConnRef;
+        friend class EdgeInf;
+        friend class EdgeList;
+        friend class VertInf;
+        friend class AStarPathPrivate;
         friend class JunctionRef;
         friend class Obstacle;
         friend class ClusterRef;
@@ -828,6 +1314,10 @@ class AVOID_EXPORT Router {
         friend struct HyperedgeTreeNode;
         friend class HyperedgeRerouter;
         friend class HyperedgeImprover;
+        friend class RouteCache;
+        friend class TiledOrthogonalRouting;
+        friend bool updateStaticOrthogonalVisGraph(Router *router,
+                OrthogonalVisGraphSnapshot& previous);
 
         unsigned int assignId(const unsigned int suggestedId);
         void addShape(ShapeRef *shape);
@@ -847,22 +1337,58 @@ class AVOID_EXPORT Router {
         void adjustClustersWithAdd(const PolygonInterface& poly, 
                 const int p_cluster);
         void adjustClustersWithDel(const int p_cluster);
+        void indexObstacle(Obstacle *obstacle);
+        void unindexObstacle(Obstacle *obstacle);
+        void obstaclesOverlappingBox(const Box& box,
+                std::vector<Obstacle *>& obstacles);
+        void indexEdge(EdgeInf *edge);
+        void unindexEdge(EdgeInf *edge);
+        void prepareRouteSearchGraphs(void);
+        void publishRouteSnapshot(void);
         void rerouteAndCallbackConnectors(void);
+        void searchPathsInIsolation(const ConnRefSet& excludedConns,
+                std::map<ConnRef *, std::vector<VertInf *> >& searchedPaths);
         void improveCrossings(void);
 
         ActionInfoList actionList;
         unsigned int m_largest_assigned_id;
+        // The number of vertices created so far, see VertInf::creationOrder.
+        unsigned int m_vertices_created;
         bool m_consolidate_actions;
         bool m_currently_calling_destructors;
+        // Whether objects are being added by addShapes() or addConnectors().
+        bool m_bulk_loading;
         double m_routing_parameters[lastRoutingParameterMarker];
         bool m_routing_options[lastRoutingOptionMarker];
+        unsigned int m_routing_thread_count;
+        ThreadPool *m_thread_pool;
+
+        // Spatial indexes over active obstacles and the polyline visibility
+        // graph, so that changes only need to examine nearby objects.  The
+        // obstacle index is rebuilt if the shapeBufferDistance changes.
+        SpatialIndex<Obstacle> m_obstacle_index;
+        double m_obstacle_index_buffer;
+        SpatialIndex<EdgeInf> m_vis_edge_index;
+        // Invisibility graph edges, grouped by the obstacle blocking them.
+        std::map<int, EdgeInfListOrderSet> m_invis_edges_by_blocker;
         
         ConnRerouteFlagDelegate m_conn_reroute_flags;
         HyperedgeRerouter m_hyperedge_rerouter;
         
         // Progress tracking and transaction cancelling.
-        clock_t m_transaction_start_time;
+        std::chrono::steady_clock::time_point m_transaction_start_time;
         bool m_abort_transaction;
+        unsigned int m_transaction_time_limit;
+        // Bitset of the TransactionPhases completed in the last transaction.
+        unsigned int m_completed_transaction_phases;
+        // Counts of connectors that did and didn't keep their routes
+        // because of the performRouteCaching option.
+        size_t m_route_cache_hits;
+        size_t m_route_cache_misses;
+        // The latest published RouteSnapshot.  This is only accessed with
+        // std::atomic_load() and std::atomic_store(), since it is read by
+        // other threads.
+        RouteSnapshotPtr m_route_snapshot;
         
         TopologyAddonInterface *m_topology_addon;
 
@@ -871,6 +1397,9 @@ class AVOID_EXPORT Router {
         bool m_allows_orthogonal_routing;
         
         bool m_static_orthogonal_graph_invalidated;
+        // The state the orthogonal visibility graph was last generated
+        // from, for incremental updates.
+        OrthogonalVisGraphSnapshot m_orthogonal_graph_snapshot;
         bool m_in_crossing_rerouting_stage;
 
         bool m_settings_changes;
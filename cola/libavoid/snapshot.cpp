@@ -0,0 +1,227 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ *
+ * Copyright (C) 2026  agent
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * Licensees holding a valid commercial license may use this file in
+ * accordance with the commercial license agreement provided with the
+ * library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):  agent
+*/
+
+
+#include <cstring>
+
+#include "libavoid/snapshot.h"
+
+namespace Avoid {
+
+
+static const char snapshotMagic[8] = { 'L', 'I', 'B', 'A', 'V', 'O', 'I', 'D' };
+static const uint32_t snapshotByteOrderMark = 0x01020304;
+
+// Polygons, routes and lists of checkpoints with more points than this are
+// assumed to be the result of a corrupt file, rather than allocating a 
+// huge amount of memory for them.
+static const uint32_t maxSnapshotPointCount = 1 << 24;
+
+
+SnapshotWriter::SnapshotWriter(const std::string& filename)
+    : m_file(fopen(filename.c_str(), "wb")),
+      m_good(m_file != nullptr)
+{
+    write(snapshotMagic, sizeof(snapshotMagic));
+    writeUInt(snapshotByteOrderMark);
+    writeUInt(snapshotFormatVersion);
+}
+
+
+SnapshotWriter::~SnapshotWriter()
+{
+    close();
+}
+
+
+bool SnapshotWriter::good(void) const
+{
+    return m_good;
+}
+
+
+bool SnapshotWriter::close(void)
+{
+    if (m_file)
+    {
+        if (fclose(m_file) != 0)
+        {
+            m_good = false;
+        }
+        m_file = nullptr;
+    }
+    return m_good;
+}
+
+
+void SnapshotWriter::write(const void *data, const size_t size)
+{
+    if (m_good && (fwrite(data, size, 1, m_file) != 1))
+    {
+        m_good = false;
+    }
+}
+
+
+void SnapshotWriter::writeUInt(const uint32_t value)
+{
+    write(&value, sizeof(value));
+}
+
+
+void SnapshotWriter::writeBool(const bool value)
+{
+    unsigned char byte = (value) ? 1 : 0;
+    write(&byte, sizeof(byte));
+}
+
+
+void SnapshotWriter::writeDouble(const double value)
+{
+    write(&value, sizeof(value));
+}
+
+
+void SnapshotWriter::writePoint(const Point& point)
+{
+    writeDouble(point.x);
+    writeDouble(point.y);
+}
+
+
+void SnapshotWriter::writePolygon(const PolygonInterface& poly)
+{
+    writeUInt((uint32_t) poly.size());
+    for (size_t i = 0; i < poly.size(); ++i)
+    {
+        writePoint(poly.at(i));
+    }
+}
+
+
+SnapshotReader::SnapshotReader(const std::string& filename)
+    : m_file(fopen(filename.c_str(), "rb")),
+      m_good(m_file != nullptr)
+{
+    char magic[sizeof(snapshotMagic)];
+    read(magic, sizeof(magic));
+    if (m_good && (memcmp(magic, snapshotMagic, sizeof(magic)) != 0))
+    {
+        m_good = false;
+    }
+    if (readUInt() != snapshotByteOrderMark)
+    {
+        // Not written by this libavoid, or on a machine with a different
+        // byte order.
+        m_good = false;
+    }
+    if (readUInt() != snapshotFormatVersion)
+    {
+        m_good = false;
+    }
+}
+
+
+SnapshotReader::~SnapshotReader()
+{
+    if (m_file)
+    {
+        fclose(m_file);
+    }
+}
+
+
+bool SnapshotReader::good(void) const
+{
+    return m_good;
+}
+
+
+void SnapshotReader::read(void *data, const size_t size)
+{
+    if (!m_good || (fread(data, size, 1, m_file) != 1))
+    {
+        m_good = false;
+        memset(data, 0, size);
+    }
+}
+
+
+uint32_t SnapshotReader::readUInt(void)
+{
+    uint32_t value;
+    read(&value, sizeof(value));
+    return value;
+}
+
+
+bool SnapshotReader::readBool(void)
+{
+    unsigned char byte;
+    read(&byte, sizeof(byte));
+    return (byte != 0);
+}
+
+
+double SnapshotReader::readDouble(void)
+{
+    double value;
+    read(&value, sizeof(value));
+    return value;
+}
+
+
+Point SnapshotReader::readPoint(void)
+{
+    double x = readDouble();
+    double y = readDouble();
+    return Point(x, y);
+}
+
+
+uint32_t SnapshotReader::readPointCount(void)
+{
+    uint32_t count = readUInt();
+    if (count > maxSnapshotPointCount)
+    {
+        m_good = false;
+        count = 0;
+    }
+    return count;
+}
+
+
+Polygon SnapshotReader::readPolygon(void)
+{
+    Polygon poly(readPointCount());
+    for (size_t i = 0; i < poly.size(); ++i)
+    {
+        poly.ps[i] = readPoint();
+    }
+    return poly;
+}
+
+
+}
+
@@ -0,0 +1,108 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ *
+ * Copyright (C) 2026  agent
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * Licensees holding a valid commercial license may use this file in
+ * accordance with the commercial license agreement provided with the
+ * library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):  agent
+*/
+
+// Low-level reading and writing of router instance snapshots, the compact
+// binary alternative to the C++ code embedded by outputInstanceToSVG().
+//
+// A snapshot starts with a fixed header, followed by a sequence of 
+// fixed-width values in the byte order of the machine that wrote it.
+// The header records that byte order, and snapshots written on a machine
+// with a different byte order are rejected on load.
+
+
+#ifndef AVOID_SNAPSHOT_H
+#define AVOID_SNAPSHOT_H
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+
+#include "libavoid/geomtypes.h"
+
+
+namespace Avoid {
+
+// The version of the snapshot format.  Increment this whenever the 
+// layout of the snapshot changes.
+static const uint32_t snapshotFormatVersion = 1;
+
+
+class SnapshotWriter
+{
+    public:
+        SnapshotWriter(const std::string& filename);
+        ~SnapshotWriter();
+
+        // Returns false if the file could not be opened or any write 
+        // has failed.
+        bool good(void) const;
+        // Closes the file, returning whether everything was written.
+        bool close(void);
+
+        void writeUInt(const uint32_t value);
+        void writeBool(const bool value);
+        void writeDouble(const double value);
+        void writePoint(const Point& point);
+        void writePolygon(const PolygonInterface& poly);
+
+    private:
+        void write(const void *data, const size_t size);
+
+        FILE *m_file;
+        bool m_good;
+};
+
+
+class SnapshotReader
+{
+    public:
+        SnapshotReader(const std::string& filename);
+        ~SnapshotReader();
+
+        // Returns false if the file could not be opened, it was not a
+        // valid snapshot, or any read has failed.  Once false, all 
+        // further reads return zero values.
+        bool good(void) const;
+
+        uint32_t readUInt(void);
+        bool readBool(void);
+        double readDouble(void);
+        Point readPoint(void);
+        // Reads the number of points in a polygon, route or list of 
+        // checkpoints.  A count too large to be from a valid snapshot
+        // fails the read and gives zero.
+        uint32_t readPointCount(void);
+        Polygon readPolygon(void);
+
+    private:
+        void read(void *data, const size_t size);
+
+        FILE *m_file;
+        bool m_good;
+};
+
+
+}
+
+#endif
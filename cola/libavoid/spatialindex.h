@@ -0,0 +1,378 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ *
+ * Copyright (C) 2026  agent
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * Licensees holding a valid commercial license may use this file in
+ * accordance with the commercial license agreement provided with the
+ * library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):  agent
+*/
+
+// A spatial index for router objects, keyed on their bounding boxes.
+//
+// Objects are stored in a hierarchy of uniform grids.  Each object is
+// placed in the grid level whose cell size is the smallest power of two
+// that is larger than the object, so it will only ever occupy between one
+// and four cells of that level.  This means the index needs no tuning
+// for the scale of the diagram and long objects (such as polyline
+// visibility edges) don't get copied into many cells.  Objects too large
+// for this, whose size overflows or isn't a number, are kept in a 
+// separate list that every query checks.
+//
+// The index is maintained incrementally by the router as objects are
+// added, moved and removed.  Queries return candidates whose bounding box
+// overlaps the query box, so callers still need to perform exact tests.
+
+
+#ifndef AVOID_SPATIALINDEX_H
+#define AVOID_SPATIALINDEX_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "libavoid/geomtypes.h"
+#include "libavoid/assertions.h"
+
+
+namespace Avoid {
+
+
+template <typename T>
+class SpatialIndex
+{
+    public:
+        SpatialIndex()
+            : m_query_stamp(0)
+        {
+        }
+
+        // Adds the item to the index with the given bounding box.  If the
+        // item is already present its bounding box is updated.
+        void insert(T *item, const Box& bbox)
+        {
+            typename EntryMap::iterator found = m_entries.find(item);
+            if (found != m_entries.end())
+            {
+                removeFromCells(found->second);
+            }
+            else
+            {
+                found = m_entries.insert(
+                        std::make_pair(item, Entry())).first;
+            }
+            Entry& entry = found->second;
+            entry.item = item;
+            entry.bbox = bbox;
+            entry.stamp = m_query_stamp;
+            entry.level = levelForBox(bbox);
+            entry.overflow = !isFinite(bbox);
+            if (!entry.overflow)
+            {
+                cellRange(bbox, entry.level, entry.min, entry.max);
+                entry.overflow = (entry.max.x - entry.min.x > 1) ||
+                        (entry.max.y - entry.min.y > 1);
+            }
+            addToCells(entry);
+        }
+
+        // Removes the item from the index, if present.
+        void remove(T *item)
+        {
+            typename EntryMap::iterator found = m_entries.find(item);
+            if (found == m_entries.end())
+            {
+                return;
+            }
+            removeFromCells(found->second);
+            m_entries.erase(found);
+        }
+
+        bool contains(T *item) const
+        {
+            return (m_entries.find(item) != m_entries.end());
+        }
+
+        size_t size(void) const
+        {
+            return m_entries.size();
+        }
+
+        void clear(void)
+        {
+            m_entries.clear();
+            m_cells.clear();
+            m_level_sizes.clear();
+            m_overflow.clear();
+        }
+
+        // Appends to results every item whose bounding box overlaps or
+        // touches the given box.  Each item is reported once, in no
+        // particular order.
+        void query(const Box& box, std::vector<T *>& results) const
+        {
+            ++m_query_stamp;
+
+            // Work out how many cells would be visited.  If this is more
+            // than the number of items, or the box is too large to work
+            // this out, then just check them all directly.
+            bool checkAll = !isFinite(box);
+            double cellCount = 0;
+            for (LevelSizeMap::const_iterator level = m_level_sizes.begin();
+                    !checkAll && (level != m_level_sizes.end()); ++level)
+            {
+                CellCoord min, max;
+                cellRange(box, level->first, min, max);
+                cellCount += ((double) (max.x - min.x) + 1) *
+                        ((double) (max.y - min.y) + 1);
+            }
+
+            if (checkAll || (cellCount > m_entries.size()))
+            {
+                for (typename EntryMap::const_iterator it = m_entries.begin();
+                        it != m_entries.end(); ++it)
+                {
+                    if (boxesOverlap(it->second.bbox, box))
+                    {
+                        results.push_back(it->second.item);
+                    }
+                }
+                return;
+            }
+
+            for (size_t i = 0; i < m_overflow.size(); ++i)
+            {
+                const Entry *entry = m_overflow[i];
+                if (boxesOverlap(entry->bbox, box))
+                {
+                    entry->stamp = m_query_stamp;
+                    results.push_back(entry->item);
+                }
+            }
+            for (LevelSizeMap::const_iterator level = m_level_sizes.begin();
+                    level != m_level_sizes.end(); ++level)
+            {
+                CellCoord min, max;
+                cellRange(box, level->first, min, max);
+                for (long long x = min.x; x <= max.x; ++x)
+                {
+                    for (long long y = min.y; y <= max.y; ++y)
+                    {
+                        CellKey key(level->first, x, y);
+                        typename CellMap::const_iterator cell =
+                                m_cells.find(key);
+                        if (cell == m_cells.end())
+                        {
+                            continue;
+                        }
+                        const EntryPtrList& entries = cell->second;
+                        for (size_t i = 0; i < entries.size(); ++i)
+                        {
+                            const Entry *entry = entries[i];
+                            if ((entry->stamp != m_query_stamp) &&
+                                    boxesOverlap(entry->bbox, box))
+                            {
+                                entry->stamp = m_query_stamp;
+                                results.push_back(entry->item);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+    private:
+        // Objects smaller than this are treated as being this size.  This
+        // keeps cell coordinates within a sensible range.
+        enum { minLevel = -16, maxLevel = 1000 };
+
+        struct CellCoord
+        {
+            long long x;
+            long long y;
+        };
+        struct Entry
+        {
+            T *item;
+            Box bbox;
+            int level;
+            CellCoord min;
+            CellCoord max;
+            // Whether the entry is in the overflow list rather than cells.
+            bool overflow;
+            mutable unsigned int stamp;
+        };
+        struct CellKey
+        {
+            CellKey(const int l, const long long cx, const long long cy)
+                : level(l),
+                  x(cx),
+                  y(cy)
+            {
+            }
+            bool operator==(const CellKey& rhs) const
+            {
+                return (level == rhs.level) && (x == rhs.x) && (y == rhs.y);
+            }
+            int level;
+            long long x;
+            long long y;
+        };
+        struct CellKeyHash
+        {
+            size_t operator()(const CellKey& key) const
+            {
+                size_t hash = (size_t) key.x * 73856093u;
+                hash ^= (size_t) key.y * 19349663u;
+                hash ^= (size_t) key.level * 83492791u;
+                return hash;
+            }
+        };
+        typedef std::unordered_map<T *, Entry> EntryMap;
+        typedef std::vector<const Entry *> EntryPtrList;
+        typedef std::unordered_map<CellKey, EntryPtrList, CellKeyHash> CellMap;
+        typedef std::map<int, size_t> LevelSizeMap;
+
+        static bool boxesOverlap(const Box& a, const Box& b)
+        {
+            return (a.min.x <= b.max.x) && (b.min.x <= a.max.x) &&
+                    (a.min.y <= b.max.y) && (b.min.y <= a.max.y);
+        }
+
+        static bool isFinite(const Box& bbox)
+        {
+            double size = std::max(bbox.max.x - bbox.min.x,
+                    bbox.max.y - bbox.min.y);
+            return std::isfinite(size) && std::isfinite(bbox.min.x) &&
+                    std::isfinite(bbox.min.y);
+        }
+
+        static int levelForBox(const Box& bbox)
+        {
+            double size = std::max(bbox.max.x - bbox.min.x,
+                    bbox.max.y - bbox.min.y);
+            if (!(size < HUGE_VAL))
+            {
+                return maxLevel;
+            }
+            int exponent = minLevel;
+            if (size > 0)
+            {
+                // size < 2^exponent.
+                std::frexp(size, &exponent);
+            }
+            if (exponent < minLevel)
+            {
+                return minLevel;
+            }
+            return (exponent > maxLevel) ? (int) maxLevel : exponent;
+        }
+
+        static long long cellIndex(const double value, const int level)
+        {
+            // Clamp so conversion to an integer is always well defined.
+            const double limit = 4.0e18;
+            double index = std::floor(std::ldexp(value, -level));
+            index = std::min(std::max(index, -limit), limit);
+            return (long long) index;
+        }
+
+        static void cellRange(const Box& bbox, const int level,
+                CellCoord& min, CellCoord& max)
+        {
+            min.x = cellIndex(bbox.min.x, level);
+            min.y = cellIndex(bbox.min.y, level);
+            max.x = cellIndex(bbox.max.x, level);
+            max.y = cellIndex(bbox.max.y, level);
+        }
+
+        void addToCells(const Entry& entry)
+        {
+            if (entry.overflow)
+            {
+                m_overflow.push_back(&entry);
+                return;
+            }
+            for (long long x = entry.min.x; x <= entry.max.x; ++x)
+            {
+                for (long long y = entry.min.y; y <= entry.max.y; ++y)
+                {
+                    m_cells[CellKey(entry.level, x, y)].push_back(&entry);
+                }
+            }
+            ++m_level_sizes[entry.level];
+        }
+
+        void removeFromCells(const Entry& entry)
+        {
+            if (entry.overflow)
+            {
+                typename EntryPtrList::iterator found = std::find(
+                        m_overflow.begin(), m_overflow.end(), &entry);
+                COLA_ASSERT(found != m_overflow.end());
+                *found = m_overflow.back();
+                m_overflow.pop_back();
+                return;
+            }
+            for (long long x = entry.min.x; x <= entry.max.x; ++x)
+            {
+                for (long long y = entry.min.y; y <= entry.max.y; ++y)
+                {
+                    typename CellMap::iterator cell =
+                            m_cells.find(CellKey(entry.level, x, y));
+                    COLA_ASSERT(cell != m_cells.end());
+                    EntryPtrList& entries = cell->second;
+                    for (size_t i = 0; i < entries.size(); ++i)
+                    {
+                        if (entries[i] == &entry)
+                        {
+                            entries[i] = entries.back();
+                            entries.pop_back();
+                            break;
+                        }
+                    }
+                    if (entries.empty())
+                    {
+                        m_cells.erase(cell);
+                    }
+                }
+            }
+            LevelSizeMap::iterator levelSize = m_level_sizes.find(entry.level);
+            COLA_ASSERT(levelSize != m_level_sizes.end());
+            if (--(levelSize->second) == 0)
+            {
+                m_level_sizes.erase(levelSize);
+            }
+        }
+
+        // Entries are stable in memory while in the map, so the cells
+        // can refer to them directly.
+        EntryMap m_entries;
+        CellMap m_cells;
+        LevelSizeMap m_level_sizes;
+        // Entries too large to be stored in the cells.
+        EntryPtrList m_overflow;
+        mutable unsigned int m_query_stamp;
+};
+
+
+}
+
+#endif
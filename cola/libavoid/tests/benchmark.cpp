@@ -0,0 +1,251 @@
+// Times routing of router instance snapshots, such as those captured by
+// the heavy regression tests, and compares against a stored baseline.
+//
+// Usage: benchmark [-n repeats] [-o baselineToWrite] [-b baselineToCompare]
+//                  [-t tolerancePercent] snapshot...
+//
+// Each snapshot is loaded and routed from scratch the given number of
+// times with profiling enabled.  The median time of each phase is 
+// reported, along with the peak memory used by the router's pools.  The
+// peak resident size of the process covers the whole run, so it is only
+// reported once, after all the instances.  When comparing against a baseline,
+// phases more than the tolerance slower than the baseline (and by more
+// than a millisecond, to ignore noise in short phases) are reported as
+// regressions and the program exits with a non-zero status.
+//
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#include "libavoid/libavoid.h"
+using namespace Avoid;
+
+// Results for an instance, keyed by "instance metric".
+typedef std::map<std::string, double> Results;
+
+static double median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    size_t mid = values.size() / 2;
+    return (values.size() % 2) ? values[mid] : 
+            (0.5 * (values[mid - 1] + values[mid]));
+}
+
+static std::string instanceName(const std::string& filename)
+{
+    size_t start = filename.find_last_of("/\\");
+    start = (start == std::string::npos) ? 0 : start + 1;
+    size_t end = filename.find('.', start);
+    return filename.substr(start, end - start);
+}
+
+static double poolPeakKB(const MemoryPoolStatistics& stats)
+{
+    return (stats.peakLiveObjects * stats.objectSize) / 1024.0;
+}
+
+static double processPeakKB(void)
+{
+#ifndef _WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1024.0;
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return 0;
+}
+
+static bool benchmarkInstance(const std::string& filename, 
+        const unsigned int repeats, Results& results)
+{
+    const std::string name = instanceName(filename);
+    std::vector<std::vector<double> > phaseTimes(tmCount);
+    std::vector<bool> performed(tmCount, false);
+    double poolKB = 0;
+    for (unsigned int r = 0; r < repeats; ++r)
+    {
+        Router *router = Router::createFromInstanceSnapshot(filename);
+        if (router == nullptr)
+        {
+            fprintf(stderr, "Error: could not load snapshot %s\n", 
+                    filename.c_str());
+            return false;
+        }
+        router->setProfilingEnabled(true);
+        router->processTransaction();
+
+        const RouterProfile& profile = router->lastTransactionProfile();
+        for (size_t p = 0; p < tmCount; ++p)
+        {
+            phaseTimes[p].push_back(profile.phaseTime[p]);
+            performed[p] = performed[p] || (profile.phaseCount[p] > 0);
+        }
+        RouterAllocatorStatistics stats = router->allocatorStatistics();
+        poolKB = std::max(poolKB, poolPeakKB(stats.vertices) + 
+                poolPeakKB(stats.orthogonalVertices) + 
+                poolPeakKB(stats.edges) + poolPeakKB(stats.orthogonalEdges) +
+                poolPeakKB(stats.searchNodeBlocks));
+        delete router;
+    }
+
+    printf("%s (%u runs)\n", name.c_str(), repeats);
+    for (size_t p = 0; p < tmCount; ++p)
+    {
+        if (!performed[p])
+        {
+            continue;
+        }
+        const char *phase = timerIndexName((TimerIndex) p);
+        double time = median(phaseTimes[p]);
+        printf("    %-20s %10.2f ms  (min %.2f, max %.2f)\n", phase, time,
+                *std::min_element(phaseTimes[p].begin(), phaseTimes[p].end()),
+                *std::max_element(phaseTimes[p].begin(), phaseTimes[p].end()));
+        results[name + " " + phase] = time;
+    }
+    printf("    %-20s %10.0f KB\n", "PoolPeak", poolKB);
+    results[name + " PoolPeakKB"] = poolKB;
+    return true;
+}
+
+static bool readBaseline(const char *filename, Results& baseline)
+{
+    FILE *fp = fopen(filename, "r");
+    if (fp == nullptr)
+    {
+        return false;
+    }
+    char name[256], metric[256];
+    double value;
+    while (fscanf(fp, "%255s %255s %lf", name, metric, &value) == 3)
+    {
+        baseline[std::string(name) + " " + metric] = value;
+    }
+    fclose(fp);
+    return true;
+}
+
+static bool writeBaseline(const char *filename, const Results& results)
+{
+    FILE *fp = fopen(filename, "w");
+    if (fp == nullptr)
+    {
+        return false;
+    }
+    for (Results::const_iterator it = results.begin(); 
+            it != results.end(); ++it)
+    {
+        fprintf(fp, "%s %.3f\n", it->first.c_str(), it->second);
+    }
+    return (fclose(fp) == 0);
+}
+
+// Prints the comparison and returns the number of regressions.
+static int compareWithBaseline(const Results& results, 
+        const Results& baseline, const double tolerance)
+{
+    int regressions = 0;
+    printf("\nComparison with baseline:\n");
+    for (Results::const_iterator it = results.begin(); 
+            it != results.end(); ++it)
+    {
+        Results::const_iterator base = baseline.find(it->first);
+        if (base == baseline.end())
+        {
+            continue;
+        }
+        double change = (base->second > 0) ? 
+                (100.0 * (it->second - base->second) / base->second) : 0;
+        bool isTime = (it->first.find("KB") == std::string::npos);
+        bool regressed = (change > tolerance) && 
+                (!isTime || ((it->second - base->second) > 1.0));
+        printf("    %-40s %10.2f -> %10.2f  %+7.1f%%%s\n", it->first.c_str(),
+                base->second, it->second, change, 
+                (regressed) ? "  REGRESSION" : "");
+        if (regressed)
+        {
+            ++regressions;
+        }
+    }
+    return regressions;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int repeats = 5;
+    const char *saveBaseline = nullptr;
+    const char *compareBaseline = nullptr;
+    double tolerance = 10;
+    std::vector<std::string> snapshots;
+    for (int i = 1; i < argc; ++i)
+    {
+        bool hasValue = (i + 1 < argc);
+        if ((strcmp(argv[i], "-n") == 0) && hasValue)
+        {
+            repeats = std::max(atoi(argv[++i]), 1);
+        }
+        else if ((strcmp(argv[i], "-o") == 0) && hasValue)
+        {
+            saveBaseline = argv[++i];
+        }
+        else if ((strcmp(argv[i], "-b") == 0) && hasValue)
+        {
+            compareBaseline = argv[++i];
+        }
+        else if ((strcmp(argv[i], "-t") == 0) && hasValue)
+        {
+            tolerance = atof(argv[++i]);
+        }
+        else
+        {
+            snapshots.push_back(argv[i]);
+        }
+    }
+    if (snapshots.empty())
+    {
+        fprintf(stderr, "Usage: %s [-n repeats] [-o baselineToWrite] "
+                "[-b baselineToCompare] [-t tolerancePercent] snapshot...\n",
+                argv[0]);
+        return 1;
+    }
+
+    Results results;
+    for (size_t i = 0; i < snapshots.size(); ++i)
+    {
+        if (!benchmarkInstance(snapshots[i], repeats, results))
+        {
+            return 1;
+        }
+    }
+    printf("\nProcess peak resident size: %.0f KB\n", processPeakKB());
+
+    if (saveBaseline && !writeBaseline(saveBaseline, results))
+    {
+        fprintf(stderr, "Error: could not write baseline %s\n", saveBaseline);
+        return 1;
+    }
+
+    int regressions = 0;
+    if (compareBaseline)
+    {
+        Results baseline;
+        if (!readBaseline(compareBaseline, baseline))
+        {
+            fprintf(stderr, "Error: could not read baseline %s\n", 
+                    compareBaseline);
+            return 1;
+        }
+        regressions = compareWithBaseline(results, baseline, tolerance);
+    }
+    return (regressions > 0) ? 1 : 0;
+}
@@ -0,0 +1,112 @@
+// Checks that adding shapes and connectors with Router::addShapes() and
+// Router::addConnectors() gives the same visibility graph and routes as 
+// constructing each ShapeRef and ConnRef in turn, both with and without
+// transactions.
+//
+#include <cmath>
+#include "libavoid/libavoid.h"
+#include "gridDiagram.h"
+using namespace Avoid;
+
+static void diagram(std::vector<Polygon>& polygons,
+        std::vector<std::pair<size_t, size_t> >& links)
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        for (int j = 0; j < 8; ++j)
+        {
+            polygons.push_back(staggeredGridRectangle(i, j, 80, 45, 30));
+        }
+    }
+
+    PseudoRandom random(2468);
+    for (int c = 0; c < 60; ++c)
+    {
+        size_t a = random.next(polygons.size());
+        size_t b = random.next(polygons.size());
+        if (a != b)
+        {
+            links.push_back(std::make_pair(a, b));
+        }
+    }
+}
+
+static Router *createRouter(const bool bulk, const bool transactions)
+{
+    std::vector<Polygon> polygons;
+    std::vector<std::pair<size_t, size_t> > links;
+    diagram(polygons, links);
+
+    Router *router = new Router(PolyLineRouting);
+    router->setTransactionUse(transactions);
+    std::vector<ShapeRef *> shapes;
+    if (bulk)
+    {
+        shapes = router->addShapes(polygons);
+    }
+    else
+    {
+        for (size_t i = 0; i < polygons.size(); ++i)
+        {
+            shapes.push_back(new ShapeRef(router, polygons[i]));
+        }
+    }
+
+    std::vector<std::pair<ConnEnd, ConnEnd> > endpoints;
+    for (size_t i = 0; i < links.size(); ++i)
+    {
+        endpoints.push_back(std::make_pair(
+                ConnEnd(shapes[links[i].first]->position()),
+                ConnEnd(shapes[links[i].second]->position())));
+    }
+    if (bulk)
+    {
+        router->addConnectors(endpoints);
+    }
+    else
+    {
+        for (size_t i = 0; i < endpoints.size(); ++i)
+        {
+            new ConnRef(router, endpoints[i].first, endpoints[i].second);
+        }
+    }
+    router->processTransaction();
+    return router;
+}
+
+static bool sameResults(Router *router1, Router *router2)
+{
+    if ((router1->visGraph.size() != router2->visGraph.size()) ||
+            (router1->invisGraph.size() != router2->invisGraph.size()) ||
+            (router1->connRefs.size() != router2->connRefs.size()))
+    {
+        return false;
+    }
+    ConnRefList::const_iterator c1 = router1->connRefs.begin();
+    ConnRefList::const_iterator c2 = router2->connRefs.begin();
+    for (; c1 != router1->connRefs.end(); ++c1, ++c2)
+    {
+        if (fabs(routeLength((*c1)->displayRoute()) - 
+                routeLength((*c2)->displayRoute())) > 0.0001)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(void)
+{
+    Router *single = createRouter(false, true);
+    Router *bulk = createRouter(true, true);
+    Router *bulkImmediate = createRouter(true, false);
+
+    bool same = sameResults(single, bulk) && 
+            sameResults(single, bulkImmediate);
+
+    bulk->outputDiagram("output/bulkLoad01");
+    delete single;
+    delete bulk;
+    delete bulkImmediate;
+    return (same) ? 0 : 1;
+}
@@ -5236,6 +5236,7 @@ int main(void) {
 
     router->processTransaction();
     router->outputDiagram("output/checkpointNudging3");
+    router->outputInstanceSnapshot("output/checkpointNudging3.snapshot");
     bool overlap = router->existsOrthogonalSegmentOverlap();
     delete router;
     return (overlap) ? 1 : 0;
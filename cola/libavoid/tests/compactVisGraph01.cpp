@@ -0,0 +1,58 @@
+// Checks that routing connectors with the performRouteSearchOnCompactVisGraph
+// option gives routes of the same cost as searching the visibility graph
+// edge lists.
+//
+#include "libavoid/libavoid.h"
+#include "gridDiagram.h"
+using namespace Avoid;
+
+static Router *createRouter(const bool compact)
+{
+    Router *router = new Router(PolyLineRouting | OrthogonalRouting);
+    router->setRoutingParameter(segmentPenalty, 50);
+    router->setRoutingParameter(shapeBufferDistance, 4);
+    router->setRoutingOption(performRouteSearchOnCompactVisGraph, compact);
+
+    std::vector<ShapeRef *> shapes = addShapeGrid(router, 8, 100, true);
+    std::vector<ConnRef *> conns = 
+            addGridConnectors(router, shapes, 120, 12345);
+    for (size_t c = 0; c < conns.size(); ++c)
+    {
+        conns[c]->setRoutingType((c % 3 == 0) ? ConnType_PolyLine :
+                ConnType_Orthogonal);
+    }
+    router->processTransaction();
+
+    // Move some shapes and reroute.
+    for (size_t s = 0; s < shapes.size(); s += 7)
+    {
+        router->moveShape(shapes[s], 13, 17);
+    }
+    router->processTransaction();
+    return router;
+}
+
+int main(void)
+{
+    Router *standard = createRouter(false);
+    Router *compact = createRouter(true);
+
+    // Ties may be broken differently, but the routes should cost the same.
+    bool same = (standard->connRefs.size() == compact->connRefs.size());
+    double segmentCost = standard->routingParameter(segmentPenalty);
+    ConnRefList::const_iterator s = standard->connRefs.begin();
+    ConnRefList::const_iterator c = compact->connRefs.begin();
+    for (; same && (s != standard->connRefs.end()); ++s, ++c)
+    {
+        if (fabs(routeCost((*s)->route(), segmentCost) -
+                routeCost((*c)->route(), segmentCost)) > 0.0001)
+        {
+            same = false;
+        }
+    }
+
+    compact->outputDiagram("output/compactVisGraph01");
+    delete standard;
+    delete compact;
+    return (same) ? 0 : 1;
+}
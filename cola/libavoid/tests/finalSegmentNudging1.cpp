@@ -5218,6 +5218,7 @@ int main(void) {
 
     router->processTransaction();
     router->outputDiagram("output/finalSegmentNudging1");
+    router->outputInstanceSnapshot("output/finalSegmentNudging1.snapshot");
 
     bool optimisedForConnectorType = true;
     int crossings = router->existsCrossings(optimisedForConnectorType);
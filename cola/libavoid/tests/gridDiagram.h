@@ -0,0 +1,186 @@
+// Helpers for the tests that build a diagram from a grid of shapes joined
+// by connectors between pseudo-randomly chosen shapes, and compare the
+// results of routing it with and without a routing option.
+//
+#ifndef AVOID_TESTS_GRIDDIAGRAM_H
+#define AVOID_TESTS_GRIDDIAGRAM_H
+
+#include <cmath>
+#include <vector>
+
+#include "libavoid/libavoid.h"
+
+
+// A simple deterministic pseudo-random sequence.
+class PseudoRandom
+{
+    public:
+        PseudoRandom(const unsigned int seed)
+            : m_seed(seed)
+        {
+        }
+        // Returns the next number in the sequence, less than n.
+        size_t next(const size_t n)
+        {
+            m_seed = m_seed * 1103515245 + 12345;
+            return (m_seed >> 8) % n;
+        }
+    private:
+        unsigned int m_seed;
+};
+
+
+// Adds a gridSize by gridSize grid of 40 by 30 shapes.  If pins is true,
+// each shape is given a shared connection pin, with class id 1, at the
+// centre of its top side.
+static inline std::vector<Avoid::ShapeRef *> addShapeGrid(
+        Avoid::Router *router, const int gridSize, const double spacing,
+        const bool pins = false)
+{
+    std::vector<Avoid::ShapeRef *> shapes;
+    for (int i = 0; i < gridSize; ++i)
+    {
+        for (int j = 0; j < gridSize; ++j)
+        {
+            Avoid::Rectangle rect(Avoid::Point(i * spacing, j * spacing),
+                    Avoid::Point(i * spacing + 40, j * spacing + 30));
+            Avoid::ShapeRef *shape = new Avoid::ShapeRef(router, rect);
+            if (pins)
+            {
+                Avoid::ShapeConnectionPin *pin =
+                        new Avoid::ShapeConnectionPin(shape, 1,
+                            Avoid::ATTACH_POS_CENTRE, Avoid::ATTACH_POS_TOP,
+                            true, 0, Avoid::ConnDirUp);
+                pin->setExclusive(false);
+            }
+            shapes.push_back(shape);
+        }
+    }
+    return shapes;
+}
+
+
+// Adds a gridSize by gridSize grid of 45 by 35 shapes, with each diagonal
+// of the grid offset to the right by a different amount.
+static inline std::vector<Avoid::ShapeRef *> addOffsetShapeGrid(
+        Avoid::Router *router, const int gridSize, const double spacing)
+{
+    std::vector<Avoid::ShapeRef *> shapes;
+    for (int i = 0; i < gridSize; ++i)
+    {
+        for (int j = 0; j < gridSize; ++j)
+        {
+            double offset = ((i + j) % 3) * 17;
+            Avoid::Rectangle rect(
+                    Avoid::Point(i * spacing + offset, j * spacing + 5),
+                    Avoid::Point(i * spacing + offset + 45, j * spacing + 40));
+            shapes.push_back(new Avoid::ShapeRef(router, rect));
+        }
+    }
+    return shapes;
+}
+
+
+// Returns the shape at column i and row j of a grid where the shapes are
+// staggered so some overlap their neighbours, and their sizes are varied
+// from width by height so their edges aren't exactly aligned.
+static inline Avoid::Rectangle staggeredGridRectangle(const int i,
+        const int j, const double spacing, const double width,
+        const double height)
+{
+    double offset = ((i + j) % 3) * 25;
+    double jitterX = ((i * 7 + j * 13) % 11) * 1.37;
+    double jitterY = ((i * 5 + j * 3) % 7) * 1.91;
+    return Avoid::Rectangle(
+            Avoid::Point(i * spacing + offset + jitterX,
+                    j * spacing + jitterY),
+            Avoid::Point(i * spacing + offset + width + jitterY,
+                    j * spacing + height + jitterX));
+}
+
+
+// Adds up to count connectors between pseudo-random pairs of the shapes
+// from addShapeGrid(), leaving from below each shape's centre.  Every
+// fifth connector is attached to the connection pin of its destination
+// shape instead.
+static inline std::vector<Avoid::ConnRef *> addGridConnectors(
+        Avoid::Router *router, const std::vector<Avoid::ShapeRef *>& shapes,
+        const int count, const unsigned int seed)
+{
+    std::vector<Avoid::ConnRef *> conns;
+    PseudoRandom random(seed);
+    for (int c = 0; c < count; ++c)
+    {
+        size_t a = random.next(shapes.size());
+        size_t b = random.next(shapes.size());
+        if (a == b)
+        {
+            continue;
+        }
+
+        Avoid::ConnEnd srcEnd(shapes[a]->position() + Avoid::Point(0, 20),
+                Avoid::ConnDirDown);
+        Avoid::ConnEnd dstEnd(shapes[b]->position() + Avoid::Point(0, 20),
+                Avoid::ConnDirDown);
+        if (c % 5 == 0)
+        {
+            dstEnd = Avoid::ConnEnd(shapes[b], 1);
+        }
+        conns.push_back(new Avoid::ConnRef(router, srcEnd, dstEnd));
+    }
+    return conns;
+}
+
+
+// Returns the length of the route.
+static inline double routeLength(const Avoid::PolyLine& route)
+{
+    double length = 0;
+    for (size_t i = 1; i < route.size(); ++i)
+    {
+        length += Avoid::euclideanDist(route.ps[i - 1], route.ps[i]);
+    }
+    return length;
+}
+
+
+// Returns the cost of the route, as its length plus segmentCost for each
+// bend.
+static inline double routeCost(const Avoid::PolyLine& route,
+        const double segmentCost)
+{
+    double cost = routeLength(route);
+    for (size_t i = 2; i < route.size(); ++i)
+    {
+        if (Avoid::vecDir(route.ps[i - 2], route.ps[i - 1],
+                route.ps[i]) != 0)
+        {
+            cost += segmentCost;
+        }
+    }
+    return cost;
+}
+
+
+// Returns whether the connectors of the two routers have exactly the same
+// display routes.
+static inline bool sameRoutes(Avoid::Router *router1, Avoid::Router *router2)
+{
+    if (router1->connRefs.size() != router2->connRefs.size())
+    {
+        return false;
+    }
+    Avoid::ConnRefList::const_iterator c1 = router1->connRefs.begin();
+    Avoid::ConnRefList::const_iterator c2 = router2->connRefs.begin();
+    for (; c1 != router1->connRefs.end(); ++c1, ++c2)
+    {
+        if ((*c1)->displayRoute().ps != (*c2)->displayRoute().ps)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+#endif
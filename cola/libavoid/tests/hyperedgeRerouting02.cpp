@@ -0,0 +1,70 @@
+// Reroutes a single hyperedge that joins the centres of a large grid of
+// shapes, to check that the minimum terminal spanning tree construction
+// copes with hundreds of terminals.
+//
+#include "libavoid/libavoid.h"
+using namespace Avoid;
+
+static const int gridSize = 12;
+static const double spacing = 90;
+
+int main(void)
+{
+    Router *router = new Router(OrthogonalRouting);
+    router->setRoutingPenalty(segmentPenalty, 50);
+    router->setRoutingParameter(idealNudgingDistance, 10);
+
+    std::vector<ShapeRef *> shapes;
+    for (int i = 0; i < gridSize; ++i)
+    {
+        for (int j = 0; j < gridSize; ++j)
+        {
+            // Vary the sizes, so the shape edges aren't all aligned.
+            double width = 30 + ((i * 7 + j * 3) % 5) * 4;
+            double height = 20 + ((i * 3 + j * 5) % 4) * 6;
+            Point topLeft(i * spacing + ((j % 2) * 15), j * spacing);
+            Rectangle rect(topLeft,
+                    Point(topLeft.x + width, topLeft.y + height));
+            ShapeRef *shape = new ShapeRef(router, rect);
+            new ShapeConnectionPin(shape, 1, ATTACH_POS_CENTRE,
+                    ATTACH_POS_CENTRE, true, 0.0, ConnDirAll);
+            shapes.push_back(shape);
+        }
+    }
+
+    double middle = (gridSize * spacing) / 2 - (spacing / 4);
+    JunctionRef *junction = new JunctionRef(router, Point(middle, middle));
+    std::vector<ConnRef *> connectors;
+    for (size_t i = 0; i < shapes.size(); ++i)
+    {
+        connectors.push_back(new ConnRef(router,
+                ConnEnd(shapes[i], 1), ConnEnd(junction)));
+    }
+    router->processTransaction();
+
+    router->hyperedgeRerouter()->registerHyperedgeForRerouting(junction);
+    router->processTransaction();
+
+    bool valid = !router->existsInvalidOrthogonalPaths();
+
+    // Every shape should still be attached to the rerouted hyperedge.
+    size_t attachedShapes = 0;
+    const ConnRefList& conns = router->connRefs;
+    for (ConnRefList::const_iterator curr = conns.begin();
+            curr != conns.end(); ++curr)
+    {
+        std::pair<ConnEnd, ConnEnd> ends = (*curr)->endpointConnEnds();
+        if ((ends.first.type() == ConnEndShapePin) ||
+                (ends.second.type() == ConnEndShapePin))
+        {
+            ++attachedShapes;
+        }
+    }
+    if (attachedShapes != shapes.size())
+    {
+        valid = false;
+    }
+
+    delete router;
+    return (valid) ? 0 : 1;
+}
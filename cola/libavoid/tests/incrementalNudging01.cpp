@@ -0,0 +1,86 @@
+// Checks that nudging with the performIncrementalNudgingSolve option still
+// separates connectors passing through a channel too narrow for the ideal
+// nudging distance, and keeps them within the channel.
+//
+#include <algorithm>
+#include <vector>
+#include "libavoid/libavoid.h"
+using namespace Avoid;
+
+static const int connCount = 12;
+static const double channelLeft = 100;
+static const double channelRight = 120;
+
+// Returns the x positions of the connector segments passing through the
+// channel, or an empty list if any of them lie outside it.
+static std::vector<double> channelPositions(const bool incremental)
+{
+    Router *router = new Router(OrthogonalRouting);
+    router->setRoutingParameter(segmentPenalty, 50);
+    router->setRoutingParameter(idealNudgingDistance, 4);
+    router->setRoutingOption(performIncrementalNudgingSolve, incremental);
+
+    Rectangle leftRect(Point(0, 100), Point(channelLeft, 300));
+    new ShapeRef(router, leftRect);
+    Rectangle rightRect(Point(channelRight, 100), Point(220, 300));
+    new ShapeRef(router, rightRect);
+
+    std::vector<ConnRef *> conns;
+    for (int i = 0; i < connCount; ++i)
+    {
+        ConnEnd srcEnd(Point(10 + 17 * i, 20), ConnDirDown);
+        ConnEnd dstEnd(Point(200 - 17 * i, 380), ConnDirUp);
+        conns.push_back(new ConnRef(router, srcEnd, dstEnd));
+    }
+    router->processTransaction();
+    router->outputDiagram((incremental) ? "output/incrementalNudging01" :
+            "output/incrementalNudging01-full");
+
+    std::vector<double> positions;
+    bool valid = true;
+    for (size_t c = 0; c < conns.size(); ++c)
+    {
+        const PolyLine& route = conns[c]->displayRoute();
+        for (size_t i = 1; i < route.size(); ++i)
+        {
+            const Point& a = route.ps[i - 1];
+            const Point& b = route.ps[i];
+            if ((a.x == b.x) && (std::min(a.y, b.y) < 200) &&
+                    (std::max(a.y, b.y) > 200))
+            {
+                // This is the vertical segment crossing the channel.
+                if ((a.x < channelLeft) || (a.x > channelRight))
+                {
+                    valid = false;
+                }
+                positions.push_back(a.x);
+            }
+        }
+    }
+    delete router;
+
+    if (!valid)
+    {
+        positions.clear();
+    }
+    std::sort(positions.begin(), positions.end());
+    return positions;
+}
+
+int main(void)
+{
+    std::vector<double> full = channelPositions(false);
+    std::vector<double> incremental = channelPositions(true);
+
+    bool okay = (full.size() == (size_t) connCount) &&
+            (incremental.size() == full.size());
+    for (size_t i = 1; okay && (i < incremental.size()); ++i)
+    {
+        if ((incremental[i] - incremental[i - 1]) < 0.0001)
+        {
+            // Two connectors have been left overlapping.
+            okay = false;
+        }
+    }
+    return (okay) ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+// Checks that updating the orthogonal visibility graph incrementally, with
+// the performIncrementalOrthogonalVisGraphUpdate option, gives the same
+// graph as regenerating it from scratch each transaction.
+//
+#include <algorithm>
+#include <vector>
+#include "libavoid/libavoid.h"
+#include "gridDiagram.h"
+using namespace Avoid;
+
+typedef std::pair<Point, Point> EdgePoints;
+
+static bool edgePointsLessThan(const EdgePoints& lhs, const EdgePoints& rhs)
+{
+    if (!(lhs.first == rhs.first))
+    {
+        return lhs.first < rhs.first;
+    }
+    return lhs.second < rhs.second;
+}
+
+// Returns the edges of the orthogonal visibility graph in a canonical order.
+static std::vector<EdgePoints> graphEdges(Router *router)
+{
+    std::vector<EdgePoints> edges;
+    for (EdgeInf *edge = router->visOrthogGraph.begin(); edge;
+            edge = edge->lstNext)
+    {
+        EdgePoints points = edge->points();
+        if (points.second < points.first)
+        {
+            std::swap(points.first, points.second);
+        }
+        edges.push_back(points);
+    }
+    std::sort(edges.begin(), edges.end(), edgePointsLessThan);
+    return edges;
+}
+
+struct Instance
+{
+    Router *router;
+    std::vector<ShapeRef *> shapes;
+    std::vector<ConnRef *> conns;
+};
+
+static Instance createInstance(const bool incremental)
+{
+    Instance instance;
+    Router *router = new Router(OrthogonalRouting);
+    router->setRoutingParameter(segmentPenalty, 50);
+    router->setRoutingParameter(shapeBufferDistance, 4);
+    router->setRoutingOption(performIncrementalOrthogonalVisGraphUpdate,
+            incremental);
+    instance.router = router;
+
+    instance.shapes = addShapeGrid(router, 8, 100, true);
+    instance.conns = addGridConnectors(router, instance.shapes, 60, 4321);
+    router->processTransaction();
+    return instance;
+}
+
+int main(void)
+{
+    Instance full = createInstance(false);
+    Instance incremental = createInstance(true);
+
+    bool same = (graphEdges(full.router) == graphEdges(incremental.router));
+
+    // Perform a series of small changes, checking the graph after each.
+    for (int step = 0; same && (step < 12); ++step)
+    {
+        Instance *instances[] = { &full, &incremental };
+        for (int i = 0; i < 2; ++i)
+        {
+            Instance& inst = *instances[i];
+            size_t s = (step * 11) % inst.shapes.size();
+            if (step == 5)
+            {
+                // Remove a shape.
+                inst.router->deleteShape(inst.shapes[s]);
+                inst.shapes.erase(inst.shapes.begin() + s);
+            }
+            else if (step == 8)
+            {
+                // Add a shape.
+                Rectangle rect(Point(355, 255), Point(385, 290));
+                inst.shapes.push_back(new ShapeRef(inst.router, rect));
+            }
+            else if (step == 10)
+            {
+                // Move a connector endpoint.
+                inst.conns[3]->setDestEndpoint(
+                        ConnEnd(Point(470, 350), ConnDirAll));
+            }
+            else
+            {
+                inst.router->moveShape(inst.shapes[s],
+                        7 + step, (step % 2) ? 23 : -19);
+            }
+            inst.router->processTransaction();
+        }
+        same = (graphEdges(full.router) == graphEdges(incremental.router));
+    }
+
+    // The graph should have been updated rather than regenerated, so 
+    // fewer of its vertices created.
+    RouterAllocatorStatistics fullStats = full.router->allocatorStatistics();
+    RouterAllocatorStatistics incrementalStats = 
+            incremental.router->allocatorStatistics();
+    if (incrementalStats.orthogonalVertices.totalAllocations >=
+            fullStats.orthogonalVertices.totalAllocations)
+    {
+        same = false;
+    }
+
+    incremental.router->outputDiagram("output/incrementalOrthogGraph01");
+    delete full.router;
+    delete incremental.router;
+    return (same) ? 0 : 1;
+}
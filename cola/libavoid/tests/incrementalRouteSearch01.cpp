@@ -0,0 +1,110 @@
+// Checks that rerouting poly-line connectors with the 
+// performIncrementalPolylineRouteSearch option, while dragging shapes, 
+// gives routes of the same cost as searching for them afresh, and that
+// routes are repaired rather than searched for again after a small change.
+//
+#include <cmath>
+#include "libavoid/libavoid.h"
+#include "gridDiagram.h"
+using namespace Avoid;
+
+static const double segmentCost = 50;
+
+static Router *createRouter(const bool incremental, 
+        std::vector<ShapeRef *>& shapes, std::vector<ConnRef *>& conns)
+{
+    Router *router = new Router(PolyLineRouting);
+    router->setRoutingOption(performIncrementalPolylineRouteSearch, 
+            incremental);
+    router->setRoutingParameter(segmentPenalty, segmentCost);
+    router->setRoutingParameter(shapeBufferDistance, 4);
+    router->setProfilingEnabled(true);
+
+    shapes = addOffsetShapeGrid(router, 6, 100);
+
+    PseudoRandom random(1234);
+    for (int c = 0; c < 30; ++c)
+    {
+        size_t a = random.next(shapes.size());
+        size_t b = random.next(shapes.size());
+        if (a == b)
+        {
+            continue;
+        }
+        conns.push_back(new ConnRef(router, ConnEnd(shapes[a]->position()),
+                ConnEnd(shapes[b]->position())));
+    }
+    router->processTransaction();
+    return router;
+}
+
+int main(void)
+{
+    std::vector<ShapeRef *> freshShapes, incrShapes;
+    std::vector<ConnRef *> freshConns, incrConns;
+    Router *fresh = createRouter(false, freshShapes, freshConns);
+    Router *incremental = createRouter(true, incrShapes, incrConns);
+
+    bool same = true;
+    bool repaired = false;
+    for (int frame = 0; same && (frame <= 40); ++frame)
+    {
+        if (frame == 40)
+        {
+            // Finally, nudge a corner shape that few routes pass near.
+            fresh->moveShape(freshShapes[0], 0, -3);
+            incremental->moveShape(incrShapes[0], 0, -3);
+        }
+        else
+        {
+            // Drag two shapes across the diagram.
+            double dx = (frame < 20) ? 9 : -7;
+            double dy = (frame % 2) ? 6 : -4;
+            size_t dragged[] = { 7, 22 };
+            for (size_t d = 0; d < 2; ++d)
+            {
+                fresh->moveShape(freshShapes[dragged[d]], dx, dy);
+                incremental->moveShape(incrShapes[dragged[d]], dx, dy);
+            }
+        }
+        // Occasionally move the end of a connector.
+        if (frame % 10 == 5)
+        {
+            Point end(frame * 13.0, 250 + frame);
+            freshConns[frame % freshConns.size()]->setDestEndpoint(end);
+            incrConns[frame % incrConns.size()]->setDestEndpoint(end);
+        }
+        // Reroute every connector, so each can be compared with a fresh 
+        // search rather than only those whose routes were invalidated.
+        for (size_t c = 0; c < freshConns.size(); ++c)
+        {
+            freshConns[c]->makePathInvalid();
+            incrConns[c]->makePathInvalid();
+        }
+        fresh->processTransaction();
+        incremental->processTransaction();
+        if (frame == 40)
+        {
+            // Repairing the previous searches after the small change 
+            // should expand far fewer nodes than searching afresh.
+            repaired = (incremental->lastTransactionProfile().
+                    aStarNodesExpanded * 4 < 
+                    fresh->lastTransactionProfile().aStarNodesExpanded);
+        }
+
+        for (size_t c = 0; c < freshConns.size(); ++c)
+        {
+            double freshCost = routeCost(freshConns[c]->route(), segmentCost);
+            double incrCost = routeCost(incrConns[c]->route(), segmentCost);
+            if (fabs(freshCost - incrCost) > 0.0001)
+            {
+                same = false;
+            }
+        }
+    }
+
+    incremental->outputDiagram("output/incrementalRouteSearch01");
+    delete fresh;
+    delete incremental;
+    return (same && repaired) ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+// Checks the router's memory pool statistics, and that the vertices and
+// edges of the orthogonal visibility graph are returned to the pools
+// when the graph is discarded.
+//
+#include "libavoid/libavoid.h"
+using namespace Avoid;
+
+int main(void)
+{
+    Router *router = new Router(OrthogonalRouting);
+    router->setRoutingParameter(shapeBufferDistance, 4);
+
+    std::vector<ShapeRef *> shapes;
+    for (int i = 0; i < 6; ++i)
+    {
+        for (int j = 0; j < 6; ++j)
+        {
+            Rectangle rect(Point(i * 100, j * 100),
+                    Point(i * 100 + 40, j * 100 + 30));
+            shapes.push_back(new ShapeRef(router, rect));
+        }
+    }
+    for (size_t s = 1; s < shapes.size(); ++s)
+    {
+        ConnEnd srcEnd(shapes[s - 1]->position(), ConnDirAll);
+        ConnEnd dstEnd(shapes[s]->position(), ConnDirAll);
+        new ConnRef(router, srcEnd, dstEnd);
+    }
+    router->processTransaction();
+
+    RouterAllocatorStatistics stats = router->allocatorStatistics();
+    if ((stats.vertices.liveObjects == 0) ||
+            (stats.orthogonalVertices.liveObjects == 0) ||
+            (stats.orthogonalEdges.liveObjects == 0) ||
+            (stats.searchNodeBlocks.totalAllocations == 0))
+    {
+        return 1;
+    }
+    if ((stats.orthogonalEdges.peakLiveObjects < 
+                stats.orthogonalEdges.liveObjects) ||
+            (stats.orthogonalEdges.capacity < 
+                stats.orthogonalEdges.liveObjects) ||
+            (stats.orthogonalEdges.chunks == 0))
+    {
+        return 1;
+    }
+    // Search node blocks are only held for the duration of a search.
+    if (stats.searchNodeBlocks.liveObjects != 0)
+    {
+        return 1;
+    }
+
+    // Moving a shape rebuilds the orthogonal visibility graph, which 
+    // should reuse the memory freed when the old graph was discarded.
+    const size_t vertexChunks = stats.orthogonalVertices.chunks;
+    const size_t edgeChunks = stats.orthogonalEdges.chunks;
+    router->moveShape(shapes[0], 10, 10);
+    router->processTransaction();
+    stats = router->allocatorStatistics();
+    if ((stats.orthogonalVertices.chunks > vertexChunks + 1) ||
+            (stats.orthogonalEdges.chunks > edgeChunks + 1))
+    {
+        return 1;
+    }
+
+    // Removing everything should free all graph objects.
+    ConnRefList conns = router->connRefs;
+    for (ConnRefList::iterator c = conns.begin(); c != conns.end(); ++c)
+    {
+        router->deleteConnector(*c);
+    }
+    for (size_t s = 0; s < shapes.size(); ++s)
+    {
+        router->deleteShape(shapes[s]);
+    }
+    router->processTransaction();
+    stats = router->allocatorStatistics();
+    bool empty = (stats.vertices.liveObjects == 0) && 
+            (stats.orthogonalVertices.liveObjects == 0) &&
+            (stats.edges.liveObjects == 0) &&
+            (stats.orthogonalEdges.liveObjects == 0);
+
+    delete router;
+    return (empty) ? 0 : 1;
+}
@@ -0,0 +1,95 @@
+// Checks that rerouting several hyperedges with the
+// performParallelHyperedgeRerouting option gives the same junction
+// positions and routes as rerouting each hyperedge in turn.  The
+// junctions are left where the rerouter puts them, so that only the
+// rerouting is compared.
+//
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "libavoid/libavoid.h"
+using namespace Avoid;
+
+static const int gridSize = 8;
+static const double spacing = 80;
+static const int hyperedgeCount = 6;
+
+static std::vector<std::string> rerouteHyperedges(const bool parallel)
+{
+    Router *router = new Router(OrthogonalRouting);
+    router->setRoutingPenalty(segmentPenalty, 50);
+    router->setRoutingParameter(idealNudgingDistance, 10);
+    router->setRoutingOption(improveHyperedgeRoutesMovingJunctions, false);
+    router->setRoutingOption(performParallelHyperedgeRerouting, parallel);
+    router->setRoutingThreadCount(4);
+
+    std::vector<ShapeRef *> shapes;
+    for (int i = 0; i < gridSize; ++i)
+    {
+        for (int j = 0; j < gridSize; ++j)
+        {
+            double width = 26 + ((i * 7 + j * 3) % 5) * 4;
+            double height = 20 + ((i * 3 + j * 5) % 4) * 5;
+            Point topLeft(i * spacing + ((j % 2) * 12), j * spacing);
+            Rectangle rect(topLeft,
+                    Point(topLeft.x + width, topLeft.y + height));
+            ShapeRef *shape = new ShapeRef(router, rect);
+            new ShapeConnectionPin(shape, 1, ATTACH_POS_CENTRE,
+                    ATTACH_POS_CENTRE, true, 0.0, ConnDirAll);
+            shapes.push_back(shape);
+        }
+    }
+
+    // Each hyperedge joins a different, overlapping subset of the shapes.
+    std::vector<JunctionRef *> junctions;
+    for (int h = 0; h < hyperedgeCount; ++h)
+    {
+        Point centre((h % 3) * 2.5 * spacing + spacing * 1.5,
+                (h / 3) * 3.5 * spacing + spacing * 1.5);
+        JunctionRef *junction = new JunctionRef(router, centre);
+        junctions.push_back(junction);
+        for (size_t s = h; s < shapes.size(); s += hyperedgeCount + h)
+        {
+            new ConnRef(router, ConnEnd(shapes[s], 1), ConnEnd(junction));
+        }
+    }
+    router->processTransaction();
+
+    for (size_t h = 0; h < junctions.size(); ++h)
+    {
+        router->hyperedgeRerouter()->registerHyperedgeForRerouting(
+                junctions[h]);
+    }
+    router->processTransaction();
+
+    std::vector<std::string> routes;
+    const ConnRefList& conns = router->connRefs;
+    for (ConnRefList::const_iterator curr = conns.begin();
+            curr != conns.end(); ++curr)
+    {
+        const PolyLine& route = (*curr)->displayRoute();
+        std::ostringstream str;
+        for (size_t i = 0; i < route.size(); ++i)
+        {
+            str << route.ps[i].x << "," << route.ps[i].y << " ";
+        }
+        routes.push_back(str.str());
+    }
+    std::sort(routes.begin(), routes.end());
+
+    if (router->existsInvalidOrthogonalPaths())
+    {
+        routes.clear();
+    }
+    delete router;
+    return routes;
+}
+
+int main(void)
+{
+    std::vector<std::string> serial = rerouteHyperedges(false);
+    std::vector<std::string> parallel = rerouteHyperedges(true);
+
+    return (!serial.empty() && (serial == parallel)) ? 0 : 1;
+}
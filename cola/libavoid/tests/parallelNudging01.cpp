@@ -0,0 +1,48 @@
+// Checks that nudging orthogonal routes with the
+// performParallelOrthogonalNudging option gives the same routes as normal
+// serial nudging.
+//
+#include "libavoid/libavoid.h"
+#include "gridDiagram.h"
+using namespace Avoid;
+
+static Router *createRouter(const bool parallel)
+{
+    Router *router = new Router(OrthogonalRouting);
+    router->setRoutingParameter(segmentPenalty, 50);
+    router->setRoutingParameter(shapeBufferDistance, 4);
+    router->setRoutingOption(performParallelOrthogonalNudging, parallel);
+    router->setRoutingParameter(idealNudgingDistance, 6);
+    router->setRoutingThreadCount(4);
+    router->setProfilingEnabled(true);
+
+    std::vector<ShapeRef *> shapes = addShapeGrid(router, 8, 100, true);
+    addGridConnectors(router, shapes, 120, 12345);
+    router->processTransaction();
+
+    // Move some shapes and reroute.
+    for (size_t s = 0; s < shapes.size(); s += 7)
+    {
+        router->moveShape(shapes[s], 13, 17);
+    }
+    router->processTransaction();
+    return router;
+}
+
+int main(void)
+{
+    Router *serial = createRouter(false);
+    Router *parallel = createRouter(true);
+
+    bool same = sameRoutes(serial, parallel);
+    // Each region should have been solved exactly once, and there should
+    // be more than one to solve in parallel.
+    same = same && (serial->lastTransactionProfile().vpscSolves ==
+            parallel->lastTransactionProfile().vpscSolves) &&
+            (serial->lastTransactionProfile().vpscSolves > 1);
+
+    parallel->outputDiagram("output/parallelNudging01");
+    delete serial;
+    delete parallel;
+    return (same) ? 0 : 1;
+}
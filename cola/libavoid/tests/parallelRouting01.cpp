@@ -0,0 +1,82 @@
+// Checks that routing connectors with the performParallelRouteSearch
+// option gives the same routes as normal serial routing, and that the 
+// parallel searches stop when the transaction is aborted.
+//
+#include "libavoid/libavoid.h"
+#include "gridDiagram.h"
+using namespace Avoid;
+
+// A router that can be made to abort transactions in the route search
+// phase.
+class AbortingRouter : public Router
+{
+    public:
+        AbortingRouter()
+            : Router(PolyLineRouting | OrthogonalRouting),
+              abortRouteSearch(false)
+        {
+        }
+        virtual bool shouldContinueTransactionWithProgress(unsigned int, 
+                unsigned int phaseNumber, unsigned int, double)
+        {
+            return !abortRouteSearch || 
+                    (phaseNumber != TransactionPhaseRouteSearch);
+        }
+        bool abortRouteSearch;
+};
+
+static Router *createRouter(const bool parallel, 
+        const bool abortRerouting = false)
+{
+    AbortingRouter *router = new AbortingRouter();
+    router->setRoutingParameter(segmentPenalty, 50);
+    router->setRoutingParameter(shapeBufferDistance, 4);
+    router->setRoutingOption(performParallelRouteSearch, parallel);
+    router->setRoutingThreadCount(4);
+    router->setProfilingEnabled(true);
+
+    std::vector<ShapeRef *> shapes = addShapeGrid(router, 8, 100, true);
+    std::vector<ConnRef *> conns = 
+            addGridConnectors(router, shapes, 120, 12345);
+    for (size_t c = 0; c < conns.size(); ++c)
+    {
+        conns[c]->setRoutingType((c % 3 == 0) ? ConnType_PolyLine :
+                ConnType_Orthogonal);
+    }
+    router->processTransaction();
+
+    // Move some shapes and reroute.
+    router->abortRouteSearch = abortRerouting;
+    for (size_t s = 0; s < shapes.size(); s += 7)
+    {
+        router->moveShape(shapes[s], 13, 17);
+    }
+    router->processTransaction();
+    return router;
+}
+
+int main(void)
+{
+    Router *serial = createRouter(false);
+    Router *parallel = createRouter(true);
+
+    bool same = sameRoutes(serial, parallel);
+    // Each connector should have been searched for exactly once.
+    same = same && (serial->lastTransactionProfile().aStarNodesExpanded ==
+            parallel->lastTransactionProfile().aStarNodesExpanded);
+
+    // When the transaction is aborted during the route search phase, the
+    // parallel searches should stop after their first batch, rather than
+    // searching for every connector.
+    Router *aborted = createRouter(true, true);
+    same = same && 
+            !aborted->transactionPhaseCompleted(TransactionPhaseRouteSearch) &&
+            (aborted->lastTransactionProfile().aStarNodesExpanded * 2 <
+             parallel->lastTransactionProfile().aStarNodesExpanded);
+
+    parallel->outputDiagram("output/parallelRouting01");
+    delete serial;
+    delete parallel;
+    delete aborted;
+    return (same) ? 0 : 1;
+}
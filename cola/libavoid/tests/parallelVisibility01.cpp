@@ -0,0 +1,97 @@
+// Checks that computing polyline visibility with the
+// performParallelPolylineVisibility option gives the same visibility
+// graph and route lengths as computing it for each obstacle in turn, and
+// that it has no effect when only one thread is available.
+//
+#include <cmath>
+#include "libavoid/libavoid.h"
+#include "gridDiagram.h"
+using namespace Avoid;
+
+static Router *createRouter(const bool parallel, const unsigned int threads)
+{
+    Router *router = new Router(PolyLineRouting);
+    router->setRoutingOption(performParallelPolylineVisibility, parallel);
+    router->setRoutingThreadCount(threads);
+
+    std::vector<ShapeRef *> shapes;
+    for (int i = 0; i < 7; ++i)
+    {
+        for (int j = 0; j < 7; ++j)
+        {
+            Rectangle rect = staggeredGridRectangle(i, j, 90, 50, 35);
+            ShapeRef *shape = new ShapeRef(router, rect);
+            ShapeConnectionPin *pin = new ShapeConnectionPin(shape, 1,
+                    ATTACH_POS_CENTRE, ATTACH_POS_TOP, true, 0, ConnDirNone);
+            pin->setExclusive(false);
+            shapes.push_back(shape);
+        }
+    }
+
+    PseudoRandom random(4321);
+    for (int c = 0; c < 80; ++c)
+    {
+        size_t a = random.next(shapes.size());
+        size_t b = random.next(shapes.size());
+        if (a == b)
+        {
+            continue;
+        }
+
+        ConnEnd srcEnd(shapes[a]->position());
+        ConnEnd dstEnd(shapes[b]->position());
+        if (c % 4 == 0)
+        {
+            // Some connectors attach to connection pins.
+            dstEnd = ConnEnd(shapes[b], 1);
+        }
+        new ConnRef(router, srcEnd, dstEnd);
+    }
+    router->processTransaction();
+
+    // Move some shapes, then rebuild the whole graph.
+    for (size_t s = 0; s < shapes.size(); s += 5)
+    {
+        router->moveShape(shapes[s], 11, -14);
+    }
+    router->processTransaction();
+    router->markAllObstaclesAsMoved();
+    router->processTransaction();
+    return router;
+}
+
+int main(void)
+{
+    Router *serial = createRouter(false, 4);
+    Router *parallel = createRouter(true, 4);
+    Router *oneThread = createRouter(true, 1);
+
+    bool same = (serial->visGraph.size() == parallel->visGraph.size()) &&
+            (serial->invisGraph.size() == parallel->invisGraph.size()) &&
+            (serial->connRefs.size() == parallel->connRefs.size());
+    ConnRefList::const_iterator s = serial->connRefs.begin();
+    ConnRefList::const_iterator p = parallel->connRefs.begin();
+    for (; same && (s != serial->connRefs.end()); ++s, ++p)
+    {
+        double sLength = routeLength((*s)->displayRoute());
+        double pLength = routeLength((*p)->displayRoute());
+        if (fabs(sLength - pLength) > 0.0001)
+        {
+            same = false;
+        }
+    }
+
+    // With one thread, each obstacle is swept in turn as usual.
+    s = serial->connRefs.begin();
+    ConnRefList::const_iterator o = oneThread->connRefs.begin();
+    for (; same && (s != serial->connRefs.end()); ++s, ++o)
+    {
+        same = ((*s)->displayRoute().ps == (*o)->displayRoute().ps);
+    }
+
+    parallel->outputDiagram("output/parallelVisibility01");
+    delete serial;
+    delete parallel;
+    delete oneThread;
+    return (same) ? 0 : 1;
+}
@@ -7660,6 +7660,7 @@ int main(void) {
 
     router->processTransaction();
     router->outputDiagram("output/performance01");
+    router->outputInstanceSnapshot("output/performance01.snapshot");
     delete router;
     return 0;
 };
@@ -0,0 +1,57 @@
+// Checks that the router's profiler records the phases and work counts of
+// a transaction when enabled, and nothing when it is disabled.
+//
+#include "libavoid/libavoid.h"
+using namespace Avoid;
+
+static void addConnectors(Router *router)
+{
+    Rectangle leftRect(Point(0, 100), Point(100, 300));
+    new ShapeRef(router, leftRect);
+    Rectangle rightRect(Point(120, 100), Point(220, 300));
+    new ShapeRef(router, rightRect);
+
+    for (int i = 0; i < 6; ++i)
+    {
+        ConnEnd srcEnd(Point(10 + 40 * i, 20), ConnDirDown);
+        ConnEnd dstEnd(Point(210 - 40 * i, 380), ConnDirUp);
+        new ConnRef(router, srcEnd, dstEnd);
+    }
+}
+
+int main(void)
+{
+    Router *router = new Router(OrthogonalRouting);
+    router->setRoutingParameter(segmentPenalty, 50);
+    router->setRoutingParameter(idealNudgingDistance, 4);
+    router->setProfilingEnabled(true);
+    addConnectors(router);
+    router->processTransaction();
+
+    const RouterProfile& profile = router->lastTransactionProfile();
+    bool okay = (profile.phaseCount[tmTransaction] == 1) &&
+            (profile.phaseCount[tmOrthogGraph] == 1) &&
+            (profile.phaseCount[tmOrthogNudge] > 0) &&
+            (profile.phaseTime[tmTransaction] > 0) &&
+            (profile.phaseTime[tmTransaction] >= 
+                    profile.phaseTime[tmOrthogGraph]) &&
+            (profile.visGraphVertices > 0) &&
+            (profile.orthogVisGraphEdges > 0) &&
+            (profile.aStarNodesExpanded > 0) &&
+            (profile.vpscSolves > 0) && !profile.events.empty() &&
+            (profile.events.front().phase == tmTransaction);
+    okay = okay && router->outputProfileAsChromeTrace("output/profiler01.json");
+    router->outputDiagram("output/profiler01");
+    delete router;
+
+    // Nothing is recorded when profiling is disabled.
+    router = new Router(OrthogonalRouting);
+    addConnectors(router);
+    router->processTransaction();
+    okay = okay && !router->profilingEnabled() &&
+            (router->lastTransactionProfile().phaseCount[tmTransaction] == 0) &&
+            router->lastTransactionProfile().events.empty();
+    delete router;
+
+    return (okay) ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+// Checks that connectors keeping their routes because of the
+// performRouteCaching option, while dragging a shape, have routes of the
+// same cost as searching for them afresh, and that the cache is used.
+// Also checks that changing the visibility directions of a connector's
+// endpoint stops its route being kept.
+//
+#include <cmath>
+#include "libavoid/libavoid.h"
+#include "gridDiagram.h"
+using namespace Avoid;
+
+static const double segmentCost = 50;
+
+static Router *createRouter(const ConnType type, const bool caching,
+        std::vector<ShapeRef *>& shapes, std::vector<ConnRef *>& conns)
+{
+    Router *router = new Router((type == ConnType_PolyLine) ?
+            PolyLineRouting : OrthogonalRouting);
+    router->setRoutingOption(performRouteCaching, caching);
+    router->setRoutingParameter(segmentPenalty, segmentCost);
+    router->setRoutingParameter(shapeBufferDistance, 4);
+
+    shapes = addOffsetShapeGrid(router, 6, 100);
+
+    // Join nearby shapes so that most connectors are far from the
+    // dragged shape.
+    PseudoRandom random(1234);
+    for (int c = 0; c < 30; ++c)
+    {
+        size_t a = random.next(shapes.size());
+        size_t b = (a + 1 + random.next(7)) % shapes.size();
+        ConnRef *conn = new ConnRef(router, ConnEnd(shapes[a]->position()),
+                ConnEnd(shapes[b]->position()));
+        conn->setRoutingType(type);
+        conns.push_back(conn);
+    }
+    router->processTransaction();
+    return router;
+}
+
+static bool test(const ConnType type, const char *filename)
+{
+    std::vector<ShapeRef *> freshShapes, cachedShapes;
+    std::vector<ConnRef *> freshConns, cachedConns;
+    Router *fresh = createRouter(type, false, freshShapes, freshConns);
+    Router *cached = createRouter(type, true, cachedShapes, cachedConns);
+
+    bool same = true;
+    for (int frame = 0; same && (frame < 30); ++frame)
+    {
+        // Drag a shape across the diagram, and occasionally move the
+        // end of a connector.
+        double dx = (frame < 15) ? 9 : -7;
+        double dy = (frame % 2) ? 6 : -4;
+        fresh->moveShape(freshShapes[14], dx, dy);
+        cached->moveShape(cachedShapes[14], dx, dy);
+        if (frame % 10 == 5)
+        {
+            Point end(frame * 13.0, 250 + frame);
+            freshConns[frame % freshConns.size()]->setDestEndpoint(end);
+            cachedConns[frame % cachedConns.size()]->setDestEndpoint(end);
+        }
+        // Reroute every connector, so each can be compared with a fresh
+        // search rather than only those whose routes were invalidated.
+        for (size_t c = 0; c < freshConns.size(); ++c)
+        {
+            freshConns[c]->makePathInvalid();
+            cachedConns[c]->makePathInvalid();
+        }
+        fresh->processTransaction();
+        cached->processTransaction();
+
+        for (size_t c = 0; c < freshConns.size(); ++c)
+        {
+            double freshCost = routeCost(freshConns[c]->route(), segmentCost);
+            double cachedCost = 
+                    routeCost(cachedConns[c]->route(), segmentCost);
+            if (fabs(freshCost - cachedCost) > 0.0001)
+            {
+                same = false;
+            }
+        }
+    }
+
+    bool used = (cached->routeCacheHitCount() > 0) &&
+            (cached->routeCacheMissCount() > 0) &&
+            (fresh->routeCacheHitCount() == 0);
+
+    cached->outputDiagram(filename);
+    delete fresh;
+    delete cached;
+    return same && used;
+}
+
+static bool testDirectionChange(void)
+{
+    Router *router = new Router(OrthogonalRouting);
+    router->setRoutingOption(performRouteCaching, true);
+    router->setRoutingParameter(segmentPenalty, segmentCost);
+    Rectangle rect(Point(-60, -60), Point(-20, 60));
+    new ShapeRef(router, rect);
+    ConnRef *conn = new ConnRef(router, ConnEnd(Point(0, 0), ConnDirRight),
+            ConnEnd(Point(200, 0), ConnDirAll));
+    router->processTransaction();
+    bool straight = (conn->route().size() == 2);
+
+    // The straight route leaves the source to the right, so can't be kept.
+    conn->setSourceEndpoint(ConnEnd(Point(0, 0), ConnDirUp));
+    router->processTransaction();
+    const PolyLine& route = conn->route();
+    bool leavesUp = (route.size() > 2) && (route.ps[1].x == 0) &&
+            (route.ps[1].y < 0);
+    bool searched = (router->routeCacheHitCount() == 0);
+
+    delete router;
+    return straight && leavesUp && searched;
+}
+
+int main(void)
+{
+    bool orthogonal = test(ConnType_Orthogonal, "output/routeCache01-orthog");
+    bool polyline = test(ConnType_PolyLine, "output/routeCache01-polyline");
+    bool directions = testDirectionChange();
+    return (orthogonal && polyline && directions) ? 0 : 1;
+}
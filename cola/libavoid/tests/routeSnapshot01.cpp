@@ -0,0 +1,133 @@
+// Checks that route snapshots published with the publishRouteSnapshots
+// option match the connectors' display routes, are unaffected by later
+// transactions, share unchanged routes, and can be read from another
+// thread while transactions are being processed.
+//
+#include <atomic>
+#include <thread>
+#include "libavoid/libavoid.h"
+using namespace Avoid;
+
+static std::atomic<bool> finished(false);
+static std::atomic<bool> readerFailed(false);
+
+static void readSnapshots(Router *router)
+{
+    unsigned long long lastVersion = 0;
+    while (!finished)
+    {
+        RouteSnapshotPtr snapshot = router->routeSnapshot();
+        if (snapshot->version() < lastVersion)
+        {
+            readerFailed = true;
+        }
+        lastVersion = snapshot->version();
+        for (RouteSnapshot::RouteMap::const_iterator i =
+                snapshot->routes().begin(); i != snapshot->routes().end(); ++i)
+        {
+            if (i->second->size() < 2)
+            {
+                readerFailed = true;
+            }
+        }
+    }
+}
+
+static bool matchesRouter(const RouteSnapshotPtr& snapshot,
+        const std::vector<ConnRef *>& conns)
+{
+    if (snapshot->routes().size() != conns.size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < conns.size(); ++i)
+    {
+        const PolyLine *route = snapshot->route(conns[i]->id());
+        if (!route || (route->ps != conns[i]->displayRoute().ps))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(void)
+{
+    Router *router = new Router(OrthogonalRouting);
+    router->setRoutingParameter(segmentPenalty, 50);
+    router->setRoutingOption(publishRouteSnapshots, true);
+
+    bool success = (router->routeSnapshot()->version() == 0) &&
+            router->routeSnapshot()->routes().empty();
+
+    std::vector<ShapeRef *> shapes;
+    for (int i = 0; i < 6; ++i)
+    {
+        for (int j = 0; j < 6; ++j)
+        {
+            Rectangle rect(Point(i * 100, j * 100),
+                    Point(i * 100 + 40, j * 100 + 40));
+            shapes.push_back(new ShapeRef(router, rect));
+        }
+    }
+    std::vector<ConnRef *> conns;
+    for (int i = 0; i < 5; ++i)
+    {
+        for (int j = 0; j < 6; j += 2)
+        {
+            conns.push_back(new ConnRef(router,
+                    ConnEnd(Point(i * 100 + 40, j * 100 + 10), ConnDirRight),
+                    ConnEnd(Point(i * 100 + 100, j * 100 + 30), ConnDirLeft)));
+        }
+    }
+    router->processTransaction();
+
+    RouteSnapshotPtr first = router->routeSnapshot();
+    success &= (first->version() == 1) && matchesRouter(first, conns);
+    std::vector<PolyLine> firstRoutes;
+    for (size_t i = 0; i < conns.size(); ++i)
+    {
+        firstRoutes.push_back(*first->route(conns[i]->id()));
+    }
+
+    // Add a shape in the path of the first connector, and delete the last.
+    Rectangle blocker(Point(60, -20), Point(80, 20));
+    new ShapeRef(router, blocker);
+    unsigned int deletedId = conns.back()->id();
+    router->deleteConnector(conns.back());
+    conns.pop_back();
+    router->processTransaction();
+
+    RouteSnapshotPtr second = router->routeSnapshot();
+    success &= (second->version() == 2) && matchesRouter(second, conns);
+    success &= (second->route(deletedId) == nullptr) &&
+            (first->route(deletedId) != nullptr);
+    // The earlier snapshot is unchanged, and shares unmoved routes.
+    size_t shared = 0;
+    for (size_t i = 0; i < conns.size(); ++i)
+    {
+        const PolyLine *route = first->route(conns[i]->id());
+        success &= (route->ps == firstRoutes[i].ps);
+        if (route == second->route(conns[i]->id()))
+        {
+            ++shared;
+        }
+    }
+    success &= (shared > 0) && (shared < conns.size());
+
+    // Read snapshots from another thread while dragging a shape.
+    std::thread reader(readSnapshots, router);
+    for (int frame = 0; frame < 30; ++frame)
+    {
+        router->moveShape(shapes[14], (frame < 15) ? 3 : -3, 2);
+        router->processTransaction();
+    }
+    finished = true;
+    reader.join();
+    success &= !readerFailed && (router->routeSnapshot()->version() == 32) &&
+            matchesRouter(router->routeSnapshot(), conns);
+
+    router->outputDiagram("output/routeSnapshot01");
+    delete router;
+    return (success) ? 0 : 1;
+}
@@ -1445,6 +1445,7 @@ JunctionRef *junctionRef990913310 = new JunctionRef(router, Point(24000, 27025),
 
     router->processTransaction();
     router->outputDiagram("output/slowrouting");
+    router->outputInstanceSnapshot("output/slowrouting.snapshot");
 
     /*
     for (int i = 0; i < 1; ++i)
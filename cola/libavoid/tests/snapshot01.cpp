@@ -0,0 +1,184 @@
+// Checks that a router instance written with outputInstanceSnapshot() can
+// be loaded with createFromInstanceSnapshot() and routes identically, and
+// that invalid snapshots, including ones with corrupt point counts, are
+// rejected.
+//
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <vector>
+#include "libavoid/libavoid.h"
+using namespace Avoid;
+
+typedef std::map<unsigned int, PolyLine> RouteMap;
+
+static RouteMap routesById(Router *router)
+{
+    RouteMap routes;
+    for (ConnRefList::const_iterator curr = router->connRefs.begin();
+            curr != router->connRefs.end(); ++curr)
+    {
+        routes[(*curr)->id()] = (*curr)->displayRoute();
+    }
+    return routes;
+}
+
+static bool sameRoutes(const RouteMap& lhs, const RouteMap& rhs)
+{
+    if (lhs.size() != rhs.size())
+    {
+        return false;
+    }
+    for (RouteMap::const_iterator l = lhs.begin(), r = rhs.begin();
+            l != lhs.end(); ++l, ++r)
+    {
+        if ((l->first != r->first) || (l->second.size() != r->second.size()))
+        {
+            return false;
+        }
+        for (size_t i = 0; i < l->second.size(); ++i)
+        {
+            if (!(l->second.ps[i] == r->second.ps[i]))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Copies a snapshot, replacing the count stored just before the last
+// occurrence of the given coordinate with a huge value.
+static bool corruptCountBefore(const char *filename, const char *corrupted,
+        const double coordinate)
+{
+    std::vector<char> data;
+    FILE *fp = fopen(filename, "rb");
+    if (!fp)
+    {
+        return false;
+    }
+    int c;
+    while ((c = fgetc(fp)) != EOF)
+    {
+        data.push_back((char) c);
+    }
+    fclose(fp);
+
+    const uint32_t hugeCount = 0xFFFFFFFF;
+    bool found = false;
+    for (size_t i = data.size() - sizeof(coordinate); 
+            !found && (i >= sizeof(hugeCount)); --i)
+    {
+        if (memcmp(&data[i], &coordinate, sizeof(coordinate)) == 0)
+        {
+            memcpy(&data[i - sizeof(hugeCount)], &hugeCount, 
+                    sizeof(hugeCount));
+            found = true;
+        }
+    }
+
+    fp = fopen(corrupted, "wb");
+    if (!fp)
+    {
+        return false;
+    }
+    fwrite(&data[0], 1, data.size(), fp);
+    fclose(fp);
+    return found;
+}
+
+int main(void)
+{
+    Router *router = new Router(OrthogonalRouting | PolyLineRouting);
+    router->setRoutingParameter(segmentPenalty, 50);
+    router->setRoutingParameter(crossingPenalty, 100);
+    router->setRoutingParameter(idealNudgingDistance, 6);
+    router->setRoutingOption(nudgeOrthogonalSegmentsConnectedToShapes, true);
+
+    Rectangle rect1(Point(0, 0), Point(60, 40));
+    ShapeRef *shape1 = new ShapeRef(router, rect1, 10);
+    ShapeConnectionPin *pin = new ShapeConnectionPin(shape1, 1, 
+            ATTACH_POS_RIGHT, ATTACH_POS_CENTRE, true, 0, ConnDirRight);
+    pin->setExclusive(false);
+    Rectangle rect2(Point(200, 100), Point(260, 140));
+    ShapeRef *shape2 = new ShapeRef(router, rect2, 20);
+    new ShapeConnectionPin(shape2, 2, ATTACH_POS_LEFT, ATTACH_POS_CENTRE,
+            true, 0, ConnDirLeft);
+    Rectangle rect3(Point(100, 40), Point(140, 90));
+    new ShapeRef(router, rect3, 30);
+    JunctionRef *junction = new JunctionRef(router, Point(150, 200), 40);
+
+    new ConnRef(router, ConnEnd(shape1, 1), ConnEnd(shape2, 2), 50);
+    ConnRef *conn2 = new ConnRef(router, ConnEnd(shape1, 1),
+            ConnEnd(junction), 60);
+    new ConnRef(router, ConnEnd(junction), 
+            ConnEnd(Point(300, 250), ConnDirUp), 70);
+    ConnRef *conn4 = new ConnRef(router, ConnEnd(Point(-20, 100)),
+            ConnEnd(Point(280, 20)), 80);
+    conn4->setRoutingType(ConnType_PolyLine);
+    std::vector<Checkpoint> checkpoints;
+    checkpoints.push_back(Checkpoint(Point(40, 150), ConnDirAll, 
+            ConnDirDown));
+    conn2->setRoutingCheckpoints(checkpoints);
+    router->processTransaction();
+
+    bool okay = router->outputInstanceSnapshot("output/snapshot01.snapshot");
+    RouteMap original = routesById(router);
+    router->outputDiagram("output/snapshot01");
+    delete router;
+
+    router = Router::createFromInstanceSnapshot("output/snapshot01.snapshot");
+    okay = okay && (router != nullptr);
+    if (router)
+    {
+        router->processTransaction();
+        okay = okay && sameRoutes(original, routesById(router)) &&
+                (router->routingParameter(idealNudgingDistance) == 6) &&
+                router->routingOption(
+                        nudgeOrthogonalSegmentsConnectedToShapes);
+        router->outputDiagram("output/snapshot01-loaded");
+        delete router;
+    }
+
+    // Files that aren't snapshots, or are truncated, can't be loaded.
+    FILE *fp = fopen("output/snapshot01-invalid.snapshot", "w");
+    if (fp)
+    {
+        fprintf(fp, "LIBAVOID");
+        fclose(fp);
+    }
+    okay = okay && 
+            !Router::createFromInstanceSnapshot(
+                    "output/snapshot01-invalid.snapshot") &&
+            !Router::createFromInstanceSnapshot(
+                    "output/snapshot01-missing.snapshot");
+
+    // Huge route and checkpoint counts are rejected rather than allocated.
+    router = new Router(OrthogonalRouting);
+    ConnRef *fixed = new ConnRef(router, ConnEnd(Point(0, 0)),
+            ConnEnd(Point(100, 0)), 10);
+    PolyLine route(2);
+    route.ps[0] = Point(1234.5, 0);
+    route.ps[1] = Point(100, 0);
+    fixed->setFixedRoute(route);
+    ConnRef *checkpointed = new ConnRef(router, ConnEnd(Point(0, 50)),
+            ConnEnd(Point(100, 50)), 20);
+    checkpoints.clear();
+    checkpoints.push_back(Checkpoint(Point(5678.5, 50)));
+    checkpointed->setRoutingCheckpoints(checkpoints);
+    router->processTransaction();
+    okay = okay && router->outputInstanceSnapshot(
+            "output/snapshot01-counts.snapshot");
+    delete router;
+    okay = okay && corruptCountBefore("output/snapshot01-counts.snapshot",
+            "output/snapshot01-route.snapshot", 1234.5) &&
+            !Router::createFromInstanceSnapshot(
+                    "output/snapshot01-route.snapshot");
+    okay = okay && corruptCountBefore("output/snapshot01-counts.snapshot",
+            "output/snapshot01-checkpoints.snapshot", 5678.5) &&
+            !Router::createFromInstanceSnapshot(
+                    "output/snapshot01-checkpoints.snapshot");
+
+    return (okay) ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+// Checks that routing orthogonal connectors with the
+// performTiledOrthogonalRouting option gives routes of the same cost as
+// routing over the whole diagram, that connectors crossing tiles are
+// still routed, and that the visibility graph for the whole diagram isn't
+// generated when every connector lies within a tile.
+//
+#include <cmath>
+#include "libavoid/libavoid.h"
+#include "gridDiagram.h"
+using namespace Avoid;
+
+static const int gridSize = 12;
+static const double segmentCost = 50;
+
+static Router *createRouter(const bool tiled, const bool crossTile,
+        std::vector<ShapeRef *>& shapes, std::vector<ConnRef *>& conns)
+{
+    Router *router = new Router(OrthogonalRouting);
+    router->setRoutingOption(performTiledOrthogonalRouting, tiled);
+    router->setRoutingParameter(routingTileSize, 400);
+    router->setRoutingParameter(segmentPenalty, segmentCost);
+    router->setRoutingParameter(shapeBufferDistance, 4);
+    router->setRoutingThreadCount(4);
+
+    shapes = addOffsetShapeGrid(router, gridSize, 100);
+
+    // Join each shape to a nearby shape, with endpoints on the shapes'
+    // right and left sides.
+    for (int i = 0; i + 1 < gridSize; ++i)
+    {
+        for (int j = 0; j < gridSize; j += 2)
+        {
+            Box src = shapes[(i * gridSize) + j]->polygon().offsetBoundingBox(0);
+            Box dst = shapes[((i + 1) * gridSize) +
+                    ((j + 1) % gridSize)]->polygon().offsetBoundingBox(0);
+            conns.push_back(new ConnRef(router,
+                    ConnEnd(Point(src.max.x, src.min.y + 10), ConnDirRight),
+                    ConnEnd(Point(dst.min.x, dst.min.y + 20), ConnDirLeft)));
+        }
+    }
+    if (crossTile)
+    {
+        // Connectors across the whole diagram.
+        for (int j = 1; j < gridSize; j += 4)
+        {
+            Box src = shapes[j]->polygon().offsetBoundingBox(0);
+            Box dst = shapes[((gridSize - 1) * gridSize) +
+                    (gridSize - 1 - j)]->polygon().offsetBoundingBox(0);
+            conns.push_back(new ConnRef(router,
+                    ConnEnd(Point(src.min.x, src.min.y + 15), ConnDirLeft),
+                    ConnEnd(Point(dst.max.x, dst.min.y + 15), ConnDirRight)));
+        }
+    }
+    router->processTransaction();
+    return router;
+}
+
+static bool sameCosts(const std::vector<ConnRef *>& conns1,
+        const std::vector<ConnRef *>& conns2)
+{
+    for (size_t c = 0; c < conns1.size(); ++c)
+    {
+        if (conns1[c]->route().empty() || conns2[c]->route().empty() ||
+                (fabs(routeCost(conns1[c]->route(), segmentCost) -
+                      routeCost(conns2[c]->route(), segmentCost)) > 0.0001))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(void)
+{
+    bool success = true;
+    for (int crossTile = 0; crossTile < 2; ++crossTile)
+    {
+        std::vector<ShapeRef *> wholeShapes, tiledShapes;
+        std::vector<ConnRef *> wholeConns, tiledConns;
+        Router *whole = createRouter(false, crossTile, wholeShapes,
+                wholeConns);
+        Router *tiled = createRouter(true, crossTile, tiledShapes,
+                tiledConns);
+        success &= sameCosts(wholeConns, tiledConns);
+
+        // Move a shape and check again.
+        whole->moveShape(wholeShapes[50], 6, 3);
+        tiled->moveShape(tiledShapes[50], 6, 3);
+        whole->processTransaction();
+        tiled->processTransaction();
+        success &= sameCosts(wholeConns, tiledConns);
+
+        RouterAllocatorStatistics wholeStats = whole->allocatorStatistics();
+        RouterAllocatorStatistics tiledStats = tiled->allocatorStatistics();
+        size_t wholeVertices = wholeStats.vertices.peakLiveObjects +
+                wholeStats.orthogonalVertices.peakLiveObjects;
+        size_t tiledVertices = tiledStats.vertices.peakLiveObjects +
+                tiledStats.orthogonalVertices.peakLiveObjects;
+        if (crossTile)
+        {
+            tiled->outputDiagram("output/tiledRouting01");
+        }
+        else if (tiledVertices * 2 > wholeVertices)
+        {
+            // The whole diagram's graph should not have been generated.
+            success = false;
+        }
+        delete whole;
+        delete tiled;
+    }
+    return (success) ? 0 : 1;
+}
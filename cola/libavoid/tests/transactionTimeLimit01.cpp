@@ -0,0 +1,78 @@
+// Checks that a transaction cut short by the transaction time limit still
+// leaves every connector with a route between its endpoints, reports the
+// phases it didn't complete, and that the next transaction without a limit
+// is completed.
+//
+#include <vector>
+#include "libavoid/libavoid.h"
+#include "gridDiagram.h"
+using namespace Avoid;
+
+static bool routesEndAtEndpoints(Router *router)
+{
+    for (ConnRefList::const_iterator curr = router->connRefs.begin();
+            curr != router->connRefs.end(); ++curr)
+    {
+        const PolyLine& route = (*curr)->displayRoute();
+        std::pair<ConnEnd, ConnEnd> ends = (*curr)->endpointConnEnds();
+        if ((route.size() < 2) || !(route.ps.front() == ends.first.position()) ||
+                !(route.ps.back() == ends.second.position()))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(void)
+{
+    Router *router = new Router(OrthogonalRouting);
+    router->setRoutingParameter(segmentPenalty, 50);
+    router->setRoutingParameter(idealNudgingDistance, 4);
+
+    std::vector<ShapeRef *> shapes = addShapeGrid(router, 8, 100);
+    PseudoRandom random(2468);
+    for (int c = 0; c < 100; ++c)
+    {
+        size_t a = random.next(shapes.size());
+        size_t b = random.next(shapes.size());
+        if (a == b)
+        {
+            continue;
+        }
+        ConnEnd srcEnd(shapes[a]->position() + Point(0, 20), ConnDirDown);
+        ConnEnd dstEnd(shapes[b]->position() + Point(0, 20), ConnDirDown);
+        new ConnRef(router, srcEnd, dstEnd);
+    }
+    router->processTransaction();
+    bool okay = router->transactionPhaseCompleted(TransactionPhaseCompleted);
+
+    // Move every shape in the middle of the diagram, with a time limit far
+    // too short to reroute everything.
+    router->setTransactionTimeLimit(1);
+    for (size_t s = 0; s < shapes.size(); ++s)
+    {
+        Point centre = shapes[s]->position();
+        if ((centre.x > 200) && (centre.x < 500))
+        {
+            router->moveShape(shapes[s], 0, 35);
+        }
+    }
+    router->processTransaction();
+    okay = okay &&
+            !router->transactionPhaseCompleted(TransactionPhaseCompleted) &&
+            !router->transactionPhaseCompleted(TransactionPhaseRouteSearch) &&
+            routesEndAtEndpoints(router);
+
+    // Without a limit, the connectors are now all rerouted.
+    router->setTransactionTimeLimit(0);
+    router->moveShape(shapes[0], 0, 5);
+    router->processTransaction();
+    okay = okay &&
+            router->transactionPhaseCompleted(TransactionPhaseCompleted) &&
+            routesEndAtEndpoints(router);
+
+    router->outputDiagram("output/transactionTimeLimit01");
+    delete router;
+    return (okay) ? 0 : 1;
+}
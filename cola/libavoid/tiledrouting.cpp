@@ -0,0 +1,323 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ *
+ * Copyright (C) 2026  agent
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * Licensees holding a valid commercial license may use this file in
+ * accordance with the commercial license agreement provided with the
+ * library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):  agent
+*/
+
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "libavoid/tiledrouting.h"
+#include "libavoid/assertions.h"
+#include "libavoid/connend.h"
+#include "libavoid/junction.h"
+#include "libavoid/obstacle.h"
+#include "libavoid/parallel.h"
+#include "libavoid/router.h"
+#include "libavoid/shape.h"
+#include "libavoid/vertices.h"
+
+namespace Avoid {
+
+
+static bool insideBox(const Box& box, const Point& point)
+{
+    return (point.x >= box.min.x) && (point.x <= box.max.x) &&
+            (point.y >= box.min.y) && (point.y <= box.max.y);
+}
+
+
+// The input for, and results of, routing the connectors within a tile.
+// This holds copies of everything from the main router, so tiles can be
+// routed concurrently.
+struct RoutingTile
+{
+    struct Conn
+    {
+        ConnRef *connRef;
+        Point srcPoint;
+        ConnDirFlags srcDirections;
+        Point dstPoint;
+        ConnDirFlags dstDirections;
+    };
+
+    void route(const Router *router);
+
+    Box bounds;
+    std::vector<std::pair<unsigned int, Polygon> > shapes;
+    std::vector<std::pair<unsigned int, Point> > junctions;
+    std::vector<Conn> conns;
+    // The route for each connector, or an empty route if it left the tile.
+    std::vector<PolyLine> routes;
+};
+
+
+void RoutingTile::route(const Router *router)
+{
+    Router tileRouter(OrthogonalRouting);
+    for (size_t p = 0; p < lastRoutingParameterMarker; ++p)
+    {
+        RoutingParameter parameter = (RoutingParameter) p;
+        tileRouter.setRoutingParameter(parameter,
+                router->routingParameter(parameter));
+    }
+    for (size_t o = 0; o < lastRoutingOptionMarker; ++o)
+    {
+        RoutingOption option = (RoutingOption) o;
+        tileRouter.setRoutingOption(option, router->routingOption(option));
+    }
+    // Crossings are only improved for the whole diagram, and the tile's
+    // router should do everything on this thread.
+    tileRouter.setRoutingParameter(crossingPenalty, 0);
+    tileRouter.setRoutingParameter(fixedSharedPathPenalty, 0);
+    tileRouter.setRoutingOption(performTiledOrthogonalRouting, false);
+    tileRouter.setRoutingOption(performRouteCaching, false);
+    tileRouter.setRoutingThreadCount(1);
+
+    // Objects are given the same IDs as in the main router, so that route
+    // points refer to the same objects.
+    for (size_t i = 0; i < shapes.size(); ++i)
+    {
+        new ShapeRef(&tileRouter, shapes[i].second, shapes[i].first);
+    }
+    for (size_t i = 0; i < junctions.size(); ++i)
+    {
+        JunctionRef *junction = new JunctionRef(&tileRouter,
+                junctions[i].second, junctions[i].first);
+        junction->setPositionFixed(true);
+    }
+    std::vector<ConnRef *> tileConns(conns.size());
+    for (size_t i = 0; i < conns.size(); ++i)
+    {
+        tileConns[i] = new ConnRef(&tileRouter,
+                ConnEnd(conns[i].srcPoint, conns[i].srcDirections),
+                ConnEnd(conns[i].dstPoint, conns[i].dstDirections),
+                conns[i].connRef->id());
+        tileConns[i]->setRoutingType(ConnType_Orthogonal);
+    }
+    tileRouter.processTransaction();
+
+    routes.resize(conns.size());
+    for (size_t i = 0; i < conns.size(); ++i)
+    {
+        const PolyLine& route = tileConns[i]->route();
+        bool inside = !route.empty();
+        for (size_t j = 0; inside && (j < route.size()); ++j)
+        {
+            inside = insideBox(bounds, route.ps[j]);
+        }
+        if (inside)
+        {
+            routes[i] = route;
+        }
+    }
+}
+
+
+TiledOrthogonalRouting::TiledOrthogonalRouting(Router *router)
+    : m_router(router)
+{
+}
+
+
+bool TiledOrthogonalRouting::canRouteInTile(ConnRef *conn) const
+{
+    if ((conn->routingType() != ConnType_Orthogonal) ||
+            conn->hasFixedRoute() || !conn->canSearchPathInIsolation())
+    {
+        return false;
+    }
+    // Connection pins are excluded by canSearchPathInIsolation(), but
+    // also skip endpoints that have no visibility.
+    return (conn->src()->visDirections != ConnDirNone) &&
+            (conn->dst()->visDirections != ConnDirNone);
+}
+
+
+void TiledOrthogonalRouting::execute(const ConnRefSet& excludedConns,
+        ConnRefRouteMap& tiledRoutes)
+{
+    const double tileSize = m_router->routingParameter(routingTileSize);
+    if (tileSize <= 0)
+    {
+        return;
+    }
+    if (m_router->ClusteredRouting && !m_router->clusterRefs.empty() &&
+            (m_router->routingParameter(clusterCrossingPenalty) > 0))
+    {
+        // Tiles' routers don't know about clusters.
+        return;
+    }
+
+    std::vector<ConnRef *> conns;
+    for (ConnRefList::const_iterator i = m_router->connRefs.begin();
+            i != m_router->connRefs.end(); ++i)
+    {
+        ConnRef *conn = *i;
+        if ((excludedConns.find(conn) == excludedConns.end()) &&
+                canRouteInTile(conn))
+        {
+            conns.push_back(conn);
+        }
+    }
+    if (conns.empty())
+    {
+        return;
+    }
+
+    // The tiles cover the extent of the obstacles and connector endpoints.
+    Box extent;
+    extent.min = conns[0]->src()->point;
+    extent.max = extent.min;
+    for (ObstacleList::const_iterator i = m_router->m_obstacles.begin();
+            i != m_router->m_obstacles.end(); ++i)
+    {
+        JunctionRef *junction = dynamic_cast<JunctionRef *> (*i);
+        if (junction && !junction->positionFixed())
+        {
+            // Junctions that are free to move are not treated as obstacles.
+            continue;
+        }
+        Box box = (*i)->routingBox();
+        extent.min.x = std::min(extent.min.x, box.min.x);
+        extent.min.y = std::min(extent.min.y, box.min.y);
+        extent.max.x = std::max(extent.max.x, box.max.x);
+        extent.max.y = std::max(extent.max.y, box.max.y);
+    }
+    for (size_t i = 0; i < conns.size(); ++i)
+    {
+        const Point points[] = { conns[i]->src()->point,
+                conns[i]->dst()->point };
+        for (size_t j = 0; j < 2; ++j)
+        {
+            extent.min.x = std::min(extent.min.x, points[j].x);
+            extent.min.y = std::min(extent.min.y, points[j].y);
+            extent.max.x = std::max(extent.max.x, points[j].x);
+            extent.max.y = std::max(extent.max.y, points[j].y);
+        }
+    }
+    const size_t columns =
+            (size_t) std::floor((extent.max.x - extent.min.x) / tileSize) + 1;
+    const double overlap = tileSize / 4;
+
+    // Assign each connector to the tile containing the centre of its
+    // endpoints, if they both lie within the tile's extended bounds.
+    std::map<size_t, RoutingTile> tilesByIndex;
+    for (size_t i = 0; i < conns.size(); ++i)
+    {
+        const Point& srcPoint = conns[i]->src()->point;
+        const Point& dstPoint = conns[i]->dst()->point;
+        size_t column = (size_t) std::floor(
+                (((srcPoint.x + dstPoint.x) / 2) - extent.min.x) / tileSize);
+        size_t row = (size_t) std::floor(
+                (((srcPoint.y + dstPoint.y) / 2) - extent.min.y) / tileSize);
+        Box bounds;
+        bounds.min.x = extent.min.x + (column * tileSize) - overlap;
+        bounds.min.y = extent.min.y + (row * tileSize) - overlap;
+        bounds.max.x = bounds.min.x + tileSize + (2 * overlap);
+        bounds.max.y = bounds.min.y + tileSize + (2 * overlap);
+        if (!insideBox(bounds, srcPoint) || !insideBox(bounds, dstPoint))
+        {
+            continue;
+        }
+
+        RoutingTile& tile = tilesByIndex[(row * columns) + column];
+        tile.bounds = bounds;
+        RoutingTile::Conn conn = { conns[i], srcPoint,
+                conns[i]->src()->visDirections, dstPoint,
+                conns[i]->dst()->visDirections };
+        tile.conns.push_back(conn);
+    }
+    if (tilesByIndex.empty())
+    {
+        return;
+    }
+
+    std::vector<RoutingTile> tiles;
+    tiles.reserve(tilesByIndex.size());
+    for (std::map<size_t, RoutingTile>::iterator i = tilesByIndex.begin();
+            i != tilesByIndex.end(); ++i)
+    {
+        tiles.push_back(RoutingTile());
+        std::swap(tiles.back(), i->second);
+    }
+    tilesByIndex.clear();
+
+    // Give each tile copies of the obstacles overlapping it.
+    for (size_t t = 0; t < tiles.size(); ++t)
+    {
+        RoutingTile& tile = tiles[t];
+        std::vector<Obstacle *> overlapping;
+        m_router->obstaclesOverlappingBox(tile.bounds, overlapping);
+        for (size_t i = 0; i < overlapping.size(); ++i)
+        {
+            Obstacle *obstacle = overlapping[i];
+            JunctionRef *junction = dynamic_cast<JunctionRef *> (obstacle);
+            if (junction)
+            {
+                if (junction->positionFixed())
+                {
+                    tile.junctions.push_back(std::make_pair(junction->id(),
+                            junction->position()));
+                }
+            }
+            else
+            {
+                tile.shapes.push_back(std::make_pair(obstacle->id(),
+                        obstacle->polygon()));
+            }
+        }
+    }
+
+    struct RouteTileTask
+    {
+        const Router *router;
+        std::vector<RoutingTile>& tiles;
+
+        void operator()(const size_t index, const unsigned int thread)
+        {
+            COLA_UNUSED(thread);
+            tiles[index].route(router);
+        }
+    };
+    RouteTileTask task = { m_router, tiles };
+    unsigned int threads = effectiveThreadCount(
+            m_router->routingThreadCount(), tiles.size());
+    parallelFor(m_router->threadPool(), tiles.size(), threads, task);
+
+    for (size_t t = 0; t < tiles.size(); ++t)
+    {
+        RoutingTile& tile = tiles[t];
+        for (size_t i = 0; i < tile.conns.size(); ++i)
+        {
+            if (!tile.routes[i].empty())
+            {
+                tiledRoutes[tile.conns[i].connRef] = tile.routes[i];
+            }
+        }
+    }
+}
+
+
+}
+
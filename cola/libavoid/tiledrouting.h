@@ -0,0 +1,80 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ *
+ * Copyright (C) 2026  agent
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * Licensees holding a valid commercial license may use this file in
+ * accordance with the commercial license agreement provided with the
+ * library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):  agent
+*/
+
+// Tiled orthogonal routing, used for the performTiledOrthogonalRouting
+// option.
+//
+// The extent of the diagram is split into a grid of tiles of size
+// routingTileSize, each extended by a quarter of this on every side so
+// that neighbouring tiles overlap.  An orthogonal connector is routed
+// within the tile containing the centre of its endpoints if both
+// endpoints lie within that tile's extended bounds.  Each tile is routed
+// by a private Router holding just the obstacles overlapping the tile and
+// the tile's connectors, so it only builds a visibility graph for that
+// part of the diagram.  The tiles' routers are independent, so they are
+// run concurrently.
+//
+// A route found within a tile is only valid if it stays within the tile's
+// bounds, since obstacles outside these are not known to the tile's
+// router.  Connectors whose routes leave their tile are routed as usual.
+
+
+#ifndef AVOID_TILEDROUTING_H
+#define AVOID_TILEDROUTING_H
+
+#include <map>
+
+#include "libavoid/geomtypes.h"
+#include "libavoid/connector.h"
+#include "libavoid/hyperedge.h"
+
+
+namespace Avoid {
+
+class Router;
+
+typedef std::map<ConnRef *, PolyLine> ConnRefRouteMap;
+
+class TiledOrthogonalRouting
+{
+    public:
+        TiledOrthogonalRouting(Router *router);
+        // Routes the connectors needing rerouting, other than those in
+        // excludedConns, that can be routed within a tile, giving their
+        // routes in tiledRoutes.  The connectors themselves are not
+        // changed, see ConnRef::generatePathFromTile().
+        void execute(const ConnRefSet& excludedConns,
+                ConnRefRouteMap& tiledRoutes);
+
+    private:
+        bool canRouteInTile(ConnRef *conn) const;
+
+        Router *m_router;
+};
+
+
+}
+
+#endif
+
@@ -23,166 +23,181 @@
 */
 
 
+
 #include <cstdio>
-#include <cstdlib>
-#include <climits>
 
 #include "libavoid/timer.h"
-#include "libavoid/debug.h"
+#include "libavoid/router.h"
 #include "libavoid/assertions.h"
 
 namespace Avoid {
 
-#ifdef AVOID_PROFILE
 
-Timer::Timer()
+static const char* timerNames[] =
+{
+    "Transaction",
+    "ProcessActions",
+    "OrthogGraph",
+    "OrthogRoute",
+    "Crossings",
+    "HyperedgeForest",
+    "HyperedgeMTST",
+    "HyperedgeAlt",
+    "HyperedgeImprove",
+    "OrthogCentre",
+    "OrthogNudge"
+};
+
+
+const char *timerIndexName(const TimerIndex phase)
+{
+    COLA_ASSERT(phase < tmCount);
+    return timerNames[phase];
+}
+
+
+RouterProfile::RouterProfile()
 {
-    reset();
+    clear();
 }
 
 
-void Timer::reset(void)
+void RouterProfile::clear(void)
 {
     for (size_t i = 0; i < tmCount; ++i)
     {
-        m_total_time[i] =  0;
-        m_tally[i] = 0;
-        m_max_time[i] = 0;
-        for (size_t j = 0; j < TIMER_VARIABLES_COUNT; ++j)
-        {
-            m_variables[i][j] = 0;
-        }
+        phaseTime[i] = 0;
+        phaseCount[i] = 0;
     }
-    m_is_running = false;
-    m_type = m_last_type = tmCount;
+    visGraphVertices = 0;
+    visGraphEdges = 0;
+    orthogVisGraphEdges = 0;
+    aStarNodesExpanded = 0;
+    vpscSolves = 0;
+    nudgingRetries = 0;
+    events.clear();
 }
 
 
-void Timer::initialise(const TimerIndex t)
+Profiler::Profiler()
+    : m_enabled(false),
+      m_transaction_start_time(Clock::now()),
+      m_astar_nodes_expanded(0),
+      m_vpsc_solves(0),
+      m_nudging_retries(0)
 {
-    COLA_ASSERT(t != tmCount);
-    COLA_ASSERT(m_type == tmCount);
-    
-    m_type = t;
 }
 
-void Timer::start(void)
+
+void Profiler::setEnabled(const bool enabled)
 {
-    COLA_ASSERT(!m_is_running);
-    m_start_time[m_type] = clock();  // CPU time
-    m_is_running = true;
+    m_enabled = enabled;
 }
 
 
-void Timer::stop(void)
+double Profiler::msecSinceTransactionStart(const Clock::time_point& time) const
 {
-    COLA_ASSERT(m_is_running);
-    clock_t stopTime = clock();      // CPU time
-    m_is_running = false;
+    return std::chrono::duration<double, std::milli>(
+            time - m_transaction_start_time).count();
+}
 
-    bigclock_t timeDiff;
-    if (stopTime < m_start_time[m_type])
-    {
-        // Uh-oh, the clock value has wrapped around.
-        //
-        bigclock_t realStopTime = ((bigclock_t) stopTime) + ULONG_MAX + 1;
-        timeDiff = realStopTime - m_start_time[m_type];
-    }
-    else
+
+void Profiler::beginTransaction(void)
+{
+    if (!m_enabled)
     {
-        timeDiff = stopTime - m_start_time[m_type];
+        return;
     }
-    
-    COLA_ASSERT(timeDiff < LONG_MAX);
+    m_profile.clear();
+    m_running.clear();
+    m_astar_nodes_expanded = 0;
+    m_vpsc_solves = 0;
+    m_nudging_retries = 0;
+    m_transaction_start_time = Clock::now();
+    start(tmTransaction);
+}
+
 
-    m_total_time[m_type] += timeDiff;
-    m_tally[m_type]++;
-    if (((clock_t) timeDiff) > m_max_time[m_type])
+void Profiler::stop(void)
+{
+    if (!m_enabled || m_running.empty())
     {
-        m_max_time[m_type] = (clock_t) timeDiff;
+        return;
     }
-    m_last_type = m_type;
+    ProfileEvent& event = m_profile.events[m_running.back()];
+    m_running.pop_back();
 
-    m_type = tmCount;
+    event.duration = msecSinceTransactionStart(Clock::now()) - event.start;
+    m_profile.phaseTime[event.phase] += event.duration;
+    ++m_profile.phaseCount[event.phase];
 }
 
-static const char* timerNames[] =
-{
-    "Adds",
-    "Dels",
-    "Movs",
-    "Pths",
-    "OrthogGraph",
-    "OrthogRoute",
-    "OrthogCentre",
-    "OrthogNudge",
-    "HyperedgeForest",
-    "HyperedgeMTST",
-    "HyperedgeImprove",
-    "HyperedgeAlt"
-};
 
-
-void Timer::printAll(FILE *fp)
+void Profiler::endTransaction(const Router *router)
 {
-    for (unsigned int i = 0; i < tmCount; i++)
+    if (!m_enabled)
+    {
+        return;
+    }
+    // Stop the tmTransaction phase, and any left running.
+    while (!m_running.empty())
     {
-        fprintf(fp, "%s:  ", timerNames[i]);
-        print((TimerIndex) i, fp);
+        stop();
     }
-    fprintf(fp, "\n");
+
+    m_profile.visGraphVertices = router->vertices.connsSize() + 
+            router->vertices.shapesSize();
+    m_profile.visGraphEdges = router->visGraph.size();
+    m_profile.orthogVisGraphEdges = router->visOrthogGraph.size();
+    m_profile.aStarNodesExpanded = m_astar_nodes_expanded;
+    m_profile.vpscSolves = m_vpsc_solves;
+    m_profile.nudgingRetries = m_nudging_retries;
 }
 
-#define toMsec(tot) ((bigclock_t) ((tot) / (((double) CLOCKS_PER_SEC) / 1000)))
-#define toAvg(tot, cnt) ((((cnt) > 0) ? ((long double) (tot)) / (cnt) : 0))
 
-void Timer::printHyperedgePaper(FILE *fp)
+const RouterProfile& Profiler::profile(void) const
 {
-    fprintf(fp, "%5lld & %5lld & %5lld & %5lld\n\n",
-        toMsec(m_total_time[tmOrthogGraph]),
-        toMsec(m_total_time[tmHyperedgeForest] + m_total_time[tmHyperedgeMTST]),
-        toMsec(m_total_time[tmHyperedgeAlt]),
-        toMsec(m_total_time[tmHyperedgeImprove]));
+    return m_profile;
 }
 
-void Timer::print(const TimerIndex t, FILE *fp)
-{
-    bigclock_t avg = toMsec(toAvg(m_total_time[t], m_tally[t]));
-    clock_t max = toMsec(m_max_time[t]); 
-    fprintf(fp, "%lld %d %lld %ld",
-            toMsec(m_total_time[t]), m_tally[t], avg, max);
-    
-    for (size_t j = 0; j < TIMER_VARIABLES_COUNT; ++j)
-    {
-        if (m_variables[t][j] > 0)
-        {
-            fprintf(fp, ", %lu: %u", j, m_variables[t][j]);
-        }
-    }
-    fprintf(fp, "\n");
-}
 
-void Timer::varIncrement(size_t i, unsigned int val)
+bool Profiler::outputChromeTrace(const std::string& filename) const
 {
-    COLA_ASSERT(i < TIMER_VARIABLES_COUNT);
-    
-    if (m_is_running)
+    FILE *fp = fopen(filename.c_str(), "w");
+    if (fp == nullptr)
     {
-        m_variables[m_type][i] += val;
+        return false;
     }
-}
-
-void Timer::varMax(size_t i, unsigned int val)
-{
-    COLA_ASSERT(i < TIMER_VARIABLES_COUNT);
 
-    if (m_is_running)
+    // Each phase is output as a complete ("X") event, with times in usec.
+    fprintf(fp, "{\"traceEvents\":[\n");
+    for (size_t i = 0; i < m_profile.events.size(); ++i)
     {
-        m_variables[m_type][i] = std::max(m_variables[m_type][i], val);
+        const ProfileEvent& event = m_profile.events[i];
+        fprintf(fp, "{\"name\":\"%s\",\"cat\":\"libavoid\",\"ph\":\"X\","
+                "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1", 
+                timerIndexName(event.phase), event.start * 1000, 
+                event.duration * 1000);
+        if (event.phase == tmTransaction)
+        {
+            fprintf(fp, ",\"args\":{\"visGraphVertices\":%zu,"
+                    "\"visGraphEdges\":%zu,\"orthogVisGraphEdges\":%zu,"
+                    "\"aStarNodesExpanded\":%zu,\"vpscSolves\":%zu,"
+                    "\"nudgingRetries\":%zu}",
+                    m_profile.visGraphVertices, m_profile.visGraphEdges,
+                    m_profile.orthogVisGraphEdges, 
+                    m_profile.aStarNodesExpanded, m_profile.vpscSolves, 
+                    m_profile.nudgingRetries);
+        }
+        fprintf(fp, "}%s\n", ((i + 1) < m_profile.events.size()) ? "," : "");
     }
+    fprintf(fp, "],\"displayTimeUnit\":\"ms\"}\n");
+
+    bool success = (ferror(fp) == 0);
+    fclose(fp);
+    return success;
 }
 
-#endif
 
 }
 
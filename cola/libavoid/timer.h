@@ -23,81 +23,186 @@
 */
 
 
-#ifndef AVOID_TIMER_H
-#define AVOID_TIMER_H
+//! @file    timer.h
+//! @brief   Contains the interface for the router's phase profiler.
 
-#include <ctime>
 
-namespace Avoid {
+#ifndef AVOID_TIMER_H
+#define AVOID_TIMER_H
 
-//#define AVOID_PROFILE
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
 
-#ifndef AVOID_PROFILE
+#include "libavoid/dllexport.h"
 
-  #define TIMER_START(r, t) do {} while(0)
-  #define TIMER_STOP(r) do {} while(0)
-  #define TIMER_VAR_ADD(r, n, v) do {} while(0)
-  #define TIMER_VAR_MAX(r, n, v) do {} while(0)
+namespace Avoid {
 
-#else
-   
-  #define TIMER_START(r, t) r->timers.initialise(t); r->timers.start()
-  #define TIMER_STOP(r) r->timers.stop()
-  #define TIMER_VAR_ADD(r, n, v) r->timers.varIncrement(n, v);
-  #define TIMER_VAR_MAX(r, n, v) r->timers.varMax(n, v)
+class Router;
 
-typedef unsigned long long int bigclock_t;
+// Times the enclosed phase if profiling is enabled for the router.  These 
+// may be nested, but must only be used from the thread that called 
+// Router::processTransaction().
+#define TIMER_START(r, t) (r)->profiler.start(t)
+#define TIMER_STOP(r) (r)->profiler.stop()
 
+//! @brief  Phases of a transaction timed by the router's profiler.
+//!
+//! Phases may be nested within others, e.g., all are within 
+//! tmTransaction, and tmOrthogCentre is within tmOrthogNudge.
+//!
 enum TimerIndex 
 {
-    tmAdd,
-    tmDel,
-    tmMov,
-    tmPth,
+    //! @brief  The whole of Router::processTransaction().
+    tmTransaction,
+    //! @brief  Processing shape and junction additions, moves and removals.
+    tmProcessActions,
+    //! @brief  Building the orthogonal visibility graph.
     tmOrthogGraph,
+    //! @brief  Searching for the route of a connector.
     tmOrthogRoute,
-    tmOrthogCentre,
-    tmOrthogNudge,
+    //! @brief  Detecting and rerouting crossing connectors.
+    tmCrossings,
+    //! @brief  Building the forest for hyperedge rerouting.
     tmHyperedgeForest,
+    //! @brief  Building the minimum terminal spanning tree for hyperedge
+    //!         rerouting.
     tmHyperedgeMTST,
-    tmHyperedgeImprove,
+    //! @brief  Building the alternative minimum terminal spanning tree
+    //!         for hyperedge rerouting.
     tmHyperedgeAlt,
+    //! @brief  Improving hyperedge routes.
+    tmHyperedgeImprove,
+    //! @brief  Unifying (centring) orthogonal segments, prior to nudging.
+    tmOrthogCentre,
+    //! @brief  Nudging orthogonal segments apart.
+    tmOrthogNudge,
     tmCount
 };
 
-static const bool timerStart = true;
-static const bool timerDelay = false;
+//! @brief  Returns a short name for a profiled phase.
+//!
+AVOID_EXPORT const char *timerIndexName(const TimerIndex phase);
+
+//! @brief  A single timed occurrence of a phase.
+//!
+struct ProfileEvent
+{
+    TimerIndex phase;
+    //! @brief  The start time in msec, relative to the transaction start.
+    double start;
+    //! @brief  The wall-clock duration in msec.
+    double duration;
+};
+
+//! @brief  The timings and work counts recorded by the router's profiler
+//!         for the most recent transaction.
+//!
+//! @sa  Router::setProfilingEnabled()
+//!
+struct AVOID_EXPORT RouterProfile
+{
+    RouterProfile();
+    void clear(void);
+
+    //! @brief  The total wall-clock time in msec spent in each phase.
+    double phaseTime[tmCount];
+    //! @brief  The number of times each phase was performed.
+    unsigned int phaseCount[tmCount];
+
+    //! @brief  The number of vertices in the visibility graphs.
+    size_t visGraphVertices;
+    //! @brief  The number of edges in the polyline visibility graph.
+    size_t visGraphEdges;
+    //! @brief  The number of edges in the orthogonal visibility graph.
+    size_t orthogVisGraphEdges;
+    //! @brief  The number of nodes expanded by A* route searches.
+    size_t aStarNodesExpanded;
+    //! @brief  The number of VPSC problems solved during nudging.
+    size_t vpscSolves;
+    //! @brief  The number of times a nudging problem was re-solved with
+    //!         reduced separation or an additional constraint.
+    size_t nudgingRetries;
+
+    //! @brief  Each timed phase, in the order they were started.
+    std::vector<ProfileEvent> events;
+};
 
-static const size_t TIMER_VARIABLES_COUNT = 2;
 
-class Timer
+// NOTE: This is an internal helper class that should not be used by the user.
+//
+// Records the profile of each transaction for the Router when enabled.
+// The work counters may be updated concurrently by routing threads.
+//
+class Profiler
 {
     public:
-        Timer();
-        void initialise(const TimerIndex t);
-        void start(void);
+        Profiler();
+        void setEnabled(const bool enabled);
+        bool enabled(void) const;
+
+        void beginTransaction(void);
+        void endTransaction(const Router *router);
+        void start(const TimerIndex phase);
         void stop(void);
-        void reset(void);
-        void varIncrement(size_t i, unsigned int val);
-        void varMax(size_t i, unsigned int val);
 
-        void print(TimerIndex, FILE *fp);
-        void printAll(FILE *fp);
-        void printHyperedgePaper(FILE *fp);
+        void countAStarNodesExpanded(const size_t nodes);
+        void countVpscSolves(const size_t solves, const size_t retries);
+
+        const RouterProfile& profile(void) const;
+        bool outputChromeTrace(const std::string& filename) const;
 
     private:
-        clock_t m_start_time[tmCount];
-        bigclock_t m_total_time[tmCount];
-        int m_tally[tmCount];
-        clock_t m_max_time[tmCount];
-        unsigned int m_variables[tmCount][TIMER_VARIABLES_COUNT];
-
-        bool m_is_running;
-        TimerIndex m_type;
-        TimerIndex m_last_type;
+        typedef std::chrono::steady_clock Clock;
+        double msecSinceTransactionStart(const Clock::time_point& time) const;
+
+        bool m_enabled;
+        Clock::time_point m_transaction_start_time;
+        // Indexes into m_profile.events of the currently running phases.
+        std::vector<size_t> m_running;
+        std::atomic<size_t> m_astar_nodes_expanded;
+        std::atomic<size_t> m_vpsc_solves;
+        std::atomic<size_t> m_nudging_retries;
+        RouterProfile m_profile;
 };
 
-#endif
+inline bool Profiler::enabled(void) const
+{
+    return m_enabled;
+}
+
+inline void Profiler::start(const TimerIndex phase)
+{
+    if (m_enabled)
+    {
+        ProfileEvent event;
+        event.phase = phase;
+        event.start = msecSinceTransactionStart(Clock::now());
+        event.duration = 0;
+        m_running.push_back(m_profile.events.size());
+        m_profile.events.push_back(event);
+    }
+}
+
+inline void Profiler::countAStarNodesExpanded(const size_t nodes)
+{
+    if (m_enabled)
+    {
+        m_astar_nodes_expanded.fetch_add(nodes, std::memory_order_relaxed);
+    }
+}
+
+inline void Profiler::countVpscSolves(const size_t solves, 
+        const size_t retries)
+{
+    if (m_enabled)
+    {
+        m_vpsc_solves.fetch_add(solves, std::memory_order_relaxed);
+        m_nudging_retries.fetch_add(retries, std::memory_order_relaxed);
+    }
+}
 
 }
 
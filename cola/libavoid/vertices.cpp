@@ -169,7 +169,9 @@ VertInf::VertInf(Router *router, const VertID& vid, const Point& vpoint,
       m_orthogonalPartner(nullptr),
       m_treeRoot(nullptr),
       visDirections(ConnDirNone),
-      orthogVisPropFlags(0)
+      orthogVisPropFlags(0),
+      compactIndex(CompactVisGraph::noIndex),
+      creationOrder(router->m_vertices_created++)
 {
     point.id = vid.objID;
     point.vn = vid.vn;
@@ -184,6 +186,52 @@ VertInf::VertInf(Router *router, const VertID& vid, const Point& vpoint,
 VertInf::~VertInf()
 {
     COLA_ASSERT(orphaned());
+
+    if (id != dummyOrthogID)
+    {
+        // Logged changes may refer to this vertex, so can't be used now.
+        _router->visGraphChanges.discard();
+    }
+}
+
+
+void *VertInf::operator new(size_t size, Router *router)
+{
+    COLA_ASSERT(size == sizeof(VertInf));
+    COLA_UNUSED(size);
+    return router->m_vertex_pool.allocate();
+}
+
+
+void *VertInf::operator new(size_t size, Router *router,
+        OrthogonalGraphVertexTag tag)
+{
+    COLA_ASSERT(size == sizeof(VertInf));
+    COLA_UNUSED(size);
+    COLA_UNUSED(tag);
+    return router->m_orthogonal_vertex_pool.allocate();
+}
+
+
+void VertInf::operator delete(void *ptr)
+{
+    MemoryPool::deallocate(ptr);
+}
+
+
+void VertInf::operator delete(void *ptr, Router *router)
+{
+    COLA_UNUSED(router);
+    MemoryPool::deallocate(ptr);
+}
+
+
+void VertInf::operator delete(void *ptr, Router *router,
+        OrthogonalGraphVertexTag tag)
+{
+    COLA_UNUSED(router);
+    COLA_UNUSED(tag);
+    MemoryPool::deallocate(ptr);
 }
 
 
@@ -207,6 +255,9 @@ void VertInf::Reset(const VertID& vid, const Point& vpoint)
     point = vpoint;
     point.id = id.objID;
     point.vn = id.vn;
+    invalidateCompactIndex();
+    updateEdgeIndex();
+    _router->visGraphChanges.recordVertexMove(this);
 }
 
 
@@ -215,6 +266,40 @@ void VertInf::Reset(const Point& vpoint)
     point = vpoint;
     point.id = id.objID;
     point.vn = id.vn;
+    invalidateCompactIndex();
+    updateEdgeIndex();
+    _router->visGraphChanges.recordVertexMove(this);
+}
+
+
+// Removes this vertex and its visibility neighbours from the router's 
+// CompactVisGraph, since the snapshot describes their edges using the 
+// vertex's old ID and position.
+void VertInf::invalidateCompactIndex(void)
+{
+    compactIndex = CompactVisGraph::noIndex;
+    EdgeInfList *lists[] = { &visList, &orthogVisList };
+    for (size_t i = 0; i < 2; ++i)
+    {
+        EdgeInfList::const_iterator finish = lists[i]->end();
+        for (EdgeInfList::const_iterator edge = lists[i]->begin(); 
+                edge != finish; ++edge)
+        {
+            (*edge)->otherVert(this)->compactIndex = CompactVisGraph::noIndex;
+        }
+    }
+}
+
+
+// Updates the router's spatial index for visibility edges that end at
+// this vertex, after it has been moved.
+void VertInf::updateEdgeIndex(void)
+{
+    for (EdgeInfList::const_iterator edge = visList.begin();
+            edge != visList.end(); ++edge)
+    {
+        _router->indexEdge(*edge);
+    }
 }
 
 
@@ -705,6 +790,12 @@ VertInf *VertInfList::shapesBegin(void)
 }
 
 
+VertInf *VertInfList::shapesLast(void)
+{
+    return _lastShapeVert;
+}
+
+
 VertInf *VertInfList::connsBegin(void)
 {
     if (_firstConnVert)
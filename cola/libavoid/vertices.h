@@ -110,14 +110,25 @@ class VertID
 static const VertID dummyOrthogID(0, 0);
 static const VertID dummyOrthogShapeID(0, 0, VertID::PROP_OrthShapeEdge);
 
-class ANode;
-
 class VertInf
 {
     public:
         VertInf(Router *router, const VertID& vid, const Point& vpoint,
                 const bool addToRouter = true);
         ~VertInf();
+        // Vertices are allocated from their router's memory pool, i.e.,
+        // new (router) VertInf(router, vid, vpoint).  Dummy vertices of
+        // the orthogonal visibility graph instead use new (router, 
+        // OrthogonalGraphVertex), which takes them from a pool that is 
+        // reset when the graph is discarded.
+        enum OrthogonalGraphVertexTag { OrthogonalGraphVertex };
+        static void *operator new(size_t size, Router *router);
+        static void *operator new(size_t size, Router *router,
+                OrthogonalGraphVertexTag tag);
+        static void operator delete(void *ptr);
+        static void operator delete(void *ptr, Router *router);
+        static void operator delete(void *ptr, Router *router,
+                OrthogonalGraphVertexTag tag);
         void Reset(const VertID& vid, const Point& vpoint);
         void Reset(const Point& vpoint);
         void removeFromGraph(const bool isConnVert = true);
@@ -164,11 +175,19 @@ class VertInf
         double sptfDist;
 
         ConnDirFlags visDirections;
-        std::list<ANode *> aStarDoneNodes;
-        std::list<ANode *> aStarPendingNodes;
         // Flags for orthogonal visibility properties, i.e., whether the 
         // line points to a shape edge, connection point or an obstacle.
         unsigned int orthogVisPropFlags;
+        // Index of this vertex in the router's CompactVisGraph, or
+        // CompactVisGraph::noIndex if its edges have since changed.
+        unsigned int compactIndex;
+        // The order in which the router created this vertex.  Used to 
+        // order vertices at the same position independently of where 
+        // they happen to have been allocated.
+        unsigned int creationOrder;
+    private:
+        void invalidateCompactIndex(void);
+        void updateEdgeIndex(void);
 };
 
 
@@ -181,6 +200,9 @@ static const unsigned int YL_EDGE = 16;
 static const unsigned int YL_CONN = 32;
 static const unsigned int YH_EDGE = 64;
 static const unsigned int YH_CONN = 128;
+// Whether the vertex is a breakpoint of a horizontal or vertical line.
+static const unsigned int X_LINE = 256;
+static const unsigned int Y_LINE = 512;
 
 
 bool directVis(VertInf *src, VertInf *dst);
@@ -200,6 +222,8 @@ class VertInfList
         VertInf *getVertexByID(const VertID& id);
         VertInf *getVertexByPos(const Point& p);
         VertInf *shapesBegin(void);
+        // The last shape vertex, after which new ones are added.
+        VertInf *shapesLast(void);
         VertInf *connsBegin(void);
         VertInf *end(void);
         unsigned int connsSize(void) const;
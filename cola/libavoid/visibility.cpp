@@ -32,7 +32,9 @@
 
 
 #include <algorithm>
+#include <unordered_map>
 #include <cfloat>
+#include <vector>
 
 #include "libavoid/shape.h"
 #include "libavoid/debug.h"
@@ -42,12 +44,28 @@
 #include "libavoid/geometry.h"
 #include "libavoid/router.h"
 #include "libavoid/assertions.h"
+#include "libavoid/parallel.h"
 
 
 namespace Avoid {
 
 
+// The outcome of a rotational sweep for the visibility between its centre
+// vertex and one other vertex.
+struct SweepVisibility
+{
+    VertInf *vert;
+    double dist;
+    int blocker;
+    bool inValidRegion;
+    bool visible;
+};
+typedef std::vector<SweepVisibility> SweepVisibilityList;
+
 static void vertexSweep(VertInf *vert);
+static void computeVertexSweep(VertInf *vert, SweepVisibilityList& results);
+static void addVertexSweepEdges(VertInf *centerInf,
+        const SweepVisibilityList& results);
 
 void Obstacle::computeVisibilityNaive(void)
 {
@@ -323,7 +341,7 @@ class isBoundingShape
 {
     public:
         // Class instance remembers the ShapeSet.
-        isBoundingShape(ShapeSet& set) : 
+        isBoundingShape(const ShapeSet& set) : 
             ss(set)
         { }
         // The following is an overloading of the function call operator.
@@ -343,10 +361,25 @@ class isBoundingShape
         isBoundingShape & operator=(isBoundingShape const &);
         isBoundingShape();
 
-        ShapeSet& ss;
+        const ShapeSet& ss;
 };
 
 
+// Returns the set of shapes containing the given vertex.  This doesn't
+// add an entry to the contains map, so can be used by concurrent sweeps.
+static const ShapeSet& containingShapes(Router *router, const VertID& id)
+{
+    static const ShapeSet noShapes;
+
+    ContainsMap::const_iterator found = router->contains.find(id);
+    if (found == router->contains.end())
+    {
+        return noShapes;
+    }
+    return found->second;
+}
+
+
 static bool sweepVisible(SweepEdgeList& T, const PointPair& point, 
         std::set<unsigned int>& onBorderIDs, int *blocker)
 {
@@ -382,7 +415,7 @@ static bool sweepVisible(SweepEdgeList& T, const PointPair& point,
     {
         // It's a connector endpoint, so we have to ignore 
         // edges of containing shapes for determining visibility.
-        ShapeSet& rss = router->contains[point.vInf->id];
+        const ShapeSet& rss = containingShapes(router, point.vInf->id);
         while (closestIt != end)
         {
             if (rss.find(closestIt->vInf1->id.objID) == rss.end())
@@ -434,6 +467,19 @@ static bool sweepVisible(SweepEdgeList& T, const PointPair& point,
 
 
 static void vertexSweep(VertInf *vert)
+{
+    SweepVisibilityList results;
+    computeVertexSweep(vert, results);
+    addVertexSweepEdges(vert, results);
+}
+
+
+// Performs the rotational sweep around vert, recording the visibility to
+// each other vertex in results, in the order the sweep reaches them.  
+// This only reads the router's state, leaving the visibility graph to be 
+// updated afterwards by addVertexSweepEdges().
+//
+static void computeVertexSweep(VertInf *vert, SweepVisibilityList& results)
 {
     Router *router = vert->_router;
     VertID& pID = vert->id;
@@ -448,7 +494,7 @@ static void vertexSweep(VertInf *vert)
     VertSet v;
 
     // Initialise the vertex list
-    ShapeSet& ss = router->contains[centerID];
+    const ShapeSet& ss = containingShapes(router, centerID);
     VertInf *beginVert = router->vertices.connsBegin();
     VertInf *endVert = router->vertices.end();
     for (VertInf *inf = beginVert; inf != endVert; inf = inf->lstNext)
@@ -571,12 +617,6 @@ static void vertexSweep(VertInf *vert)
 
         const double& currDist = (*t).distance;
 
-        EdgeInf *edge = EdgeInf::existingEdge(centerInf, currInf);
-        if (edge == nullptr)
-        {
-            edge = new EdgeInf(centerInf, currInf);
-        }
-
         for (SweepEdgeList::iterator c = e.begin(); c != e.end(); ++c)
         {
             (*c).setCurrAngle(*t);
@@ -601,36 +641,9 @@ static void vertexSweep(VertInf *vert)
                     currInf->shNext->point, centerPoint);
         }
 
-        if (!cone1 || !cone2)
-        {
-            if (router->InvisibilityGrph)
-            {
-                db_printf("\tSetting invisibility edge... \n\t\t");
-                edge->addBlocker(0);
-                edge->db_print();
-            }
-        }
-        else
-        {
-            if (currVisible)
-            {
-                db_printf("\tSetting visibility edge... \n\t\t");
-                edge->setDist(currDist);
-                edge->db_print();
-            }
-            else if (router->InvisibilityGrph)
-            {
-                db_printf("\tSetting invisibility edge... \n\t\t");
-                edge->addBlocker(blocker);
-                edge->db_print();
-            }
-        }
-        
-        if (!(edge->added()) && !(router->InvisibilityGrph))
-        {
-            delete edge;
-            edge = nullptr;
-        }
+        SweepVisibility result = { currInf, currDist, blocker, 
+                (cone1 && cone2), currVisible };
+        results.push_back(result);
 
         if (!(currID.isConnPt()))
         {
@@ -672,5 +685,174 @@ static void vertexSweep(VertInf *vert)
 }
 
 
+// Adds or updates the visibility graph edges from centerInf for the 
+// results of a sweep computed by computeVertexSweep().
+//
+static void addVertexSweepEdges(VertInf *centerInf,
+        const SweepVisibilityList& results)
+{
+    Router *router = centerInf->_router;
+
+    SweepVisibilityList::const_iterator finish = results.end();
+    for (SweepVisibilityList::const_iterator curr = results.begin(); 
+            curr != finish; ++curr)
+    {
+        VertInf *currInf = curr->vert;
+
+        EdgeInf *edge = EdgeInf::existingEdge(centerInf, currInf);
+        if (edge == nullptr)
+        {
+            edge = new (router) EdgeInf(centerInf, currInf);
+        }
+
+        if (!curr->inValidRegion)
+        {
+            if (router->InvisibilityGrph)
+            {
+                db_printf("\tSetting invisibility edge... \n\t\t");
+                edge->addBlocker(0);
+                edge->db_print();
+            }
+        }
+        else
+        {
+            if (curr->visible)
+            {
+                db_printf("\tSetting visibility edge... \n\t\t");
+                edge->setDist(curr->dist);
+                edge->db_print();
+            }
+            else if (router->InvisibilityGrph)
+            {
+                db_printf("\tSetting invisibility edge... \n\t\t");
+                edge->addBlocker(curr->blocker);
+                edge->db_print();
+            }
+        }
+        
+        if (!(edge->added()) && !(router->InvisibilityGrph))
+        {
+            delete edge;
+            edge = nullptr;
+        }
+    }
+}
+
+
+void Obstacle::computeVisibilitySweeps(
+        const std::vector<Obstacle *>& obstacles,
+        const unsigned int threadCount)
+{
+    if (obstacles.empty())
+    {
+        return;
+    }
+    Router *router = obstacles.front()->router();
+
+    // The vertices to sweep around, in the order they would be swept by 
+    // calling Obstacle::computeVisibilitySweep() for each obstacle.
+    std::vector<VertInf *> verts;
+    std::vector<size_t> obstacleVertsEnd;
+    for (size_t i = 0; i < obstacles.size(); ++i)
+    {
+        VertInf *endIter = obstacles[i]->lastVert()->lstNext;
+        for (VertInf *vert = obstacles[i]->firstVert(); vert != endIter; 
+                vert = vert->lstNext)
+        {
+            verts.push_back(vert);
+        }
+        obstacleVertsEnd.push_back(verts.size());
+    }
+
+    // The position of each obstacle in the order.  The sweep from a vertex
+    // computes its visibility to the vertices of obstacles later in the 
+    // order too, but those results would be replaced by the later sweeps
+    // from the other end, so they are dropped rather than being applied.
+    std::unordered_map<unsigned int, size_t> obstacleOrder;
+    for (size_t i = 0; i < obstacles.size(); ++i)
+    {
+        obstacleOrder[obstacles[i]->id()] = i;
+    }
+
+    struct SweepTask
+    {
+        std::vector<VertInf *>& verts;
+        std::vector<SweepVisibilityList>& results;
+        const std::unordered_map<unsigned int, size_t>& obstacleOrder;
+        size_t chunkStart;
+
+        void operator()(const size_t index, const unsigned int thread)
+        {
+            COLA_UNUSED(thread);
+            VertInf *vert = verts[chunkStart + index];
+            SweepVisibilityList& vertResults = results[index];
+            computeVertexSweep(vert, vertResults);
+
+            size_t order = obstacleOrder.find(vert->id.objID)->second;
+            size_t kept = 0;
+            for (size_t i = 0; i < vertResults.size(); ++i)
+            {
+                const VertID& otherID = vertResults[i].vert->id;
+                if (!otherID.isConnPt())
+                {
+                    std::unordered_map<unsigned int, size_t>::const_iterator 
+                            other = obstacleOrder.find(otherID.objID);
+                    if ((other != obstacleOrder.end()) && 
+                            (other->second > order))
+                    {
+                        continue;
+                    }
+                }
+                vertResults[kept++] = vertResults[i];
+            }
+            vertResults.resize(kept);
+        }
+    };
+
+    // The sweeps are performed in chunks, so that the results waiting to 
+    // be added to the graph only need memory for a few hundred vertices.
+    const size_t chunkSize = 256;
+    std::vector<SweepVisibilityList> results;
+    SweepTask task = { verts, results, obstacleOrder, 0 };
+    size_t obstacleIndex = 0;
+    size_t obstacleStart = 0;
+    while (task.chunkStart < verts.size())
+    {
+        size_t chunkEnd = std::min(task.chunkStart + chunkSize, verts.size());
+        results.clear();
+        results.resize(chunkEnd - task.chunkStart);
+
+        unsigned int threads = effectiveThreadCount(threadCount, 
+                results.size());
+        parallelFor(router->threadPool(), results.size(), threads, 
+                task);
+
+        // Add the edges in order, clearing each obstacle from the graph
+        // before its first vertex, as computeVisibilitySweep() would.
+        // The visibility of each obstacle's connection pins is updated 
+        // after its last vertex, as the sweeps from pins and from shape
+        // vertices don't always agree and the later one takes precedence.
+        for (size_t v = task.chunkStart; v < chunkEnd; ++v)
+        {
+            while (obstacleVertsEnd[obstacleIndex] == v)
+            {
+                obstacleStart = obstacleVertsEnd[obstacleIndex];
+                ++obstacleIndex;
+            }
+            if ((v == obstacleStart) && !(router->InvisibilityGrph))
+            {
+                obstacles[obstacleIndex]->removeFromGraph();
+            }
+            addVertexSweepEdges(verts[v], results[v - task.chunkStart]);
+            if (obstacleVertsEnd[obstacleIndex] == (v + 1))
+            {
+                obstacles[obstacleIndex]->updatePinPolyLineVisibility();
+            }
+        }
+        task.chunkStart = chunkEnd;
+    }
+}
+
+
 }
 
@@ -39,6 +39,7 @@
 
 #ifndef USELIBVPSC
 
+#include <algorithm>
 #include <iostream>
 #include <cmath>
 #include <sstream>
@@ -103,6 +104,64 @@ void IncSolver::addConstraint(Constraint *c)
     c->needsScaling = needsScaling;
 }
 
+/*
+ * Removes a constraint that was previously added to the problem.
+ */
+void IncSolver::removeConstraint(Constraint *c)
+{
+    if (c->active)
+    {
+        dissolveBlock(c->left->block);
+    }
+    COLA_ASSERT(m > 0);
+    --m;
+    inactive.erase(std::remove(inactive.begin(), inactive.end(), c),
+            inactive.end());
+    Constraints& out = c->left->out;
+    out.erase(std::remove(out.begin(), out.end(), c), out.end());
+    Constraints& in = c->right->in;
+    in.erase(std::remove(in.begin(), in.end(), c), in.end());
+}
+
+/*
+ * Changes the separation required by a constraint.
+ */
+void IncSolver::setConstraintGap(Constraint *c, double gap)
+{
+    if (c->active && (c->gap != gap))
+    {
+        dissolveBlock(c->left->block);
+    }
+    c->gap = gap;
+}
+
+/*
+ * Breaks a block back up into a block for each of its variables, making
+ * all its constraints inactive.  Just splitting the block over a single
+ * constraint is not enough when the problem changes, since other active
+ * constraints in the block may only still be held together by Lagrangian
+ * multipliers within LAGRANGIAN_TOLERANCE of zero.  Blocks elsewhere in
+ * the problem are unaffected and are reused by the next solve().
+ */
+void IncSolver::dissolveBlock(Block *b)
+{
+    for (Variables::iterator v = b->vars->begin(); v != b->vars->end(); ++v)
+    {
+        for (Constraints::iterator c = (*v)->out.begin(); 
+                c != (*v)->out.end(); ++c)
+        {
+            if ((*c)->active)
+            {
+                (*c)->active = false;
+                inactive.push_back(*c);
+            }
+        }
+        bs->insert(new Block(bs, *v));
+    }
+    b->deleted = true;
+    bs->cleanup();
+}
+
 // useful in debugging
 void IncSolver::printBlocks() {
 #ifdef LIBVPSC_LOGGING
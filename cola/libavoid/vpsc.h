@@ -305,7 +305,13 @@ public:
     IncSolver(Variables const &vs, Constraints const &cs);
 
     ~IncSolver();
+    // The following allow the problem to be modified and then re-solved,
+    // starting from the block structure found by the previous solve().
+    // Constraints must also be appended to or removed from the end of the
+    // Constraints list this solver was constructed with.
     void addConstraint(Constraint *constraint);
+    void removeConstraint(Constraint *constraint);
+    void setConstraintGap(Constraint *constraint, double gap);
     Variables const & getVariables() { return vs; }
 protected:
     Blocks *bs;
@@ -320,6 +326,7 @@ protected:
 private:
     bool constraintGraphIsCyclic(const unsigned n, Variable* const vs[]);
     bool blockGraphIsCyclic();
+    void dissolveBlock(Block *block);
     Constraints inactive;
     Constraints violated;
     Constraint* mostViolated(Constraints &l);
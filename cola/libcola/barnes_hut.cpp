@@ -0,0 +1,209 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libcola - A library providing force-directed network layout using the
+ *           stress-majorization method subject to separation constraints.
+ *
+ * Copyright (C) 2026  agent
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+*/
+
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+#include "libvpsc/assertions.h"
+#include "libcola/barnes_hut.h"
+
+using namespace std;
+
+namespace cola {
+
+// Limits the depth of the tree, so nodes at identical positions end up
+// sharing a leaf rather than causing unbounded subdivision.
+static const unsigned maxTreeDepth = 32;
+
+BarnesHutTree::BarnesHutTree(const valarray<double>& X,
+        const valarray<double>& Y)
+    : X(X),
+      Y(Y),
+      stamp(0)
+{
+    COLA_ASSERT(X.size()==Y.size());
+    const unsigned n=X.size();
+    if(n==0) return;
+
+    order.resize(n);
+    leafOf.resize(n,-1);
+    double minX=X[0], maxX=X[0], minY=Y[0], maxY=Y[0];
+    for(unsigned i=0;i<n;++i) {
+        order[i]=i;
+        minX=min(minX,X[i]);
+        maxX=max(maxX,X[i]);
+        minY=min(minY,Y[i]);
+        maxY=max(maxY,Y[i]);
+    }
+
+    Cell root;
+    root.size=max(maxX-minX,maxY-minY);
+    if(!(root.size>0)) {
+        root.size=1;
+    }
+    root.begin=0;
+    root.end=n;
+    root.parent=-1;
+    cells.push_back(root);
+    build(0,minX,minY,0);
+    farMark.resize(cells.size(),0);
+}
+
+void BarnesHutTree::build(const int cellIndex, const double minX,
+        const double minY, const unsigned depth)
+{
+    const unsigned begin=cells[cellIndex].begin;
+    const unsigned end=cells[cellIndex].end;
+    const double size=cells[cellIndex].size;
+
+    // Centre of mass.
+    double cx=0, cy=0;
+    for(unsigned i=begin;i<end;++i) {
+        cx+=X[order[i]];
+        cy+=Y[order[i]];
+    }
+    cx/=(end-begin);
+    cy/=(end-begin);
+    cells[cellIndex].x=cx;
+    cells[cellIndex].y=cy;
+    for(unsigned q=0;q<4;++q) {
+        cells[cellIndex].children[q]=-1;
+    }
+
+    if((end-begin)<=1 || depth>=maxTreeDepth) {
+        // Leaf: pick the node closest to the centre of mass.
+        unsigned best=order[begin];
+        double bestDist=DBL_MAX;
+        for(unsigned i=begin;i<end;++i) {
+            const unsigned v=order[i];
+            leafOf[v]=cellIndex;
+            double dx=X[v]-cx, dy=Y[v]-cy;
+            double d=dx*dx+dy*dy;
+            if(d<bestDist) {
+                bestDist=d;
+                best=v;
+            }
+        }
+        cells[cellIndex].representative=best;
+        return;
+    }
+
+    // Partition the nodes into quadrants.
+    const double half=size/2;
+    const double midX=minX+half, midY=minY+half;
+    vector<unsigned> quadrant[4];
+    for(unsigned i=begin;i<end;++i) {
+        const unsigned v=order[i];
+        unsigned q=(X[v]>=midX?1:0)+(Y[v]>=midY?2:0);
+        quadrant[q].push_back(v);
+    }
+    unsigned pos=begin;
+    for(unsigned q=0;q<4;++q) {
+        if(quadrant[q].empty()) continue;
+        Cell child;
+        child.size=half;
+        child.begin=pos;
+        child.end=pos+quadrant[q].size();
+        child.parent=cellIndex;
+        copy(quadrant[q].begin(),quadrant[q].end(),order.begin()+pos);
+        pos=child.end;
+        cells[cellIndex].children[q]=cells.size();
+        cells.push_back(child);
+    }
+    COLA_ASSERT(pos==end);
+
+    unsigned best=0;
+    double bestDist=DBL_MAX;
+    for(unsigned q=0;q<4;++q) {
+        const int c=cells[cellIndex].children[q];
+        if(c<0) continue;
+        build(c,(q&1)?midX:minX,(q&2)?midY:minY,depth+1);
+        const unsigned v=cells[c].representative;
+        double dx=X[v]-cx, dy=Y[v]-cy;
+        double d=dx*dx+dy*dy;
+        if(d<bestDist) {
+            bestDist=d;
+            best=v;
+        }
+    }
+    cells[cellIndex].representative=best;
+}
+
+void BarnesHutTree::interactions(const unsigned u, const double theta,
+        vector<unsigned>& nearNodes, vector<int>& farCells)
+{
+    nearNodes.clear();
+    farCells.clear();
+    if(cells.empty()) return;
+
+    if(++stamp==0) {
+        // Counter wrapped, so reset the marks.
+        fill(farMark.begin(),farMark.end(),0);
+        stamp=1;
+    }
+
+    // The cell containing u is always an ancestor of its leaf.
+    const int uLeaf=leafOf[u];
+    const unsigned uPos=cells[uLeaf].begin;
+
+    stack.clear();
+    stack.push_back(0);
+    while(!stack.empty()) {
+        const int c=stack.back();
+        stack.pop_back();
+        const Cell& cell=cells[c];
+        const bool containsU=(cell.begin<=uPos && uPos<cell.end);
+        if(!containsU && cell.count()>1) {
+            double dx=X[u]-cell.x, dy=Y[u]-cell.y;
+            double dist=sqrt(dx*dx+dy*dy);
+            if(dist>0 && cell.size<theta*dist) {
+                farMark[c]=stamp;
+                farCells.push_back(c);
+                continue;
+            }
+        }
+        if(cell.isLeaf()) {
+            for(unsigned i=cell.begin;i<cell.end;++i) {
+                if(order[i]!=u) {
+                    nearNodes.push_back(order[i]);
+                }
+            }
+            continue;
+        }
+        for(unsigned q=0;q<4;++q) {
+            if(cell.children[q]>=0) {
+                stack.push_back(cell.children[q]);
+            }
+        }
+    }
+}
+
+int BarnesHutTree::approximatingCell(const unsigned v) const
+{
+    for(int c=leafOf[v];c>=0;c=cells[c].parent) {
+        if(farMark[c]==stamp) {
+            return c;
+        }
+    }
+    return -1;
+}
+
+} // namespace cola
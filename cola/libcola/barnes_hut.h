@@ -0,0 +1,105 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libcola - A library providing force-directed network layout using the
+ *           stress-majorization method subject to separation constraints.
+ *
+ * Copyright (C) 2026  agent
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+*/
+
+#ifndef COLA_BARNES_HUT_H
+#define COLA_BARNES_HUT_H
+
+#include <vector>
+#include <valarray>
+
+namespace cola {
+
+/*
+ * A quadtree over node positions, used to approximate the stress terms
+ * between a node and a distant group of nodes by a single term (the
+ * Barnes-Hut approximation).
+ *
+ * Each cell of the tree records the centre of mass of the nodes inside it
+ * and a representative node close to that centre.  A cell is considered
+ * distant from a node u if size/dist < theta, where size is the side
+ * length of the cell and dist is the distance from u to the cell's centre
+ * of mass.  Smaller values of theta give more accurate results.
+ */
+class BarnesHutTree {
+public:
+    struct Cell {
+        // Centre of mass.
+        double x, y;
+        // Side length of the square region covered by this cell.
+        double size;
+        // Range of nodes in this cell, as indexes into nodeOrder().
+        unsigned begin, end;
+        // The node closest to the centre of mass.
+        unsigned representative;
+        int parent;
+        int children[4];
+        bool isLeaf() const {
+            return children[0] < 0 && children[1] < 0 &&
+                   children[2] < 0 && children[3] < 0;
+        }
+        unsigned count() const {
+            return end - begin;
+        }
+    };
+
+    BarnesHutTree(const std::valarray<double>& X,
+            const std::valarray<double>& Y);
+
+    /*
+     * Determines the interactions for node u.  Nodes that need their
+     * stress terms computed exactly are added to nearNodes (this never
+     * includes u itself) and cells that can be approximated by a single
+     * term are added to farCells.  Together these cover every other node
+     * exactly once.
+     */
+    void interactions(const unsigned u, const double theta,
+            std::vector<unsigned>& nearNodes, std::vector<int>& farCells);
+
+    /*
+     * Returns the index of the cell in the farCells from the most recent
+     * call to interactions() that contains node v, or -1 if the stress
+     * term for v was to be computed exactly.
+     */
+    int approximatingCell(const unsigned v) const;
+
+    const Cell& cell(const int index) const {
+        return cells[index];
+    }
+    const std::vector<unsigned>& nodeOrder() const {
+        return order;
+    }
+
+private:
+    void build(const int cellIndex, const double minX, const double minY,
+            const unsigned depth);
+
+    const std::valarray<double>& X;
+    const std::valarray<double>& Y;
+    std::vector<Cell> cells;
+    std::vector<unsigned> order;
+    std::vector<int> leafOf;
+    std::vector<unsigned> farMark;
+    unsigned stamp;
+    std::vector<int> stack;
+};
+
+} // namespace cola
+
+#endif // COLA_BARNES_HUT_H
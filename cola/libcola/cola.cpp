@@ -44,7 +44,8 @@ ConstrainedMajorizationLayout
         EdgeLengths eLengths,
         TestConvergence *doneTest,
         PreIteration* preIteration,
-        bool useNeighbourStress)
+        bool useNeighbourStress,
+        ThreadPool* threadPool)
     : n(rs.size()),
       lap2(valarray<double>(n*n)), 
       Dij(valarray<double>(n*n)),
@@ -111,6 +112,8 @@ ConstrainedMajorizationLayout
             unsigned target = es[i].second;
             D[source][target] = D[target][source] = (haveLengths ? edgeLengths[i] : 1.0);
         }
+    } else if (threadPool) {
+        shortest_paths::johnsons(n,D,es,edgeLengths,*threadPool);
     } else {
         shortest_paths::johnsons(n,D,es,edgeLengths);
         //shortest_paths::neighbours(n,D,es,edgeLengths);
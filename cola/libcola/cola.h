@@ -57,6 +57,7 @@ namespace cola {
 
 class NonOverlapConstraints;
 class NonOverlapConstraintExemptions;
+class ThreadPool;
 
 //! @brief A vector of node Indexes.
 typedef std::vector<unsigned> NodeIndexes;
@@ -288,6 +289,11 @@ public:
      *                  each iteration (optional).
      * @param[in] preIteration  An operation called before each iteration
      *                          (optional).
+     * @param[in] useNeighbourStress  Only use stress between neighbours
+     *                                (optional).
+     * @param[in] threadPool  The threads used to compute the shortest paths
+     *                        between nodes concurrently (optional).  If 
+     *                        not given, they are computed serially.
      */
     ConstrainedMajorizationLayout(
         vpsc::Rectangles& rs,
@@ -297,7 +303,8 @@ public:
         EdgeLengths eLengths = StandardEdgeLengths,
         TestConvergence *doneTest = nullptr,
         PreIteration* preIteration=nullptr,
-        bool useNeighbourStress = false);
+        bool useNeighbourStress = false,
+        ThreadPool* threadPool = nullptr);
     /**
      * @brief  Specify a set of compound constraints to apply to the layout.
      *
@@ -648,6 +655,10 @@ public:
      *                  default TestConvergence object.
      * @param[in] preIteration  An operation called before each iteration
      *                          (optional).
+     * @param[in] threadPool  The threads used to compute the shortest paths
+     *                        between all pairs of nodes concurrently 
+     *                        (optional).  If not given, they are computed
+     *                        serially.
      */
     ConstrainedFDLayout(
         const vpsc::Rectangles& rs,
@@ -655,7 +666,56 @@ public:
         const double idealLength,
         const EdgeLengths& eLengths = StandardEdgeLengths, 
         TestConvergence* doneTest = nullptr,
-        PreIteration* preIteration = nullptr);
+        PreIteration* preIteration = nullptr,
+        ThreadPool* threadPool = nullptr);
+
+    /**
+     * @brief Constructs a constrained force-directed layout instance that
+     *        uses pivot-based sparse stress.
+     *
+     * Rather than computing the shortest paths between all pairs of nodes,
+     * shortest paths are only computed from pivotCount pivot nodes, chosen
+     * to be spread out through the graph.  Each node then has stress
+     * terms for its immediate neighbours and for each of the pivots.  Each
+     * node is assigned to the region of its closest pivot, and the term
+     * for a pivot is weighted by the number of nodes in its region that
+     * are within half the node's distance to the pivot.
+     *
+     * This avoids the n by n path length matrices used by the standard
+     * constructor, so memory and preprocessing time scale with
+     * pivotCount*n rather than n*n, making it suitable for very large
+     * graphs.  Constraints, clusters and overlap removal are handled as
+     * usual.  readLinearD() and readLinearG() return empty vectors for
+     * such layouts, and setUseNeighbourStress() and
+     * setStressApproximation() have no effect.
+     *
+     * @param[in] rs  Bounding boxes of nodes at their initial positions.
+     * @param[in] es  Simple pair edges, giving indices of the start and end 
+     *                nodes in rs.
+     * @param[in] idealLength  A scalar modifier of ideal edge lengths in 
+     *                         eLengths or of 1 if no ideal lengths are 
+     *                         specified.
+     * @param[in] pivotCount  The number of pivot nodes to use.  If this is
+     *                        zero, all pairs stress is used, as for the
+     *                        standard constructor.
+     * @param[in] eLengths  Individual ideal lengths for edges.
+     * @param[in] done  A test of convergence operation called at the end of 
+     *                  each iteration (optional).
+     * @param[in] preIteration  An operation called before each iteration
+     *                          (optional).
+     * @param[in] threadPool  The threads used to compute the shortest paths
+     *                        between all pairs of nodes when pivotCount is
+     *                        zero (optional).  See the standard constructor.
+     */
+    ConstrainedFDLayout(
+        const vpsc::Rectangles& rs,
+        const std::vector<cola::Edge>& es,
+        const double idealLength,
+        const unsigned pivotCount,
+        const EdgeLengths& eLengths = StandardEdgeLengths, 
+        TestConvergence* doneTest = nullptr,
+        PreIteration* preIteration = nullptr,
+        ThreadPool* threadPool = nullptr);
     ~ConstrainedFDLayout();
   
     /**
@@ -819,6 +879,46 @@ public:
      */
     void setUseNeighbourStress(bool useNeighbourStress);
 
+    /**
+     * @brief  Specifies whether stress between distant nodes should be
+     *         approximated, and with what accuracy.
+     *
+     * When enabled, a quadtree is built over the node positions and the
+     * stress terms between each node and a group of distant nodes are
+     * replaced by a single term for the group's centre of mass, using the
+     * ideal distance to a representative node of the group (a Barnes-Hut
+     * approximation).  A group is treated as distant when the ratio of its
+     * size to its distance is less than theta.  This reduces each
+     * iteration from O(n^2) to roughly O(n log n) for large graphs.
+     * Terms between nodes connected by an edge are always computed exactly.
+     *
+     * Smaller values of theta give more accurate results; a value of 0.5
+     * to 1.0 is typical.  A value of zero (the default) disables the
+     * approximation.  This option has no effect with neighbour stress.
+     *
+     * Note that this reduces the time taken by each iteration, but not
+     * the memory used: the full n by n matrices of ideal distances and
+     * path types are still computed, since they are used for the distance
+     * to each group's representative node.  For a graph with 20,000
+     * nodes the distances alone take about 3.2 GB.  For such graphs use
+     * the pivot stress constructor instead, which avoids these matrices.
+     *
+     * @param[in] theta  The accuracy parameter for the approximation.
+     */
+    void setStressApproximation(double theta);
+
+    /**
+     * @brief  Returns the number of entries in the Hessian assembled by
+     *         the most recent iteration of the layout.
+     *
+     * This is n^2 for a connected graph with the full stress model, and
+     * grows roughly linearly with n when using neighbour stress, pivot
+     * stress or the stress approximation.
+     *
+     * @return  The number of stored entries.
+     */
+    size_t hessianEntryCount(void) const;
+
     /**
      * @brief  Retrieve a copy of the "D matrix" computed by the computePathLengths
      * method, linearised as a vector.
@@ -875,8 +975,8 @@ private:
             const double oldStress, 
             double stepsize
             /*,topology::TopologyConstraints *s=nullptr*/);
-    void computePathLengths(
-            const std::vector<Edge>& es, std::valarray<double> eLengths);
+    void computePathLengths(const std::vector<Edge>& es,
+            std::valarray<double> eLengths, ThreadPool *threadPool);
     void generateNonOverlapAndClusterCompoundConstraints(
             vpsc::Variables (&vs)[2]);
     void handleResizes(const Resizes&);
@@ -885,6 +985,14 @@ private:
     bool noForces(double, double, unsigned) const;
     void computeForces(const vpsc::Dim dim, SparseMap &H, 
             std::valarray<double> &g);
+    bool useStressApproximation(void) const;
+    void computeApproximateForces(const vpsc::Dim dim, SparseMap &H,
+            std::valarray<double> &g);
+    void computeDesiredPositionForces(const vpsc::Dim dim, SparseMap &H,
+            std::valarray<double> &g) const;
+    void separateCoincidentNodes(const unsigned u, const unsigned v,
+            double& rx, double& ry);
+    double computeApproximatePairStress(void) const;
     void recGenerateClusterVariablesAndConstraints(
             vpsc::Variables (&vars)[2], unsigned int& priority, 
             cola::NonOverlapConstraints *noc, Cluster *cluster, 
@@ -892,7 +1000,18 @@ private:
     std::vector<double> offsetDir(double minD);
 
     void computeNeighbours(std::vector<Edge> es);
-    std::vector<std::vector<unsigned> > neighbours;
+    bool areNeighbours(const unsigned u, const unsigned v) const;
+    void computeHessianPattern(void);
+    bool usePivotStress(void) const;
+    void computePivotPathLengths(const std::vector<Edge>& es,
+            std::valarray<double> eLengths);
+    void computePivotForces(const vpsc::Dim dim, SparseMap &H,
+            std::valarray<double> &g);
+    double computePivotStress(void) const;
+    double pivotWeight(const unsigned i, const double d) const;
+    // Nodes connected to each node by an edge, in increasing order.
+    std::vector<std::vector<unsigned> > adjacentNodes;
+    // Ideal distances to the nodes in adjacentNodes (pivot stress only).
     std::vector<std::vector<double> > neighbourLengths;
     TestConvergence *done;
     bool using_default_done; // Whether we allocated a default TestConvergence object.
@@ -914,6 +1033,16 @@ private:
     double m_idealEdgeLength;
     bool m_generateNonOverlapConstraints;
     bool m_useNeighbourStress;
+    double m_stressApproximationTheta;
+    unsigned m_pivotCount;
+    // Pivot stress: the pivot nodes, the ideal distances from each pivot
+    // to every node (m_pivots.size() rows of n), and the sorted distances
+    // from each pivot to the nodes in its region.
+    std::vector<unsigned> m_pivots;
+    std::valarray<double> m_pivotDistances;
+    std::vector<std::vector<double> > m_pivotRegionDistances;
+    // The Hessian, reused between iterations.
+    SparseMap m_hessian;
     const std::valarray<double> m_edge_lengths;
 
     NonOverlapConstraintExemptions *m_nonoverlap_exemptions;
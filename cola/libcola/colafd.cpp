@@ -40,6 +40,7 @@
 #include "libcola/straightener.h"
 #include "libcola/cc_clustercontainmentconstraints.h"
 #include "libcola/cc_nonoverlapconstraints.h"
+#include "libcola/barnes_hut.h"
 
 #ifdef MAKEFEASIBLE_DEBUG
   #include "libcola/output_svg.h"
@@ -96,7 +97,18 @@ void dumpSquareMatrix(unsigned n, T** L) {
 ConstrainedFDLayout::ConstrainedFDLayout(const vpsc::Rectangles& rs,
         const std::vector< Edge >& es, const double idealLength,
         const EdgeLengths& eLengths,
-        TestConvergence *doneTest, PreIteration* preIteration)
+        TestConvergence *doneTest, PreIteration* preIteration,
+        ThreadPool *threadPool)
+    : ConstrainedFDLayout(rs, es, idealLength, 0, eLengths, doneTest,
+            preIteration, threadPool)
+{
+}
+
+ConstrainedFDLayout::ConstrainedFDLayout(const vpsc::Rectangles& rs,
+        const std::vector< Edge >& es, const double idealLength,
+        const unsigned pivotCount, const EdgeLengths& eLengths,
+        TestConvergence *doneTest, PreIteration* preIteration,
+        ThreadPool *threadPool)
     : n(rs.size()),
       X(valarray<double>(n)),
       Y(valarray<double>(n)),
@@ -111,6 +123,8 @@ ConstrainedFDLayout::ConstrainedFDLayout(const vpsc::Rectangles& rs,
       m_idealEdgeLength(idealLength),
       m_generateNonOverlapConstraints(false),
       m_useNeighbourStress(false),
+      m_stressApproximationTheta(0),
+      m_pivotCount(pivotCount),
       m_edge_lengths(eLengths.data(), eLengths.size()),
       m_nonoverlap_exemptions(new NonOverlapConstraintExemptions())
 {
@@ -134,6 +148,12 @@ ConstrainedFDLayout::ConstrainedFDLayout(const vpsc::Rectangles& rs,
         Y[i]=(*ri)->getCentreY();
         FILE_LOG(logDEBUG) << *ri;
     }
+    if(usePivotStress()) {
+        D=nullptr;
+        G=nullptr;
+        computePivotPathLengths(es,m_edge_lengths);
+        return;
+    }
     D=new double*[n];
     G=new unsigned short*[n];
     for(unsigned i=0;i<n;i++) {
@@ -141,12 +161,15 @@ ConstrainedFDLayout::ConstrainedFDLayout(const vpsc::Rectangles& rs,
         G[i]=new unsigned short[n];
     }
 
-    computePathLengths(es,m_edge_lengths);
+    computePathLengths(es,m_edge_lengths,threadPool);
 }
 
 std::vector<double> ConstrainedFDLayout::readLinearD(void)
 {
     std::vector<double> d;
+    if (usePivotStress()) {
+        return d;
+    }
     d.resize(n*n);
     for (unsigned i = 0; i < n; ++i) {
         for (unsigned j = 0; j < n; ++j) {
@@ -159,6 +182,9 @@ std::vector<double> ConstrainedFDLayout::readLinearD(void)
 std::vector<unsigned> ConstrainedFDLayout::readLinearG(void)
 {
     std::vector<unsigned> g;
+    if (usePivotStress()) {
+        return g;
+    }
     g.resize(n*n);
     for (unsigned i = 0; i < n; ++i) {
         for (unsigned j = 0; j < n; ++j) {
@@ -169,15 +195,25 @@ std::vector<unsigned> ConstrainedFDLayout::readLinearG(void)
 }
 
 void ConstrainedFDLayout::computeNeighbours(vector<Edge> es) {
-    for (unsigned i = 0; i < n; ++i) {
-        neighbours.push_back(vector<unsigned>(n));
-    }
+    adjacentNodes.resize(n);
     for (vector<Edge>::iterator it = es.begin(); it!=es.end(); ++it) {
         Edge e = *it;
         unsigned s = e.first, t = e.second;
-        neighbours[s][t] = 1;
-        neighbours[t][s] = 1;
+        if (s != t) {
+            adjacentNodes[s].push_back(t);
+            adjacentNodes[t].push_back(s);
+        }
     }
+    for (unsigned i = 0; i < n; ++i) {
+        vector<unsigned>& adj = adjacentNodes[i];
+        sort(adj.begin(), adj.end());
+        adj.erase(unique(adj.begin(), adj.end()), adj.end());
+    }
+}
+
+bool ConstrainedFDLayout::areNeighbours(const unsigned u,
+        const unsigned v) const {
+    return binary_search(adjacentNodes[u].begin(), adjacentNodes[u].end(), v);
 }
 
 void dijkstra(const unsigned s, const unsigned n, double* d,
@@ -201,6 +237,30 @@ void ConstrainedFDLayout::setAvoidNodeOverlaps(bool avoidOverlaps,
 void ConstrainedFDLayout::setUseNeighbourStress(bool useNeighbourStress)
 {
     m_useNeighbourStress = useNeighbourStress;
+    // The Hessian only has entries for neighbours in this mode.
+    m_hessian.clearPattern();
+}
+
+void ConstrainedFDLayout::setStressApproximation(double theta)
+{
+    m_stressApproximationTheta = theta;
+    m_hessian.clearPattern();
+}
+
+size_t ConstrainedFDLayout::hessianEntryCount(void) const
+{
+    return m_hessian.nonZeroCount();
+}
+
+bool ConstrainedFDLayout::useStressApproximation(void) const
+{
+    return (m_stressApproximationTheta > 0) && !m_useNeighbourStress &&
+            !usePivotStress();
+}
+
+bool ConstrainedFDLayout::usePivotStress(void) const
+{
+    return m_pivotCount > 0;
 }
 
 void ConstrainedFDLayout::setDesiredPositions(DesiredPositions *desiredPositions)
@@ -224,10 +284,9 @@ void ConstrainedFDLayout::setDesiredPositions(DesiredPositions *desiredPositions
  *   2 if no attractive force is required between u and v but there is
  *     a connected path between them.
  */
-void ConstrainedFDLayout::computePathLengths(
-        const vector<Edge>& es, std::valarray<double> eLengths)
+// Corrects zero or negative entries in eLengths array.
+static void correctEdgeLengths(std::valarray<double>& eLengths)
 {
-    // Correct zero or negative entries in eLengths array.
     for (size_t i = 0; i < eLengths.size(); ++i)
     {
         if (eLengths[i] <= 0)
@@ -237,8 +296,18 @@ void ConstrainedFDLayout::computePathLengths(
             eLengths[i] = 1;
         }
     }
+}
+
+void ConstrainedFDLayout::computePathLengths(const vector<Edge>& es,
+        std::valarray<double> eLengths, ThreadPool *threadPool)
+{
+    correctEdgeLengths(eLengths);
 
-    shortest_paths::johnsons(n,D,es,eLengths);
+    if (threadPool) {
+        shortest_paths::johnsons(n,D,es,eLengths,*threadPool);
+    } else {
+        shortest_paths::johnsons(n,D,es,eLengths);
+    }
     //dumpSquareMatrix<double>(n,D);
     for(unsigned i=0;i<n;i++) {
         for(unsigned j=0;j<n;j++) {
@@ -268,6 +337,120 @@ void ConstrainedFDLayout::computePathLengths(
     //dumpSquareMatrix<short>(n,G);
 }
 
+/*
+ * Sets up the data for pivot stress, in place of the D and G matrices.
+ * Pivots are chosen one at a time, each being the node furthest from all
+ * the pivots chosen so far, and shortest paths are computed from each.
+ * Each node is assigned to the region of its closest pivot.
+ * See Ortmann, Klimenta and Brandes, "A sparse stress model", 2016.
+ */
+void ConstrainedFDLayout::computePivotPathLengths(
+        const vector<Edge>& es, std::valarray<double> eLengths)
+{
+    correctEdgeLengths(eLengths);
+
+    neighbourLengths.resize(n);
+    for(unsigned u=0;u<n;u++) {
+        neighbourLengths[u].assign(adjacentNodes[u].size(),DBL_MAX);
+    }
+    for(unsigned i=0;i<es.size();i++) {
+        unsigned u=es[i].first, v=es[i].second;
+        if(u==v) continue;
+        double d=m_idealEdgeLength*(eLengths.size()>0?eLengths[i]:1);
+        unsigned uv=lower_bound(adjacentNodes[u].begin(),
+                adjacentNodes[u].end(),v)-adjacentNodes[u].begin();
+        unsigned vu=lower_bound(adjacentNodes[v].begin(),
+                adjacentNodes[v].end(),u)-adjacentNodes[v].begin();
+        neighbourLengths[u][uv]=min(neighbourLengths[u][uv],d);
+        neighbourLengths[v][vu]=min(neighbourLengths[v][vu],d);
+        if(d<minD) minD=d;
+    }
+
+    const unsigned k=min(m_pivotCount,n);
+    vector<shortest_paths::Node<double> > vs(n);
+    shortest_paths::dijkstra_init(vs,es,eLengths);
+    m_pivots.clear();
+    m_pivotDistances.resize(k*n);
+    // The distance from each node to the closest pivot so far, and the
+    // index of that pivot.
+    vector<double> closest(n,DBL_MAX);
+    vector<unsigned> region(n,0);
+    unsigned next=0;
+    for(unsigned i=0;i<k;i++) {
+        m_pivots.push_back(next);
+        double *d=&m_pivotDistances[i*n];
+        shortest_paths::dijkstra(next,vs,d);
+        double furthest=-1;
+        for(unsigned v=0;v<n;v++) {
+            if(d[v]!=DBL_MAX) {
+                d[v]*=m_idealEdgeLength;
+                if((d[v]>0) && (d[v]<minD)) minD=d[v];
+            }
+            if(d[v]<closest[v]) {
+                closest[v]=d[v];
+                region[v]=i;
+            }
+            // Nodes in components without a pivot are chosen first.
+            if(closest[v]>furthest) {
+                furthest=closest[v];
+                next=v;
+            }
+        }
+    }
+    if (minD == DBL_MAX) minD = 1;
+
+    m_pivotRegionDistances.assign(k,vector<double>());
+    for(unsigned v=0;v<n;v++) {
+        if(closest[v]!=DBL_MAX) {
+            m_pivotRegionDistances[region[v]].push_back(closest[v]);
+        }
+    }
+    for(unsigned i=0;i<k;i++) {
+        sort(m_pivotRegionDistances[i].begin(),
+                m_pivotRegionDistances[i].end());
+    }
+}
+
+/*
+ * Computes the sparsity pattern of the Hessian built by computeForces(),
+ * which has entries on the diagonal and between nodes u and v that have
+ * stress between them (G[u][v]!=0).  This is computed once so the Hessian
+ * can be reassembled in place each iteration.  With neighbour stress,
+ * pivot stress or the stress approximation only the diagonal and
+ * neighbours are in the pattern.  The approximation's other entries are
+ * for nearby nodes, which change between iterations, so they are stored
+ * outside the pattern.
+ */
+void ConstrainedFDLayout::computeHessianPattern(void) {
+    valarray<unsigned> IA(n+1);
+    vector<unsigned> JA;
+    for(unsigned u=0;u<n;u++) {
+        IA[u]=JA.size();
+        if(m_useNeighbourStress || usePivotStress() ||
+                useStressApproximation()) {
+            // Just the diagonal and neighbours.
+            const vector<unsigned>& adj=adjacentNodes[u];
+            vector<unsigned>::const_iterator mid=
+                lower_bound(adj.begin(),adj.end(),u);
+            JA.insert(JA.end(),adj.begin(),mid);
+            JA.push_back(u);
+            JA.insert(JA.end(),mid,adj.end());
+            continue;
+        }
+        for(unsigned v=0;v<n;v++) {
+            if(u==v) {
+                JA.push_back(v);
+                continue;
+            }
+            if(G[u][v]==0) continue;
+            JA.push_back(v);
+        }
+    }
+    IA[n]=JA.size();
+    m_hessian.resize(n);
+    m_hessian.setPattern(IA,valarray<unsigned>(&JA[0],JA.size()));
+}
+
 typedef valarray<double> Position;
 void getPosition(Position& X, Position& Y, Position& pos) {
     unsigned n=X.size();
@@ -902,13 +1085,16 @@ ConstrainedFDLayout::~ConstrainedFDLayout()
         delete done;
     }
 
-    for (unsigned i = 0; i < n; ++i)
+    if (D)
     {
-        delete [] G[i];
-        delete [] D[i];
+        for (unsigned i = 0; i < n; ++i)
+        {
+            delete [] G[i];
+            delete [] D[i];
+        }
+        delete [] G;
+        delete [] D;
     }
-    delete [] G;
-    delete [] D;
     delete topologyAddon;
     delete m_nonoverlap_exemptions;
 }
@@ -1129,9 +1315,14 @@ double ConstrainedFDLayout::applyForcesAndConstraints(const vpsc::Dim dim, const
         // Add non-overlap constraints, but not variables again.
         setupExtraConstraints(extraConstraints, dim, vs, cs, boundingBoxes);
         // Projection.
-        SparseMap HMap(n);
-        computeForces(dim,HMap,g);
-        SparseMatrix H(HMap);
+        if(!m_hessian.hasPattern()) {
+            computeHessianPattern();
+        }
+        m_hessian.clear();
+        computeForces(dim,m_hessian,g);
+        // Entries are normally all in the pattern, in which case H uses the
+        // arrays of m_hessian in place.
+        SparseMatrix H(m_hessian);
         valarray<double> oldCoords=coords;
         applyDescentVector(g,oldCoords,coords,oldStress,computeStepSize(H,g,g));
         setVariableDesiredPositions(vs,cs,des,coords);
@@ -1227,6 +1418,14 @@ void ConstrainedFDLayout::computeForces(
         SparseMap &H,
         valarray<double> &g) {
     if(n==1) return;
+    if(usePivotStress()) {
+        computePivotForces(dim,H,g);
+        return;
+    }
+    if(useStressApproximation()) {
+        computeApproximateForces(dim,H,g);
+        return;
+    }
     g=0;
     // for each node:
     for(unsigned u=0;u<n;u++) {
@@ -1234,7 +1433,7 @@ void ConstrainedFDLayout::computeForces(
         double Huu=0;
         for(unsigned v=0;v<n;v++) {
             if(u==v) continue;
-            if (m_useNeighbourStress && neighbours[u][v]!=1) continue;
+            if (m_useNeighbourStress && !areNeighbours(u,v)) continue;
 
             // The following loop randomly displaces nodes that are at identical positions
             double rx=X[u]-X[v], ry=Y[u]-Y[v];
@@ -1273,6 +1472,13 @@ void ConstrainedFDLayout::computeForces(
         }
         H(u,u)=Huu;
     }
+    computeDesiredPositionForces(dim,H,g);
+}
+
+void ConstrainedFDLayout::computeDesiredPositionForces(
+        const vpsc::Dim dim,
+        SparseMap &H,
+        valarray<double> &g) const {
     if(desiredPositions) {
         for(DesiredPositions::const_iterator p=desiredPositions->begin();
             p!=desiredPositions->end();++p) {
@@ -1285,6 +1491,246 @@ void ConstrainedFDLayout::computeForces(
         }
     }
 }
+
+/*
+ * Randomly displaces node v if it is at the same position as node u.
+ * rx and ry are the offset of u from v, and are updated.
+ */
+void ConstrainedFDLayout::separateCoincidentNodes(
+        const unsigned u, const unsigned v, double& rx, double& ry) {
+    unsigned maxDisplaces = n;  // avoid infinite loop in the case of numerical issues, such as huge values
+    while (maxDisplaces-- && (rx*rx+ry*ry) <= 1e-3)
+    {
+        std::vector<double> rd = offsetDir(minD);
+        X[v] += rd[0];
+        Y[v] += rd[1];
+        rx=X[u]-X[v], ry=Y[u]-Y[v];
+    }
+}
+
+/*
+ * Computes the contributions to the negative gradient for u, and to the
+ * Hessian entry H(u,v), from the stress term between nodes u and v, where
+ * (rx,ry) is the offset of u from v, d is their ideal distance and p is
+ * their entry in G.  Returns false if there is no such term.
+ */
+static bool pairForces(const vpsc::Dim dim, const double rx, const double ry,
+        const double d, const unsigned short p, double& gu, double& huv) {
+    // no forces between disconnected parts of the graph
+    if(p==0) return false;
+    double l=sqrt(rx*rx+ry*ry);
+    if(l>d && p>1) return false; // attractive forces not required
+    double d2=d*d;
+    /* force apart zero distances */
+    if (l < 1e-30) {
+        l=0.1;
+    }
+    double dx=dim==vpsc::HORIZONTAL?rx:ry;
+    double dy=dim==vpsc::HORIZONTAL?ry:rx;
+    gu=dx*(l-d)/(d2*l);
+    huv=(d*dy*dy/(l*l*l)-1)/d2;
+    return true;
+}
+
+/*
+ * Returns the stress term between two nodes, where (rx,ry) is their
+ * offset, d is their ideal distance and p is their entry in G.
+ */
+static double pairStress(const double rx, const double ry, const double d,
+        const unsigned short p) {
+    // no forces between disconnected parts of the graph
+    if(p==0) return 0;
+    double l=sqrt(rx*rx+ry*ry);
+    if(l>d && p>1) return 0; // no attractive forces required
+    double rl=d-l;
+    return rl*rl/(d*d);
+}
+
+/*
+ * The path type used for the approximate term between a node and a
+ * distant cell.  Attractive forces between neighbours are handled exactly,
+ * so these are just treated as connected by a path.
+ */
+static inline unsigned short farPathType(const unsigned short p) {
+    return (p==0)?0:2;
+}
+
+/*
+ * As for computeForces(), but approximates the terms for distant groups
+ * of nodes using a Barnes-Hut quadtree.  The Hessian terms for such groups
+ * only contribute to the diagonal, which keeps H sparse.  Whether a pair
+ * of nodes is near is decided separately for each of them, so half of
+ * each near pair's term is added to both H(u,v) and H(v,u), keeping H
+ * symmetric.
+ */
+void ConstrainedFDLayout::computeApproximateForces(
+        const vpsc::Dim dim,
+        SparseMap &H,
+        valarray<double> &g) {
+    g=0;
+    BarnesHutTree tree(X,Y);
+    vector<unsigned> nearNodes;
+    vector<int> farCells;
+    double gu, huv;
+    for(unsigned u=0;u<n;u++) {
+        double Huu=0;
+        tree.interactions(u,m_stressApproximationTheta,nearNodes,farCells);
+        for(unsigned i=0;i<nearNodes.size();++i) {
+            const unsigned v=nearNodes[i];
+            double rx=X[u]-X[v], ry=Y[u]-Y[v];
+            separateCoincidentNodes(u,v,rx,ry);
+            if(pairForces(dim,rx,ry,D[u][v],G[u][v],gu,huv)) {
+                g[u]+=gu;
+                H(u,v)+=huv/2;
+                H(v,u)+=huv/2;
+                Huu-=huv;
+            }
+        }
+        for(unsigned i=0;i<farCells.size();++i) {
+            const BarnesHutTree::Cell& cell=tree.cell(farCells[i]);
+            const unsigned r=cell.representative;
+            const double count=cell.count();
+            if(pairForces(dim,X[u]-cell.x,Y[u]-cell.y,D[u][r],
+                        farPathType(G[u][r]),gu,huv)) {
+                g[u]+=count*gu;
+                Huu-=count*huv;
+            }
+        }
+        // Replace any approximated terms for neighbours with exact ones.
+        for(unsigned i=0;i<adjacentNodes[u].size();++i) {
+            const unsigned v=adjacentNodes[u][i];
+            const int c=tree.approximatingCell(v);
+            if(c<0) continue;
+            const BarnesHutTree::Cell& cell=tree.cell(c);
+            const unsigned r=cell.representative;
+            if(pairForces(dim,X[u]-cell.x,Y[u]-cell.y,D[u][r],
+                        farPathType(G[u][r]),gu,huv)) {
+                g[u]-=gu;
+                Huu+=huv;
+            }
+            if(pairForces(dim,X[u]-X[v],Y[u]-Y[v],D[u][v],G[u][v],gu,huv)) {
+                g[u]+=gu;
+                H(u,v)+=huv/2;
+                H(v,u)+=huv/2;
+                Huu-=huv;
+            }
+        }
+        H(u,u)=Huu;
+    }
+    computeDesiredPositionForces(dim,H,g);
+}
+
+/*
+ * Approximates the sum of the stress terms between all pairs of nodes
+ * using a Barnes-Hut quadtree.  See computeApproximateForces().
+ */
+double ConstrainedFDLayout::computeApproximatePairStress(void) const {
+    BarnesHutTree tree(X,Y);
+    vector<unsigned> nearNodes;
+    vector<int> farCells;
+    double stress=0;
+    for(unsigned u=0;u<n;u++) {
+        tree.interactions(u,m_stressApproximationTheta,nearNodes,farCells);
+        for(unsigned i=0;i<nearNodes.size();++i) {
+            const unsigned v=nearNodes[i];
+            stress+=pairStress(X[u]-X[v],Y[u]-Y[v],D[u][v],G[u][v]);
+        }
+        for(unsigned i=0;i<farCells.size();++i) {
+            const BarnesHutTree::Cell& cell=tree.cell(farCells[i]);
+            const unsigned r=cell.representative;
+            stress+=cell.count()*pairStress(X[u]-cell.x,Y[u]-cell.y,
+                    D[u][r],farPathType(G[u][r]));
+        }
+        for(unsigned i=0;i<adjacentNodes[u].size();++i) {
+            const unsigned v=adjacentNodes[u][i];
+            const int c=tree.approximatingCell(v);
+            if(c<0) continue;
+            const BarnesHutTree::Cell& cell=tree.cell(c);
+            const unsigned r=cell.representative;
+            stress-=pairStress(X[u]-cell.x,Y[u]-cell.y,D[u][r],
+                    farPathType(G[u][r]));
+            stress+=pairStress(X[u]-X[v],Y[u]-Y[v],D[u][v],G[u][v]);
+        }
+    }
+    // Each pair has been counted from both ends.
+    return stress/2;
+}
+
+/*
+ * Returns the weight of the stress term between the ith pivot and a node
+ * at ideal distance d from it.  This is the number of nodes in the pivot's
+ * region that are within d/2 of the pivot, i.e., the nodes the pivot
+ * stands in for from that distance.
+ */
+double ConstrainedFDLayout::pivotWeight(const unsigned i,
+        const double d) const {
+    const vector<double>& dists=m_pivotRegionDistances[i];
+    return upper_bound(dists.begin(),dists.end(),d/2)-dists.begin();
+}
+
+/*
+ * As for computeForces(), but using pivot stress.  Each node has exact
+ * terms for its neighbours, and a weighted term for each pivot (see
+ * pivotWeight()).  Pivot terms only contribute to the diagonal of the
+ * Hessian.
+ */
+void ConstrainedFDLayout::computePivotForces(
+        const vpsc::Dim dim,
+        SparseMap &H,
+        valarray<double> &g) {
+    g=0;
+    double gu, huv;
+    for(unsigned u=0;u<n;u++) {
+        double Huu=0;
+        for(unsigned i=0;i<adjacentNodes[u].size();++i) {
+            const unsigned v=adjacentNodes[u][i];
+            double rx=X[u]-X[v], ry=Y[u]-Y[v];
+            separateCoincidentNodes(u,v,rx,ry);
+            if(pairForces(dim,rx,ry,neighbourLengths[u][i],1,gu,huv)) {
+                g[u]+=gu;
+                H(u,v)+=huv;
+                Huu-=huv;
+            }
+        }
+        for(unsigned i=0;i<m_pivots.size();++i) {
+            const unsigned p=m_pivots[i];
+            if(p==u || areNeighbours(u,p)) continue;
+            const double d=m_pivotDistances[i*n+u];
+            if(d==DBL_MAX) continue;
+            const double w=pivotWeight(i,d);
+            if(w==0) continue;
+            if(pairForces(dim,X[u]-X[p],Y[u]-Y[p],d,2,gu,huv)) {
+                g[u]+=w*gu;
+                Huu-=w*huv;
+            }
+        }
+        H(u,u)=Huu;
+    }
+    computeDesiredPositionForces(dim,H,g);
+}
+
+/*
+ * The pivot stress equivalent of the sum of stress terms between all
+ * pairs of nodes.  See computePivotForces().
+ */
+double ConstrainedFDLayout::computePivotStress(void) const {
+    double stress=0;
+    for(unsigned u=0;u<n;u++) {
+        for(unsigned i=0;i<adjacentNodes[u].size();++i) {
+            const unsigned v=adjacentNodes[u][i];
+            if(v<u) continue;
+            stress+=pairStress(X[u]-X[v],Y[u]-Y[v],neighbourLengths[u][i],1);
+        }
+        for(unsigned i=0;i<m_pivots.size();++i) {
+            const unsigned p=m_pivots[i];
+            if(p==u || areNeighbours(u,p)) continue;
+            const double d=m_pivotDistances[i*n+u];
+            if(d==DBL_MAX) continue;
+            stress+=pivotWeight(i,d)*pairStress(X[u]-X[p],Y[u]-Y[p],d,2);
+        }
+    }
+    return stress;
+}
 /*
  * Returns the optimal step-size in the direction d, given gradient g and
  * hessian H.
@@ -1314,21 +1760,27 @@ double ConstrainedFDLayout::computeStepSize(
 double ConstrainedFDLayout::computeStress() const {
     FILE_LOG(logDEBUG)<<"ConstrainedFDLayout::computeStress()";
     double stress=0;
-    for(unsigned u=0;(u + 1)<n;u++) {
-        for(unsigned v=u+1;v<n;v++) {
-            if (m_useNeighbourStress && neighbours[u][v]!=1) continue;
-            unsigned short p=G[u][v];
-            // no forces between disconnected parts of the graph
-            if(p==0) continue;
-            double rx=X[u]-X[v], ry=Y[u]-Y[v];
-            double l=sqrt(rx*rx+ry*ry);
-            double d=D[u][v];
-            if(l>d && p>1) continue; // no attractive forces required
-            double d2=d*d;
-            double rl=d-l;
-            double s=rl*rl/d2;
-            stress+=s;
-            FILE_LOG(logDEBUG2)<<"s("<<u<<","<<v<<")="<<s;
+    if(usePivotStress()) {
+        stress=computePivotStress();
+    } else if(useStressApproximation()) {
+        stress=computeApproximatePairStress();
+    } else {
+        for(unsigned u=0;(u + 1)<n;u++) {
+            for(unsigned v=u+1;v<n;v++) {
+                if (m_useNeighbourStress && !areNeighbours(u,v)) continue;
+                unsigned short p=G[u][v];
+                // no forces between disconnected parts of the graph
+                if(p==0) continue;
+                double rx=X[u]-X[v], ry=Y[u]-Y[v];
+                double l=sqrt(rx*rx+ry*ry);
+                double d=D[u][v];
+                if(l>d && p>1) continue; // no attractive forces required
+                double d2=d*d;
+                double rl=d-l;
+                double s=rl*rl/d2;
+                stress+=s;
+                FILE_LOG(logDEBUG2)<<"s("<<u<<","<<v<<")="<<s;
+            }
         }
     }
     if(preIteration) {
@@ -1427,6 +1879,31 @@ void ConstrainedFDLayout::outputInstanceToSVG(std::string instanceName)
     maxX += 50;
     maxY += 50;
 
+    // The edges.  Pivot stress doesn't compute G, so these are taken from
+    // the neighbours of each node instead.
+    std::vector<Edge> edges;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        if (usePivotStress())
+        {
+            for (size_t k = 0; k < adjacentNodes[i].size(); ++k)
+            {
+                if (adjacentNodes[i][k] > i)
+                {
+                    edges.push_back(std::make_pair(i, adjacentNodes[i][k]));
+                }
+            }
+            continue;
+        }
+        for (unsigned j = i + 1; j < n; ++j)
+        {
+            if (G[i][j] == 1)
+            {
+                edges.push_back(std::make_pair(i, j));
+            }
+        }
+    }
+
     fprintf(fp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
     fprintf(fp, "<svg xmlns:inkscape=\"http://www.inkscape.org/namespaces/inkscape\" xmlns=\"http://www.w3.org/2000/svg\" width=\"100%%\" height=\"100%%\" viewBox=\"%g %g %g %g\">\n", minX, minY, maxX - minX, maxY - minY);
 
@@ -1451,15 +1928,10 @@ void ConstrainedFDLayout::outputInstanceToSVG(std::string instanceName)
         fprintf(fp, "    rs.push_back(rect);\n\n");
     }
 
-    for (size_t i = 0; i < n; ++i)
+    for (size_t i = 0; i < edges.size(); ++i)
     {
-        for (size_t j =  i + 1; j < n; ++j)
-        {
-            if (G[i][j] == 1)
-            {
-                fprintf(fp, "    es.push_back(std::make_pair(%lu, %lu));\n", i, j);
-            }
-        }
+        fprintf(fp, "    es.push_back(std::make_pair(%u, %u));\n",
+                edges[i].first, edges[i].second);
     }
     fprintf(fp, "\n");
 
@@ -1479,7 +1951,16 @@ void ConstrainedFDLayout::outputInstanceToSVG(std::string instanceName)
         (*c)->printCreationCode(fp);
     }
 
-    fprintf(fp, "    ConstrainedFDLayout alg(rs, es, defaultEdgeLength, eLengths);\n");
+    if (usePivotStress())
+    {
+        fprintf(fp, "    ConstrainedFDLayout alg(rs, es, defaultEdgeLength, "
+                "%u, eLengths);\n", m_pivotCount);
+    }
+    else
+    {
+        fprintf(fp, "    ConstrainedFDLayout alg(rs, es, defaultEdgeLength, "
+                "eLengths);\n");
+    }
     if (clusterHierarchy)
     {
         clusterHierarchy->printCreationCode(fp);
@@ -1523,20 +2004,15 @@ void ConstrainedFDLayout::outputInstanceToSVG(std::string instanceName)
 
     fprintf(fp, "<g inkscape:groupmode=\"layer\" "
             "inkscape:label=\"Edges\">\n");
-    for (size_t i = 0; i < n; ++i)
+    for (size_t i = 0; i < edges.size(); ++i)
     {
-        for (size_t j =  i + 1; j < n; ++j)
-        {
-            if (G[i][j] == 1)
-            {
-                fprintf(fp, "<path d=\"M %g %g L %g %g\" "
-                        "style=\"stroke-width: 1px; stroke: black;\" />\n",
-                        boundingBoxes[i]->getCentreX(),
-                        boundingBoxes[i]->getCentreY(),
-                        boundingBoxes[j]->getCentreX(),
-                        boundingBoxes[j]->getCentreY());
-            }
-        }
+        const unsigned u = edges[i].first, v = edges[i].second;
+        fprintf(fp, "<path d=\"M %g %g L %g %g\" "
+                "style=\"stroke-width: 1px; stroke: black;\" />\n",
+                boundingBoxes[u]->getCentreX(),
+                boundingBoxes[u]->getCentreY(),
+                boundingBoxes[v]->getCentreX(),
+                boundingBoxes[v]->getCentreY());
     }
     fprintf(fp, "</g>\n");
 
@@ -31,6 +31,7 @@
 #include <limits>
 
 #include "libcola/commondefs.h"
+#include "libcola/thread_pool.h"
 #include <libvpsc/pairing_heap.h>
 #include <libvpsc/assertions.h>
 
@@ -106,6 +107,51 @@ void dijkstra(unsigned const s, unsigned const n, T* d,
         std::vector<Edge> const & es, 
         std::valarray<T> const & eweights = std::valarray<T>());
 
+/**
+ * A graph in compressed adjacency form, for repeated shortest path
+ * computations.  The neighbours of node u are targets[i] (with edge
+ * weight weights[i]) for i from offsets[u] to offsets[u+1]-1.
+ */
+template <typename T>
+struct CompactGraph {
+    /**
+     * @param n total number of nodes
+     * @param es edge pairs
+     * @param eweights edge weights, if empty then all weights will be taken as 1
+     */
+    CompactGraph(unsigned const n, std::vector<Edge> const & es,
+            std::valarray<T> const & eweights = std::valarray<T>());
+    unsigned size() const {
+        return offsets.size()-1;
+    }
+    std::vector<unsigned> offsets;
+    std::vector<unsigned> targets;
+    std::vector<T> weights;
+};
+/**
+ * find shortest path lengths from node s to all other nodes
+ * @param s starting node
+ * @param g the graph
+ * @param vs scratch storage, resized as needed and reusable between calls
+ * @param d n vector of path lengths
+ */
+template <typename T>
+void dijkstra(unsigned const s, CompactGraph<T> const & g,
+        std::vector<Node<T> > & vs, T* d);
+/**
+ * find all pairs shortest paths, running the dijkstra searches from each
+ * source concurrently on the threads of the given pool.  Gives the same
+ * result as the serial version.
+ * @param n total number of nodes
+ * @param D n*n matrix of shortest paths
+ * @param es edge pairs
+ * @param eweights edge weights, if empty then all weights will be taken as 1
+ * @param pool the threads to use
+ */
+template <typename T>
+void johnsons(unsigned const n, T** D, std::vector<Edge> const & es,
+        std::valarray<T> const & eweights, cola::ThreadPool& pool);
+
 
 //-----------------------------------------------------------------------------
 // Implementation:
@@ -241,5 +287,96 @@ void johnsons(
     }
 }
 
+template <typename T>
+CompactGraph<T>::CompactGraph(
+        unsigned const n,
+        std::vector<Edge> const & es,
+        std::valarray<T> const & eweights)
+    : offsets(n+1,0),
+      targets(2*es.size()),
+      weights(2*es.size())
+{
+    COLA_ASSERT((eweights.size() == 0) || (eweights.size() == es.size()));
+    for(unsigned i=0;i<es.size();i++) {
+        COLA_ASSERT(es[i].first<n);
+        COLA_ASSERT(es[i].second<n);
+        offsets[es[i].first+1]++;
+        offsets[es[i].second+1]++;
+    }
+    for(unsigned u=0;u<n;u++) {
+        offsets[u+1]+=offsets[u];
+    }
+    // Neighbours are stored in the same order as by dijkstra_init.
+    std::vector<unsigned> next(offsets.begin(),offsets.end()-1);
+    for(unsigned i=0;i<es.size();i++) {
+        unsigned u=es[i].first, v=es[i].second;
+        T w = (eweights.size() > 0) ? eweights[i] : 1;
+        targets[next[u]]=v;
+        weights[next[u]++]=w;
+        targets[next[v]]=u;
+        weights[next[v]++]=w;
+    }
+}
+template <typename T>
+void dijkstra(
+        unsigned const s,
+        CompactGraph<T> const & g,
+        std::vector<Node<T> > & vs,
+        T* d)
+{
+    const unsigned n=g.size();
+    COLA_ASSERT(s<n);
+    vs.resize(n);
+    for(unsigned i=0;i<n;i++) {
+        vs[i].id=i;
+        vs[i].d=std::numeric_limits<T>::max();
+        vs[i].p=nullptr;
+    }
+    vs[s].d=0;
+    PairingHeap<Node<T>*,CompareNodes<T> > Q;
+    for(unsigned i=0;i<n;i++) {
+        vs[i].qnode = Q.insert(&vs[i]);
+    }
+    while(!Q.isEmpty()) {
+        Node<T> *u=Q.extractMin();
+        d[u->id]=u->d;
+        for(unsigned i=g.offsets[u->id];i<g.offsets[u->id+1];i++) {
+            Node<T> *v=&vs[g.targets[i]];
+            T w=g.weights[i];
+            if(u->d!=std::numeric_limits<T>::max()
+               && v->d > u->d+w) {
+                v->p=u;
+                v->d=u->d+w;
+                Q.decreaseKey(v->qnode,v);
+            }
+        }
+    }
+}
+
+template <typename T>
+struct JohnsonsTask {
+    JohnsonsTask(CompactGraph<T> const & g, T** D, unsigned const threads)
+        : g(g), D(D), scratch(threads) {}
+    void operator()(size_t k, unsigned thread) {
+        dijkstra(k,g,scratch[thread],D[k]);
+    }
+    CompactGraph<T> const & g;
+    T** D;
+    std::vector<std::vector<Node<T> > > scratch;
+};
+
+template <typename T>
+void johnsons(
+        unsigned const n,
+        T** D, 
+        std::vector<Edge> const & es,
+        std::valarray<T> const & eweights,
+        cola::ThreadPool& pool) 
+{
+    CompactGraph<T> g(n,es,eweights);
+    JohnsonsTask<T> task(g,D,pool.threadCount());
+    pool.parallelFor(n,std::ref(task));
+}
+
 } //namespace shortest_paths
 #endif //SHORTEST_PATHS_H
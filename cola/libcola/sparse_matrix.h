@@ -34,11 +34,21 @@
 
 #include <valarray>
 #include <map>
+#include <algorithm>
 #include <cstdio>
+#include <limits>
 
 #include "libvpsc/assertions.h"
 
 namespace cola {
+/*
+ * A sparse matrix under construction.  Entries are normally stored in a
+ * std::map, but if a fixed sparsity pattern is given with setPattern()
+ * then entries in the pattern are stored in place in compressed row form.
+ * clear() keeps the pattern, so a matrix with the same structure can be
+ * reassembled each iteration without any allocation.  Entries outside the
+ * pattern are still allowed and are stored in the map.
+ */
 struct SparseMap {
     SparseMap(unsigned n = 0) : n(n) {};
     unsigned n;
@@ -46,15 +56,27 @@ struct SparseMap {
     typedef std::map<SparseIndex,double> SparseLookup;
     typedef SparseLookup::const_iterator ConstIt;
     SparseLookup lookup;
+    // The fixed sparsity pattern, with the same layout as in SparseMatrix.
+    // Columns within each row must be in increasing order.
+    std::valarray<unsigned> patternIA, patternJA;
+    std::valarray<double> patternA;
     double& operator[](const SparseIndex& k) {
-        return lookup[k];
+        return (*this)(k.first,k.second);
     }
     double& operator()(const unsigned i, const unsigned j) {
+        size_t k=patternIndex(i,j);
+        if(k!=notInPattern) {
+            return patternA[k];
+        }
         return lookup[std::make_pair(i,j)]; 
     }
     double getIJ(const unsigned i, const unsigned j) const {
         COLA_ASSERT(i<n);
         COLA_ASSERT(j<n);
+        size_t k=patternIndex(i,j);
+        if(k!=notInPattern) {
+            return patternA[k];
+        }
         ConstIt v=lookup.find(std::make_pair(i,j));
         if(v!=lookup.end()) {
             return v->second;
@@ -62,13 +84,53 @@ struct SparseMap {
         return 0;
     }
     size_t nonZeroCount() const {
-        return lookup.size();
+        return patternA.size()+lookup.size();
+    }
+    bool hasPattern() const {
+        return patternIA.size()==n+1;
+    }
+    void setPattern(std::valarray<unsigned> const & IA,
+            std::valarray<unsigned> const & JA) {
+        COLA_ASSERT(IA.size()==n+1);
+        COLA_ASSERT(IA[n]==JA.size());
+        patternIA.resize(IA.size());
+        patternIA=IA;
+        patternJA.resize(JA.size());
+        patternJA=JA;
+        patternA.resize(JA.size(),0);
+        lookup.clear();
     }
     void resize(unsigned n) {
         this->n = n;
+        clearPattern();
     }
     void clear() {
         lookup.clear();
+        patternA=0;
+    }
+    void clearPattern() {
+        patternIA.resize(0);
+        patternJA.resize(0);
+        patternA.resize(0);
+    }
+private:
+    static const size_t notInPattern=std::numeric_limits<size_t>::max();
+    // Returns the position of (i,j) in the pattern, or notInPattern if it
+    // isn't part of the pattern.
+    size_t patternIndex(const unsigned i, const unsigned j) const {
+        if(!hasPattern()) return notInPattern;
+        COLA_ASSERT(i<n);
+        const unsigned begin=patternIA[i], end=patternIA[i+1];
+        if(end-begin==n) {
+            // Dense row.
+            return static_cast<size_t>(begin)+j;
+        }
+        const unsigned *row=&patternJA[0];
+        const unsigned *found=std::lower_bound(row+begin,row+end,j);
+        if(found!=row+end && *found==j) {
+            return static_cast<size_t>(found-row);
+        }
+        return notInPattern;
     }
 };
 /*
@@ -83,36 +145,63 @@ struct SparseMap {
  */
 class SparseMatrix {
 public:
+    /*
+     * If every entry of m is in its fixed sparsity pattern then the matrix
+     * refers directly to the pattern arrays of m rather than copying them,
+     * so m must not be changed while the matrix is in use.
+     */
     SparseMatrix(SparseMap const & m)
-            : n(m.n), NZ((unsigned)m.nonZeroCount()), sparseMap(m), 
-              A(std::valarray<double>(NZ)), IA(std::valarray<unsigned>(n+1)), JA(std::valarray<unsigned>(NZ)) {
+            : n(m.n), NZ((unsigned)m.nonZeroCount()), sparseMap(m) {
+        if(m.lookup.empty() && m.hasPattern()) {
+            // Everything is in the pattern, so just use it in place.
+            a=arrayStart(m.patternA);
+            ia=arrayStart(m.patternIA);
+            ja=arrayStart(m.patternJA);
+            return;
+        }
+        A.resize(NZ);
+        IA.resize(n+1);
+        JA.resize(NZ);
+        // Merge the pattern entries of each row with those from the map.
         unsigned cnt=0;
-        int lastrow=-1;
-        for(SparseMap::ConstIt i=m.lookup.begin(); i!=m.lookup.end(); i++) {
-            SparseMap::SparseIndex p = i->first;
-            COLA_ASSERT(p.first<n);
-            COLA_ASSERT(p.second<n);
-            A[cnt]=i->second;
-            if((int)p.first!=lastrow) {
-                for(unsigned r=lastrow+1;r<=p.first;r++) {
-                    IA[r]=cnt;
+        SparseMap::ConstIt i=m.lookup.begin();
+        for(unsigned r=0;r<n;r++) {
+            IA[r]=cnt;
+            unsigned k=0, kEnd=0;
+            if(m.hasPattern()) {
+                k=m.patternIA[r];
+                kEnd=m.patternIA[r+1];
+            }
+            while(k<kEnd || (i!=m.lookup.end() && i->first.first==r)) {
+                bool fromMap=(i!=m.lookup.end() && i->first.first==r) &&
+                    (k==kEnd || i->first.second<m.patternJA[k]);
+                if(fromMap) {
+                    COLA_ASSERT(i->first.second<n);
+                    A[cnt]=i->second;
+                    JA[cnt]=i->first.second;
+                    i++;
+                } else {
+                    A[cnt]=m.patternA[k];
+                    JA[cnt]=m.patternJA[k];
+                    k++;
                 }
-                lastrow=p.first;
+                cnt++;
             }
-            JA[cnt]=p.second;
-            cnt++;
-        }
-        for(unsigned r=lastrow+1;r<=n;r++) {
-            IA[r]=NZ;
         }
+        COLA_ASSERT(i==m.lookup.end());
+        COLA_ASSERT(cnt==NZ);
+        IA[n]=NZ;
+        a=arrayStart(A);
+        ia=arrayStart(IA);
+        ja=arrayStart(JA);
     }
     void rightMultiply(std::valarray<double> const & v, std::valarray<double> & r) const {
         COLA_ASSERT(v.size()>=n);
         COLA_ASSERT(r.size()>=n);
         for(unsigned i=0;i<n;i++) {
             r[i]=0;
-            for(unsigned j=IA[i];j<IA[i+1];j++) {
-                r[i]+=A[j]*v[JA[j]];
+            for(unsigned j=ia[i];j<ia[i+1];j++) {
+                r[i]+=a[j]*v[ja[j]];
             }
         }
     }
@@ -131,10 +220,21 @@ public:
         return n;
     }
 private:
+    SparseMatrix(SparseMatrix const &);
+    SparseMatrix& operator=(SparseMatrix const &);
+    template <typename T>
+    static const T* arrayStart(std::valarray<T> const & v) {
+        return v.size()>0 ? &v[0] : nullptr;
+    }
     const unsigned n,NZ;
     SparseMap const & sparseMap;
+    // Storage for the merged arrays, used when some entries of the map
+    // are outside its pattern.
     std::valarray<double> A;
     std::valarray<unsigned> IA, JA;
+    // The arrays in use, either those above or the map's pattern arrays.
+    const double *a;
+    const unsigned *ia, *ja;
 };
 } //namespace cola
 #endif /* _SPARSE_MATRIX_H */
@@ -0,0 +1,105 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libcola - A library providing force-directed network layout using the
+ *           stress-majorization method subject to separation constraints.
+ *
+ * Copyright (C) 2026  agent
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+*/
+
+// Checks that a layout computed with pivot-based sparse stress
+// has a stress close to that of a layout computed exactly, and that it
+// can be written out as SVG.
+
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include "libcola/cola.h"
+using namespace cola;
+
+static std::vector<vpsc::Rectangle*> startingRectangles(unsigned V)
+{
+    srand(42);
+    std::vector<vpsc::Rectangle*> rs;
+    for (unsigned i = 0; i < V; ++i)
+    {
+        double x = (double) rand() / RAND_MAX * 1000;
+        double y = (double) rand() / RAND_MAX * 1000;
+        rs.push_back(new vpsc::Rectangle(x, x + 5, y, y + 5));
+    }
+    return rs;
+}
+
+static double exactStress(std::vector<vpsc::Rectangle*>& rs,
+        std::vector<Edge>& es, double idealLength)
+{
+    ConstrainedFDLayout alg(rs, es, idealLength);
+    return alg.computeStress();
+}
+
+int main(void)
+{
+    const unsigned V = 300;
+    const double idealLength = 40;
+
+    // A grid graph plus some extra edges.
+    std::vector<Edge> es;
+    const unsigned side = 15;
+    for (unsigned i = 0; i < V; ++i)
+    {
+        if ((i % side) + 1 < side && i + 1 < V)
+        {
+            es.push_back(std::make_pair(i, i + 1));
+        }
+        if (i + side < V)
+        {
+            es.push_back(std::make_pair(i, i + side));
+        }
+    }
+    for (unsigned i = 0; i < V; i += 7)
+    {
+        es.push_back(std::make_pair(i, (i * 13 + 5) % V));
+    }
+
+    std::vector<vpsc::Rectangle*> exactRs = startingRectangles(V);
+    ConstrainedFDLayout exact(exactRs, es, idealLength);
+    exact.run();
+    double exactResult = exactStress(exactRs, es, idealLength);
+
+    std::vector<vpsc::Rectangle*> pivotRs = startingRectangles(V);
+    ConstrainedFDLayout pivot(pivotRs, es, idealLength, 60);
+    pivot.run();
+    // The full path length matrices are never computed.
+    bool sparse = pivot.readLinearD().empty();
+    pivot.outputInstanceToSVG("pivotStress01");
+    double pivotResult = exactStress(pivotRs, es, idealLength);
+
+    std::cout << "exact stress: " << exactResult << std::endl;
+    std::cout << "pivot stress layout: " << pivotResult << std::endl;
+
+    for (unsigned i = 0; i < V; ++i)
+    {
+        delete exactRs[i];
+        delete pivotRs[i];
+    }
+
+    if (!sparse || !std::isfinite(pivotResult) ||
+            pivotResult > 1.5 * exactResult)
+    {
+        return 1;
+    }
+    return 0;
+}
@@ -36,6 +36,7 @@
 using namespace boost;
 #endif // TEST_AGAINST_BOOST
 #include <libcola/shortest_paths.h>
+#include <libcola/cola.h>
 #include <cmath>
 #include <time.h>
 #include <assert.h>
@@ -107,6 +108,15 @@ main(void)
     for(unsigned i=0;i<V;i++) {
 	    D2[i]=new double[V];
     }
+    double** D3=new double*[V];
+    for(unsigned i=0;i<V;i++) {
+	    D3[i]=new double[V];
+    }
+    cout<<"Running parallel shortest_paths::johnsons..."<<endl;
+    resetClock();
+    cola::ThreadPool pool(4);
+    shortest_paths::johnsons(V,D3,es,weights,pool);
+    cout<<"  ...done, time="<<getRunTime()<<endl;
     cout<<"Running shortest_paths::floyd_warshall..."<<endl;
     resetClock();
     shortest_paths::floyd_warshall(V,D2,es,weights);
@@ -117,12 +127,33 @@ main(void)
         for (unsigned int j = 0; j < V; ++j) {
 	        if(dump) cout << setw(5) << D1[i][j];
 	        assert(D1[i][j]==D2[i][j]);
+	        assert(D1[i][j]==D3[i][j]);
 #ifdef TEST_AGAINST_BOOST
 	        assert(D[i][j]==D2[i][j]);
 #endif
         }
         if(dump) cout << endl;
     }
+
+    // Layouts compute the same path lengths serially, on a pool with one
+    // thread and on a pool shared between layouts.
+    vector<vpsc::Rectangle*> rs;
+    for(unsigned i=0;i<V;i++) {
+        rs.push_back(new vpsc::Rectangle(i,i+5,i,i+5));
+    }
+    cola::ThreadPool serial(1);
+    assert(serial.threadCount()==1);
+    cola::ConstrainedFDLayout defaultLayout(rs,es,10);
+    cola::ConstrainedFDLayout serialLayout(rs,es,10,cola::EdgeLengths(),
+            nullptr,nullptr,&serial);
+    cola::ConstrainedFDLayout pooledLayout(rs,es,10,cola::EdgeLengths(),
+            nullptr,nullptr,&pool);
+    assert(serialLayout.readLinearD()==defaultLayout.readLinearD());
+    assert(pooledLayout.readLinearD()==defaultLayout.readLinearD());
+    for(unsigned i=0;i<V;i++) {
+        delete rs[i];
+    }
+
 #ifdef TEST_AGAINST_BOOST
     if(dump) {
         ofstream fout("figs/johnson-eg.dot");
@@ -0,0 +1,112 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libcola - A library providing force-directed network layout using the
+ *           stress-majorization method subject to separation constraints.
+ *
+ * Copyright (C) 2026  agent
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+*/
+
+// Checks that a layout computed with the Barnes-Hut stress approximation
+// has a stress close to that of a layout computed exactly, and that it
+// doesn't assemble a dense Hessian.
+
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include "libcola/cola.h"
+using namespace cola;
+
+static std::vector<vpsc::Rectangle*> startingRectangles(unsigned V)
+{
+    srand(42);
+    std::vector<vpsc::Rectangle*> rs;
+    for (unsigned i = 0; i < V; ++i)
+    {
+        double x = (double) rand() / RAND_MAX * 1000;
+        double y = (double) rand() / RAND_MAX * 1000;
+        rs.push_back(new vpsc::Rectangle(x, x + 5, y, y + 5));
+    }
+    return rs;
+}
+
+static double exactStress(std::vector<vpsc::Rectangle*>& rs,
+        std::vector<Edge>& es, double idealLength)
+{
+    ConstrainedFDLayout alg(rs, es, idealLength);
+    return alg.computeStress();
+}
+
+int main(void)
+{
+    const unsigned V = 300;
+    const double idealLength = 40;
+
+    // A grid graph plus some extra edges.
+    std::vector<Edge> es;
+    const unsigned side = 15;
+    for (unsigned i = 0; i < V; ++i)
+    {
+        if ((i % side) + 1 < side && i + 1 < V)
+        {
+            es.push_back(std::make_pair(i, i + 1));
+        }
+        if (i + side < V)
+        {
+            es.push_back(std::make_pair(i, i + side));
+        }
+    }
+    for (unsigned i = 0; i < V; i += 7)
+    {
+        es.push_back(std::make_pair(i, (i * 13 + 5) % V));
+    }
+
+    std::vector<vpsc::Rectangle*> exactRs = startingRectangles(V);
+    ConstrainedFDLayout exact(exactRs, es, idealLength);
+    exact.run();
+    double exactResult = exactStress(exactRs, es, idealLength);
+
+    std::vector<vpsc::Rectangle*> approxRs = startingRectangles(V);
+    ConstrainedFDLayout approx(approxRs, es, idealLength);
+    approx.setStressApproximation(0.7);
+    approx.run();
+    double approxResult = exactStress(approxRs, es, idealLength);
+
+    std::cout << "exact stress: " << exactResult << std::endl;
+    std::cout << "approximate stress: " << approxResult << std::endl;
+    std::cout << "exact Hessian entries: " << exact.hessianEntryCount()
+            << std::endl;
+    std::cout << "approximate Hessian entries: "
+            << approx.hessianEntryCount() << std::endl;
+
+    for (unsigned i = 0; i < V; ++i)
+    {
+        delete exactRs[i];
+        delete approxRs[i];
+    }
+
+    if (!std::isfinite(approxResult) || approxResult > 1.25 * exactResult)
+    {
+        return 1;
+    }
+    // The approximation only has Hessian entries for nearby nodes and
+    // neighbours, rather than for every pair of nodes.
+    if (approx.hessianEntryCount() > exact.hessianEntryCount() / 4)
+    {
+        return 1;
+    }
+    return 0;
+}
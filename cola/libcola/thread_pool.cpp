@@ -0,0 +1,133 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libcola - A library providing force-directed network layout using the
+ *           stress-majorization method subject to separation constraints.
+ *
+ * Copyright (C) 2026  agent
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+*/
+
+#include <algorithm>
+
+#include "libcola/thread_pool.h"
+
+namespace cola {
+
+ThreadPool::ThreadPool(unsigned threadCount)
+    : m_task(nullptr),
+      m_taskCount(0),
+      m_nextTask(0),
+      m_generation(0),
+      m_activeWorkers(0),
+      m_stopping(false)
+{
+    if (threadCount == 0)
+    {
+        // May return zero if the value is not computable.
+        threadCount = std::thread::hardware_concurrency();
+    }
+    threadCount = std::max(threadCount, 1u);
+    m_workers.reserve(threadCount - 1);
+    for (unsigned t = 1; t < threadCount; ++t)
+    {
+        m_workers.push_back(std::thread(&ThreadPool::workerLoop, this, t));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_workAvailable.notify_all();
+    for (size_t t = 0; t < m_workers.size(); ++t)
+    {
+        m_workers[t].join();
+    }
+}
+
+unsigned ThreadPool::threadCount(void) const
+{
+    return m_workers.size() + 1;
+}
+
+void ThreadPool::parallelFor(size_t taskCount, const Task& task)
+{
+    if (m_workers.empty() || (taskCount <= 1))
+    {
+        for (size_t i = 0; i < taskCount; ++i)
+        {
+            task(i, 0);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_taskCount = taskCount;
+        m_nextTask = 0;
+        m_activeWorkers = m_workers.size();
+        ++m_generation;
+    }
+    m_workAvailable.notify_all();
+
+    runTasks(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_activeWorkers > 0)
+    {
+        m_workDone.wait(lock);
+    }
+    m_task = nullptr;
+}
+
+void ThreadPool::workerLoop(unsigned threadIndex)
+{
+    unsigned generation = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        while (!m_stopping && (m_generation == generation))
+        {
+            m_workAvailable.wait(lock);
+        }
+        if (m_stopping)
+        {
+            return;
+        }
+        generation = m_generation;
+
+        lock.unlock();
+        runTasks(threadIndex);
+        lock.lock();
+
+        if (--m_activeWorkers == 0)
+        {
+            m_workDone.notify_one();
+        }
+    }
+}
+
+void ThreadPool::runTasks(unsigned threadIndex)
+{
+    size_t index;
+    while ((index = m_nextTask.fetch_add(1)) < m_taskCount)
+    {
+        (*m_task)(index, threadIndex);
+    }
+}
+
+} // namespace cola
@@ -0,0 +1,92 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libcola - A library providing force-directed network layout using the
+ *           stress-majorization method subject to separation constraints.
+ *
+ * Copyright (C) 2026  agent
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+*/
+
+#ifndef COLA_THREAD_POOL_H
+#define COLA_THREAD_POOL_H
+
+#include <cstddef>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cola {
+
+/**
+ * @brief  A fixed set of worker threads for running independent tasks.
+ *
+ * The threads are created once, when the pool is constructed, and are
+ * reused by each call to parallelFor().
+ */
+class ThreadPool {
+public:
+    typedef std::function<void(size_t, unsigned)> Task;
+
+    /**
+     * @brief  Constructs a thread pool.
+     *
+     * @param[in] threadCount  The total number of threads to use, including
+     *                         the calling thread.  If this is zero then the
+     *                         number of hardware threads is used.
+     */
+    explicit ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool();
+
+    /**
+     * @brief  Returns the total number of threads, including the calling
+     *         thread.  This is always at least one.
+     */
+    unsigned threadCount(void) const;
+
+    /**
+     * @brief  Calls task(taskIndex, threadIndex) for each taskIndex from 0
+     *         to taskCount - 1, distributing the calls over the threads in
+     *         the pool, and returns once they are all complete.
+     *
+     * The calling thread takes part as thread zero.  threadIndex can be used
+     * to index per-thread scratch storage, and is always less than
+     * threadCount().  Tasks must be independent and must not throw.
+     */
+    void parallelFor(size_t taskCount, const Task& task);
+
+private:
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    void workerLoop(unsigned threadIndex);
+    void runTasks(unsigned threadIndex);
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_workDone;
+    const Task *m_task;
+    size_t m_taskCount;
+    std::atomic<size_t> m_nextTask;
+    unsigned m_generation;
+    unsigned m_activeWorkers;
+    bool m_stopping;
+};
+
+} // namespace cola
+
+#endif // COLA_THREAD_POOL_H